@@ -3,3 +3,6 @@ option(ENABLE_SANITIZER_LEAK "Enable leak sanitizer" OFF)
 option(ENABLE_SANITIZER_UNDEFINED "Enable undefined behavior sanitizer" OFF)
 option(ENABLE_SANITIZER_THREAD "Enable thread sanitizer" OFF)
 option(ENABLE_SANITIZER_MEMORY "Enable memory sanitizer" OFF)
+
+option(ENABLE_AVX "Build with AVX code paths, binary requires cpu with AVX support" OFF)
+option(ENABLE_AVX2 "Build with AVX2 and FMA code paths, implies AVX, binary requires cpu with AVX2 support" OFF)
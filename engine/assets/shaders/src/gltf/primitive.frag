@@ -1,4 +1,5 @@
 #version 450
+#extension GL_EXT_nonuniform_qualifier : require
 
 layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec4 inTangent;
@@ -6,43 +7,60 @@ layout(location = 2) in vec3 inNormal;
 layout(location = 3) in vec2 inUV0;
 layout(location = 4) in vec2 inUV1;
 layout(location = 5) in vec4 inColor0;
+layout(location = 6) flat in uint inMaterialIndex;
 
 layout(location = 0) out vec4 outColor;
 
-layout(set = 1, binding = 0) uniform sampler2D textures[5]; // 0 - base, 1 - metallicRoughness, 2 - normal, 3 - occlusion, 4 - emissive
+// bindless heap
+layout(set = 1, binding = 0) uniform texture2D textures[];
+layout(set = 1, binding = 1) uniform sampler samplers[];
 
-layout(set = 1, binding = 1) uniform readonly Material
+struct Material
 {
-    vec3 emissiveFactor;
     vec4 baseColorFactor;
+    vec4 emissiveFactor;
     float metallicFactor;
     float roughnessFactor;
     float normalScale;
 
+    // 0 - base, 1 - metallicRoughness, 2 - normal, 3 - occlusion, 4 - emissive
     // UV sets either 0-1 or -1 (no texture)
-    int baseColorTextureUVSet;
-    int metallicRoughnessTextureUVSet;
-    int normalTextureUVSet;
-    int occlusionTextureUVSet;
-    int emissiveTextureUVSet;
-} material;
+    int textureUVSets[5];
+    uint textureIndices[5];
+    uint samplerIndices[5];
+};
+
+layout(std430, set = 1, binding = 2) readonly buffer Materials
+{
+    Material materials[];
+} materials;
+
+vec4 sampleTexture(Material material, int slot, vec2 uv)
+{
+    return texture(sampler2D(textures[nonuniformEXT(material.textureIndices[slot])], samplers[nonuniformEXT(material.samplerIndices[slot])]), uv);
+}
+
+vec2 selectUV(int uvSet)
+{
+    return (uvSet == 0) ? inUV0 : inUV1;
+}
 
 void main()
 {
+    Material material = materials.materials[inMaterialIndex];
+
     // Base Color
     vec4 baseColor = material.baseColorFactor;
-    if (material.baseColorTextureUVSet >= 0)
+    if (material.textureUVSets[0] >= 0)
     {
-        vec2 baseUV = (material.baseColorTextureUVSet == 0) ? inUV0 : inUV1;
-        baseColor *= texture(textures[0], baseUV);
+        baseColor *= sampleTexture(material, 0, selectUV(material.textureUVSets[0]));
     }
 
     // Metallic & Roughness
-    vec2 metallicRoughnessUV = (material.metallicRoughnessTextureUVSet == 0) ? inUV0 : inUV1;
     vec2 metallicRoughnessValues = vec2(material.metallicFactor, material.roughnessFactor);
-    if (material.metallicRoughnessTextureUVSet >= 0)
+    if (material.textureUVSets[1] >= 0)
     {
-        vec4 metallicRoughnessTex = texture(textures[1], metallicRoughnessUV);
+        vec4 metallicRoughnessTex = sampleTexture(material, 1, selectUV(material.textureUVSets[1]));
         metallicRoughnessValues = metallicRoughnessTex.rg;
     }
     float metallic = metallicRoughnessValues.x;
@@ -50,28 +68,25 @@ void main()
 
     // Normal Map
     vec3 normal = normalize(inNormal);
-    if (material.normalTextureUVSet >= 0)
+    if (material.textureUVSets[2] >= 0)
     {
-        vec2 normalUV = (material.normalTextureUVSet == 0) ? inUV0 : inUV1;
-        vec3 normalTex = texture(textures[2], normalUV).rgb;
+        vec3 normalTex = sampleTexture(material, 2, selectUV(material.textureUVSets[2])).rgb;
         normalTex = normalTex * 2.0 - 1.0; // Convert to [-1,1] range
         normal = normalize(normal + material.normalScale * normalTex);
     }
 
     // Occlusion (Ambient Occlusion)
     float occlusion = 1.0;
-    if (material.occlusionTextureUVSet >= 0)
+    if (material.textureUVSets[3] >= 0)
     {
-        vec2 occlusionUV = (material.occlusionTextureUVSet == 0) ? inUV0 : inUV1;
-        occlusion = texture(textures[3], occlusionUV).r;
+        occlusion = sampleTexture(material, 3, selectUV(material.textureUVSets[3])).r;
     }
 
     // Emissive Color
-    vec3 emissive = material.emissiveFactor;
-    if (material.emissiveTextureUVSet >= 0)
+    vec3 emissive = material.emissiveFactor.rgb;
+    if (material.textureUVSets[4] >= 0)
     {
-        vec2 emissiveUV = (material.emissiveTextureUVSet == 0) ? inUV0 : inUV1;
-        emissive *= texture(textures[4], emissiveUV).rgb;
+        emissive *= sampleTexture(material, 4, selectUV(material.textureUVSets[4])).rgb;
     }
 
     // Final Color (No lighting, just textures & factors)
@@ -13,23 +13,41 @@ layout(location = 2) out vec3 outNormal;
 layout(location = 3) out vec2 outUV0;
 layout(location = 4) out vec2 outUV1;
 layout(location = 5) out vec4 outColor0;
+layout(location = 6) flat out uint outMaterialIndex;
 
 layout(set = 0, binding = 0) uniform readonly ViewProj
 {
     mat4 viewProj;
 } viewProj;
 
-layout(set = 0, binding = 1) uniform readonly Model
+// matches ObjectData of MeshRenderSystem and Object of gltf/cull.comp
+struct Object
 {
     mat4 model;
-} model;
+    vec4 boundsCenter;
+    vec4 boundsExtent;
+    uint materialIndex;
+    uint indexCount;
+    uint firstIndex;
+    int vertexOffset;
+    uint drawGroup;
+    uint padding[3];
+};
+
+// indexed with firstInstance of draw
+layout(std430, set = 0, binding = 1) readonly buffer Objects
+{
+    Object objects[];
+} objects;
 
 void main() {
-    gl_Position = viewProj.viewProj * model.model * vec4(inPosition, 1.0);
+    Object object = objects.objects[gl_InstanceIndex];
+    gl_Position = viewProj.viewProj * object.model * vec4(inPosition, 1.0);
     outPosition = inPosition;
     outTangent = inTangent;
     outNormal = inNormal;
     outUV0 = inUV0;
     outUV1 = inUV1;
     outColor0 = inColor0;
+    outMaterialIndex = object.materialIndex;
 }
\ No newline at end of file
@@ -1,12 +1,21 @@
 #version 450
+#extension GL_EXT_nonuniform_qualifier : require
 
 layout(location = 0) in vec3 inUVW;
 
 layout(location = 0) out vec4 outColor;
 
-layout(set = 1, binding = 0) uniform samplerCube cubemap;
+// bindless heap, cube views share binding with 2D ones
+layout(set = 1, binding = 0) uniform textureCube textures[];
+layout(set = 1, binding = 1) uniform sampler samplers[];
+
+layout(push_constant) uniform Skybox
+{
+    uint textureIndex;
+    uint samplerIndex;
+} skybox;
 
 void main()
 {
-	outColor = texture(cubemap, inUVW);
-}
\ No newline at end of file
+	outColor = texture(samplerCube(textures[skybox.textureIndex], samplers[skybox.samplerIndex]), inUVW);
+}
@@ -1,12 +1,17 @@
 #version 450
+#extension GL_EXT_nonuniform_qualifier : require
 
 layout(location = 0) in vec2 inUV;
+layout(location = 1) flat in uint inTextureIndex;
+layout(location = 2) flat in uint inSamplerIndex;
 
 layout(location = 0) out vec4 outColor;
 
-layout(set = 1, binding = 0) uniform sampler2D texSampler;
+// bindless heap
+layout(set = 1, binding = 0) uniform texture2D textures[];
+layout(set = 1, binding = 1) uniform sampler samplers[];
 
 void main()
 {
-    outColor = texture(texSampler, inUV);
-}
\ No newline at end of file
+    outColor = texture(sampler2D(textures[nonuniformEXT(inTextureIndex)], samplers[nonuniformEXT(inSamplerIndex)]), inUV);
+}
@@ -4,18 +4,34 @@ layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec2 inUV;
 
 layout(location = 0) out vec2 outUV;
+layout(location = 1) flat out uint outTextureIndex;
+layout(location = 2) flat out uint outSamplerIndex;
 
 layout(set = 0, binding = 0) uniform readonly ViewProj
 {
     mat4 viewProj;
 } viewProj;
 
-layout(set = 0, binding = 1) uniform readonly Model
+struct SpriteInstance
 {
     mat4 model;
-} model;
+    vec4 srcRect;
+    vec4 dstRect;
+    uint textureIndex;
+    uint samplerIndex;
+};
+
+// per frame instance data, indexed with gl_InstanceIndex
+layout(std430, set = 0, binding = 1) readonly buffer Instances
+{
+    SpriteInstance instances[];
+} instances;
 
 void main() {
-    gl_Position = viewProj.viewProj * model.model * vec4(inPosition, 1.0);
-    outUV = inUV;
-}
\ No newline at end of file
+    SpriteInstance instance = instances.instances[gl_InstanceIndex];
+    vec2 position = inPosition.xy * instance.dstRect.zw + instance.dstRect.xy;
+    gl_Position = viewProj.viewProj * instance.model * vec4(position, inPosition.z, 1.0);
+    outUV = instance.srcRect.xy + inUV * instance.srcRect.zw;
+    outTextureIndex = instance.textureIndex;
+    outSamplerIndex = instance.samplerIndex;
+}
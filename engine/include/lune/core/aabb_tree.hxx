@@ -0,0 +1,98 @@
+#pragma once
+
+#include "lune/core/culling.hxx"
+#include "lune/core/math.hxx"
+#include "lune/lune.hxx"
+
+#include <vector>
+
+namespace lune
+{
+	// bounding volume hierarchy of boxes that come, go and move, in manner of dynamic aabb trees of physics engines
+	// leaves keep boxes grown by margin so small moves don't touch tree, leaf reinserted once its box escapes
+	// insertion descends by surface area cost, rotations on the way up keep tree balanced
+	// queries test stored boxes, results may include objects up to margin away
+	class AabbTree
+	{
+	public:
+		static constexpr uint32 NullNode = ~0u;
+
+		struct RayHit
+		{
+			uint64 userData{};
+			float distance{}; // along direction, zero when ray starts inside box
+		};
+
+		// leaf added to tree right away, returned proxy valid until removed
+		uint32 insert(const BoundingBox& box, uint64 userData, float margin = 0.f);
+
+		// leaf left out of tree until next rebuild, way to add many at once
+		uint32 insertDeferred(const BoundingBox& box, uint64 userData, float margin = 0.f);
+
+		void remove(uint32 proxy);
+
+		// false while box stays inside stored one, leaf reinserted with new margin otherwise
+		bool move(uint32 proxy, const BoundingBox& box, float margin);
+
+		// builds tree again top down from all leaves, splitting at median of longest axis
+		void rebuild();
+
+		void clear();
+
+		uint64 getUserData(uint32 proxy) const { return mNodes[proxy].userData; }
+		const BoundingBox& getBox(uint32 proxy) const { return mNodes[proxy].box; }
+		uint32 getProxyCount() const { return mProxyCount; }
+		uint32 getHeight() const { return mRoot != NullNode ? mNodes[mRoot].height : 0; }
+		BoundingBox getBounds() const { return mRoot != NullNode ? mNodes[mRoot].box : BoundingBox{}; }
+
+		// user data of leaves overlapping query, appended to out vector
+		void queryBox(const BoundingBox& box, std::vector<uint64>& outUserData) const;
+		void querySphere(const BoundingSphere& sphere, std::vector<uint64>& outUserData) const;
+		void queryFrustum(const Frustum& frustum, std::vector<uint64>& outUserData) const;
+		void queryRay(const lnm::vec3& origin, const lnm::vec3& direction, float maxDistance, std::vector<uint64>& outUserData) const;
+
+		// nearest leaf box hit within max distance, direction doesn't have to be normalized, distance in its units
+		bool raycast(const lnm::vec3& origin, const lnm::vec3& direction, float maxDistance, RayHit& outHit) const;
+
+	private:
+		struct Node
+		{
+			BoundingBox box{};
+			uint64 userData{};
+			uint32 parent{NullNode}; // next free node while in free list
+			uint32 child1{NullNode};
+			uint32 child2{NullNode};
+			int32 height{}; // zero for leaves, -1 for free nodes
+
+			bool isLeaf() const { return child1 == NullNode; }
+		};
+
+		uint32 allocateNode();
+		void freeNode(uint32 node);
+
+		void insertLeaf(uint32 leaf);
+		void removeLeaf(uint32 leaf);
+
+		// rotates subtree rooted at node if its children heights differ by more than one, returns new subtree root
+		uint32 balance(uint32 node);
+
+		// walks from node up to root refitting boxes and heights
+		void refitAncestors(uint32 node);
+
+		uint32 buildTopDown(uint32* leaves, uint32 count);
+
+		// classify tells if node box is outside, intersecting or containing query
+		template <typename Classify>
+		void queryTree(Classify&& classify, std::vector<uint64>& outUserData) const;
+
+		// pushes all leaves of subtree without further tests
+		void collectLeaves(uint32 node, std::vector<uint64>& outUserData) const;
+
+		std::vector<Node> mNodes{};
+		uint32 mRoot{NullNode};
+		uint32 mFreeList{NullNode};
+		uint32 mProxyCount{};
+
+		std::vector<uint32> mDeferredLeaves{};
+	};
+} // namespace lune
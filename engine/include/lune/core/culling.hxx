@@ -0,0 +1,72 @@
+#pragma once
+
+#include "lune/core/math.hxx"
+#include "lune/lune.hxx"
+
+#include <array>
+#include <vector>
+
+namespace lune
+{
+	struct BoundingBox
+	{
+		lnm::vec3 min{};
+		lnm::vec3 max{};
+
+		lnm::vec3 getCenter() const { return (min + max) * 0.5f; }
+		lnm::vec3 getExtent() const { return (max - min) * 0.5f; }
+
+		// box enclosing this one after transformation
+		BoundingBox transform(const lnm::mat4& matrix) const;
+	};
+
+	struct BoundingSphere
+	{
+		lnm::vec3 center{};
+		float radius{};
+	};
+
+	struct Frustum
+	{
+		enum Plane : uint8
+		{
+			Left,
+			Right,
+			Bottom,
+			Top,
+			Near,
+			Far,
+			Count
+		};
+
+		// normal (xyz) pointing inside and distance (w), normalized
+		std::array<lnm::vec4, Plane::Count> planes{};
+
+		// clip space depth expected in -w..w range, as lnm::perspective produces
+		static Frustum fromViewProjection(const lnm::mat4& viewProj);
+
+		bool intersects(const BoundingBox& box) const;
+		bool intersects(const BoundingSphere& sphere) const;
+	};
+
+	// world space boxes stored as separate arrays of center and extent components
+	// tested against frustum few at once, 8 with AVX, 4 with SSE
+	class FrustumCuller
+	{
+	public:
+		void resize(uint32 count);
+		uint32 getCount() const { return mCount; }
+
+		void setBox(uint32 index, const BoundingBox& box);
+
+		// writes 1 for boxes intersecting frustum and 0 for ones fully outside, returns number of visible boxes
+		uint32 cull(const Frustum& frustum, std::vector<uint8>& outVisible) const;
+
+	private:
+		uint32 mCount{};
+
+		// padded to multiple of widest lane count, padding results ignored
+		std::array<std::vector<float>, 3> mCenters{};
+		std::array<std::vector<float>, 3> mExtents{};
+	};
+} // namespace lune
@@ -1,9 +1,12 @@
 #pragma once
 
+#include "lune/core/job_subsystem.hxx"
 #include "lune/lune.hxx"
 
+#include <chrono>
 #include <filesystem>
 #include <memory>
+#include <string>
 #include <string_view>
 #include <vector>
 
@@ -16,13 +19,114 @@ namespace tinygltf
 namespace lune
 {
 	class Scene;
-}
+	struct PreparedModel;
+
+	namespace lmesh
+	{
+		struct Model;
+	} // namespace lmesh
+} // namespace lune
 
 namespace lune
 {
 	namespace gltf
 	{
-		extern "C++" std::vector<uint64> loadInScene(std::filesystem::path gltfScene, std::string_view alias, class Scene* scene);
+		struct LoadOptions
+		{
+			// cpu copy of triangles, needed by occluders and raycasts against triangles
+			bool keepTriangles{true};
+
+			// bounding volume hierarchy per primitive for raycasts, built on job threads, needs triangles kept
+			bool buildTriangleBvh{};
+
+			// .lmesh next to model used instead of it, written by mesh cooker tool, .lmesh path loaded as it is
+			bool preferCookedMeshes{true};
+
+			// block compressed .ktx2 next to image used instead of it, written by texture cooker tool
+			bool preferCookedTextures{true};
+
+			// textures start with small mips resident, finer ones streamed in as they grow on screen
+			// whole mip chain of each texture kept on cpu
+			bool streamTextures{};
+
+			// async loads only, uploads of model queued with it, higher drained first, see AsyncLoad::setPriority
+			float uploadPriority{};
+		};
+
+		// parses .gltf or .glb model and converts its meshes, nodes and materials into tables of engine mesh format
+		// used by loader when there is no cooked file and by mesh cooker tool
+		extern "C++" bool convert(const std::filesystem::path& gltfScene, lmesh::Model& outModel);
+
+		extern "C++" std::vector<uint64> loadInScene(std::filesystem::path gltfScene, std::string_view alias, class Scene* scene, const LoadOptions& options = {});
+
+		enum class LoadState : uint8
+		{
+			Loading = 0,
+			Loaded = 1,
+			Failed = 2
+		};
+
+		using SharedAsyncLoad = std::shared_ptr<class AsyncLoad>;
+
+		// file parsed, images decoded and vertices converted on job threads
+		// then primitives and textures uploaded few a frame by upload scheduler, entities spawned once all of them completed
+		// root entities known from there on
+		extern "C++" SharedAsyncLoad loadInSceneAsync(std::filesystem::path gltfScene, std::string_view alias, class Scene* scene, const LoadOptions& options = {});
+
+		// called by engine every frame before scenes update, queues uploads of loads read by then within small time budget
+		// and spawns entities of ones with uploads done
+		extern "C++" void finalizeLoads();
+
+		// waits for jobs of loads still being read and drops them, called by engine on shutdown
+		extern "C++" void cancelLoads();
+
+		class AsyncLoad final
+		{
+		public:
+			AsyncLoad() = default;
+			AsyncLoad(const AsyncLoad&) = delete;
+			AsyncLoad(AsyncLoad&&) = delete;
+			~AsyncLoad();
+
+			// model getting close to camera may jump queue of uploads
+			void setPriority(float priority);
+
+			LoadState getState() const { return mState; }
+			bool isDone() const { return mState != LoadState::Loading; }
+
+			// empty till loaded
+			const std::vector<uint64>& getRootEntities() const { return mRootEntities; }
+
+		private:
+			friend SharedAsyncLoad loadInSceneAsync(std::filesystem::path gltfScene, std::string_view alias, class Scene* scene, const LoadOptions& options);
+			friend void finalizeLoads();
+			friend void cancelLoads();
+
+			// resources without data created right away, rest of them by upload jobs
+			void queueUploads();
+
+			// once upload jobs ran, materials created and entities spawned
+			void finish();
+
+			std::filesystem::path mPath{};
+			std::string mAlias{};
+			class Scene* mScene{};
+			LoadOptions mOptions{};
+
+			// written by job, read once counter done
+			std::unique_ptr<PreparedModel> mPrepared{};
+			bool mPrepareResult{};
+			JobCounter mCounter{};
+
+			uint64 mUploadGroup{};
+			uint32 mPendingUploads{};
+			bool mUploadsQueued{};
+			uint64 mUploadTicket{}; // covers all uploads of load, entities spawned once complete
+			std::chrono::steady_clock::time_point mBeginTime{};
+
+			LoadState mState{LoadState::Loading};
+			std::vector<uint64> mRootEntities{};
+		};
 	}; // namespace gltf
 
 } // namespace lune
\ No newline at end of file
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "lune/lune.hxx"
+
+#include "engine_subsystem.hxx"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace lune
+{
+	// number of jobs still running, jobs submitted with it decrement it once done
+	struct JobCounter
+	{
+		std::atomic<uint32> pending{};
+
+		bool isDone() const { return pending.load(std::memory_order_acquire) == 0; }
+	};
+
+	// worker threads running jobs from single shared queue
+	// thread waiting for its jobs runs queued ones of same counter meanwhile, so jobs may wait on jobs they submit
+	// long jobs of others, like model loads, never end up on thread that only waits for its own short ones
+	class JobSubsystem final : public EngineSubsystem
+	{
+	public:
+		using Job = std::function<void()>;
+
+		JobSubsystem() = default;
+		~JobSubsystem();
+
+		virtual bool allowInitialize() override { return true; };
+		virtual void initialize() override;
+
+		// threads besides calling one, zero on single core machines
+		uint32 getWorkerCount() const { return mWorkers.size(); }
+
+		// queues job for workers, counter incremented right away
+		void submit(Job job, JobCounter* counter = nullptr);
+
+		// runs queued jobs of counter on calling thread until it drops to zero
+		void wait(const JobCounter& counter);
+
+		// calls func with sub ranges of at most batch size, on workers and calling thread, returns once all are done
+		void parallelFor(uint32 count, uint32 batchSize, const std::function<void(uint32 begin, uint32 end)>& func);
+
+	private:
+		struct QueuedJob
+		{
+			Job job{};
+			JobCounter* counter{};
+		};
+
+		void workerLoop(std::stop_token stopToken);
+
+		// pops and runs oldest job of counter, false if none queued
+		bool runQueuedJob(const JobCounter& counter);
+
+		void runJob(QueuedJob& queuedJob);
+
+		std::mutex mMutex{};
+		std::condition_variable_any mCondition{};
+		std::deque<QueuedJob> mJobs{};
+
+		std::vector<std::jthread> mWorkers{};
+	};
+} // namespace lune
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "lune/lune.hxx"
+#include "lune/vulkan/vulkan_core.hxx"
+
+#include <filesystem>
+#include <vector>
+
+namespace lune
+{
+	// texture as stored in khronos texture 2 container, supercompressed files not supported
+	struct Ktx2Texture
+	{
+		vk::Format format{};
+		uint32 width{};
+		uint32 height{};
+		uint32 faceCount{1}; // six for cubemaps
+
+		// largest first, faces of each level one after another
+		std::vector<std::vector<uint8>> levels{};
+
+		// bytes of 4x4 block for block compressed formats, zero for others
+		static uint32 getBlockSize(vk::Format format);
+
+		// bytes of single face of level, blocks on edges count whole
+		static uint64 getFaceSize(vk::Format format, uint32 width, uint32 height);
+	};
+
+	namespace ktx2
+	{
+		// false when file missing, malformed or supercompressed
+		extern "C++" bool read(const std::filesystem::path& path, Ktx2Texture& outTexture);
+
+		// data format descriptor written only for RGBA8 and BC1, BC3, BC4, BC5 and BC7 formats, false for others
+		extern "C++" bool write(const std::filesystem::path& path, const Ktx2Texture& texture);
+	} // namespace ktx2
+} // namespace lune
@@ -0,0 +1,141 @@
+#pragma once
+
+#include "lune/core/culling.hxx"
+#include "lune/core/mapped_file.hxx"
+#include "lune/core/math.hxx"
+#include "lune/lune.hxx"
+
+#include <array>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace lune
+{
+	// engine mesh format, model cooked from gltf by mesh cooker tool
+	// tables and data laid out as used at runtime, file mapped and uploaded without parsing
+	// vertices are Vertex343224, indices 16 or 32 bit, all offsets in bytes
+	namespace lmesh
+	{
+		struct Primitive
+		{
+			uint32 vertexOffset{}; // into vertex data, multiple of vertex size
+			uint32 vertexCount{};
+			uint32 indexOffset{}; // into index data, multiple of index size
+			uint32 indexCount{}; // zero for non indexed
+			uint32 indexSizeof{};
+			int32 material{-1};
+			int32 mode{}; // gltf primitive mode
+			uint32 padding{};
+
+			BoundingBox box{};
+			BoundingSphere sphere{};
+		};
+
+		// primitives of mesh follow one another
+		struct Mesh
+		{
+			uint32 firstPrimitive{};
+			uint32 primitiveCount{};
+		};
+
+		struct Node
+		{
+			lnm::vec3 translation{};
+			lnm::quat rotation{1.f, 0.f, 0.f, 0.f};
+			lnm::vec3 scale{1.f};
+			int32 mesh{-1};
+			uint32 firstChild{}; // into children table
+			uint32 childCount{};
+			uint32 padding{};
+		};
+
+		struct Material
+		{
+			lnm::vec4 baseColorFactor{1.f};
+			lnm::vec4 emissiveFactor{0.f}; // w unused
+			float metallicFactor{1.f};
+			float roughnessFactor{1.f};
+			float normalScale{1.f};
+			uint32 doubleSided{};
+
+			// same order as texture slots of ShaderMaterialData
+			std::array<int32, 5> textures{-1, -1, -1, -1, -1};
+			std::array<int32, 5> texCoords{};
+		};
+
+		struct Texture
+		{
+			int32 image{-1};
+			int32 sampler{-1};
+		};
+
+		// gltf filter values, -1 when not set
+		struct Sampler
+		{
+			int32 magFilter{-1};
+			int32 minFilter{-1};
+		};
+
+		// either uri relative to model file, within strings, or encoded image file embedded in model, within image data
+		struct Image
+		{
+			uint32 uriOffset{};
+			uint32 uriSize{};
+			uint32 dataOffset{};
+			uint32 dataSize{}; // zero for images referenced by uri
+		};
+
+		// tables of model somewhere else, in mapped file or Model
+		struct ModelView
+		{
+			std::span<const uint8> verticies{};
+			std::span<const uint8> indices{};
+			std::span<const Primitive> primitives{};
+			std::span<const Mesh> meshes{};
+			std::span<const Node> nodes{};
+			std::span<const uint32> children{};
+			std::span<const uint32> roots{}; // of all scenes of source model
+			std::span<const Material> materials{};
+			std::span<const Texture> textures{};
+			std::span<const Sampler> samplers{};
+			std::span<const Image> images{};
+			std::string_view strings{};
+			std::span<const uint8> imageData{};
+
+			std::string_view getImageUri(const Image& image) const { return strings.substr(image.uriOffset, image.uriSize); }
+			std::span<const uint8> getImageData(const Image& image) const { return imageData.subspan(image.dataOffset, image.dataSize); }
+
+			// references between tables and ranges of primitives within data
+			bool isValid() const;
+		};
+
+		// tables owned, as built by converting gltf
+		struct Model
+		{
+			std::vector<uint8> verticies{};
+			std::vector<uint8> indices{};
+			std::vector<Primitive> primitives{};
+			std::vector<Mesh> meshes{};
+			std::vector<Node> nodes{};
+			std::vector<uint32> children{};
+			std::vector<uint32> roots{};
+			std::vector<Material> materials{};
+			std::vector<Texture> textures{};
+			std::vector<Sampler> samplers{};
+			std::vector<Image> images{};
+			std::string strings{};
+			std::vector<uint8> imageData{};
+
+			ModelView getView() const;
+		};
+
+		// tables point into mapped file, valid as long as it stays open
+		// false when file missing, malformed or written by different version
+		extern "C++" bool read(const std::filesystem::path& path, MappedFile& outFile, ModelView& outModel);
+
+		extern "C++" bool write(const std::filesystem::path& path, const ModelView& model);
+	} // namespace lmesh
+} // namespace lune
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "lune/lune.hxx"
+
+#include <filesystem>
+#include <span>
+
+namespace lune
+{
+	// whole file mapped read only, pages read from disk as they are touched and shared with page cache
+	class MappedFile final
+	{
+	public:
+		MappedFile() = default;
+		MappedFile(const MappedFile&) = delete;
+		MappedFile(MappedFile&& other) noexcept;
+		MappedFile& operator=(MappedFile&& other) noexcept;
+		~MappedFile();
+
+		// false when file missing or empty, previous mapping closed either way
+		bool open(const std::filesystem::path& path);
+		void close();
+
+		bool isOpen() const { return mData != nullptr; }
+
+		const uint8* getData() const { return mData; }
+		size_t getSize() const { return mSize; }
+		std::span<const uint8> getSpan() const { return std::span<const uint8>(mData, mSize); }
+
+	private:
+		const uint8* mData{};
+		size_t mSize{};
+
+#ifdef _WIN32
+		void* mFile{};
+		void* mMapping{};
+#endif
+	};
+} // namespace lune
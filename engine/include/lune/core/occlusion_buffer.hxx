@@ -0,0 +1,108 @@
+#pragma once
+
+#include "lune/core/culling.hxx"
+#include "lune/core/math.hxx"
+#include "lune/core/triangle_mesh.hxx"
+#include "lune/lune.hxx"
+
+#include <array>
+#include <vector>
+
+namespace lune
+{
+	// low resolution depth rasterized on cpu from few occluder meshes, boxes tested against it
+	// after masked occlusion culling: instead of depth per pixel each 8x4 tile keeps coverage mask of working layer
+	// with its farthest depth and reference depth valid for whole tile, coverage of row of tile computed 8 pixels at once
+	// depth is clip z / w, -1 near and 1 far, occluders only ever make it nearer so tests stay conservative
+	class OcclusionBuffer
+	{
+	public:
+		static constexpr uint32 TileWidth = 8;
+		static constexpr uint32 TileHeight = 4;
+
+		OcclusionBuffer() = default;
+
+		// rounded up to whole tiles, contents cleared when size changes
+		void resize(uint32 width, uint32 height);
+		uint32 getWidth() const { return mWidth; }
+		uint32 getHeight() const { return mHeight; }
+
+		// clears depth and occluders of previous frame
+		void begin(const lnm::mat4& viewProj);
+
+		// mesh has to stay alive until rasterize returns
+		void addOccluder(const lnm::mat4& model, const TriangleMesh& mesh);
+
+		// transforms and rasterizes all added occluders, split in horizontal bands between job threads when jobs given
+		void rasterize(class JobSubsystem* jobs);
+
+		// true when box lies entirely behind rasterized occluders, safe to call from multiple threads
+		// boxes crossing near plane or out of screen never occluded
+		bool isOccluded(const BoundingBox& box) const;
+
+		// farthest possible depth per pixel, row after row
+		void resolveDepth(std::vector<float>& outDepth) const;
+
+		// triangles of added occluders and those that made it through near plane, size and screen rejection
+		uint32 getTriangleCount() const { return mTriangles.size(); }
+		uint32 getRasterizedCount() const { return mRasterizedCount; }
+
+	private:
+		struct Occluder
+		{
+			lnm::mat4 modelViewProj{};
+			const TriangleMesh* mesh{};
+			uint32 firstTriangle{};
+		};
+
+		// screen space setup, coordinates in pixels
+		struct ScreenTriangle
+		{
+			// edge functions a * x + b * y + c, non negative inside
+			std::array<float, 3> edgeA{};
+			std::array<float, 3> edgeB{};
+			std::array<float, 3> edgeC{};
+
+			// depth plane a * x + b * y + c
+			float depthA{};
+			float depthB{};
+			float depthC{};
+			float maxDepth{};
+
+			// covered tiles, empty range for rejected triangles
+			uint32 minTileX{};
+			uint32 minTileY{};
+			uint32 endTileX{};
+			uint32 endTileY{};
+		};
+
+		// false when triangle rejected
+		bool setupTriangle(const lnm::mat4& modelViewProj, const lnm::vec3& p0, const lnm::vec3& p1, const lnm::vec3& p2, ScreenTriangle& outTriangle) const;
+
+		// pixel rect touched by screen bounds, false when it's empty
+		bool clampToScreen(const lnm::vec2& screenMin, const lnm::vec2& screenMax, int32& outMinX, int32& outMinY, int32& outEndX, int32& outEndY) const;
+
+		void rasterizeTileRows(uint32 firstTileRow, uint32 endTileRow);
+
+		// one bit per pixel covered by triangle, row by row, lowest bit top left
+		uint32 computeCoverage(const ScreenTriangle& triangle, float tileX, float tileY) const;
+
+		void updateTile(uint32 tile, uint32 coverage, float maxDepth);
+
+		uint32 mWidth{};
+		uint32 mHeight{};
+		uint32 mTilesX{};
+		uint32 mTilesY{};
+
+		lnm::mat4 mViewProj{};
+
+		// per tile, pixels in mask covered by working layer no farther than its depth, all pixels no farther than reference depth
+		std::vector<uint32> mMasks{};
+		std::vector<float> mLayerDepths{};
+		std::vector<float> mReferenceDepths{};
+
+		std::vector<Occluder> mOccluders{};
+		std::vector<ScreenTriangle> mTriangles{};
+		uint32 mRasterizedCount{};
+	};
+} // namespace lune
@@ -5,7 +5,9 @@
 #include "SDL3_image/SDL_image.h"
 
 #include <lune/core/log.hxx>
+#include <lune/lune.hxx>
 #include <memory>
+#include <span>
 #include <string>
 
 namespace lune
@@ -20,9 +22,9 @@ namespace lune
 
 	using UniqueSDLSurface = std::unique_ptr<SDL_Surface, UniqueSDLSurfaceDeleter>;
 
-	static UniqueSDLSurface loadTextureImage(const std::string_view& path)
+	// surface of format textures take, rgb expanded to rgba
+	static UniqueSDLSurface toTextureFormat(UniqueSDLSurface newSurface)
 	{
-		auto newSurface = UniqueSDLSurface(IMG_Load(path.data()));
 		if (newSurface)
 		{
 			if (newSurface->format == SDL_PIXELFORMAT_RGB24)
@@ -41,4 +43,15 @@ namespace lune
 		}
 		return nullptr;
 	}
+
+	static UniqueSDLSurface loadTextureImage(const std::string_view& path)
+	{
+		return toTextureFormat(UniqueSDLSurface(IMG_Load(path.data())));
+	}
+
+	// image file already in memory, like one embedded in model
+	static UniqueSDLSurface loadTextureImage(std::span<const uint8> data)
+	{
+		return toTextureFormat(UniqueSDLSurface(IMG_Load_IO(SDL_IOFromConstMem(data.data(), data.size()), true)));
+	}
 } // namespace lune
\ No newline at end of file
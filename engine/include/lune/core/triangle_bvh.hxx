@@ -0,0 +1,97 @@
+#pragma once
+
+#include "lune/core/culling.hxx"
+#include "lune/core/math.hxx"
+#include "lune/core/triangle_mesh.hxx"
+#include "lune/lune.hxx"
+
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace lune
+{
+	struct Ray
+	{
+		lnm::vec3 origin{};
+		lnm::vec3 direction{}; // doesn't have to be normalized, distances in its units
+		float maxDistance{};
+	};
+
+	struct TriangleRayHit
+	{
+		static constexpr uint32 NoTriangle = ~0u;
+
+		uint32 triangle{NoTriangle}; // index of triangle in mesh
+		float distance{};
+
+		// barycentric weights of second and third vertex of triangle
+		float u{};
+		float v{};
+
+		bool isHit() const { return triangle != NoTriangle; }
+	};
+
+	// bounding volume hierarchy over triangles of mesh, split by binned surface area heuristic
+	// leaves hold up to four triangles stored so single ray tests all of them at once
+	// triangles copied in, mesh doesn't have to outlive tree, both faces of triangles hit
+	class TriangleBvh
+	{
+	public:
+		static constexpr uint32 LeafSize = 4;
+
+		void build(const TriangleMesh& mesh);
+
+		// nearest hit within max distance
+		bool raycast(const Ray& ray, TriangleRayHit& outHit) const;
+
+		// whether anything is hit within max distance, stops at first hit found
+		bool intersects(const Ray& ray) const;
+
+		// hit per ray, misses left without triangle, rays split between job threads when jobs given
+		void raycastBatch(std::span<const Ray> rays, std::span<TriangleRayHit> outHits, class JobSubsystem* jobs) const;
+
+		BoundingBox getBoundingBox() const;
+		uint32 getTriangleCount() const { return mTriangleCount; }
+		uint32 getNodeCount() const { return mNodes.size(); }
+		uint32 getDepth() const { return mDepth; }
+
+	private:
+		struct Node
+		{
+			lnm::vec3 min{};
+			uint32 first{}; // left child of inner node, right one follows it, packet of leaf
+			lnm::vec3 max{};
+			uint32 count{}; // triangles in leaf, zero for inner nodes
+		};
+
+		// four triangles as first vertex and two edges, component by component, unused lanes have zero edges
+		struct alignas(16) TrianglePacket
+		{
+			float vertex[3][LeafSize]{};
+			float edge1[3][LeafSize]{};
+			float edge2[3][LeafSize]{};
+			uint32 triangles[LeafSize]{};
+		};
+
+		struct BuildTriangle
+		{
+			BoundingBox box{};
+			lnm::vec3 centroid{};
+			uint32 index{};
+		};
+
+		void buildNode(uint32 node, const TriangleMesh& mesh, std::span<BuildTriangle> triangles, uint32 depth);
+
+		// closest hit when any hit is false, first one found otherwise
+		template <bool AnyHit>
+		bool traverse(const Ray& ray, TriangleRayHit& outHit) const;
+
+		std::vector<Node> mNodes{};
+		std::vector<TrianglePacket> mPackets{};
+		uint32 mTriangleCount{};
+		uint32 mDepth{};
+	};
+
+	using SharedTriangleBvh = std::shared_ptr<const TriangleBvh>;
+} // namespace lune
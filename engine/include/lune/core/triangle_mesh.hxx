@@ -0,0 +1,21 @@
+#pragma once
+
+#include "lune/core/math.hxx"
+#include "lune/lune.hxx"
+
+#include <memory>
+#include <vector>
+
+namespace lune
+{
+	// cpu copy of primitive geometry, positions only, three indices per triangle
+	struct TriangleMesh
+	{
+		std::vector<lnm::vec3> positions{};
+		std::vector<uint32> indices{};
+
+		uint32 getTriangleCount() const { return indices.size() / 3; }
+	};
+
+	using SharedTriangleMesh = std::shared_ptr<const TriangleMesh>;
+} // namespace lune
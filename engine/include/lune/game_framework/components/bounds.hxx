@@ -0,0 +1,15 @@
+#pragma once
+
+#include "lune/core/culling.hxx"
+
+#include "component.hxx"
+
+namespace lune
+{
+	// local space bounds of entity for spatial index
+	// entities without it are bounded by primitives of their mesh, or just by their position
+	struct BoundsComponent : public ComponentBase
+	{
+		BoundingBox box{};
+	};
+} // namespace lune
@@ -0,0 +1,12 @@
+#pragma once
+
+#include "component.hxx"
+
+namespace lune
+{
+	// mesh of same entity rasterized into software occlusion buffer, hides meshes behind it
+	// best suited for large simple meshes like walls and terrain
+	struct OccluderComponent : public ComponentBase
+	{
+	};
+} // namespace lune
\ No newline at end of file
@@ -12,6 +12,10 @@ namespace lune
 	{
 		std::string imageName{};
 		lnm::vec3 position{};
-		lnm::vec2 srcRect{}, dstRect{};
+
+		// uv offset (xy) and size (zw) of sprite in texture
+		lnm::vec4 srcRect{0.f, 0.f, 1.f, 1.f};
+		// offset (xy) and scale (zw) of quad in entity space
+		lnm::vec4 dstRect{0.f, 0.f, 1.f, 1.f};
 	};
 } // namespace lune
\ No newline at end of file
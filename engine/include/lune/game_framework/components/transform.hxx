@@ -1,5 +1,6 @@
 #pragma once
 
+#include "lune/core/delegate.hxx"
 #include "lune/core/math.hxx"
 
 #include "component.hxx"
@@ -8,14 +9,56 @@ namespace lune
 {
 	struct TransformComponent : public ComponentBase
 	{
-		void translate(const lnm::vec3& translation) { mPosition += translation; }
-		void move(const lnm::vec3& translation) { mPosition += mOrientation * translation; }
-		void rotate(const lnm::quat& rotation) { mOrientation = lnm::normalize(rotation * mOrientation); }
+		using ChangedDelegate = DelegateOwned<TransformComponent, TransformComponent*>;
+
+		// executed by every method changing transform, code writing fields directly calls markChanged after
+		ChangedDelegate onChangedDelegate;
+
+		void translate(const lnm::vec3& translation)
+		{
+			mPosition += translation;
+			markChanged();
+		}
+		void move(const lnm::vec3& translation)
+		{
+			mPosition += mOrientation * translation;
+			markChanged();
+		}
+		void rotate(const lnm::quat& rotation)
+		{
+			mOrientation = lnm::normalize(rotation * mOrientation);
+			markChanged();
+		}
 		void rotate(float rads, const lnm::vec3& axis) { rotate(lnm::angleAxis(rads, glm::normalize(axis))); };
-		void scale(const lnm::vec3& scaling) { mScale *= scaling; }
+		void scale(const lnm::vec3& scaling)
+		{
+			mScale *= scaling;
+			markChanged();
+		}
+
+		void setPosition(const lnm::vec3& position)
+		{
+			mPosition = position;
+			markChanged();
+		}
+		void setOrientation(const lnm::quat& orientation)
+		{
+			mOrientation = orientation;
+			markChanged();
+		}
+		void setScale(const lnm::vec3& scale)
+		{
+			mScale = scale;
+			markChanged();
+		}
+
+		void markChanged() { onChangedDelegate.execute(this); }
+
+		// local matrix, parent transforms not applied
+		lnm::mat4 getMatrix() const { return lnm::translate(lnm::mat4(1.f), mPosition) * lnm::mat4(mOrientation) * lnm::scale(lnm::mat4(1.f), mScale); }
 
 		lnm::vec3 mPosition = lnm::vec3(0.0f);
 		lnm::quat mOrientation = lnm::quat(1.0f, lnm::vec3());
 		lnm::vec3 mScale = lnm::vec3(1.0f);
 	};
-} // namespace lune
\ No newline at end of file
+} // namespace lune
@@ -25,6 +25,8 @@ namespace lune
 		};
 
 	public:
+		using ComponentDelegate = DelegateOwned<Scene, const EntityBase*, ComponentBase*>;
+
 		Scene() = default;
 		Scene(const Scene&) = delete;
 		Scene(Scene&&) = default;
@@ -57,6 +59,10 @@ namespace lune
 		template <typename T>
 		const std::set<uint64>& getComponentEntities();
 
+		// components of entities in scene, executed for each component of attached or detached entity too
+		ComponentDelegate onComponentAddedDelegate;
+		ComponentDelegate onComponentRemovedDelegate;
+
 	private:
 		void onEntityComponentAdded(const EntityBase* entity, ComponentBase* comp);
 		void onEntityComponentRemoved(const EntityBase* entity, ComponentBase* comp);
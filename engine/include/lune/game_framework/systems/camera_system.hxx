@@ -1,5 +1,6 @@
 #pragma once
 
+#include "lune/core/culling.hxx"
 #include "lune/core/math.hxx"
 #include "lune/vulkan/buffer.hxx"
 
@@ -22,10 +23,14 @@ namespace lune
 		const vulkan::UniqueBuffer& getViewBuffer() const { return mViewBuffer; }
 		const vulkan::UniqueBuffer& getProjectionBuffer() const { return mProjBuffer; }
 
+		bool hasView(uint32 viewId) const { return mViewsProjs.contains(viewId); }
 		const lnm::mat4& getView(uint32 viewId) const { return mViewsProjs.at(viewId).view; }
 		const lnm::mat4& getProjection(uint32 viewId) const { return mViewsProjs.at(viewId).proj; }
 		const lnm::mat4& getViewProjection(uint32 viewId) const { return mViewsProjs.at(viewId).viewProj; }
 
+		// world space frustum of view projection
+		const Frustum& getFrustum(uint32 viewId) const { return mFrustums.at(viewId); }
+
 	private:
 		vulkan::UniqueBuffer mViewProjStagingBuffer{};
 
@@ -40,5 +45,9 @@ namespace lune
 			lnm::mat4 proj{};
 		};
 		std::map<uint32, ViewProj> mViewsProjs{};
+		std::map<uint32, Frustum> mFrustums{};
+
+		// last values written to staging buffer
+		ViewProj mStagedViewProj{lnm::mat4(0.f), lnm::mat4(0.f), lnm::mat4(0.f)};
 	};
 } // namespace lune
\ No newline at end of file
@@ -1,33 +1,187 @@
 #pragma once
 
+#include "lune/core/culling.hxx"
 #include "lune/core/gltf.hxx"
+#include "lune/core/math.hxx"
+#include "lune/core/occlusion_buffer.hxx"
 #include "lune/game_framework/components/mesh.hxx"
 #include "lune/vulkan/buffer.hxx"
+#include "lune/vulkan/depth_pyramid.hxx"
 #include "lune/vulkan/descriptor_sets.hxx"
 #include "lune/vulkan/vulkan_core.hxx"
 
 #include "system.hxx"
 
+#include <array>
+#include <vector>
+
 namespace lune
 {
 	class MeshRenderSystem : public SystemBase, public PrepareRenderSystemInterface, public RenderSystemInterface
 	{
 	public:
 		MeshRenderSystem();
+		~MeshRenderSystem();
 
 		virtual void update(class Scene* scene, double deltaTime) override {};
 		virtual void prepareRender(class Scene* scene) override;
 		virtual void render(class Scene* scene) override;
 
+		// primitives outside of view frustum skipped, on by default
+		void setCulling(bool culling) { mCulling = culling; }
+		bool getCulling() const { return mCulling; }
+
+		// indexed primitives culled on gpu and drawn with indirect draws generated there
+		// on by default when device supports draw indirect count
+		void setGpuDriven(bool gpuDriven);
+		bool getGpuDriven() const { return mGpuDriven; }
+		uint32 getDrawGroupCount() const { return mDrawGroups.size(); }
+
+		// gpu driven draws tested against depth pyramid too, on by default where depth can be sampled
+		// objects visible last frame drawn first, rest tested against their depth and drawn after pass break
+		void setOcclusionCulling(bool occlusionCulling) { mOcclusionCulling = occlusionCulling; }
+		bool getOcclusionCulling() const { return mOcclusionCulling; }
+
+		// counters of gpu culling, written by shader and read back on next frame
+		// matches Stats buffer of gltf/cull.comp
+		struct CullStats
+		{
+			uint32 frustumCulled{};
+			uint32 occlusionCulled{};
+			uint32 earlyDrawn{}; // drawn without occlusion test, all drawn objects without occlusion culling
+			uint32 lateDrawn{};
+		};
+		const CullStats& getCullStats() const { return mCullStats; }
+
+		// meshes of entities with occluder component rasterized on cpu, objects behind them skipped
+		// applies to objects drawn from cpu, on by default when device can't drive draws from gpu
+		void setSoftwareOcclusion(bool softwareOcclusion) { mSoftwareOcclusion = softwareOcclusion; }
+		bool getSoftwareOcclusion() const { return mSoftwareOcclusion; }
+		const OcclusionBuffer& getOcclusionBuffer() const { return mOcclusionBuffer; }
+
+		// primitives of last rendered view, culled on cpu, free slots of removed meshes not counted
+		uint32 getObjectCount() const { return mObjects.size() - mFreeObjects.size(); }
+		uint32 getVisibleCount() const { return mVisibleCount; }
+		uint32 getSoftwareOccludedCount() const { return mSoftwareOccludedCount; }
+
 	private:
+		// per object data, matches Object struct (std430) in gltf/primitive.vert and gltf/cull.comp
+		struct ObjectData
+		{
+			lnm::mat4 model{};
+			lnm::vec4 boundsCenter{}; // world space box, w unused
+			lnm::vec4 boundsExtent{};
+			uint32 materialIndex{}; // index in bindless heap materials
+
+			// indirect draw parameters, index count zero for objects drawn on cpu path
+			uint32 indexCount{};
+			uint32 firstIndex{};
+			int32 vertexOffset{};
+			uint32 drawGroup{};
+			uint32 padding[3]{};
+		};
+
+		// objects sharing pipeline, vertex and index buffers, drawn with single indirect draw
+		struct DrawGroup
+		{
+			vulkan::SharedGraphicsPipeline pipeline{};
+			vulkan::SharedPrimitive primitive{}; // any primitive of group, provides buffers to bind
+			uint32 firstCommand{};
+			uint32 objectCount{};
+		};
+
+		// matches phase constants of gltf/cull.comp
+		enum class CullPhase : uint32
+		{
+			Frustum = 0,
+			Early = 1,
+			Late = 2
+		};
+
+		// matches push constants of gltf/cull.comp
+		struct CullConstants
+		{
+			std::array<lnm::vec4, 6> planes{};
+			uint32 objectCount{};
+			CullPhase phase{};
+			uint32 commandCount{};
+			uint32 groupCount{};
+		};
+
 		struct MeshResources
 		{
 			std::vector<vulkan::SharedPrimitive> primitives{};
-			std::vector<vulkan::UniqueDescriptorSets> descSets{};
 			std::vector<vulkan::SharedMaterial> materials{};
-			vulkan::UniqueBuffer stagingModelBuffer{};
-			vulkan::UniqueBuffer modelBuffer{};
+			std::vector<uint32> objects{}; // slot of each primitive in objects buffer
 		};
+
+		void bindScene(class Scene* scene);
+
+		// mesh removed or its entity detached, its object slots freed for next meshes
+		void onComponentRemoved(const class EntityBase* entity, struct ComponentBase* comp);
+
+		// grows object buffers to fit capacity, new buffers filled with all objects
+		void reserveObjects(vk::CommandBuffer commandBuffer, uint32 capacity);
+
+		void createFrameDescriptorSets(class CameraSystem* cameraSystem, const vulkan::SharedGraphicsPipeline& pipeline);
+
+		// assigns objects to draw groups and recreates cull buffers sized for them
+		void rebuildDrawGroups(vk::CommandBuffer commandBuffer, class CameraSystem* cameraSystem);
+
+		// clears draw counts of phase and dispatches cull shader, commands ready for draw indirect afterwards
+		void cmdCull(vk::CommandBuffer commandBuffer, const Frustum& frustum, CullPhase phase);
+
+		// points cull set to pyramid of current view, placeholder image when there is none
+		void updateCullPyramid(const vulkan::DepthPyramid* depthPyramid);
+
+		// rasterizes occluders and clears visibility of objects hidden behind them
+		void cullSoftwareOcclusion(class Scene* scene, class CameraSystem* cameraSystem, uint32 viewId);
+
+		// screen sizes of visible objects reported for textures of their materials, streamed ones get mips for them
+		void requestTextureMips(class CameraSystem* cameraSystem, uint32 viewId);
+
+		class Scene* mScene{};
 		std::unordered_map<class MeshComponent*, MeshResources> mResources{};
+
+		// per frame set (view projection, objects buffer indexed with firstInstance), shared by all mesh packets
+		// transient, written every frame it's drawn in
+		// materials and textures come from bindless heap
+		vulkan::UniqueDescriptorSets mFrameDescSets{};
+
+		// cpu copy of objects buffer
+		std::vector<ObjectData> mObjects{};
+		std::vector<uint32> mFreeObjects{}; // zero index count and empty bounds, skipped by both cull paths
+		uint32 mObjectsCapacity{};
+		vulkan::UniqueBuffer mObjectsStagingBuffer{};
+		vulkan::UniqueBuffer mObjectsBuffer{};
+
+		// world bounds of objects, same indices as objects buffer
+		FrustumCuller mCuller{};
+		std::vector<uint8> mVisible{};
+		uint32 mVisibleCount{};
+		bool mCulling{true};
+
+		bool mSoftwareOcclusion{};
+		OcclusionBuffer mOcclusionBuffer{};
+		std::vector<uint8> mOccluderObjects{}; // objects of occluders, never tested against themselves
+		uint32 mSoftwareOccludedCount{};
+
+		bool mGpuDriven{};
+		bool mDrawGroupsDirty{};
+		std::vector<DrawGroup> mDrawGroups{};
+		vulkan::SharedComputePipeline mCullPipeline{};
+		vulkan::UniqueDescriptorSets mCullDescSets{};
+		vulkan::UniqueBuffer mDrawGroupsBuffer{};
+		vulkan::UniqueBuffer mDrawCommandsBuffer{};
+		vulkan::UniqueBuffer mDrawCountsBuffer{};
+		uint32 mCommandCount{};
+
+		// visibility shared by all views, views looking at different things just draw more objects late
+		bool mOcclusionCulling{true};
+		vulkan::UniqueBuffer mVisibilityBuffer{};
+		vulkan::UniqueBuffer mCullStatsBuffer{};
+		CullStats mCullStats{};
+		vk::ImageView mCullPyramidView{};
+		bool mLateCull{}; // early phase recorded this frame, late one follows in pass break
 	};
-} // namespace lune
\ No newline at end of file
+} // namespace lune
@@ -25,10 +25,18 @@ namespace lune
 		vulkan::SharedPrimitive mBox{};
 		vulkan::SharedGraphicsPipeline mPipeline{};
 		vulkan::SharedSampler mSampler{};
+		// matches Skybox push constant in skybox.frag
+		struct SkyboxConstants
+		{
+			uint32 textureIndex{};
+			uint32 samplerIndex{};
+		};
+
 		struct SkyboxResources
 		{
 			vulkan::SharedTextureImage mTextureImage{};
 			vulkan::UniqueDescriptorSets mDescriptorSets{};
+			SkyboxConstants mConstants{};
 		};
 		std::map<uint64, SkyboxResources> mSkyboxes{};
 	};
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "lune/core/aabb_tree.hxx"
+#include "lune/core/culling.hxx"
+#include "lune/core/math.hxx"
+#include "lune/core/triangle_bvh.hxx"
+#include "lune/lune.hxx"
+
+#include "system.hxx"
+
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+namespace lune
+{
+	struct MeshRayHit
+	{
+		uint64 entity{};
+		uint32 primitive{}; // index in primitives of mesh component
+		TriangleRayHit triangle{}; // distance along world ray
+
+		bool isHit() const { return triangle.isHit(); }
+	};
+
+	// world bounds of every entity with transform, kept in dynamic aabb tree
+	// listens to transform changes, only moved entities and their children refit, only those leaving their grown box reinserted
+	// queries answer state as of last update, results may include entities up to their margin away
+	class SpatialIndexSystem : public SystemBase
+	{
+	public:
+		SpatialIndexSystem() = default;
+		~SpatialIndexSystem();
+
+		virtual void update(class Scene* scene, double deltaTime) override;
+
+		// bounds recomputed on next update, for changes transform doesn't report, like edited bounds component
+		void markDirty(uint64 eId);
+
+		// ids of entities with bounds overlapping query, out vector cleared first
+		void queryBox(const BoundingBox& box, std::vector<uint64>& outEntities) const;
+		void querySphere(const BoundingSphere& sphere, std::vector<uint64>& outEntities) const;
+		void queryFrustum(const Frustum& frustum, std::vector<uint64>& outEntities) const;
+		void queryRay(const lnm::vec3& origin, const lnm::vec3& direction, float maxDistance, std::vector<uint64>& outEntities) const;
+
+		// nearest entity bounds hit, user data of hit is entity id
+		bool raycast(const lnm::vec3& origin, const lnm::vec3& direction, float maxDistance, AabbTree::RayHit& outHit) const;
+
+		// nearest triangle hit among meshes loaded with triangle hierarchies, others ignored
+		// only reads scene, safe to call from multiple threads while nothing changes it
+		bool raycastMeshes(const Ray& ray, MeshRayHit& outHit) const;
+
+		// nothing with triangle hierarchy between two points
+		bool hasLineOfSight(const lnm::vec3& from, const lnm::vec3& to) const;
+
+		// hit per ray, misses left without triangle, rays split between job threads when jobs given
+		void raycastMeshesBatch(std::span<const Ray> rays, std::span<MeshRayHit> outHits, class JobSubsystem* jobs) const;
+
+		// bounds of everything indexed, grown by margins of moved entities
+		BoundingBox getBounds() const { return mTree.getBounds(); }
+
+		uint32 getEntityCount() const { return mTree.getProxyCount(); }
+		uint32 getTreeHeight() const { return mTree.getHeight(); }
+
+		// entities with bounds recomputed in last update and those of them that had to be reinserted
+		uint32 getRefitCount() const { return mRefitCount; }
+		uint32 getReinsertCount() const { return mReinsertCount; }
+
+	private:
+		struct Proxy
+		{
+			uint32 treeProxy{AabbTree::NullNode}; // null until first update after entity got transform
+			struct TransformComponent* transform{};
+			bool dirty{};
+		};
+
+		void bindScene(class Scene* scene);
+
+		void onComponentAdded(const class EntityBase* entity, struct ComponentBase* comp);
+		void onComponentRemoved(const class EntityBase* entity, struct ComponentBase* comp);
+		void onTransformChanged(struct TransformComponent* transform);
+
+		lnm::mat4 computeWorldMatrix(class Scene* scene, uint64 eId) const;
+		BoundingBox computeWorldBounds(class Scene* scene, uint64 eId) const;
+
+		// stops at first hit when any hit is set
+		bool traceMeshes(const Ray& ray, bool anyHit, MeshRayHit& outHit) const;
+
+		class Scene* mScene{};
+		AabbTree mTree{};
+
+		std::unordered_map<uint64, Proxy> mProxies{};
+		std::unordered_map<const struct TransformComponent*, uint64> mTransformEntities{}; // change delegate passes only component
+
+		std::vector<uint64> mPendingInserts{};
+		std::vector<uint64> mDirty{};
+
+		uint32 mRefitCount{};
+		uint32 mReinsertCount{};
+	};
+} // namespace lune
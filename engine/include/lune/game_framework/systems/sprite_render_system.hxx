@@ -6,6 +6,9 @@
 #include "camera_system.hxx"
 #include "system.hxx"
 
+#include <unordered_map>
+#include <vector>
+
 namespace lune
 {
 	class SpriteRenderSystem
@@ -25,18 +28,72 @@ namespace lune
 
 		virtual void render(class Scene* scene) override;
 
+		// sprites with same texture drawn with one instanced draw, otherwise one draw per sprite
+		void setInstancing(bool instancing) { mInstancing = instancing; }
+		bool getInstancing() const { return mInstancing; }
+
+		uint32 getSpriteCount() const { return mInstanceCount; }
+		uint32 getDrawCount() const { return mInstancing ? mBatches.size() : mInstanceCount; }
+
 	private:
-		vulkan::SharedPrimitive mPrimitive{};
-		vulkan::SharedGraphicsPipeline mPipeline{};
-		vulkan::SharedSampler mSampler{};
+		// matches SpriteInstance struct (std430) in sprite.vert
+		struct SpriteInstance
+		{
+			lnm::mat4 model{1.f};
+			lnm::vec4 srcRect{};
+			lnm::vec4 dstRect{};
+			uint32 textureIndex{}; // index in bindless heap textures
+			uint32 samplerIndex{}; // index in bindless heap samplers
+			uint32 padding[2]{};
+		};
+
+		// instances with same texture, continuous range in instance buffer
+		struct Batch
+		{
+			uint32 textureIndex{};
+			uint32 firstInstance{};
+			uint32 instanceCount{};
+			float depth{}; // of farthest instance
+		};
+
+		struct InstanceInfo
+		{
+			uint32 batch{};
+			float depth{};
+		};
 
 		struct SpriteResources
 		{
 			vulkan::SharedTextureImage texImage{};
-			vulkan::UniqueDescriptorSets descSets{};
-			vulkan::UniqueBuffer stagingModelBuffer{};
-			vulkan::UniqueBuffer modelBuffer{};
+			lnm::vec4 uvRect{}; // whole texture or region of atlas page
 		};
+
+		// grows instance buffer, frame set updated to point to new one
+		void reserveInstances(uint32 capacity);
+
+		vulkan::SharedPrimitive mPrimitive{};
+		vulkan::SharedGraphicsPipeline mPipeline{};
+		vulkan::SharedSampler mSampler{};
+
+		// per frame set with view projection and instances, shared by all sprite packets
+		// transient, written every frame it's drawn in
+		vulkan::UniqueDescriptorSets mFrameDescSets{};
+
 		std::unordered_map<class SpriteComponent*, SpriteResources> mResources{};
+
+		// gathered in entity order, written to instance buffer grouped by batch
+		std::vector<SpriteInstance> mInstances{};
+		std::vector<InstanceInfo> mInstanceInfos{};
+		std::vector<float> mInstanceDepths{}; // in instance buffer order
+
+		std::vector<Batch> mBatches{};
+		std::unordered_map<uint32, uint32> mTextureBatches{};
+
+		// host visible, rewritten every frame, read by vertex shader directly
+		vulkan::UniqueBuffer mInstanceBuffer{};
+		uint32 mInstanceCapacity{};
+		uint32 mInstanceCount{};
+
+		bool mInstancing{true};
 	};
-} // namespace lune
\ No newline at end of file
+} // namespace lune
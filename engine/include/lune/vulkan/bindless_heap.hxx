@@ -0,0 +1,104 @@
+#pragma once
+
+#include "lune/core/math.hxx"
+#include "lune/lune.hxx"
+
+#include "buffer.hxx"
+#include "vulkan_core.hxx"
+
+#include <vector>
+
+namespace lune::vulkan
+{
+	// material record in bindless materials buffer, matches Material struct (std430) in shaders
+	// texture slots: 0 - base color, 1 - metallic roughness, 2 - normal, 3 - occlusion, 4 - emissive
+	struct ShaderMaterialData
+	{
+		lnm::vec4 baseColorFactor{1.f};
+		lnm::vec4 emissiveFactor{0.f}; // w unused
+		float metallicFactor{1.f};
+		float roughnessFactor{1.f};
+		float normalScale{1.f};
+		float padding0{};
+
+		// UV sets either 0-1 or -1 (no texture)
+		int32 textureUVSets[5]{-1, -1, -1, -1, -1};
+		uint32 textureIndices[5]{};
+		uint32 samplerIndices[5]{};
+		uint32 padding1{};
+	};
+	static_assert(sizeof(ShaderMaterialData) == 112, "ShaderMaterialData must match std430 layout");
+
+	// engine wide descriptor set with every registered texture, sampler and material, bound at SetIndex
+	// shaders index textures and samplers with indices from registration, descriptors updated after bind
+	//	layout(set = 1, binding = 0) uniform texture2D textures2D[];
+	//	layout(set = 1, binding = 0) uniform textureCube texturesCube[];
+	//	layout(set = 1, binding = 1) uniform sampler samplers[];
+	//	layout(std430, set = 1, binding = 2) readonly buffer Materials { Material materials[]; };
+	class BindlessHeap final
+	{
+	public:
+		static constexpr uint32 SetIndex = 1;
+
+		static constexpr uint32 TexturesBinding = 0;
+		static constexpr uint32 SamplersBinding = 1;
+		static constexpr uint32 MaterialsBinding = 2;
+
+		BindlessHeap() = default;
+		BindlessHeap(const BindlessHeap&) = delete;
+		BindlessHeap(BindlessHeap&&) = delete;
+		~BindlessHeap() = default;
+
+		void init();
+		void shutdown();
+
+		uint32 registerTexture(vk::ImageView imageView);
+		// points slot at another view, materials referencing slot don't change, slot must not be used by pending frame
+		void updateTexture(uint32 index, vk::ImageView imageView);
+		void unregisterTexture(uint32 index);
+
+		uint32 registerSampler(vk::Sampler sampler);
+		void unregisterSampler(uint32 index);
+
+		uint32 registerMaterial(const ShaderMaterialData& material);
+		void updateMaterial(uint32 index, const ShaderMaterialData& material);
+		void unregisterMaterial(uint32 index);
+
+		vk::DescriptorSetLayout getDescriptorSetLayout() const { return mDescriptorSetLayout; }
+		vk::DescriptorSet getDescriptorSet() const { return mDescriptorSet; }
+
+		void cmdBind(vk::CommandBuffer commandBuffer, vk::PipelineLayout pipelineLayout, vk::PipelineBindPoint bindPoint = vk::PipelineBindPoint::eGraphics);
+
+		uint32 getTextureCount() const { return mNextTextureSlot - mFreeTextureSlots.size(); }
+		uint32 getMaterialCount() const { return mMaterials.size() - mFreeMaterialSlots.size(); }
+
+	private:
+		static uint32 allocateSlot(std::vector<uint32>& freeSlots, uint32& nextSlot, uint32 maxSlots);
+
+		void reserveMaterials(uint32 capacity);
+
+		uint32 mMaxTextures{};
+		uint32 mMaxSamplers{};
+
+		vk::DescriptorSetLayout mDescriptorSetLayout{};
+		vk::DescriptorPool mDescriptorPool{};
+		vk::DescriptorSet mDescriptorSet{};
+
+		std::vector<uint32> mFreeTextureSlots{};
+		uint32 mNextTextureSlot{};
+
+		std::vector<uint32> mFreeSamplerSlots{};
+		uint32 mNextSamplerSlot{};
+
+		// cpu copy of materials buffer
+		std::vector<ShaderMaterialData> mMaterials{};
+		std::vector<uint32> mFreeMaterialSlots{};
+		UniqueBuffer mMaterialsBuffer{};
+		uint32 mMaterialsCapacity{};
+	};
+} // namespace lune::vulkan
+
+namespace lune
+{
+	extern "C++" vulkan::BindlessHeap& getVulkanBindlessHeap() noexcept;
+} // namespace lune
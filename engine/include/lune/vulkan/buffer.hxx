@@ -3,6 +3,7 @@
 #include "lune/vulkan/vulkan_core.hxx"
 
 #include <memory>
+#include <span>
 
 namespace lune::vulkan
 {
@@ -21,15 +22,35 @@ namespace lune::vulkan
 		vk::Buffer getBuffer() const { return mBuffer; }
 		vk::DeviceSize getSize() const { return mSize; }
 
+		// persistently mapped pointer, nullptr unless created with VMA_ALLOCATION_CREATE_MAPPED_BIT
+		uint8* getMappedData() const { return mMappedData; }
+
+		// returns persistently mapped pointer if any, otherwise maps memory with vmaMapMemory
 		uint8* map() const;
 
 		void unmap() const;
 
+		// writes bytes to host visible allocation, flushes non-coherent memory
+		void write(std::span<const std::byte> bytes, vk::DeviceSize offset = 0);
+
+		template <typename T>
+		void write(const T& value, vk::DeviceSize offset = 0)
+		{
+			write(std::as_bytes(std::span<const T, 1>(&value, 1)), offset);
+		}
+
+		// flush range of host writes, no-op for host coherent memory
+		void flush(vk::DeviceSize offset, vk::DeviceSize size) const;
+
+		// makes device writes visible to host reads, no-op for host coherent memory
+		void invalidate(vk::DeviceSize offset, vk::DeviceSize size) const;
+
 		// copies data to allocation with VkMapMemory (if possible)
 		void copyMap(const void* data, size_t offset, size_t size);
 
-		// copies data to allocation using stagin buffer and transfer queue
-		void copyTransfer(const void* data, size_t offset, size_t size);
+		// queues copy of data to allocation with upload context, valid for gpu once ticket complete
+		// buffer released only after last such copy completed
+		UploadTicket copyTransfer(const void* data, size_t offset, size_t size);
 
 	private:
 		void init(vk::BufferUsageFlags usage, vk::DeviceSize size, VmaMemoryUsage vmaUsage, VmaAllocationCreateFlags vmaFlags);
@@ -38,5 +59,10 @@ namespace lune::vulkan
 		vk::DeviceSize mSize{};
 
 		VmaAllocation mVmaAllocation{};
+
+		uint8* mMappedData{};
+		bool mHostCoherent{};
+
+		UploadTicket mUploadTicket{}; // of last copyTransfer
 	};
 } // namespace lune::vulkan
\ No newline at end of file
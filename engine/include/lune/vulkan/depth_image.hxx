@@ -20,6 +20,8 @@ namespace lune::vulkan
 		static UniqueDepthImage create(vk::Extent2D extent);
 
 		vk::Format getFormat() const { return mFormat; }
+		vk::SampleCountFlagBits getSampleCount() const { return mSampleCount; }
+		vk::Extent2D getExtent() const { return mExtent; }
 		vk::Image getImage() const { return mImage; }
 		vk::ImageView getImageView() const { return mImageView; }
 
@@ -32,6 +34,7 @@ namespace lune::vulkan
 
 		vk::Format mFormat{vk::Format::eD32Sfloat};
 		vk::SampleCountFlagBits mSampleCount{vk::SampleCountFlagBits::e1};
+		vk::Extent2D mExtent{};
 
 		vk::Image mImage{};
 		VmaAllocation mVmaAllocation{};
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "lune/vulkan/descriptor_sets.hxx"
+#include "lune/vulkan/vulkan_core.hxx"
+
+#include <memory>
+#include <vector>
+
+namespace lune::vulkan
+{
+	using UniqueDepthPyramid = std::unique_ptr<class DepthPyramid>;
+
+	// hierarchical z of depth image, every texel holds farthest depth of area it covers
+	// first level is depth extent rounded down to power of two, each next one half of previous
+	class DepthPyramid final
+	{
+	public:
+		DepthPyramid() = default;
+		DepthPyramid(DepthPyramid&) = delete;
+		DepthPyramid(DepthPyramid&&) = default;
+		~DepthPyramid();
+
+		static UniqueDepthPyramid create(const class DepthImage& depthImage);
+
+		// reduces depth into all levels, depth expected in depth read only layout and its writes made visible to compute shaders
+		// levels left in general layout, ready to be read by compute shaders
+		void cmdBuild(vk::CommandBuffer commandBuffer);
+
+		vk::Extent2D getExtent() const { return mExtent; }
+		uint32 getLevelCount() const { return mLevelCount; }
+
+		// view of all levels, general layout, read with texelFetch
+		vk::ImageView getImageView() const { return mImageView; }
+
+	private:
+		void init(const class DepthImage& depthImage);
+
+		void createImage();
+		void createImageViews();
+		void createDescriptorSets(const class DepthImage& depthImage);
+
+		vk::Extent2D mDepthExtent{};
+		uint32 mDepthSampleCount{};
+
+		vk::Extent2D mExtent{};
+		uint32 mLevelCount{};
+
+		vk::Image mImage{};
+		VmaAllocation mVmaAllocation{};
+		vk::ImageView mImageView{};
+		std::vector<vk::ImageView> mLevelViews{};
+
+		SharedComputePipeline mCopyPipeline{};
+		SharedComputePipeline mReducePipeline{};
+
+		// single set copying depth into first level, set per level reducing previous level into it
+		UniqueDescriptorSets mCopyDescSets{};
+		UniqueDescriptorSets mReduceDescSets{};
+	};
+} // namespace lune::vulkan
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "lune/lune.hxx"
+
+#include "vulkan_core.hxx"
+
+#include <map>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+namespace lune::vulkan
+{
+	// allocates descriptor sets from list of shared pools, new pool created once existing ones out of memory
+	// pool sizes follow ratio of descriptor types registered by pipelines, never smaller than layout allocated from new pool
+	// persistent sets either freed individually or cached by bound resources and reference counted
+	// transient sets valid for current frame only, reset in bulk on next frame
+	// not thread safe, expected to be used from main thread only
+	class DescriptorAllocator final
+	{
+	public:
+		DescriptorAllocator() = default;
+		DescriptorAllocator(const DescriptorAllocator&) = delete;
+		DescriptorAllocator(DescriptorAllocator&&) = delete;
+		~DescriptorAllocator() = default;
+
+		void init();
+		void shutdown();
+
+		// account descriptor types of pipeline layouts in sizes of pools created from now on
+		void addPoolSizes(std::span<const vk::DescriptorPoolSize> poolSizes, uint32 setCount);
+
+		// descriptor counts of layout, pool created for it holds at least them however rare its types are
+		void registerLayout(vk::DescriptorSetLayout layout, std::span<const vk::DescriptorPoolSize> layoutSizes);
+		void unregisterLayout(vk::DescriptorSetLayout layout);
+
+		vk::DescriptorSet allocate(vk::DescriptorSetLayout layout);
+		void free(vk::DescriptorSet set);
+
+		// returns set with same layout and template data if one exists, otherwise allocates and updates new one with template
+		// each acquire must be matched with release
+		vk::DescriptorSet acquire(vk::DescriptorSetLayout layout, vk::DescriptorUpdateTemplate updateTemplate, std::span<const std::byte> data);
+		void release(vk::DescriptorSet set);
+
+		// set valid until next resetTransient call, neither cached nor freed
+		vk::DescriptorSet allocateTransient(vk::DescriptorSetLayout layout);
+
+		// reset all transient pools, sets allocated with them must not be in use anymore
+		void resetTransient();
+
+		uint32 getPoolCount() const { return mPools.size() + mTransientPools.size() + mFreeTransientPools.size(); }
+		uint32 getCachedSetCount() const { return mCache.size(); }
+
+	private:
+		struct Pool
+		{
+			vk::DescriptorPool pool{};
+			bool full{};
+		};
+
+		struct CachedSet
+		{
+			vk::DescriptorSet set{};
+			uint32 refCount{};
+		};
+
+		using CacheKey = std::vector<uint64>;
+
+		struct CacheKeyHash
+		{
+			size_t operator()(const CacheKey& key) const noexcept;
+		};
+
+		vk::DescriptorPool createPool(uint32 maxSets, vk::DescriptorPoolCreateFlags flags, vk::DescriptorSetLayout layout);
+
+		// tries to allocate from pool, false when pool out of memory
+		bool tryAllocate(vk::DescriptorPool pool, vk::DescriptorSetLayout layout, vk::DescriptorSet& outSet);
+
+		std::map<vk::DescriptorType, uint64> mDescriptorCounts{};
+		uint64 mSetCount{};
+
+		uint32 mNextPoolSets{};
+
+		std::vector<Pool> mPools{};
+		std::unordered_map<VkDescriptorSet, VkDescriptorPool> mSetPools{};
+
+		std::vector<vk::DescriptorPool> mTransientPools{};
+		std::vector<vk::DescriptorPool> mFreeTransientPools{};
+
+		std::unordered_map<VkDescriptorSetLayout, std::vector<vk::DescriptorPoolSize>> mLayoutSizes{};
+
+		std::unordered_map<CacheKey, CachedSet, CacheKeyHash> mCache{};
+		std::unordered_map<VkDescriptorSet, CacheKey> mCacheKeys{};
+	};
+} // namespace lune::vulkan
+
+namespace lune
+{
+	extern "C++" vulkan::DescriptorAllocator& getVulkanDescriptorAllocator() noexcept;
+} // namespace lune
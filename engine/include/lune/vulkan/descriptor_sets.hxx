@@ -2,50 +2,82 @@
 
 #include "lune/vulkan/vulkan_core.hxx"
 
-#include <map>
 #include <memory>
+#include <string_view>
 #include <vector>
 
 namespace lune::vulkan
 {
-	class GraphicsPipeline;
+	class Pipeline;
 
 	using UniqueDescriptorSets = std::unique_ptr<class DescriptorSets>;
 
+	// element of packed per-set array consumed by descriptor update templates
+	union DescriptorInfo
+	{
+		VkDescriptorImageInfo image;
+		VkDescriptorBufferInfo buffer;
+	};
+
+	// descriptor set indices ordered by update frequency, lower sets stay bound while higher ones change
+	// per frame data (camera, objects buffer) bound once per pass, material data bound once per material
+	// per draw data passed with push constants or instance index
+	enum class DescriptorSetFrequency : uint32
+	{
+		PerFrame = 0,
+		PerMaterial = 1
+	};
+
 	class DescriptorSets final
 	{
 	public:
 		DescriptorSets() = default;
-		DescriptorSets(SharedGraphicsPipeline pipeline, uint32 maxAllocations);
+		DescriptorSets(SharedPipeline pipeline, uint32 maxAllocations);
 		DescriptorSets(DescriptorSets&) = delete;
 		DescriptorSets(DescriptorSets&&) = default;
 		~DescriptorSets();
 
-		static UniqueDescriptorSets create(SharedGraphicsPipeline pipeline, uint32 maxAllocations);
+		static UniqueDescriptorSets create(SharedPipeline pipeline, uint32 maxAllocations);
 
+		// slot from Pipeline::findBindingSlot
+		void setBufferInfo(uint32 slot, uint32 allocId, vk::Buffer buffer, vk::DeviceSize offset, vk::DeviceSize range);
+		void setImageInfo(uint32 slot, uint32 allocId, vk::ImageView imageView, vk::Sampler sampler, uint32 dstArrayElem = 0, vk::ImageLayout layout = vk::ImageLayout::eShaderReadOnlyOptimal);
+
+		// resolves slot by name each call, prefer slot overloads for frequent updates
 		void setBufferInfo(std::string_view name, uint32 allocId, vk::Buffer buffer, vk::DeviceSize offset, vk::DeviceSize range);
-		void setImageInfo(std::string_view name, uint32 allocId, vk::ImageView imageView, vk::Sampler sampler, uint32 dstArrayElem = 0);
+		void setImageInfo(std::string_view name, uint32 allocId, vk::ImageView imageView, vk::Sampler sampler, uint32 dstArrayElem = 0, vk::ImageLayout layout = vk::ImageLayout::eShaderReadOnlyOptimal);
 
+		// writes infos with update templates, every element of bound arrays expected to be set
 		void updateSets(uint32 allocId);
 
+		// same as updateSets for single set, other sets of allocation may stay unset
+		void updateSet(uint32 allocId, DescriptorSetFrequency set);
+
+		// writes set into transient set valid for current frame only, without cache lookup
+		// for per frame sets rewritten every frame they are bound in
+		void updateTransientSet(uint32 allocId, DescriptorSetFrequency set);
+
 		void cmdBind(vk::CommandBuffer commandBuffer, uint32 offsetSets);
 
-		SharedGraphicsPipeline getPipeline() const { return mPipeline; }
+		// binds single set, sets before it stay bound if pipeline layouts compatible up to it
+		void cmdBind(vk::CommandBuffer commandBuffer, uint32 allocId, DescriptorSetFrequency set);
+
+		vk::DescriptorSet getDescriptorSet(uint32 allocId, DescriptorSetFrequency set) const;
+
+		SharedPipeline getPipeline() const { return mPipeline; }
 
 	private:
 		void init();
-		void createDescriptorPool();
-
-		void allocateDescriptorSets();
 
-		SharedGraphicsPipeline mPipeline{};
+		SharedPipeline mPipeline{};
 
 		uint32 mMaxAllocations{};
 
-		vk::DescriptorPool mDescriptorPool{};
+		// sets acquired from descriptor allocator on update, null until first update
 		std::vector<vk::DescriptorSet> mDescriptorSets{};
+		std::vector<uint8> mTransientSets{}; // reset with transient pools, never released
 
-		std::vector<std::map<std::string, vk::DescriptorBufferInfo>> mBufferInfos{};
-		std::vector<std::map<std::string, std::map<int32, vk::DescriptorImageInfo>>> mImageInfos{};
+		// per allocation per set, layout matches pipeline update templates
+		std::vector<std::vector<DescriptorInfo>> mDescriptorInfos{};
 	};
 } // namespace lune::vulkan
\ No newline at end of file
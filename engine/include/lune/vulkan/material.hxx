@@ -16,13 +16,17 @@ namespace lune::vulkan
 	public:
 		const SharedGraphicsPipeline& getPipeline() const { return mPipeline; }
 		const UniqueBuffer& getBuffer() const { return mBuffer; }
-		const std::vector<SharedTextureImage> getTextures() const { return mTextures; }
-		const std::vector<SharedSampler> getSamplers() const { return mSamplers; }
+		const std::vector<SharedTextureImage>& getTextures() const { return mTextures; }
+		const std::vector<SharedSampler>& getSamplers() const { return mSamplers; }
+
+		// index in bindless heap materials buffer
+		uint32 getMaterialIndex() const { return mMaterialIndex; }
 
 	protected:
 		SharedGraphicsPipeline mPipeline{};
 		UniqueBuffer mBuffer{};
 		std::vector<SharedTextureImage> mTextures{};
 		std::vector<SharedSampler> mSamplers{};
+		uint32 mMaterialIndex{};
 	};
 } // namespace lune::vulkan
\ No newline at end of file
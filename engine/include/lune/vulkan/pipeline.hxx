@@ -3,19 +3,94 @@
 #include "lune/vulkan/shader.hxx"
 #include "lune/vulkan/vulkan_core.hxx"
 
+#include <map>
 #include <memory>
+#include <string>
+#include <string_view>
 #include <vulkan/vulkan_enums.hpp>
 
 namespace lune::vulkan
 {
+	// descriptor set layouts, update templates and pipeline layout reflected from shaders
+	// shared by graphics and compute pipelines, so descriptor sets work with either
+	class Pipeline
+	{
+	public:
+		Pipeline() = default;
+		Pipeline(Pipeline&) = delete;
+		Pipeline(Pipeline&&) = default;
+		virtual ~Pipeline();
+
+		// descriptor binding resolved from shader reflection, info offset is index of first element in packed per-set DescriptorInfo array
+		struct BindingSlot
+		{
+			uint32 set{};
+			uint32 binding{};
+			vk::DescriptorType type{};
+			uint32 count{};
+			uint32 infoOffset{};
+		};
+		static constexpr uint32 InvalidBindingSlot = UINT32_MAX;
+
+		const std::vector<vk::DescriptorSetLayout>& getDescriptorLayouts() const { return mDescriptorSetLayouts; }
+		const std::vector<vk::DescriptorPoolSize>& getDescriptorPoolSizes() const { return mPoolSizes; }
+
+		// returns index of binding slot by name of binding variable in shader, InvalidBindingSlot if not found
+		uint32 findBindingSlot(std::string_view name) const;
+		const std::vector<BindingSlot>& getBindingSlots() const { return mBindingSlots; }
+
+		// per set, null for sets without bindings
+		const std::vector<vk::DescriptorUpdateTemplate>& getDescriptorUpdateTemplates() const { return mDescriptorUpdateTemplates; }
+		const std::vector<uint32>& getDescriptorInfoCounts() const { return mDescriptorInfoCounts; }
+
+		vk::PipelineBindPoint getBindPoint() const { return mBindPoint; }
+		vk::PipelineLayout getPipelineLayout() const { return mPipelineLayout; }
+		vk::Pipeline getPipeline() const { return mPipeline; }
+
+		// unique per pipeline, used in render queue sort keys
+		uint32 getId() const { return mId; }
+
+		// equal for pipelines with compatible layouts up to and including set (push constant ranges and set layouts 0..set)
+		// sets bound with one pipeline stay valid after binding another one with same hash
+		uint64 getSetCompatibilityHash(uint32 set) const { return set < mSetCompatibilityHashes.size() ? mSetCompatibilityHashes[set] : 0; }
+
+		void cmdBind(vk::CommandBuffer commandBuffer);
+
+	protected:
+		// bindings of all shaders merged, stages of bindings used by several shaders combined
+		// bindless uses heap layout for set BindlessHeap::SetIndex instead of reflected one
+		void createDescriptorLayoutsAndPoolSizes(const std::vector<SharedShader>& shaders, bool bindless);
+		void createPipelineLayout(const std::vector<SharedShader>& shaders);
+
+		vk::PipelineBindPoint mBindPoint{};
+
+		std::vector<vk::DescriptorSetLayout> mDescriptorSetLayouts{};
+		bool mBindless{}; // layout at BindlessHeap::SetIndex owned by heap
+		std::vector<vk::DescriptorPoolSize> mPoolSizes{};
+
+		std::vector<BindingSlot> mBindingSlots{};
+		std::map<std::string, uint32, std::less<>> mBindingNames{};
+
+		std::vector<vk::DescriptorUpdateTemplate> mDescriptorUpdateTemplates{};
+		std::vector<uint32> mDescriptorInfoCounts{};
+
+		// hashes of set layout bindings first, combined with push constants and lower sets on pipeline layout creation
+		std::vector<uint64> mSetCompatibilityHashes{};
+
+		uint32 mId{};
+
+		vk::PipelineLayout mPipelineLayout{};
+		vk::Pipeline mPipeline{};
+	};
+
 	using UniqueGraphicsPipeline = std::unique_ptr<class GraphicsPipeline>;
-	class GraphicsPipeline final
+	class GraphicsPipeline final : public Pipeline
 	{
 	public:
 		GraphicsPipeline() = default;
 		GraphicsPipeline(GraphicsPipeline&) = delete;
 		GraphicsPipeline(GraphicsPipeline&&) = default;
-		~GraphicsPipeline();
+		~GraphicsPipeline() = default;
 
 		struct StatesOverride
 		{
@@ -24,6 +99,9 @@ namespace lune::vulkan
 			vk::PipelineRasterizationStateCreateInfo* rasterization{};
 			vk::PipelineMultisampleStateCreateInfo* multisampling{};
 			vk::PipelineDepthStencilStateCreateInfo* depthStencil{};
+
+			// use bindless heap layout for set BindlessHeap::SetIndex instead of reflected one
+			bool bindless{};
 		};
 
 		static const std::vector<vk::DynamicState>& defaultDynamicStates();
@@ -38,28 +116,32 @@ namespace lune::vulkan
 		std::shared_ptr<Shader> getVertShader() const { return mVertShader; }
 		std::shared_ptr<Shader> getFragShader() const { return mFragShader; }
 
-		const std::vector<vk::DescriptorSetLayout>& getDescriptorLayouts() const { return mDescriptorSetLayouts; }
-		const std::vector<vk::DescriptorPoolSize>& getDescriptorPoolSizes() const { return mPoolSizes; }
-
-		vk::PipelineLayout getPipelineLayout() const { return mPipelineLayout; }
-		vk::Pipeline getPipeline() const { return mPipeline; }
-
-		void cmdBind(vk::CommandBuffer commandBuffer);
-
 	private:
 		void init(std::shared_ptr<Shader> vertShader, std::shared_ptr<Shader> fragShader, const StatesOverride& statesOverride);
 
-		void createDescriptorLayoutsAndPoolSizes();
-		void createPipelineLayout();
 		void createPipeline(const StatesOverride& statesOverride);
 
 		std::shared_ptr<Shader> mVertShader{};
 		std::shared_ptr<Shader> mFragShader{};
+	};
 
-		std::vector<vk::DescriptorSetLayout> mDescriptorSetLayouts{};
-		std::vector<vk::DescriptorPoolSize> mPoolSizes{};
+	class ComputePipeline final : public Pipeline
+	{
+	public:
+		ComputePipeline() = default;
+		ComputePipeline(ComputePipeline&) = delete;
+		ComputePipeline(ComputePipeline&&) = default;
+		~ComputePipeline() = default;
 
-		vk::PipelineLayout mPipelineLayout{};
-		vk::Pipeline mPipeline{};
+		static SharedComputePipeline create(std::shared_ptr<Shader> compShader, bool bindless = false);
+
+		std::shared_ptr<Shader> getCompShader() const { return mCompShader; }
+
+	private:
+		void init(std::shared_ptr<Shader> compShader, bool bindless);
+
+		void createPipeline();
+
+		std::shared_ptr<Shader> mCompShader{};
 	};
 } // namespace lune::vulkan
\ No newline at end of file
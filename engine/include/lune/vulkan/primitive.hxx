@@ -1,6 +1,9 @@
 #pragma once
 
+#include "lune/core/culling.hxx"
 #include "lune/core/math.hxx"
+#include "lune/core/triangle_bvh.hxx"
+#include "lune/core/triangle_mesh.hxx"
 #include "lune/lune.hxx"
 #include "lune/vulkan/vulkan_core.hxx"
 
@@ -40,6 +43,9 @@ namespace lune::vulkan
 
 		static SharedPrimitive create(const void* vertData, uint32 vertDataSize, uint32 vertSizeof, const void* indexData, uint32 indexDataSize, uint32 indexSizeof);
 
+		// data uploaded into shared buffers by caller, nothing recorded here, ticket of that upload kept for users waiting on it
+		static SharedPrimitive createInBuffers(uint32 vertCount, uint32 vertSizeof, SharedBuffer vertBuffer, uint32 vertOffset, uint32 indxCount, uint32 indxSizeof, SharedBuffer indxBuffer, uint32 indxOffset, UploadTicket uploadTicket = {});
+
 		void cmdBind(vk::CommandBuffer commandBuffer);
 
 		void cmdDraw(vk::CommandBuffer commandBuffer, uint32 instanceCount = 1, uint32 firstInstance = 0);
@@ -50,8 +56,33 @@ namespace lune::vulkan
 		SharedBuffer getIndexBuffer() const { return mIndexBuffer; }
 		vk::IndexType getIndexType() const { return mIndicesType; }
 
+		// draw parameters within shared buffers, as expected by indirect draw commands
+		uint32 getIndexCount() const { return mIndicesCount; }
+		uint32 getFirstIndex() const { return mIndexBuffer ? mIndicesOffset / mIndicesSizeof : 0; }
+		int32 getVertexOffset() const { return mVerticiesOffset / mVerticiesSizeof; }
+
+		UploadTicket getUploadTicket() const { return mUploadTicket; }
+
+		// unique per primitive, used in render queue sort keys
+		uint32 getId() const { return mId; }
+
+		// local space bounds, primitives without them never culled
+		void setBounds(const BoundingBox& box, const BoundingSphere& sphere);
+		bool hasBounds() const { return mHasBounds; }
+		const BoundingBox& getBoundingBox() const { return mBoundingBox; }
+		const BoundingSphere& getBoundingSphere() const { return mBoundingSphere; }
+
+		// triangles kept on cpu for occlusion and queries, null for points and lines
+		void setTriangleMesh(SharedTriangleMesh triangleMesh) { mTriangleMesh = std::move(triangleMesh); }
+		const SharedTriangleMesh& getTriangleMesh() const { return mTriangleMesh; }
+
+		// hierarchy over those triangles for raycasts, null unless requested on load
+		void setTriangleBvh(SharedTriangleBvh triangleBvh) { mTriangleBvh = std::move(triangleBvh); }
+		const SharedTriangleBvh& getTriangleBvh() const { return mTriangleBvh; }
+
 	private:
 		void init(const void* vertData, uint32 vertDataSize, uint32 vertSizeof, const void* indexData, uint32 indexDataSize, uint32 indexSizeof);
+		void initLayout(uint32 vertCount, uint32 vertSizeof, uint32 indexCount, uint32 indexSizeof);
 
 		uint32 mVerticiesSize{};
 		uint32 mVerticiesCount{};
@@ -65,5 +96,16 @@ namespace lune::vulkan
 		uint32 mIndicesSizeof{};
 		vk::IndexType mIndicesType{};
 		SharedBuffer mIndexBuffer{};
+
+		UploadTicket mUploadTicket{};
+
+		uint32 mId{};
+
+		bool mHasBounds{};
+		BoundingBox mBoundingBox{};
+		BoundingSphere mBoundingSphere{};
+
+		SharedTriangleMesh mTriangleMesh{};
+		SharedTriangleBvh mTriangleBvh{};
 	};
 } // namespace lune::vulkan
\ No newline at end of file
@@ -0,0 +1,125 @@
+#pragma once
+
+#include "lune/lune.hxx"
+
+#include "vulkan_core.hxx"
+
+#include <array>
+#include <functional>
+#include <vector>
+
+namespace lune::vulkan
+{
+	// coarse draw order, packets of lower layer always executed first
+	enum class RenderLayer : uint8
+	{
+		Background = 0,
+		Opaque = 1,
+		LateOpaque = 2, // after pass break when view splits its pass, e.g. objects found visible by second occlusion culling phase
+		Transparent = 3,
+		Overlay = 4,
+	};
+
+	// single draw recorded by render queue, pointed resources must outlive queue execution
+	struct RenderPacket
+	{
+		static constexpr uint32 MaxDescriptorSets = 4;
+
+		class GraphicsPipeline* pipeline{};
+		class Primitive* primitive{};
+
+		// by set index, null sets left as is
+		std::array<vk::DescriptorSet, MaxDescriptorSets> descriptorSets{};
+
+		uint32 instanceCount{1};
+		uint32 firstInstance{};
+
+		// set for indexed indirect draw with count read from buffer, primitive then only provides vertex and index buffers
+		vk::Buffer indirectBuffer{};
+		vk::DeviceSize indirectOffset{};
+		vk::Buffer countBuffer{};
+		vk::DeviceSize countOffset{};
+		uint32 maxDrawCount{};
+
+		// range in queue push constants storage, filled by submit with push constants
+		vk::ShaderStageFlags pushConstantsStages{};
+		uint32 pushConstantsOffset{};
+		uint32 pushConstantsSize{};
+	};
+
+	struct RenderQueueStats
+	{
+		uint32 packets{};
+		uint32 pipelineBinds{};
+		uint32 descriptorSetBinds{};
+		uint32 vertexBufferBinds{};
+		uint32 indexBufferBinds{};
+		uint32 indirectDraws{};
+		uint32 passBreaks{};
+
+		// binds skipped since same state already bound
+		uint32 bindsSaved{};
+	};
+
+	// collects draws from render systems during frame, sorts them by key and records them with minimal state changes
+	// sort key, from most significant bits:
+	//	layer (4) | pipeline (12) | material (16) | mesh (16) | depth (16)
+	//	layer (4) | inverted depth (16) | pipeline (12) | material (16) | mesh (16) for transparent layer, drawn back to front
+	class RenderQueue final
+	{
+	public:
+		RenderQueue() = default;
+		RenderQueue(const RenderQueue&) = delete;
+		RenderQueue(RenderQueue&&) = default;
+		~RenderQueue() = default;
+
+		// depth is positive view space distance, ids truncated to their bit counts
+		static uint64 makeSortKey(RenderLayer layer, uint32 pipelineId, uint32 materialId, uint32 meshId, float depth);
+
+		void submit(uint64 sortKey, const RenderPacket& packet);
+
+		template <typename T>
+		void submit(uint64 sortKey, RenderPacket packet, vk::ShaderStageFlags stages, const T& pushConstants)
+		{
+			packet.pushConstantsStages = stages;
+			packet.pushConstantsOffset = mPushConstants.size();
+			packet.pushConstantsSize = sizeof(T);
+
+			const auto bytes = reinterpret_cast<const std::byte*>(&pushConstants);
+			mPushConstants.insert(mPushConstants.end(), bytes, bytes + sizeof(T));
+
+			submit(sortKey, packet);
+		}
+
+		// commands recorded outside of render pass right before late opaque layer, e.g. depth reduction and culling reading it
+		void submitPassBreak(std::function<void(vk::CommandBuffer)> commands);
+
+		// sorts and records all submitted packets, queue cleared afterwards
+		// with pass callbacks given, pass ended before late opaque layer, break commands recorded and pass resumed
+		void execute(vk::CommandBuffer commandBuffer, const std::function<void()>& endPass = {}, const std::function<void()>& resumePass = {});
+
+		void clear();
+
+		// stats of last execute
+		const RenderQueueStats& getStats() const { return mStats; }
+
+	private:
+		struct SortItem
+		{
+			uint64 key{};
+			uint32 index{};
+		};
+
+		// LSD radix sort by 8 bits, passes with single bucket skipped
+		void sort();
+
+		std::vector<RenderPacket> mPackets{};
+		std::vector<std::byte> mPushConstants{};
+		std::vector<std::function<void(vk::CommandBuffer)>> mPassBreaks{};
+
+		std::vector<SortItem> mSortItems{};
+		std::vector<SortItem> mSortScratch{};
+
+		RenderQueueStats mStats{};
+	};
+} // namespace lune::vulkan
@@ -22,9 +22,13 @@ namespace lune::vulkan
 
 		vk::Sampler getSampler() const { return mSampler; }
 
+		// index in bindless heap samplers array
+		uint32 getBindlessIndex() const { return mBindlessIndex; }
+
 	private:
 		void init(const vk::SamplerCreateInfo& createInfo);
 
 		vk::Sampler mSampler{};
+		uint32 mBindlessIndex{};
 	};
 } // namespace lune::vulkan
\ No newline at end of file
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "lune/core/math.hxx"
+#include "lune/core/sdl.hxx"
+#include "lune/lune.hxx"
+
+#include "vulkan_core.hxx"
+
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace lune::vulkan
+{
+	using UniqueTextureAtlas = std::unique_ptr<class TextureAtlas>;
+
+	struct AtlasRegion
+	{
+		uint32 page{};
+		SDL_Rect rect{};		// in page pixels, without padding
+		lnm::vec4 uvRect{};		// uv offset (xy) and size (zw) in page texture
+	};
+
+	// packs many small images into few large RGBA pages with skyline packer
+	// images may be added at any time, new page created once image doesn't fit in existing ones
+	// pixels kept on cpu to upload changed regions on commit and to save atlas to disk
+	class TextureAtlas final
+	{
+	public:
+		static constexpr uint32 DefaultPageSize = 2048;
+
+		// transparent border around each image, keeps linear filtering from bleeding neighbours in
+		static constexpr uint32 Padding = 1;
+
+		TextureAtlas() = default;
+		TextureAtlas(const TextureAtlas&) = delete;
+		TextureAtlas(TextureAtlas&&) = delete;
+		~TextureAtlas();
+
+		static UniqueTextureAtlas create(uint32 pageSize = DefaultPageSize);
+
+		// loads atlas written with save, nullptr if index or any of pages missing or invalid
+		static UniqueTextureAtlas load(const std::filesystem::path& indexPath);
+
+		// copies image into atlas, false if name already taken or image bigger than page
+		bool add(const std::string& name, const SDL_Surface* surface);
+
+		// uploads images added since last commit, bounds of all changes of each page in one upload
+		// whole page uploaded instead when queue ownership transfer required, see TextureImage::updateRegion
+		void commit();
+
+		// writes index file and one png per page next to it (<index stem>_<page>.png)
+		bool save(const std::filesystem::path& indexPath) const;
+
+		const AtlasRegion* findRegion(std::string_view name) const;
+		const std::map<std::string, AtlasRegion, std::less<>>& getRegions() const { return mRegions; }
+
+		uint32 getPageCount() const { return mPages.size(); }
+		const SharedTextureImage& getPageTexture(uint32 page) const;
+
+	private:
+		struct Page;
+
+		Page& addPage();
+
+		// packs rect into first page with space, false if none has space
+		bool pack(uint32 width, uint32 height, uint32& outPage, SDL_Rect& outRect);
+
+		uint32 mPageSize{};
+		std::vector<std::unique_ptr<Page>> mPages{};
+		std::map<std::string, AtlasRegion, std::less<>> mRegions{};
+	};
+} // namespace lune::vulkan
@@ -9,6 +9,11 @@
 #include <memory>
 #include <span>
 
+namespace lune
+{
+	struct Ktx2Texture;
+} // namespace lune
+
 namespace lune::vulkan
 {
 	using UniqueTextureImage = std::unique_ptr<class TextureImage>;
@@ -21,28 +26,104 @@ namespace lune::vulkan
 		TextureImage(TextureImage&&) = delete;
 		~TextureImage();
 
-		static UniqueTextureImage create(std::span<const SDL_Surface*, 6> cubeSurfaces);
+		// full mip chain generated on upload unless disabled, blitted on gpu or box filtered on cpu when format can't be blitted
+		static UniqueTextureImage create(std::span<const SDL_Surface*, 6> cubeSurfaces, bool mipmaps = true);
+
+		static UniqueTextureImage create(const SDL_Surface* surface, bool mipmaps = true);
+
+		// levels uploaded as stored, compressed ones included, null if device can't sample format
+		static UniqueTextureImage create(const Ktx2Texture& texture);
+
+		// streamed texture, whole mip chain kept on cpu and only mips from first resident one down live on gpu
+		// mips no larger than resident size live in small image kept for good, null if device can't sample format, see TextureStreamer
+		static UniqueTextureImage createStreamed(std::shared_ptr<const Ktx2Texture> mips, uint32 residentSize);
+
+		// block compressed formats need device feature, others optimal tiling support
+		static bool canSample(vk::Format format);
 
-		static UniqueTextureImage create(const SDL_Surface* surface);
+		// full chain of 2d surface box filtered on cpu, mips of streamed textures made from plain images
+		static Ktx2Texture buildMipChain(const SDL_Surface* surface);
 
 		void destroy();
 
+		// reuploads rect of surface with same size as texture, texture must not be in use by current frame
+		// whole surface uploaded if contents can't be kept (queue ownership transfer required)
+		// only first mip updated, textures updated in place better created without mipmaps
+		void updateRegion(const SDL_Surface* surface, const SDL_Rect& rect);
+
+		// finer mips than small image has live in image of full mip chain, allocated on first such request
+		// only levels never uploaded to it are uploaded, frames don't wait for them and old view stays bound meanwhile
+		// view starting at first mip swapped in at same bindless index by updateStreaming once upload completed
+		// coarser first mip narrows view without upload, going back to small image releases full one
+		// ignored while upload pending, returns bytes uploaded
+		vk::DeviceSize setFirstResidentMip(uint32 firstMip);
+
+		// swaps in view of pending upload once its ticket completed, called by streamer every update
+		void updateStreaming();
+		bool isUploadPending() const { return mUploadPending; }
+
+		bool isStreamed() const { return mStreamedMips != nullptr; }
+		uint32 getFirstResidentMip() const { return mFirstResidentMip; }
+		uint32 getSmallImageMip() const { return mSmallImageMip; }
+		const std::shared_ptr<const Ktx2Texture>& getStreamedMips() const { return mStreamedMips; }
+
+		// bytes of gpu memory taken by image
+		vk::DeviceSize getMemorySize() const;
+
 		vk::Format getFormat() const { return mFormat; }
-		vk::Image getImage() const { return mImage; }
-		vk::ImageView getImageView() const { return mImageView; }
+		uint32 getMipLevels() const { return mStreamImageView ? static_cast<uint32>(mStreamedMips->levels.size()) - mFirstResidentMip : mMipLevels; } // resident ones for streamed textures
+		vk::Image getImage() const { return mStreamImageView ? mStreamImage : mImage; }
+		vk::ImageView getImageView() const { return mStreamImageView ? mStreamImageView : mImageView; }
+
+		UploadTicket getUploadTicket() const { return mUploadTicket; }
+
+		// index in bindless heap textures array
+		uint32 getBindlessIndex() const { return mBindlessIndex; }
 
 	private:
-		void init(std::span<const SDL_Surface*> surfaces);
+		void init(std::span<const SDL_Surface*> surfaces, bool mipmaps);
+		void init(const Ktx2Texture& texture);
+
+		// creates image holding levels from first mip down and uploads them
+		void initLevels(const Ktx2Texture& texture, uint32 firstMip);
+
+		// levels from first to end one uploaded into image whose level zero is image mip of texture
+		UploadTicket uploadLevels(const Ktx2Texture& texture, vk::Image image, uint32 imageMip, uint32 firstLevel, uint32 endLevel);
+
+		// full mip chain image of streamed texture released through delete queue
+		void releaseStreamImage();
+
+		// view of full image from first mip replaces previous one in bindless heap
+		void swapStreamView(uint32 firstMip);
 
-		void createImage(vk::ImageCreateFlagBits flags, uint32 layerCount, vk::Extent3D extent);
-		void createImageView(vk::ImageViewType type, uint32 layerCount);
+		void createImage(vk::ImageCreateFlagBits flags, uint32 layerCount, vk::Extent3D extent, uint32 mipLevels, vk::Image& outImage, VmaAllocation& outAllocation) const;
+		vk::ImageView createImageView(vk::Image image, vk::ImageViewType type, uint32 layerCount, uint32 baseMip, uint32 mipLevels) const;
 
 		void copyPixelsToImage(std::span<const SDL_Surface*> surfaces, uint32 layerCount, vk::Extent3D extent);
 
+		// all mips box filtered from surfaces and uploaded at once
+		void copyMipsToImage(std::span<const SDL_Surface*> surfaces, uint32 layerCount, vk::Extent3D extent);
+
 		vk::Format mFormat{};
+		uint32 mMipLevels{1};
 		vk::Image mImage{};
 		VmaAllocation mVmaAllocation{};
 		vk::ImageView mImageView{};
 		vk::Sampler mSampler{};
+
+		UploadTicket mUploadTicket{};
+
+		uint32 mBindlessIndex{};
+
+		std::shared_ptr<const Ktx2Texture> mStreamedMips{};
+		uint32 mFirstResidentMip{};
+		uint32 mSmallImageMip{}; // first mip of small image, image above holds that one and ones after it
+
+		// full mip chain of streamed texture, levels from uploaded mip down hold data, view from first resident mip
+		vk::Image mStreamImage{};
+		VmaAllocation mStreamAllocation{};
+		vk::ImageView mStreamImageView{};
+		uint32 mUploadedMip{};
+		bool mUploadPending{}; // levels from uploaded mip recorded but not complete yet, not in view
 	};
 } // namespace lune::vulkan
\ No newline at end of file
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "lune/lune.hxx"
+
+#include "vulkan_core.hxx"
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace lune
+{
+	struct Ktx2Texture;
+} // namespace lune
+
+namespace lune::vulkan
+{
+	struct TextureStreamerStats
+	{
+		uint32 textureCount{};
+		uint32 pendingCount{}; // textures with finer mips wanted than resident after update
+		uint32 upgradeCount{}; // during last update
+		uint32 evictionCount{};
+		vk::DeviceSize residentBytes{};
+		vk::DeviceSize wantedBytes{}; // with every wanted mip resident
+		vk::DeviceSize uploadedBytes{}; // during last update
+
+		// device local memory streamed textures keep under, part of vma budget
+		vk::DeviceSize limitBytes{};
+		vk::DeviceSize usageBytes{};
+	};
+
+	// decides which mips of streamed textures live on gpu, see TextureImage::createStreamed
+	// renderers report screen size of surfaces textures cover, mip with about one texel per pixel of it becomes wanted
+	// finer mips uploaded one level at a time per texture within upload budget, most lacking textures first
+	// uploads go in background batches, texture keeps old view till its upload completes and takes next step only then
+	// levels uploaded once per full mip chain image, mips brought back after eviction only widen its view again
+	// device local usage over part of vma budget evicts mips without uploads, ones not wanted anymore go before ones not seen for longest
+	// not thread safe, expected to be used from main thread only
+	class TextureStreamer final
+	{
+	public:
+		struct Settings
+		{
+			// bytes of mips uploaded per update, single upgrade always allowed even if larger
+			vk::DeviceSize uploadBudget{8 * 1024 * 1024};
+
+			// part of device local budget textures fill before eviction
+			float budgetUsage{0.8f};
+
+			// mips of this size and smaller always resident
+			uint32 residentSize{64};
+
+			// updates wanted mips survive without being requested
+			uint32 retainUpdates{120};
+		};
+
+		TextureStreamer() = default;
+		TextureStreamer(const TextureStreamer&) = delete;
+		TextureStreamer(TextureStreamer&&) = delete;
+		~TextureStreamer() = default;
+
+		void shutdown();
+
+		// texture created with smallest mips resident, null if device can't sample format of mips
+		SharedTextureImage add(Ktx2Texture&& mips);
+
+		// largest size of frame counts, texture assumed to span surface once, textures not streamed ignored
+		void requestScreenSize(const TextureImage* texture, float screenSize);
+
+		// called by vulkan subsystem once frames in flight completed and before new one recorded, within background uploads
+		void update();
+
+		Settings& getSettings() { return mSettings; }
+		const TextureStreamerStats& getStats() const { return mStats; }
+		uint32 getTextureCount() const { return mEntries.size(); }
+
+	private:
+		struct Entry
+		{
+			std::weak_ptr<TextureImage> texture{};
+			uint32 wantedMip{};
+			float requestedSize{}; // since last update
+			float lastSize{};
+			uint64 lastRequest{}; // update counter of last request
+		};
+
+		struct Candidate
+		{
+			SharedTextureImage texture{};
+			Entry* entry{};
+		};
+
+		uint32 findWantedMip(const Ktx2Texture& mips, float screenSize) const;
+		uint32 findResidentMip(const Ktx2Texture& mips) const;
+
+		// evicts from candidates till usage gets under limit
+		void evict(std::vector<Candidate>& candidates, vk::DeviceSize limit, vk::DeviceSize& usage);
+		void upgrade(std::vector<Candidate>& candidates, vk::DeviceSize limit, vk::DeviceSize& usage);
+
+		std::unordered_map<const TextureImage*, Entry> mEntries{};
+		uint64 mUpdateCount{};
+
+		Settings mSettings{};
+		TextureStreamerStats mStats{};
+	};
+} // namespace lune::vulkan
+
+namespace lune
+{
+	extern "C++" vulkan::TextureStreamer& getVulkanTextureStreamer() noexcept;
+} // namespace lune
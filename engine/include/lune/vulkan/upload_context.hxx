@@ -0,0 +1,127 @@
+#pragma once
+
+#include "lune/lune.hxx"
+
+#include "buffer.hxx"
+#include "vulkan_core.hxx"
+
+#include <deque>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace lune::vulkan
+{
+	// batches staging copies into single submission on transfer queue
+	// completion tracked with timeline semaphore, staging memory recycled once batch completed
+	// if transfer queue family differs from graphics one, ownership released on transfer queue and acquired on graphics queue
+	// not thread safe, expected to be used from main thread only
+	class UploadContext final
+	{
+	public:
+		UploadContext() = default;
+		UploadContext(const UploadContext&) = delete;
+		UploadContext(UploadContext&&) = delete;
+		~UploadContext() = default;
+
+		void init();
+		void shutdown();
+
+		// copies data to staging memory and records copy to buffer in current batch
+		UploadTicket uploadBuffer(vk::Buffer dstBuffer, vk::DeviceSize dstOffset, const void* data, vk::DeviceSize size);
+
+		// copies data to staging memory and records copy to image in current batch, regions bufferOffset relative to data
+		// image transitioned from oldLayout to ShaderReadOnlyOptimal layout, contents outside regions kept only if oldLayout is not Undefined
+		// keeping contents with ownership transfer required not supported, nothing recorded and empty ticket returned then
+		UploadTicket uploadImage(vk::Image dstImage, const vk::ImageSubresourceRange& range, std::span<const vk::BufferImageCopy> regions, const void* data, vk::DeviceSize size, vk::ImageLayout oldLayout = vk::ImageLayout::eUndefined);
+
+		// as uploadImage into undefined image, regions fill first mip of range and its other mips blitted one from another with linear filter
+		// blits need graphics queue, recorded after acquire when ownership transfer required
+		// format must support linear filtered blits with optimal tiling, image usage must include transfer source
+		UploadTicket uploadImageWithMips(vk::Image dstImage, const vk::ImageSubresourceRange& range, vk::Extent2D extent, std::span<const vk::BufferImageCopy> regions, const void* data, vk::DeviceSize size);
+
+		// submit current batch (if any), returns ticket for everything recorded so far
+		UploadTicket submit();
+
+		// uploads recorded until endBackground go to own batches frames don't wait for, their users poll tickets instead
+		// e.g. streamed mips swapped in once complete while old ones stay bound
+		void beginBackground();
+		void endBackground();
+
+		// ticket frame waits for before sampling, covers all uploads recorded outside background ones
+		// and background ones observed complete so far, waiting for those costs nothing
+		UploadTicket getFrameTicket() const;
+
+		// ticket of current batch, last submitted one when nothing recording
+		UploadTicket getRecordingTicket() const { return mRecording ? mRecording->ticket : mSubmittedValue; }
+
+		// always true after shutdown, everything waited for then
+		bool isComplete(UploadTicket ticket) const;
+
+		// blocks until ticket complete, submits current batch if ticket belongs to it
+		// tickets never returned by this context logged and not waited for
+		void wait(UploadTicket ticket);
+
+		// release resources of completed batches
+		void collect();
+
+		// signaled with ticket value once uploads visible to graphics queue
+		vk::Semaphore getSemaphore() const { return mSemaphore; }
+		UploadTicket getSubmittedTicket() const { return mSubmittedValue; }
+
+		bool isOwnershipTransferRequired() const { return mOwnershipTransfer; }
+
+	private:
+		struct StagingPage
+		{
+			UniqueBuffer buffer{};
+			uint8* data{};
+			vk::DeviceSize used{};
+		};
+
+		struct Batch
+		{
+			UploadTicket ticket{};
+			vk::CommandBuffer commandBuffer{};
+			vk::CommandBuffer acquireCommandBuffer{}; // graphics queue, only with ownership transfer
+			std::vector<StagingPage> pages{};
+			bool required{}; // something recorded outside background uploads, frames wait for it
+		};
+
+		Batch& getRecordingBatch();
+
+		// returns staging page with enough space and writes data to it at returned offset
+		StagingPage& writeStaging(const void* data, vk::DeviceSize size, vk::DeviceSize& outOffset);
+
+		StagingPage createStagingPage(vk::DeviceSize size);
+		void releaseStagingPage(StagingPage&& page);
+
+		vk::CommandBuffer allocateCommandBuffer(vk::CommandPool pool);
+
+		// all mips of range expected in TransferDstOptimal with first one written, left in ShaderReadOnlyOptimal
+		void recordMipBlits(vk::CommandBuffer commandBuffer, vk::Image image, const vk::ImageSubresourceRange& range, vk::Extent2D extent);
+
+		bool mOwnershipTransfer{};
+
+		vk::CommandPool mCommandPool{};
+		vk::CommandPool mAcquireCommandPool{};
+
+		vk::Semaphore mSemaphore{};
+		vk::Semaphore mTransferSemaphore{};
+
+		UploadTicket mSubmittedValue{};
+		UploadTicket mRequiredValue{};
+		bool mBackground{};
+
+		std::optional<Batch> mRecording{};
+		std::deque<Batch> mInFlight{};
+
+		std::vector<StagingPage> mFreePages{};
+		std::vector<Batch> mFreeBatches{};
+	};
+} // namespace lune::vulkan
+
+namespace lune
+{
+	extern "C++" vulkan::UploadContext& getVulkanUploadContext() noexcept;
+} // namespace lune
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "lune/lune.hxx"
+
+#include "vulkan_core.hxx"
+
+#include <chrono>
+#include <functional>
+#include <vector>
+
+namespace lune::vulkan
+{
+	struct UploadSchedulerStats
+	{
+		uint32 queuedCount{}; // after last drain
+		vk::DeviceSize queuedBytes{};
+		uint32 drainedCount{}; // during last drain
+		vk::DeviceSize drainedBytes{};
+		float drainMs{}; // spent recording jobs during last drain
+
+		// from enqueue till recorded, of jobs drained during last drain
+		float averageLatencyMs{};
+		float maxLatencyMs{};
+
+		// of longest waiting job still queued
+		float oldestWaitMs{};
+	};
+
+	// spreads uploads of big batches of assets over frames, jobs record their uploads into upload context once drained
+	// higher priority drained first, earlier enqueued first among equal ones, so assets near camera may jump queue
+	// each drain stops once byte or time budget spent, single job always drained even if larger
+	// not thread safe, expected to be used from main thread only
+	class UploadScheduler final
+	{
+	public:
+		// records about size bytes of uploads, resources written by it usable once upload context ticket of drain completes
+		using Job = std::function<void()>;
+
+		struct Settings
+		{
+			// bytes of jobs drained per frame
+			vk::DeviceSize byteBudget{16 * 1024 * 1024};
+
+			// time spent recording jobs per frame
+			float timeBudgetMs{2.f};
+		};
+
+		UploadScheduler() = default;
+		UploadScheduler(const UploadScheduler&) = delete;
+		UploadScheduler(UploadScheduler&&) = delete;
+		~UploadScheduler() = default;
+
+		// drops queued jobs without running them
+		void shutdown();
+
+		// jobs of same group reprioritized or cancelled together, group zero belongs to no group
+		uint64 createGroup() { return ++mGroupCount; }
+
+		void enqueue(Job job, vk::DeviceSize size, float priority = 0.f, uint64 group = 0);
+
+		void setGroupPriority(uint64 group, float priority);
+
+		// queued jobs of group dropped without running them
+		void cancelGroup(uint64 group);
+
+		// called by vulkan subsystem before frame recorded, uploads submitted as background batch frame doesn't wait for
+		void drain();
+
+		Settings& getSettings() { return mSettings; }
+		const UploadSchedulerStats& getStats() const { return mStats; }
+		uint32 getQueuedCount() const { return mJobs.size(); }
+
+	private:
+		struct QueuedJob
+		{
+			Job job{};
+			vk::DeviceSize size{};
+			float priority{};
+			uint64 group{};
+			uint64 sequence{}; // keeps order of enqueue among equal priorities
+			std::chrono::steady_clock::time_point enqueueTime{};
+		};
+
+		std::vector<QueuedJob> mJobs{};
+		uint64 mSequence{};
+		uint64 mGroupCount{};
+
+		Settings mSettings{};
+		UploadSchedulerStats mStats{};
+	};
+} // namespace lune::vulkan
+
+namespace lune
+{
+	extern "C++" vulkan::UploadScheduler& getVulkanUploadScheduler() noexcept;
+} // namespace lune
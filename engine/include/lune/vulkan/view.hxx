@@ -1,7 +1,9 @@
 #pragma once
 
 #include "lune/vulkan/depth_image.hxx"
+#include "lune/vulkan/depth_pyramid.hxx"
 #include "lune/vulkan/msaa_image.hxx"
+#include "lune/vulkan/render_queue.hxx"
 
 #include "vulkan_core.hxx"
 
@@ -33,6 +35,13 @@ namespace lune::vulkan
 		void beginRenderPass();
 		void sumbit();
 
+		// pyramid of depth drawn before late opaque layer, pass split in two from next frame on while enabled
+		// ignored when depth attachment can't be sampled
+		void setDepthPyramidEnabled(bool enabled) { mDepthPyramidEnabled = enabled; }
+
+		// null unless current frame splits its pass, built by whoever needs it during pass break
+		DepthPyramid* getDepthPyramid() const { return mSplitPass ? mDepthPyramid.get() : nullptr; }
+
 		vk::Extent2D getCurrentExtent() const { return mCurrentExtent; };
 		vk::SurfaceKHR getSurface() const { return mSurface; }
 		uint32 getImageCount() const { return mSwapchainImageViews.size(); }
@@ -43,6 +52,10 @@ namespace lune::vulkan
 		vk::CommandBuffer getCurrentImageCmdBuffer() const { return mImageCommandBuffer; }
 		vk::CommandBuffer getCurrentImageCopyCmdBuffer() const { return mCopyCommandBuffer; }
 
+		// draws submitted by render systems, executed in sumbit before imgui
+		RenderQueue& getRenderQueue() { return mRenderQueue; }
+		const RenderQueue& getRenderQueue() const { return mRenderQueue; }
+
 		void updateViewSize();
 
 	private:
@@ -60,6 +73,9 @@ namespace lune::vulkan
 
 		void createFramebuffers();
 
+		// render pass begun with split or resumed variant, resumed one draws on top of split one
+		void beginRenderPass(vk::RenderPass renderPass);
+
 		void createFences();
 
 		void createSemaphores();
@@ -80,8 +96,15 @@ namespace lune::vulkan
 		vk::CommandBuffer mImageCommandBuffer{};
 		vk::CommandBuffer mCopyCommandBuffer{};
 
+		RenderQueue mRenderQueue{};
+
 		UniqueDepthImage mDepthImage;
 
+		// created or destroyed on next beginRenderPass, never while frame may still use it
+		UniqueDepthPyramid mDepthPyramid;
+		bool mDepthPyramidEnabled{};
+		bool mSplitPass{};
+
 		UniqueMsaaImage mMsaaImage;
 
 		vk::SurfaceKHR mSurface;
@@ -3,7 +3,80 @@
 #include "vk_mem_alloc.h"
 #include "vulkan_core.hxx"
 
+#include <vector>
+
 namespace vma
 {
 	vk::DeviceSize getAllocationSize(VmaAllocation allocation);
-}
\ No newline at end of file
+
+	// custom pool sub-allocating small uniform and storage buffers of matching size class
+	// returns nullptr if buffer is not eligible for pooling (too large, dedicated memory requested, etc.)
+	VmaPool findSmallBufferPool(VmaAllocator allocator, const vk::BufferCreateInfo& bufferCreateInfo, const VmaAllocationCreateInfo& allocationCreateInfo);
+
+	// destroys pools created by findSmallBufferPool, must be called before allocator destroyed
+	void destroySmallBufferPools(VmaAllocator allocator);
+
+	struct PoolStatistics
+	{
+		vk::DeviceSize sizeClass{};
+		uint32 memoryTypeIndex{};
+		uint32 allocationCount{};
+		uint32 blockCount{};
+		vk::DeviceSize allocationBytes{};
+		vk::DeviceSize blockBytes{};
+	};
+
+	struct HeapStatistics
+	{
+		uint32 heapIndex{};
+		bool deviceLocal{};
+		uint32 blockCount{};
+		vk::DeviceSize allocationBytes{};
+		vk::DeviceSize blockBytes{};
+		vk::DeviceSize largestUnusedRange{};
+
+		// 0 - free space is one contiguous range, close to 1 - free space scattered between many small ranges
+		float fragmentation{};
+	};
+
+	struct Statistics
+	{
+		uint32 allocationCount{};
+		uint32 blockCount{}; // number of VkDeviceMemory objects
+		uint32 unusedRangeCount{};
+		vk::DeviceSize allocationBytes{};
+		vk::DeviceSize blockBytes{};
+
+		std::vector<HeapStatistics> heaps{};
+		std::vector<PoolStatistics> smallBufferPools{};
+	};
+
+	// walks every block and allocation, too slow to be called every frame
+	Statistics calculateStatistics(VmaAllocator allocator);
+
+	// cheap numbers kept by allocator, fine to query every frame
+	struct HeapBudget
+	{
+		uint32 heapIndex{};
+		bool deviceLocal{};
+		uint32 allocationCount{};
+		vk::DeviceSize allocationBytes{};
+		vk::DeviceSize blockBytes{};
+		vk::DeviceSize usage{};
+		vk::DeviceSize budget{};
+	};
+
+	std::vector<HeapBudget> getHeapBudgets(VmaAllocator allocator);
+
+	// memory budget bit of allocator keeps numbers close to what driver reports, vma estimates them otherwise
+	struct Budget
+	{
+		vk::DeviceSize usage{}; // bytes of process in device local heaps
+		vk::DeviceSize budget{}; // bytes process can use there before trouble
+	};
+
+	// sum over device local heaps
+	Budget getDeviceLocalBudget(VmaAllocator allocator);
+
+	void logStatistics(VmaAllocator allocator);
+} // namespace vma
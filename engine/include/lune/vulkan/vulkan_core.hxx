@@ -16,13 +16,18 @@ namespace lune
 	namespace vulkan
 	{
 		using SharedMaterial = std::shared_ptr<class Material>;
+		using SharedPipeline = std::shared_ptr<class Pipeline>;
 		using SharedGraphicsPipeline = std::shared_ptr<class GraphicsPipeline>;
+		using SharedComputePipeline = std::shared_ptr<class ComputePipeline>;
 		using SharedShader = std::shared_ptr<class Shader>;
 		using SharedPrimitive = std::shared_ptr<class Primitive>;
 		using SharedTextureImage = std::shared_ptr<class TextureImage>;
 		using SharedSampler = std::shared_ptr<class Sampler>;
 		using SharedBuffer = std::shared_ptr<class Buffer>;
 
+		// value of upload context timeline semaphore, upload complete once semaphore reached it
+		using UploadTicket = uint64;
+
 		extern "C++" vk::detail::DispatchLoaderDynamic& getDynamicLoader() noexcept;
 		extern "C++" void loadVulkanDynamicFunctions();
 	} // namespace vulkan
@@ -44,6 +49,10 @@ namespace lune
 
 		vk::RenderPass renderPass{};
 
+		// same pass split in two around commands recorded outside of it, see RenderQueue::submitPassBreak
+		vk::RenderPass splitRenderPass{};
+		vk::RenderPass resumeRenderPass{};
+
 		VmaAllocator vmaAllocator{};
 	};
 
@@ -52,6 +61,15 @@ namespace lune
 		vk::Format colorFormat{};
 		vk::Format depthFormat{};
 		vk::SampleCountFlagBits sampleCount{};
+
+		// vkCmdDrawIndexedIndirectCount with multi draw and first instance supported, enables gpu driven draws
+		bool drawIndirectCount{};
+
+		// depth attachment can be sampled, required to build depth pyramid for occlusion culling
+		bool sampledDepth{};
+
+		// BC1-BC7 block compressed textures can be sampled, cooked textures skipped without it
+		bool textureCompressionBC{};
 	};
 
 	struct VulkanDeleteQueue;
@@ -5,7 +5,9 @@
 // also subsystem maybe be not available on some configurations
 
 #include "lune/core/engine_subsystem.hxx"
+#include "lune/vulkan/texture_atlas.hxx"
 #include "lune/vulkan/view.hxx"
+#include "lune/vulkan/vma.hxx"
 
 #include "vulkan_core.hxx"
 
@@ -22,6 +24,10 @@ namespace lune
 		uint32 imageIndex{};
 		vk::CommandBuffer copyCommandBuffer{};
 		vk::CommandBuffer renderCommandBuffer{};
+		vulkan::RenderQueue* renderQueue{};
+
+		// set while view splits its pass, see View::setDepthPyramidEnabled
+		vulkan::DepthPyramid* depthPyramid{};
 	};
 
 	namespace vulkan
@@ -64,18 +70,39 @@ namespace lune
 		void addPipeline(std::string name, vulkan::SharedGraphicsPipeline pipeline);
 		vulkan::SharedGraphicsPipeline findPipeline(const std::string& name);
 
+		void addComputePipeline(std::string name, vulkan::SharedComputePipeline pipeline);
+		vulkan::SharedComputePipeline findComputePipeline(const std::string& name);
+
 		void addPrimitive(std::string name, vulkan::SharedPrimitive primitive);
 		vulkan::SharedPrimitive findPrimitive(const std::string& name);
 
 		void addTextureImage(std::string name, vulkan::SharedTextureImage texImage);
 		vulkan::SharedTextureImage findTextureImage(const std::string& name);
 
+		// atlas pages committed every frame, images added to atlas later on become available on next frame
+		void addTextureAtlas(std::string name, vulkan::UniqueTextureAtlas atlas);
+		vulkan::TextureAtlas* findTextureAtlas(const std::string& name);
+
+		// region of any of atlases first, then standalone texture, sprites look their images up here
+		// built in sprite images live in "lune::sprites" atlas, apps may add theirs to it too
+		// outUvRect is offset (xy) and size (zw) of image in returned texture
+		vulkan::SharedTextureImage findImage(const std::string& name, lnm::vec4& outUvRect);
+
 		void addSampler(std::string name, vulkan::SharedSampler sampler);
 		vulkan::SharedSampler findSampler(const std::string& name);
 
 		void addMaterial(std::string name, vulkan::SharedMaterial material);
 		vulkan::SharedMaterial findMaterial(const std::string& name);
 
+		// walks every allocation, not meant for each frame
+		vma::Statistics getMemoryStatistics() const;
+
+		// usage and budget of each heap, cheap enough for each frame
+		std::vector<vma::HeapBudget> getMemoryBudgets() const;
+
+		// stats of render queue of view from its last frame
+		vulkan::RenderQueueStats getRenderQueueStats(uint32 viewId) const;
+
 		bool beginNextFrame(uint32 viewId);
 		FrameInfo getFrameInfo();
 		void beginRenderPass();
@@ -91,11 +118,14 @@ namespace lune
 		std::unordered_map<std::filesystem::path, vulkan::SharedShader> mShaders{};
 
 		std::unordered_map<std::string, vulkan::SharedGraphicsPipeline> mGraphicsPipelines{};
+		std::unordered_map<std::string, vulkan::SharedComputePipeline> mComputePipelines{};
 
 		std::unordered_map<std::string, vulkan::SharedPrimitive> mPrimitives{};
 
 		std::unordered_map<std::string, vulkan::SharedTextureImage> mTextureImages{};
 
+		std::unordered_map<std::string, vulkan::UniqueTextureAtlas> mTextureAtlases{};
+
 		std::unordered_map<std::string, vulkan::SharedSampler> mSamplers{};
 
 		std::unordered_map<std::string, vulkan::SharedMaterial> mMaterials{};
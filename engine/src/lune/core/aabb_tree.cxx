@@ -0,0 +1,558 @@
+#include "lune/core/aabb_tree.hxx"
+
+#include <algorithm>
+
+namespace lune
+{
+	enum class TreeOverlap : uint8
+	{
+		Outside,
+		Intersects,
+		Contains // every leaf of subtree overlaps, no need to test them
+	};
+
+	static BoundingBox unionBox(const BoundingBox& a, const BoundingBox& b)
+	{
+		return BoundingBox{lnm::min(a.min, b.min), lnm::max(a.max, b.max)};
+	}
+
+	// half of surface area, enough for comparing costs as long as every cost of tree uses it
+	static float halfSurfaceArea(const BoundingBox& box)
+	{
+		const lnm::vec3 size = box.max - box.min;
+		return size.x * size.y + size.y * size.z + size.z * size.x;
+	}
+
+	static bool containsBox(const BoundingBox& outer, const BoundingBox& inner)
+	{
+		return lnm::all(lnm::lessThanEqual(outer.min, inner.min)) && lnm::all(lnm::greaterThanEqual(outer.max, inner.max));
+	}
+
+	static bool overlapsBox(const BoundingBox& a, const BoundingBox& b)
+	{
+		return lnm::all(lnm::lessThanEqual(a.min, b.max)) && lnm::all(lnm::greaterThanEqual(a.max, b.min));
+	}
+
+	// slab test, entry distance clamped to zero for rays starting inside
+	static bool intersectRay(const BoundingBox& box, const lnm::vec3& origin, const lnm::vec3& invDirection, float maxDistance, float& outEntry)
+	{
+		const lnm::vec3 t1 = (box.min - origin) * invDirection;
+		const lnm::vec3 t2 = (box.max - origin) * invDirection;
+		const lnm::vec3 tNear = lnm::min(t1, t2);
+		const lnm::vec3 tFar = lnm::max(t1, t2);
+		outEntry = std::max({tNear.x, tNear.y, tNear.z, 0.f});
+		return outEntry <= std::min({tFar.x, tFar.y, tFar.z, maxDistance});
+	}
+} // namespace lune
+
+uint32 lune::AabbTree::insert(const BoundingBox& box, uint64 userData, float margin)
+{
+	const uint32 leaf = insertDeferred(box, userData, margin);
+	mDeferredLeaves.pop_back();
+	insertLeaf(leaf);
+	return leaf;
+}
+
+uint32 lune::AabbTree::insertDeferred(const BoundingBox& box, uint64 userData, float margin)
+{
+	const uint32 leaf = allocateNode();
+	Node& node = mNodes[leaf];
+	node.box = BoundingBox{box.min - lnm::vec3(margin), box.max + lnm::vec3(margin)};
+	node.userData = userData;
+	node.height = 0;
+
+	mDeferredLeaves.push_back(leaf);
+	++mProxyCount;
+	return leaf;
+}
+
+void lune::AabbTree::remove(uint32 proxy)
+{
+	if (proxy != mRoot && mNodes[proxy].parent == NullNode)
+		std::erase(mDeferredLeaves, proxy);
+	else
+		removeLeaf(proxy);
+
+	freeNode(proxy);
+	--mProxyCount;
+}
+
+bool lune::AabbTree::move(uint32 proxy, const BoundingBox& box, float margin)
+{
+	const bool deferred = proxy != mRoot && mNodes[proxy].parent == NullNode;
+	if (!deferred && containsBox(mNodes[proxy].box, box))
+		return false;
+
+	if (!deferred)
+		removeLeaf(proxy);
+
+	mNodes[proxy].box = BoundingBox{box.min - lnm::vec3(margin), box.max + lnm::vec3(margin)};
+
+	if (!deferred)
+		insertLeaf(proxy);
+	return true;
+}
+
+void lune::AabbTree::rebuild()
+{
+	std::vector<uint32> leaves{};
+	leaves.reserve(mProxyCount);
+	for (uint32 i = 0; i < mNodes.size(); ++i)
+	{
+		if (mNodes[i].height == 0)
+			leaves.push_back(i);
+		else if (mNodes[i].height > 0)
+			freeNode(i);
+	}
+
+	mDeferredLeaves.clear();
+	mRoot = leaves.empty() ? NullNode : buildTopDown(leaves.data(), leaves.size());
+	if (mRoot != NullNode)
+		mNodes[mRoot].parent = NullNode;
+}
+
+void lune::AabbTree::clear()
+{
+	mNodes.clear();
+	mDeferredLeaves.clear();
+	mRoot = NullNode;
+	mFreeList = NullNode;
+	mProxyCount = 0;
+}
+
+template <typename Classify>
+void lune::AabbTree::queryTree(Classify&& classify, std::vector<uint64>& outUserData) const
+{
+	if (mRoot == NullNode)
+		return;
+
+	std::vector<uint32> stack{};
+	stack.reserve(64);
+	stack.push_back(mRoot);
+	while (!stack.empty())
+	{
+		const uint32 index = stack.back();
+		stack.pop_back();
+
+		const Node& node = mNodes[index];
+		const TreeOverlap overlap = classify(node.box);
+		if (overlap == TreeOverlap::Outside)
+			continue;
+
+		if (node.isLeaf())
+		{
+			outUserData.push_back(node.userData);
+		}
+		else if (overlap == TreeOverlap::Contains)
+		{
+			collectLeaves(index, outUserData);
+		}
+		else
+		{
+			stack.push_back(node.child1);
+			stack.push_back(node.child2);
+		}
+	}
+}
+
+void lune::AabbTree::queryBox(const BoundingBox& box, std::vector<uint64>& outUserData) const
+{
+	queryTree([&box](const BoundingBox& nodeBox)
+		{
+			if (!overlapsBox(box, nodeBox))
+				return TreeOverlap::Outside;
+			return containsBox(box, nodeBox) ? TreeOverlap::Contains : TreeOverlap::Intersects; },
+		outUserData);
+}
+
+void lune::AabbTree::querySphere(const BoundingSphere& sphere, std::vector<uint64>& outUserData) const
+{
+	const float radiusSquared = sphere.radius * sphere.radius;
+	queryTree([&sphere, radiusSquared](const BoundingBox& nodeBox)
+		{
+			const lnm::vec3 offset = lnm::clamp(sphere.center, nodeBox.min, nodeBox.max) - sphere.center;
+			return lnm::dot(offset, offset) <= radiusSquared ? TreeOverlap::Intersects : TreeOverlap::Outside; },
+		outUserData);
+}
+
+void lune::AabbTree::queryFrustum(const Frustum& frustum, std::vector<uint64>& outUserData) const
+{
+	queryTree([&frustum](const BoundingBox& nodeBox)
+		{
+			const lnm::vec3 center = nodeBox.getCenter();
+			const lnm::vec3 extent = nodeBox.getExtent();
+
+			// box inside plane once its least positive corner along normal is in front of it
+			TreeOverlap overlap = TreeOverlap::Contains;
+			for (const lnm::vec4& plane : frustum.planes)
+			{
+				const lnm::vec3 normal = lnm::vec3(plane);
+				const float distance = lnm::dot(normal, center) + plane.w;
+				const float radius = lnm::dot(lnm::abs(normal), extent);
+				if (distance + radius < 0.f)
+					return TreeOverlap::Outside;
+				if (distance - radius < 0.f)
+					overlap = TreeOverlap::Intersects;
+			}
+			return overlap; },
+		outUserData);
+}
+
+void lune::AabbTree::queryRay(const lnm::vec3& origin, const lnm::vec3& direction, float maxDistance, std::vector<uint64>& outUserData) const
+{
+	const lnm::vec3 invDirection = 1.f / direction;
+	queryTree([&origin, &invDirection, maxDistance](const BoundingBox& nodeBox)
+		{
+			float entry{};
+			return intersectRay(nodeBox, origin, invDirection, maxDistance, entry) ? TreeOverlap::Intersects : TreeOverlap::Outside; },
+		outUserData);
+}
+
+bool lune::AabbTree::raycast(const lnm::vec3& origin, const lnm::vec3& direction, float maxDistance, RayHit& outHit) const
+{
+	if (mRoot == NullNode)
+		return false;
+
+	const lnm::vec3 invDirection = 1.f / direction;
+	float nearest = maxDistance;
+	bool hit{};
+
+	float rootEntry{};
+	if (!intersectRay(mNodes[mRoot].box, origin, invDirection, nearest, rootEntry))
+		return false;
+
+	// nearer child visited first, subtrees entered past nearest hit skipped
+	std::vector<std::pair<uint32, float>> stack{};
+	stack.reserve(64);
+	stack.emplace_back(mRoot, rootEntry);
+	while (!stack.empty())
+	{
+		const auto [index, entry] = stack.back();
+		stack.pop_back();
+		if (entry > nearest)
+			continue;
+
+		const Node& node = mNodes[index];
+		if (node.isLeaf())
+		{
+			nearest = entry;
+			outHit = RayHit{node.userData, entry};
+			hit = true;
+			continue;
+		}
+
+		float entry1{}, entry2{};
+		const bool hit1 = intersectRay(mNodes[node.child1].box, origin, invDirection, nearest, entry1);
+		const bool hit2 = intersectRay(mNodes[node.child2].box, origin, invDirection, nearest, entry2);
+		if (hit1 && hit2)
+		{
+			if (entry1 <= entry2)
+			{
+				stack.emplace_back(node.child2, entry2);
+				stack.emplace_back(node.child1, entry1);
+			}
+			else
+			{
+				stack.emplace_back(node.child1, entry1);
+				stack.emplace_back(node.child2, entry2);
+			}
+		}
+		else if (hit1)
+		{
+			stack.emplace_back(node.child1, entry1);
+		}
+		else if (hit2)
+		{
+			stack.emplace_back(node.child2, entry2);
+		}
+	}
+	return hit;
+}
+
+uint32 lune::AabbTree::allocateNode()
+{
+	if (mFreeList == NullNode)
+	{
+		mNodes.emplace_back();
+		return mNodes.size() - 1;
+	}
+
+	const uint32 node = mFreeList;
+	mFreeList = mNodes[node].parent;
+	mNodes[node] = Node{};
+	return node;
+}
+
+void lune::AabbTree::freeNode(uint32 node)
+{
+	mNodes[node] = Node{};
+	mNodes[node].height = -1;
+	mNodes[node].parent = mFreeList;
+	mFreeList = node;
+}
+
+void lune::AabbTree::insertLeaf(uint32 leaf)
+{
+	if (mRoot == NullNode)
+	{
+		mRoot = leaf;
+		mNodes[leaf].parent = NullNode;
+		return;
+	}
+
+	// descend while splitting child is cheaper than pairing leaf with whole node,
+	// cost of child includes area every ancestor grows by
+	const BoundingBox leafBox = mNodes[leaf].box;
+	uint32 index = mRoot;
+	while (!mNodes[index].isLeaf())
+	{
+		const Node& node = mNodes[index];
+		const float area = halfSurfaceArea(node.box);
+		const float combinedArea = halfSurfaceArea(unionBox(node.box, leafBox));
+		const float cost = 2.f * combinedArea;
+		const float inheritanceCost = 2.f * (combinedArea - area);
+
+		const auto childCost = [this, &leafBox, inheritanceCost](uint32 child)
+		{
+			const Node& childNode = mNodes[child];
+			const float newArea = halfSurfaceArea(unionBox(leafBox, childNode.box));
+			return (childNode.isLeaf() ? newArea : newArea - halfSurfaceArea(childNode.box)) + inheritanceCost;
+		};
+		const float cost1 = childCost(node.child1);
+		const float cost2 = childCost(node.child2);
+
+		if (cost < cost1 && cost < cost2)
+			break;
+
+		index = cost1 < cost2 ? node.child1 : node.child2;
+	}
+
+	const uint32 sibling = index;
+	const uint32 oldParent = mNodes[sibling].parent;
+	const uint32 newParent = allocateNode();
+
+	Node& parentNode = mNodes[newParent];
+	parentNode.parent = oldParent;
+	parentNode.box = unionBox(leafBox, mNodes[sibling].box);
+	parentNode.height = mNodes[sibling].height + 1;
+	parentNode.child1 = sibling;
+	parentNode.child2 = leaf;
+
+	if (oldParent != NullNode)
+	{
+		if (mNodes[oldParent].child1 == sibling)
+			mNodes[oldParent].child1 = newParent;
+		else
+			mNodes[oldParent].child2 = newParent;
+	}
+	else
+	{
+		mRoot = newParent;
+	}
+
+	mNodes[sibling].parent = newParent;
+	mNodes[leaf].parent = newParent;
+
+	refitAncestors(newParent);
+}
+
+void lune::AabbTree::removeLeaf(uint32 leaf)
+{
+	if (leaf == mRoot)
+	{
+		mRoot = NullNode;
+		return;
+	}
+
+	const uint32 parent = mNodes[leaf].parent;
+	const uint32 grandParent = mNodes[parent].parent;
+	const uint32 sibling = mNodes[parent].child1 == leaf ? mNodes[parent].child2 : mNodes[parent].child1;
+
+	if (grandParent != NullNode)
+	{
+		if (mNodes[grandParent].child1 == parent)
+			mNodes[grandParent].child1 = sibling;
+		else
+			mNodes[grandParent].child2 = sibling;
+		mNodes[sibling].parent = grandParent;
+		freeNode(parent);
+
+		refitAncestors(grandParent);
+	}
+	else
+	{
+		mRoot = sibling;
+		mNodes[sibling].parent = NullNode;
+		freeNode(parent);
+	}
+
+	mNodes[leaf].parent = NullNode;
+}
+
+uint32 lune::AabbTree::balance(uint32 indexA)
+{
+	Node& a = mNodes[indexA];
+	if (a.isLeaf() || a.height < 2)
+		return indexA;
+
+	const uint32 indexB = a.child1;
+	const uint32 indexC = a.child2;
+	Node& b = mNodes[indexB];
+	Node& c = mNodes[indexC];
+
+	const auto replaceInParent = [this, indexA](uint32 parent, uint32 newChild)
+	{
+		if (parent == NullNode)
+			mRoot = newChild;
+		else if (mNodes[parent].child1 == indexA)
+			mNodes[parent].child1 = newChild;
+		else
+			mNodes[parent].child2 = newChild;
+	};
+
+	const int32 heightDifference = c.height - b.height;
+
+	// c rotated up, a takes higher of its children
+	if (heightDifference > 1)
+	{
+		const uint32 indexF = c.child1;
+		const uint32 indexG = c.child2;
+		Node& f = mNodes[indexF];
+		Node& g = mNodes[indexG];
+
+		c.child1 = indexA;
+		c.parent = a.parent;
+		a.parent = indexC;
+		replaceInParent(c.parent, indexC);
+
+		if (f.height > g.height)
+		{
+			c.child2 = indexF;
+			a.child2 = indexG;
+			g.parent = indexA;
+			a.box = unionBox(b.box, g.box);
+			c.box = unionBox(a.box, f.box);
+			a.height = 1 + std::max(b.height, g.height);
+			c.height = 1 + std::max(a.height, f.height);
+		}
+		else
+		{
+			c.child2 = indexG;
+			a.child2 = indexF;
+			f.parent = indexA;
+			a.box = unionBox(b.box, f.box);
+			c.box = unionBox(a.box, g.box);
+			a.height = 1 + std::max(b.height, f.height);
+			c.height = 1 + std::max(a.height, g.height);
+		}
+		return indexC;
+	}
+
+	// b rotated up, mirror of above
+	if (heightDifference < -1)
+	{
+		const uint32 indexD = b.child1;
+		const uint32 indexE = b.child2;
+		Node& d = mNodes[indexD];
+		Node& e = mNodes[indexE];
+
+		b.child1 = indexA;
+		b.parent = a.parent;
+		a.parent = indexB;
+		replaceInParent(b.parent, indexB);
+
+		if (d.height > e.height)
+		{
+			b.child2 = indexD;
+			a.child1 = indexE;
+			e.parent = indexA;
+			a.box = unionBox(c.box, e.box);
+			b.box = unionBox(a.box, d.box);
+			a.height = 1 + std::max(c.height, e.height);
+			b.height = 1 + std::max(a.height, d.height);
+		}
+		else
+		{
+			b.child2 = indexE;
+			a.child1 = indexD;
+			d.parent = indexA;
+			a.box = unionBox(c.box, d.box);
+			b.box = unionBox(a.box, e.box);
+			a.height = 1 + std::max(c.height, d.height);
+			b.height = 1 + std::max(a.height, e.height);
+		}
+		return indexB;
+	}
+
+	return indexA;
+}
+
+void lune::AabbTree::refitAncestors(uint32 index)
+{
+	while (index != NullNode)
+	{
+		index = balance(index);
+
+		Node& node = mNodes[index];
+		const Node& child1 = mNodes[node.child1];
+		const Node& child2 = mNodes[node.child2];
+		node.height = 1 + std::max(child1.height, child2.height);
+		node.box = unionBox(child1.box, child2.box);
+
+		index = node.parent;
+	}
+}
+
+uint32 lune::AabbTree::buildTopDown(uint32* leaves, uint32 count)
+{
+	if (count == 1)
+		return leaves[0];
+
+	BoundingBox centroidBox{mNodes[leaves[0]].box.getCenter(), mNodes[leaves[0]].box.getCenter()};
+	for (uint32 i = 1; i < count; ++i)
+	{
+		const lnm::vec3 center = mNodes[leaves[i]].box.getCenter();
+		centroidBox.min = lnm::min(centroidBox.min, center);
+		centroidBox.max = lnm::max(centroidBox.max, center);
+	}
+
+	const lnm::vec3 size = centroidBox.max - centroidBox.min;
+	const uint32 axis = size.x >= size.y && size.x >= size.z ? 0 : (size.y >= size.z ? 1 : 2);
+	const uint32 half = count / 2;
+	std::nth_element(leaves, leaves + half, leaves + count, [this, axis](uint32 a, uint32 b)
+		{ return mNodes[a].box.min[axis] + mNodes[a].box.max[axis] < mNodes[b].box.min[axis] + mNodes[b].box.max[axis]; });
+
+	// internal nodes freed by rebuild reused, no reallocation while building
+	const uint32 index = allocateNode();
+	const uint32 child1 = buildTopDown(leaves, half);
+	const uint32 child2 = buildTopDown(leaves + half, count - half);
+
+	Node& node = mNodes[index];
+	node.child1 = child1;
+	node.child2 = child2;
+	node.box = unionBox(mNodes[child1].box, mNodes[child2].box);
+	node.height = 1 + std::max(mNodes[child1].height, mNodes[child2].height);
+	mNodes[child1].parent = index;
+	mNodes[child2].parent = index;
+	return index;
+}
+
+void lune::AabbTree::collectLeaves(uint32 node, std::vector<uint64>& outUserData) const
+{
+	std::vector<uint32> stack{node};
+	while (!stack.empty())
+	{
+		const Node& current = mNodes[stack.back()];
+		stack.pop_back();
+
+		if (current.isLeaf())
+		{
+			outUserData.push_back(current.userData);
+		}
+		else
+		{
+			stack.push_back(current.child1);
+			stack.push_back(current.child2);
+		}
+	}
+}
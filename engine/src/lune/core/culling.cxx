@@ -0,0 +1,192 @@
+#include "lune/core/culling.hxx"
+
+#include <bit>
+#include <cmath>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define LUNE_CULLING_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LUNE_CULLING_SSE
+#endif
+
+// widest lane count, arrays padded to it whichever path compiled
+constexpr uint32 CullingPadding = 8;
+
+lune::BoundingBox lune::BoundingBox::transform(const lnm::mat4& matrix) const
+{
+	const lnm::vec3 center = lnm::vec3(matrix * lnm::vec4(getCenter(), 1.f));
+
+	// extent along each world axis is sum of rotated and scaled local extents
+	const lnm::mat3 absMatrix = lnm::mat3(lnm::abs(lnm::vec3(matrix[0])), lnm::abs(lnm::vec3(matrix[1])), lnm::abs(lnm::vec3(matrix[2])));
+	const lnm::vec3 extent = absMatrix * getExtent();
+
+	return BoundingBox{center - extent, center + extent};
+}
+
+lune::Frustum lune::Frustum::fromViewProjection(const lnm::mat4& viewProj)
+{
+	const lnm::mat4 rows = lnm::transpose(viewProj);
+
+	Frustum frustum{};
+	frustum.planes[Left] = rows[3] + rows[0];
+	frustum.planes[Right] = rows[3] - rows[0];
+	frustum.planes[Bottom] = rows[3] + rows[1];
+	frustum.planes[Top] = rows[3] - rows[1];
+	frustum.planes[Near] = rows[3] + rows[2];
+	frustum.planes[Far] = rows[3] - rows[2];
+
+	for (lnm::vec4& plane : frustum.planes)
+		plane /= lnm::length(lnm::vec3(plane));
+
+	return frustum;
+}
+
+bool lune::Frustum::intersects(const BoundingBox& box) const
+{
+	const lnm::vec3 center = box.getCenter();
+	const lnm::vec3 extent = box.getExtent();
+	for (const lnm::vec4& plane : planes)
+	{
+		const lnm::vec3 normal = lnm::vec3(plane);
+		if (lnm::dot(normal, center) + plane.w + lnm::dot(lnm::abs(normal), extent) < 0.f)
+			return false;
+	}
+	return true;
+}
+
+bool lune::Frustum::intersects(const BoundingSphere& sphere) const
+{
+	for (const lnm::vec4& plane : planes)
+	{
+		if (lnm::dot(lnm::vec3(plane), sphere.center) + plane.w < -sphere.radius)
+			return false;
+	}
+	return true;
+}
+
+void lune::FrustumCuller::resize(uint32 count)
+{
+	mCount = count;
+
+	const uint32 paddedCount = (count + CullingPadding - 1) / CullingPadding * CullingPadding;
+	for (uint32 axis = 0; axis < 3; ++axis)
+	{
+		mCenters[axis].resize(paddedCount);
+		mExtents[axis].resize(paddedCount);
+	}
+}
+
+void lune::FrustumCuller::setBox(uint32 index, const BoundingBox& box)
+{
+	const lnm::vec3 center = box.getCenter();
+	const lnm::vec3 extent = box.getExtent();
+	for (uint32 axis = 0; axis < 3; ++axis)
+	{
+		mCenters[axis][index] = center[axis];
+		mExtents[axis][index] = extent[axis];
+	}
+}
+
+uint32 lune::FrustumCuller::cull(const Frustum& frustum, std::vector<uint8>& outVisible) const
+{
+	// box outside once its most positive corner along plane normal is behind plane:
+	// dot(n, center) + w + dot(abs(n), extent) < 0
+	uint32 visibleCount{};
+	outVisible.resize(mCenters[0].size());
+
+#if defined(LUNE_CULLING_AVX)
+	constexpr uint32 Lanes = 8;
+
+	std::array<std::array<__m256, 7>, Frustum::Count> planes{};
+	for (uint32 p = 0; p < Frustum::Count; ++p)
+	{
+		const lnm::vec4& plane = frustum.planes[p];
+		planes[p] = {_mm256_set1_ps(plane.x), _mm256_set1_ps(plane.y), _mm256_set1_ps(plane.z), _mm256_set1_ps(plane.w),
+			_mm256_set1_ps(std::abs(plane.x)), _mm256_set1_ps(std::abs(plane.y)), _mm256_set1_ps(std::abs(plane.z))};
+	}
+
+	const __m256 zero = _mm256_setzero_ps();
+	for (uint32 i = 0; i < mCount; i += Lanes)
+	{
+		const __m256 cx = _mm256_loadu_ps(mCenters[0].data() + i);
+		const __m256 cy = _mm256_loadu_ps(mCenters[1].data() + i);
+		const __m256 cz = _mm256_loadu_ps(mCenters[2].data() + i);
+		const __m256 ex = _mm256_loadu_ps(mExtents[0].data() + i);
+		const __m256 ey = _mm256_loadu_ps(mExtents[1].data() + i);
+		const __m256 ez = _mm256_loadu_ps(mExtents[2].data() + i);
+
+		__m256 inside = _mm256_cmp_ps(zero, zero, _CMP_EQ_OQ);
+		for (const auto& [nx, ny, nz, w, ax, ay, az] : planes)
+		{
+			__m256 distance = _mm256_add_ps(_mm256_mul_ps(cx, nx), w);
+			distance = _mm256_add_ps(distance, _mm256_mul_ps(cy, ny));
+			distance = _mm256_add_ps(distance, _mm256_mul_ps(cz, nz));
+			distance = _mm256_add_ps(distance, _mm256_mul_ps(ex, ax));
+			distance = _mm256_add_ps(distance, _mm256_mul_ps(ey, ay));
+			distance = _mm256_add_ps(distance, _mm256_mul_ps(ez, az));
+			inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, zero, _CMP_GE_OQ));
+		}
+
+		const uint32 mask = _mm256_movemask_ps(inside);
+		for (uint32 lane = 0; lane < Lanes; ++lane)
+			outVisible[i + lane] = (mask >> lane) & 1;
+
+		const uint32 validMask = mCount - i < Lanes ? (1u << (mCount - i)) - 1 : 0xFFu;
+		visibleCount += std::popcount(mask & validMask);
+	}
+#elif defined(LUNE_CULLING_SSE)
+	constexpr uint32 Lanes = 4;
+
+	std::array<std::array<__m128, 7>, Frustum::Count> planes{};
+	for (uint32 p = 0; p < Frustum::Count; ++p)
+	{
+		const lnm::vec4& plane = frustum.planes[p];
+		planes[p] = {_mm_set1_ps(plane.x), _mm_set1_ps(plane.y), _mm_set1_ps(plane.z), _mm_set1_ps(plane.w),
+			_mm_set1_ps(std::abs(plane.x)), _mm_set1_ps(std::abs(plane.y)), _mm_set1_ps(std::abs(plane.z))};
+	}
+
+	const __m128 zero = _mm_setzero_ps();
+	for (uint32 i = 0; i < mCount; i += Lanes)
+	{
+		const __m128 cx = _mm_loadu_ps(mCenters[0].data() + i);
+		const __m128 cy = _mm_loadu_ps(mCenters[1].data() + i);
+		const __m128 cz = _mm_loadu_ps(mCenters[2].data() + i);
+		const __m128 ex = _mm_loadu_ps(mExtents[0].data() + i);
+		const __m128 ey = _mm_loadu_ps(mExtents[1].data() + i);
+		const __m128 ez = _mm_loadu_ps(mExtents[2].data() + i);
+
+		__m128 inside = _mm_cmpeq_ps(zero, zero);
+		for (const auto& [nx, ny, nz, w, ax, ay, az] : planes)
+		{
+			__m128 distance = _mm_add_ps(_mm_mul_ps(cx, nx), w);
+			distance = _mm_add_ps(distance, _mm_mul_ps(cy, ny));
+			distance = _mm_add_ps(distance, _mm_mul_ps(cz, nz));
+			distance = _mm_add_ps(distance, _mm_mul_ps(ex, ax));
+			distance = _mm_add_ps(distance, _mm_mul_ps(ey, ay));
+			distance = _mm_add_ps(distance, _mm_mul_ps(ez, az));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, zero));
+		}
+
+		const uint32 mask = _mm_movemask_ps(inside);
+		for (uint32 lane = 0; lane < Lanes; ++lane)
+			outVisible[i + lane] = (mask >> lane) & 1;
+
+		const uint32 validMask = mCount - i < Lanes ? (1u << (mCount - i)) - 1 : 0xFu;
+		visibleCount += std::popcount(mask & validMask);
+	}
+#else
+	for (uint32 i = 0; i < mCount; ++i)
+	{
+		const lnm::vec3 center(mCenters[0][i], mCenters[1][i], mCenters[2][i]);
+		const lnm::vec3 extent(mExtents[0][i], mExtents[1][i], mExtents[2][i]);
+		const bool visible = frustum.intersects(BoundingBox{center - extent, center + extent});
+		outVisible[i] = visible;
+		visibleCount += visible;
+	}
+#endif
+
+	outVisible.resize(mCount);
+	return visibleCount;
+}
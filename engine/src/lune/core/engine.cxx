@@ -6,6 +6,7 @@
 #include "lune/core/assets.hxx"
 #include "lune/core/event_subsystem.hxx"
 #include "lune/core/gltf.hxx"
+#include "lune/core/job_subsystem.hxx"
 #include "lune/core/log.hxx"
 #include "lune/core/timer_subsystem.hxx"
 #include "lune/game_framework/scene.hxx"
@@ -61,6 +62,7 @@ bool lune::Engine::initialize(std::vector<std::string> args)
 	eventSubsystem->addEventBindingMem(SDL_EVENT_WINDOW_PIXEL_SIZE_CHANGED, this, &Engine::onSdlWindowPixelSizeChanged);
 
 	addSubsystem<TimerSubsystem>();
+	addSubsystem<JobSubsystem>();
 	addSubsystem<VulkanSubsystem>();
 
 	mInitialized = true;
@@ -74,6 +76,9 @@ bool lune::Engine::wasInitialized() const
 
 void lune::Engine::shutdown()
 {
+	// jobs reading models may still use subsystems
+	gltf::cancelLoads();
+
 	mScenes.clear();
 	mSubsystems.clear();
 	mViews.clear();
@@ -118,6 +123,9 @@ void lune::Engine::run()
 		findSubsystem<EventSubsystem>()->processEvents();
 		findSubsystem<TimerSubsystem>()->tick(deltaSeconds);
 
+		// models loaded in background show up before scenes update
+		gltf::finalizeLoads();
+
 		for (auto& [sId, s] : mScenes)
 		{
 			s->update(deltaSeconds);
@@ -1,15 +1,22 @@
 #include "lune/core/gltf.hxx"
 
 #include "lune/core/assets.hxx"
+#include "lune/core/culling.hxx"
 #include "lune/core/engine.hxx"
+#include "lune/core/job_subsystem.hxx"
+#include "lune/core/ktx2.hxx"
+#include "lune/core/lmesh.hxx"
 #include "lune/core/log.hxx"
+#include "lune/core/mapped_file.hxx"
 #include "lune/core/math.hxx"
 #include "lune/core/sdl.hxx"
+#include "lune/core/triangle_bvh.hxx"
 #include "lune/game_framework/components/mesh.hxx"
 #include "lune/game_framework/components/parent_child.hxx"
 #include "lune/game_framework/components/transform.hxx"
 #include "lune/game_framework/entities/entity.hxx"
 #include "lune/game_framework/scene.hxx"
+#include "lune/vulkan/bindless_heap.hxx"
 #include "lune/vulkan/buffer.hxx"
 #include "lune/vulkan/material.hxx"
 #include "lune/vulkan/pipeline.hxx"
@@ -17,17 +24,27 @@
 #include "lune/vulkan/sampler.hxx"
 #include "lune/vulkan/shader.hxx"
 #include "lune/vulkan/texture_image.hxx"
+#include "lune/vulkan/texture_streamer.hxx"
+#include "lune/vulkan/upload_context.hxx"
+#include "lune/vulkan/upload_scheduler.hxx"
 #include "lune/vulkan/vulkan_core.hxx"
 #include "lune/vulkan/vulkan_subsystem.hxx"
 
 #include <SDL3_image/SDL_image.h>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
 #include <cstddef>
+#include <cstring>
 #include <filesystem>
 #include <format>
 #include <glm/detail/qualifier.hpp>
 #include <glm/ext/vector_float3.hpp>
 #include <glm/fwd.hpp>
+#include <limits>
 #include <memory>
+#include <numeric>
 #include <span>
 #include <string>
 #include <tinygltf/tiny_gltf.h>
@@ -38,143 +55,503 @@ namespace lune::gltf
 	class Material : public vulkan::Material
 	{
 	public:
-		void init(const tinygltf::Model* tinyModel, const tinygltf::Material* tinyMaterial, const std::string_view alias);
+		~Material();
+
+		void init(const lmesh::ModelView& model, const lmesh::Material& material, const std::string_view alias);
 	};
 } // namespace lune::gltf
 
-bool imageLoad(tinygltf::Image*, const int, std::string*, std::string*, int, int, const unsigned char*, int, void*)
+// reached by images of data uris only, encoded file kept for engine to decode with rest of images
+bool imageLoad(tinygltf::Image* image, const int, std::string*, std::string*, int, int, const unsigned char* bytes, int size, void*)
 {
+	image->image.assign(bytes, bytes + size);
+	image->as_is = true;
 	return true;
 }
 
+// async loads upload mesh data in pieces of that size, few of them a frame within scheduler budget
+constexpr vk::DeviceSize MeshUploadChunkSize = 4 * 1024 * 1024;
+
 namespace lune
 {
+	// either surface with mips generated on gpu or whole mip chain
+	struct PreparedImage
+	{
+		UniqueSDLSurface surface{};
+		Ktx2Texture mips{};
+	};
+
+	// model read off main thread, everything short of gpu resources
+	// tables point either into mapped cooked file or into model converted from gltf
+	struct PreparedModel
+	{
+		MappedFile file{};
+		lmesh::Model converted{};
+		lmesh::ModelView view{};
+		std::filesystem::path root{}; // image uris relative to it
+
+		// per primitive, empty unless triangles kept
+		std::vector<SharedTriangleMesh> triangleMeshes{};
+		std::vector<SharedTriangleBvh> triangleBvhs{};
+
+		std::vector<PreparedImage> images{};
+		std::vector<uint32> usedImages{}; // ones textures use, others never decoded
+
+		// created on main thread before primitives, filled straight from data of view
+		vulkan::SharedBuffer vertexBuffer{};
+		vulkan::SharedBuffer indexBuffer{};
+		vulkan::UploadTicket uploadTicket{}; // of last upload into them
+	};
+
 	vk::PrimitiveTopology makeTopology(int32 mode);
 	vk::Filter makeFilter(int32 tinyFilter);
-
-	std::vector<uint64> modelToScene(std::filesystem::path sceneRoot, const tinygltf::Model& tinyModel, std::string_view alias, int32 tinySceneIndex, Scene* luneScene);
-	uint64 processNode(const tinygltf::Model& tinyModel, std::string_view alias, uint32 nodeIndex, Scene* luneScene, EntityBase* parentEntity);
-	void loadMeshes(const tinygltf::Model& tinyModel, std::string_view alias);
+	vk::SamplerMipmapMode makeMipmapMode(int32 tinyFilter);
+
+	std::vector<gltf::SharedAsyncLoad>& getPendingLoads();
+
+	// null when there is no engine, in tools
+	JobSubsystem* findJobSubsystem();
+
+	// cooked file older than source is stale, source edited after cooking
+	bool isCookedUpToDate(const std::filesystem::path& cookedPath, const std::filesystem::path& sourcePath);
+
+	// bytes of each buffer of gltf, glb BIN chunk and .bin files read straight from their mappings, data uris decoded by parser
+	using SourceBuffers = std::vector<std::span<const uint8>>;
+
+	// safe to run on job threads
+	std::span<const uint8> findGlbBinChunk(std::span<const uint8> glb);
+	bool mapBuffers(const tinygltf::Model& tinyModel, const std::filesystem::path& root, std::span<const uint8> binChunk, std::vector<MappedFile>& outFiles, SourceBuffers& outBuffers);
+	const uint8* findAccessorData(const tinygltf::Model& tinyModel, const SourceBuffers& buffers, int32 accessorIndex);
+	void convertMeshes(const tinygltf::Model& tinyModel, const SourceBuffers& buffers, lmesh::Model& outModel);
+	void convertPrimitive(const tinygltf::Model& tinyModel, const SourceBuffers& buffers, const tinygltf::Primitive& tinyPrimitive, std::span<Vertex343224> outVerticies, std::span<uint8> outIndices, lmesh::Primitive& outPrimitive);
+	void convertNodes(const tinygltf::Model& tinyModel, lmesh::Model& outModel);
+	void convertMaterials(const tinygltf::Model& tinyModel, const SourceBuffers& buffers, lmesh::Model& outModel);
+	bool prepareModel(const std::filesystem::path& modelPath, const gltf::LoadOptions& options, PreparedModel& outPrepared);
+	void prepareTriangles(PreparedModel& prepared, const gltf::LoadOptions& options);
+	void prepareImages(PreparedModel& prepared, const gltf::LoadOptions& options);
+	void prepareImage(const std::filesystem::path& imagePath, const gltf::LoadOptions& options, PreparedImage& outImage);
+	void prepareEmbeddedImage(std::span<const uint8> data, const gltf::LoadOptions& options, PreparedImage& outImage);
+
+	// main thread only, uploads recorded but not submitted
+	std::vector<uint64> createModel(PreparedModel& prepared, std::string_view alias, Scene* luneScene, const gltf::LoadOptions& options);
+	void createSamplers(const lmesh::ModelView& model, std::string_view alias);
+	void createMeshBuffers(PreparedModel& prepared);
+	void uploadMeshData(PreparedModel& prepared, const vulkan::SharedBuffer& buffer, std::span<const uint8> data, vk::DeviceSize offset, vk::DeviceSize size);
+	void createPrimitives(const PreparedModel& prepared, std::string_view alias);
+	void createTextures(PreparedModel& prepared, int32 imageIndex, std::string_view alias, const gltf::LoadOptions& options);
+	vulkan::SharedTextureImage createTexture(PreparedImage& image, const gltf::LoadOptions& options);
+	void createMaterials(const lmesh::ModelView& model, std::string_view alias);
+	std::vector<uint64> spawnEntities(const lmesh::ModelView& model, std::string_view alias, Scene* luneScene);
+
+	vk::DeviceSize getUploadSize(const PreparedImage& preparedImage);
+
+	uint64 processNode(const lmesh::ModelView& model, std::string_view alias, uint32 nodeIndex, Scene* luneScene, EntityBase* parentEntity);
+	void computeBounds(const tinygltf::Model& tinyModel, const tinygltf::Primitive& tinyPrimitive, std::span<const Vertex343224> verticies, BoundingBox& outBox, BoundingSphere& outSphere);
+	template <typename Indx>
+	SharedTriangleMesh makeTriangleMesh(int32 mode, std::span<const Vertex343224> verticies, std::span<const Indx> indices);
 	void decomposeTRS(const lnm::mat4& matrix, lnm::vec3& translation, lnm::quat& rotation, lnm::vec3& scale);
 } // namespace lune
 
-std::vector<uint64> lune::gltf::loadInScene(std::filesystem::path gltfScene, std::string_view alias, class Scene* scene)
+bool lune::gltf::convert(const std::filesystem::path& gltfScene, lmesh::Model& outModel)
 {
-	std::vector<uint64> rootEntities{};
-
-	if (scene == nullptr) [[unlikely]]
-		return rootEntities;
-	if (!std::filesystem::is_regular_file(gltfScene)) [[unlikely]]
-		return rootEntities;
-
-	tinygltf::Model model;
+	// parsed straight from mapping, .glb told apart by its magic
+	MappedFile file{};
+	if (!file.open(gltfScene) || file.getSize() > std::numeric_limits<uint32>::max())
+	{
+		LN_LOG(Error, GLTF::Loader, "Failed to map {}", gltfScene.generic_string());
+		return false;
+	}
+	const bool binary = file.getSize() >= 4 && std::memcmp(file.getData(), "glTF", 4) == 0;
 
 	tinygltf::TinyGLTF loader{};
+	tinygltf::Model tinyModel{};
 	std::string err{};
 	std::string warn{};
 
+	// buffers left for mapBuffers, parser would copy each of them whole
 	loader.SetImageLoader(&imageLoad, nullptr);
+	loader.SetLoadBufferData(false);
+
+	const std::string baseDir = gltfScene.parent_path().generic_string();
+	const bool result = binary
+		? loader.LoadBinaryFromMemory(&tinyModel, &err, &warn, file.getData(), file.getSize(), baseDir)
+		: loader.LoadASCIIFromString(&tinyModel, &err, &warn, reinterpret_cast<const char*>(file.getData()), file.getSize(), baseDir);
 
-	const bool result = loader.LoadASCIIFromFile(&model, &err, &warn, gltfScene.generic_string());
 	if (!err.empty())
 	{
 		LN_LOG(Error, GLTF::Loader, err);
 	}
 	if (!warn.empty())
 	{
-		LN_LOG(Warning, GLTF::Loader, err);
+		LN_LOG(Warning, GLTF::Loader, warn);
+	}
+
+	if (!result)
+		return false;
+
+	// mappings stay open until everything is converted out of them
+	std::vector<MappedFile> bufferFiles{};
+	SourceBuffers buffers{};
+	const std::span<const uint8> binChunk = binary ? findGlbBinChunk(file.getSpan()) : std::span<const uint8>{};
+	if (!mapBuffers(tinyModel, gltfScene.parent_path(), binChunk, bufferFiles, buffers))
+	{
+		LN_LOG(Error, GLTF::Loader, "Buffers of {} missing or too small", gltfScene.generic_string());
+		return false;
 	}
 
-	if (result)
+	convertMeshes(tinyModel, buffers, outModel);
+	convertNodes(tinyModel, outModel);
+	convertMaterials(tinyModel, buffers, outModel);
+	return true;
+}
+
+std::vector<uint64> lune::gltf::loadInScene(std::filesystem::path gltfScene, std::string_view alias, class Scene* scene, const LoadOptions& options)
+{
+	if (scene == nullptr) [[unlikely]]
+		return {};
+	if (!std::filesystem::is_regular_file(gltfScene)) [[unlikely]]
+		return {};
+
+	PreparedModel prepared{};
+	if (!prepareModel(gltfScene, options, prepared))
+		return {};
+
+	std::vector<uint64> rootEntities = createModel(prepared, alias, scene, options);
+
+	// whole model goes to gpu in single batch
+	getVulkanUploadContext().submit();
+
+	return rootEntities;
+}
+
+lune::gltf::SharedAsyncLoad lune::gltf::loadInSceneAsync(std::filesystem::path gltfScene, std::string_view alias, class Scene* scene, const LoadOptions& options)
+{
+	auto load = std::make_shared<AsyncLoad>();
+	if (scene == nullptr || !std::filesystem::is_regular_file(gltfScene)) [[unlikely]]
+	{
+		load->mState = LoadState::Failed;
+		return load;
+	}
+
+	load->mPath = std::move(gltfScene);
+	load->mAlias = alias;
+	load->mScene = scene;
+	load->mOptions = options;
+	load->mPrepared = std::make_unique<PreparedModel>();
+	load->mUploadGroup = getVulkanUploadScheduler().createGroup();
+	load->mBeginTime = std::chrono::steady_clock::now();
+
+	// load kept alive by job till it completes, even if dropped by everyone else
+	const auto prepare = [load]()
+	{ load->mPrepareResult = prepareModel(load->mPath, load->mOptions, *load->mPrepared); };
+
+	if (auto jobs = Engine::get()->findSubsystem<JobSubsystem>())
+		jobs->submit(prepare, &load->mCounter);
+	else
+		prepare();
+
+	getPendingLoads().push_back(load);
+	return load;
+}
+
+void lune::gltf::finalizeLoads()
+{
+	// buffers, samplers and such created for models read by now, rest of ready ones wait for next frames
+	constexpr auto finalizeBudget = std::chrono::milliseconds(4);
+
+	auto& pendingLoads = getPendingLoads();
+	const auto beginTime = std::chrono::steady_clock::now();
+
+	bool queued{};
+	for (auto it = pendingLoads.begin(); it != pendingLoads.end();)
 	{
-		for (size_t i = 0; i < model.scenes.size(); ++i)
+		AsyncLoad& load = **it;
+		if (!load.mCounter.isDone() || load.mPendingUploads > 0)
+		{
+			++it;
+			continue;
+		}
+
+		if (!load.mPrepareResult)
 		{
-			std::vector<uint64> sceneEntities = modelToScene(gltfScene.parent_path(), model, alias, i, scene);
-			std::move(sceneEntities.begin(), sceneEntities.end(), std::back_inserter(rootEntities));
+			load.mPrepared.reset();
+			load.mState = LoadState::Failed;
+			it = pendingLoads.erase(it);
+			continue;
 		}
+
+		// uploads themselves drained by scheduler within its own budget
+		if (!load.mUploadsQueued)
+		{
+			if (queued && std::chrono::steady_clock::now() - beginTime > finalizeBudget)
+				break;
+
+			load.queueUploads();
+			queued = true;
+			if (load.mPendingUploads > 0)
+			{
+				++it;
+				continue;
+			}
+		}
+
+		// scheduler uploads go in background batches frames don't wait for, nothing samples them before entities spawn
+		if (!load.mUploadTicket)
+			load.mUploadTicket = getVulkanUploadContext().getRecordingTicket();
+		if (!getVulkanUploadContext().isComplete(load.mUploadTicket))
+		{
+			++it;
+			continue;
+		}
+
+		load.finish();
+		const double loadSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - load.mBeginTime).count();
+		LN_LOG(Info, GLTF::Loader, "Loaded {} in {:.2f} s", load.mPath.generic_string(), loadSeconds);
+		it = pendingLoads.erase(it);
 	}
+}
 
-	return rootEntities;
+void lune::gltf::cancelLoads()
+{
+	auto jobs = findJobSubsystem();
+	for (const SharedAsyncLoad& load : getPendingLoads())
+	{
+		if (jobs)
+			jobs->wait(load->mCounter);
+		getVulkanUploadScheduler().cancelGroup(load->mUploadGroup);
+		load->mPrepared.reset();
+		load->mState = LoadState::Failed;
+	}
+	getPendingLoads().clear();
 }
 
-std::vector<uint64> lune::modelToScene(std::filesystem::path sceneRoot, const tinygltf::Model& tinyModel, std::string_view alias, int32 tinySceneIndex, Scene* scene)
+lune::gltf::AsyncLoad::~AsyncLoad() = default;
+
+void lune::gltf::AsyncLoad::setPriority(float priority)
 {
-	std::vector<uint64> rootEntities{};
+	mOptions.uploadPriority = priority;
+	getVulkanUploadScheduler().setGroupPriority(mUploadGroup, priority);
+}
 
-	loadMeshes(tinyModel, alias);
+void lune::gltf::AsyncLoad::queueUploads()
+{
+	PreparedModel& prepared = *mPrepared;
+	createSamplers(prepared.view, mAlias);
+	createMeshBuffers(prepared);
+	createTextures(prepared, -1, mAlias, mOptions);
+
+	// load stays pending till its jobs run or get cancelled with it
+	// mesh data goes in chunks so big model doesn't hold up frame, primitives created from it once all of it is uploaded
+	auto& scheduler = getVulkanUploadScheduler();
+	const auto queueMeshData = [this, &scheduler](const vulkan::SharedBuffer& buffer, std::span<const uint8> data)
+	{
+		for (vk::DeviceSize offset = 0; offset < data.size(); offset += MeshUploadChunkSize)
+		{
+			const vk::DeviceSize size = std::min<vk::DeviceSize>(MeshUploadChunkSize, data.size() - offset);
+			const auto job = [this, buffer, data, offset, size]()
+			{
+				uploadMeshData(*mPrepared, buffer, data, offset, size);
+				--mPendingUploads;
+			};
+			scheduler.enqueue(job, size, mOptions.uploadPriority, mUploadGroup);
+			++mPendingUploads;
+		}
+	};
+	queueMeshData(prepared.vertexBuffer, prepared.view.verticies);
+	queueMeshData(prepared.indexBuffer, prepared.view.indices);
 
-	auto& tinyScene = tinyModel.scenes[tinySceneIndex];
-	const size_t tinySceneNodeSize = tinyScene.nodes.size();
-	for (size_t i = 0; i < tinySceneNodeSize; ++i)
+	for (const uint32 imageIndex : prepared.usedImages)
 	{
-		uint64 entity = processNode(tinyModel, alias, tinyScene.nodes[i], scene, nullptr);
-		rootEntities.emplace_back(entity);
+		const auto job = [this, imageIndex]()
+		{
+			createTextures(*mPrepared, imageIndex, mAlias, mOptions);
+			--mPendingUploads;
+		};
+		scheduler.enqueue(job, getUploadSize(prepared.images[imageIndex]), mOptions.uploadPriority, mUploadGroup);
+		++mPendingUploads;
 	}
+	mUploadsQueued = true;
+}
+
+void lune::gltf::AsyncLoad::finish()
+{
+	// materials look up textures by name, entities primitives and materials
+	createPrimitives(*mPrepared, mAlias);
+	createMaterials(mPrepared->view, mAlias);
+	mRootEntities = spawnEntities(mPrepared->view, mAlias, mScene);
+	mPrepared.reset();
+	mState = LoadState::Loaded;
+}
+
+std::vector<lune::gltf::SharedAsyncLoad>& lune::getPendingLoads()
+{
+	static std::vector<gltf::SharedAsyncLoad> pendingLoads{};
+	return pendingLoads;
+}
+
+lune::JobSubsystem* lune::findJobSubsystem()
+{
+	return Engine::get() ? Engine::get()->findSubsystem<JobSubsystem>() : nullptr;
+}
+
+bool lune::isCookedUpToDate(const std::filesystem::path& cookedPath, const std::filesystem::path& sourcePath)
+{
+	std::error_code error{};
+	const auto cookedTime = std::filesystem::last_write_time(cookedPath, error);
+	return !error && cookedTime >= std::filesystem::last_write_time(sourcePath, error);
+}
 
+bool lune::prepareModel(const std::filesystem::path& modelPath, const gltf::LoadOptions& options, PreparedModel& outPrepared)
+{
+	auto cookedPath = modelPath;
+	cookedPath.replace_extension(".lmesh");
+	const bool cookedOnly = modelPath.extension() == ".lmesh";
+
+	// cooked tables mapped as they are, gltf converted into same tables otherwise
+	bool cooked{};
+	if (cookedOnly || (options.preferCookedMeshes && isCookedUpToDate(cookedPath, modelPath)))
+		cooked = lmesh::read(cookedPath, outPrepared.file, outPrepared.view);
+
+	if (!cooked)
+	{
+		if (cookedOnly || !gltf::convert(modelPath, outPrepared.converted))
+			return false;
+		outPrepared.view = outPrepared.converted.getView();
+	}
+	outPrepared.root = modelPath.parent_path();
+
+	prepareTriangles(outPrepared, options);
+	prepareImages(outPrepared, options);
+	return true;
+}
+
+std::vector<uint64> lune::createModel(PreparedModel& prepared, std::string_view alias, Scene* scene, const gltf::LoadOptions& options)
+{
+	createSamplers(prepared.view, alias);
+
+	createMeshBuffers(prepared);
+	if (!prepared.view.verticies.empty())
+		uploadMeshData(prepared, prepared.vertexBuffer, prepared.view.verticies, 0, prepared.view.verticies.size());
+	if (!prepared.view.indices.empty())
+		uploadMeshData(prepared, prepared.indexBuffer, prepared.view.indices, 0, prepared.view.indices.size());
+	createPrimitives(prepared, alias);
+
+	createTextures(prepared, -1, alias, options);
+	for (const uint32 imageIndex : prepared.usedImages)
+		createTextures(prepared, imageIndex, alias, options);
+
+	createMaterials(prepared.view, alias);
+	return spawnEntities(prepared.view, alias, scene);
+}
+
+void lune::createSamplers(const lmesh::ModelView& model, std::string_view alias)
+{
 	auto vkSubsystem = Engine::get()->findSubsystem<VulkanSubsystem>();
-	for (size_t i = 0; i < tinyModel.samplers.size(); ++i)
+	for (size_t i = 0; i < model.samplers.size(); ++i)
 	{
-		const auto& tinySampler = tinyModel.samplers[i];
+		const lmesh::Sampler& sampler = model.samplers[i];
 		vk::SamplerCreateInfo createInfo = vulkan::Sampler::defaultCreateInfo();
-		createInfo.setMagFilter(makeFilter(tinySampler.magFilter)).setMinFilter(makeFilter(tinySampler.minFilter));
+		createInfo.setMagFilter(makeFilter(sampler.magFilter)).setMinFilter(makeFilter(sampler.minFilter)).setMipmapMode(makeMipmapMode(sampler.minFilter));
+
+		// minification filters without mipmap part sample first mip only
+		if (sampler.minFilter == TINYGLTF_TEXTURE_FILTER_NEAREST || sampler.minFilter == TINYGLTF_TEXTURE_FILTER_LINEAR)
+			createInfo.setMaxLod(0.f);
 		vkSubsystem->addSampler(std::format("{}::sampler::{}", alias, i), vulkan::Sampler::create(createInfo));
 	}
-	for (size_t i = 0; i < tinyModel.textures.size(); ++i)
+}
+
+void lune::createTextures(PreparedModel& prepared, int32 imageIndex, std::string_view alias, const gltf::LoadOptions& options)
+{
+	const lmesh::ModelView& model = prepared.view;
+	auto vkSubsystem = Engine::get()->findSubsystem<VulkanSubsystem>();
+
+	// textures without image get default one too
+	vulkan::SharedTextureImage textureImage = nullptr;
+	if (imageIndex >= 0)
+	{
+		textureImage = createTexture(prepared.images[imageIndex], options);
+		if (!textureImage)
+		{
+			const lmesh::Image& image = model.images[imageIndex];
+			if (image.dataSize)
+				LN_LOG(Warning, GLTF::Texture, "Failed to load embedded image {}, using default texture", imageIndex);
+			else
+				LN_LOG(Warning, GLTF::Texture, "Failed to load {}, using default texture", model.getImageUri(image));
+		}
+		prepared.images[imageIndex] = PreparedImage{};
+	}
+	if (!textureImage)
+		textureImage = vkSubsystem->findTextureImage("lune::default");
+
+	// textures sharing image share texture image too
+	for (size_t i = 0; i < model.textures.size(); ++i)
 	{
-		const auto& tinyTexture = tinyModel.textures[i];
-		const auto& tinyImage = tinyModel.images[tinyTexture.source];
-		const auto imagePath = sceneRoot / tinyImage.uri;
-		auto newSurface = loadTextureImage(imagePath.generic_string());
-		vkSubsystem->addTextureImage(std::format("{}::texture::{}", alias, i), vulkan::TextureImage::create(newSurface.get()));
+		if (model.textures[i].image == imageIndex)
+			vkSubsystem->addTextureImage(std::format("{}::texture::{}", alias, i), textureImage);
 	}
-	for (size_t i = 0; i < tinyModel.materials.size(); ++i)
+}
+
+void lune::createMaterials(const lmesh::ModelView& model, std::string_view alias)
+{
+	auto vkSubsystem = Engine::get()->findSubsystem<VulkanSubsystem>();
+	for (size_t i = 0; i < model.materials.size(); ++i)
 	{
 		std::shared_ptr<gltf::Material> newMaterial = std::make_shared<gltf::Material>();
-		newMaterial->init(&tinyModel, &tinyModel.materials[i], alias);
+		newMaterial->init(model, model.materials[i], alias);
 		vkSubsystem->addMaterial(std::format("{}::material::{}", alias, i), newMaterial);
 	}
+}
 
+std::vector<uint64> lune::spawnEntities(const lmesh::ModelView& model, std::string_view alias, Scene* scene)
+{
+	std::vector<uint64> rootEntities{};
+	for (const uint32 node : model.roots)
+		rootEntities.emplace_back(processNode(model, alias, node, scene, nullptr));
 	return rootEntities;
 }
 
-uint64 lune::processNode(const tinygltf::Model& tinyModel, std::string_view alias, uint32 nodeIndex, Scene* scene, EntityBase* parentEntity)
+vk::DeviceSize lune::getUploadSize(const PreparedImage& preparedImage)
+{
+	if (preparedImage.surface)
+		return static_cast<vk::DeviceSize>(preparedImage.surface->pitch) * preparedImage.surface->h;
+
+	vk::DeviceSize size{};
+	for (const auto& level : preparedImage.mips.levels)
+		size += level.size();
+	return size;
+}
+
+uint64 lune::processNode(const lmesh::ModelView& model, std::string_view alias, uint32 nodeIndex, Scene* scene, EntityBase* parentEntity)
 {
-	const auto& node = tinyModel.nodes[nodeIndex];
+	const lmesh::Node& node = model.nodes[nodeIndex];
 
 	auto newEntity = scene->addEntity<lune::EntityBase>();
 	auto parentChildComp = newEntity->addComponent<ParentChildComponent>();
 
 	auto transformComp = newEntity->addComponent<TransformComponent>();
-	if (node.rotation.size())
-		transformComp->mOrientation = *reinterpret_cast<const lnm::dquat*>(node.rotation.data());
-	if (node.scale.size())
-		transformComp->mScale = *reinterpret_cast<const lnm::dvec3*>(node.scale.data());
-	if (node.translation.size())
-		transformComp->mPosition = *reinterpret_cast<const lnm::dvec3*>(node.translation.data());
-	if (node.matrix.size())
-		decomposeTRS(*reinterpret_cast<const lnm::dmat4x4*>(node.matrix.data()), transformComp->mPosition, transformComp->mOrientation, transformComp->mScale);
+	transformComp->mPosition = node.translation;
+	transformComp->mOrientation = node.rotation;
+	transformComp->mScale = node.scale;
 
 	if (parentEntity)
 		parentChildComp->mParentId = parentEntity->getId();
 
-	for (size_t i = 0; i < node.children.size(); ++i)
+	for (uint32 i = 0; i < node.childCount; ++i)
 	{
-		const uint64 childEntityId = processNode(tinyModel, alias, node.children[i], scene, newEntity);
+		const uint64 childEntityId = processNode(model, alias, model.children[node.firstChild + i], scene, newEntity);
 		parentChildComp->mChildren.emplace(childEntityId);
 	}
 
-	if (node.mesh != -1 && tinyModel.meshes[node.mesh].primitives.size())
+	if (node.mesh != -1 && model.meshes[node.mesh].primitiveCount)
 	{
-		const auto& nodeMesh = tinyModel.meshes[node.mesh];
+		const lmesh::Mesh& mesh = model.meshes[node.mesh];
 		auto meshComp = newEntity->addComponent<MeshComponent>();
-		for (size_t i = 0; i < nodeMesh.primitives.size(); ++i)
+		for (uint32 i = 0; i < mesh.primitiveCount; ++i)
 		{
-			const auto& primitive = nodeMesh.primitives[i];
-			const std::string primitiveName = std::format("{}::mesh::{}::primitive::{}", alias, node.mesh, i);
-			;
+			const lmesh::Primitive& primitive = model.primitives[mesh.firstPrimitive + i];
 
 			auto& meshCompPrimitive = meshComp->primitives.emplace_back();
-			meshCompPrimitive.primitiveName = primitiveName;
+			meshCompPrimitive.primitiveName = std::format("{}::mesh::{}::primitive::{}", alias, node.mesh, i);
 			if (primitive.material != -1)
 				meshCompPrimitive.materialName = std::format("{}::material::{}", alias, primitive.material);
 			meshCompPrimitive.topology = makeTopology(primitive.mode);
@@ -211,30 +588,84 @@ vk::Filter lune::makeFilter(int32 tinyFilter)
 	switch (tinyFilter)
 	{
 	case TINYGLTF_TEXTURE_FILTER_LINEAR:
+	case TINYGLTF_TEXTURE_FILTER_LINEAR_MIPMAP_NEAREST:
+	case TINYGLTF_TEXTURE_FILTER_LINEAR_MIPMAP_LINEAR:
 		return vk::Filter::eLinear;
 	case TINYGLTF_TEXTURE_FILTER_NEAREST:
+	case TINYGLTF_TEXTURE_FILTER_NEAREST_MIPMAP_NEAREST:
+	case TINYGLTF_TEXTURE_FILTER_NEAREST_MIPMAP_LINEAR:
 		return vk::Filter::eNearest;
 	}
 	return vk::Filter::eLinear;
 }
 
-struct ShaderMaterialData
+vk::SamplerMipmapMode lune::makeMipmapMode(int32 tinyFilter)
 {
-	lnm::vec3 emissiveFactor{};
-	int32 padding0{};
-	lnm::vec4 baseColorFactor{};
-	float metallicFactor{};
-	float roughnessFactor{};
-	float normalScale{};
+	switch (tinyFilter)
+	{
+	case TINYGLTF_TEXTURE_FILTER_NEAREST_MIPMAP_NEAREST:
+	case TINYGLTF_TEXTURE_FILTER_LINEAR_MIPMAP_NEAREST:
+		return vk::SamplerMipmapMode::eNearest;
+	}
+	return vk::SamplerMipmapMode::eLinear;
+}
+
+void lune::prepareImage(const std::filesystem::path& imagePath, const gltf::LoadOptions& options, PreparedImage& outImage)
+{
+	Ktx2Texture& mips = outImage.mips;
+	if (options.preferCookedTextures)
+	{
+		auto cookedPath = imagePath;
+		cookedPath.replace_extension(".ktx2");
+		if (isCookedUpToDate(cookedPath, imagePath))
+		{
+			if (!ktx2::read(cookedPath, mips))
+			{
+				mips = Ktx2Texture{};
+			}
+			else if (!vulkan::TextureImage::canSample(mips.format))
+			{
+				LN_LOG(Warning, GLTF::Texture, "Format of {} not supported by device, using source image", cookedPath.generic_string());
+				mips = Ktx2Texture{};
+			}
+		}
+	}
 
-	int32 baseColorTextureUVSet{-1};
-	int32 metallicRoughnessTextureUVSet{-1};
-	int32 normalTextureUVSet{-1};
-	int32 occlusioTextureUVSet{-1};
-	int32 emissiveTextureUVSet{-1};
-};
+	if (mips.levels.empty())
+	{
+		outImage.surface = loadTextureImage(imagePath.generic_string());
+		if (options.streamTextures && outImage.surface)
+		{
+			mips = vulkan::TextureImage::buildMipChain(outImage.surface.get());
+			outImage.surface.reset();
+		}
+	}
+}
+
+void lune::prepareEmbeddedImage(std::span<const uint8> data, const gltf::LoadOptions& options, PreparedImage& outImage)
+{
+	// nothing to cook it from, decoded every time
+	outImage.surface = loadTextureImage(data);
+	if (options.streamTextures && outImage.surface)
+	{
+		outImage.mips = vulkan::TextureImage::buildMipChain(outImage.surface.get());
+		outImage.surface.reset();
+	}
+}
 
-void lune::gltf::Material::init(const tinygltf::Model* tinyModel, const tinygltf::Material* tinyMaterial, const std::string_view alias)
+lune::vulkan::SharedTextureImage lune::createTexture(PreparedImage& image, const gltf::LoadOptions& options)
+{
+	if (image.surface)
+		return vulkan::TextureImage::create(image.surface.get());
+	if (image.mips.levels.empty())
+		return nullptr;
+
+	if (options.streamTextures)
+		return getVulkanTextureStreamer().add(std::move(image.mips));
+	return vulkan::TextureImage::create(image.mips);
+}
+
+void lune::gltf::Material::init(const lmesh::ModelView& model, const lmesh::Material& material, const std::string_view alias)
 {
 	auto vkSubsystem = Engine::get()->findSubsystem<VulkanSubsystem>();
 
@@ -242,300 +673,650 @@ void lune::gltf::Material::init(const tinygltf::Model* tinyModel, const tinygltf
 	auto shFrag = vkSubsystem->loadShader(*EngineShaderPath("gltf/primitive.frag.spv"));
 
 	auto rasterizationState = vulkan::GraphicsPipeline::defaultRasterizationState();
-	rasterizationState.setCullMode(tinyMaterial->doubleSided ? vk::CullModeFlagBits::eNone : vk::CullModeFlagBits::eFront);
+	rasterizationState.setCullMode(material.doubleSided ? vk::CullModeFlagBits::eNone : vk::CullModeFlagBits::eFront);
 
 	vulkan::GraphicsPipeline::StatesOverride statesOverride{};
 	statesOverride.rasterization = &rasterizationState;
 	statesOverride.dynamicStates = vulkan::GraphicsPipeline::defaultDynamicStates();
+	statesOverride.bindless = true;
 
 	mPipeline = vulkan::GraphicsPipeline::create(shVert, shFrag, statesOverride);
 
-	ShaderMaterialData shaderMat{};
-	shaderMat.emissiveFactor = *reinterpret_cast<const lnm::dvec3*>(tinyMaterial->emissiveFactor.data());
-	shaderMat.baseColorFactor = *reinterpret_cast<const lnm::dvec4*>(tinyMaterial->pbrMetallicRoughness.baseColorFactor.data());
-	shaderMat.metallicFactor = tinyMaterial->pbrMetallicRoughness.metallicFactor;
-	shaderMat.roughnessFactor = tinyMaterial->pbrMetallicRoughness.roughnessFactor;
-	shaderMat.normalScale = tinyMaterial->normalTexture.scale;
-
-	uint8 texCounter = 0;
+	vulkan::ShaderMaterialData shaderMat{};
+	shaderMat.emissiveFactor = material.emissiveFactor;
+	shaderMat.baseColorFactor = material.baseColorFactor;
+	shaderMat.metallicFactor = material.metallicFactor;
+	shaderMat.roughnessFactor = material.roughnessFactor;
+	shaderMat.normalScale = material.normalScale;
 
 	mTextures = std::vector<vulkan::SharedTextureImage>(5, vkSubsystem->findTextureImage("lune::default"));
 	mSamplers = std::vector<vulkan::SharedSampler>(5, vkSubsystem->findSampler("lune::default"));
 
-	if (tinyMaterial->pbrMetallicRoughness.baseColorTexture.index != -1)
+	for (size_t i = 0; i < material.textures.size(); ++i)
 	{
-		shaderMat.baseColorTextureUVSet = tinyMaterial->pbrMetallicRoughness.baseColorTexture.texCoord;
-		mTextures[0] = (vkSubsystem->findTextureImage(std::format("{}::texture::{}", alias, tinyMaterial->pbrMetallicRoughness.baseColorTexture.index)));
-		mSamplers[0] = (vkSubsystem->findSampler(std::format("{}::sampler::{}", alias, tinyModel->textures[tinyMaterial->pbrMetallicRoughness.baseColorTexture.index].sampler)));
+		const int32 textureIndex = material.textures[i];
+		if (textureIndex != -1)
+		{
+			shaderMat.textureUVSets[i] = material.texCoords[i];
+			mTextures[i] = vkSubsystem->findTextureImage(std::format("{}::texture::{}", alias, textureIndex));
+			if (model.textures[textureIndex].sampler != -1)
+				mSamplers[i] = vkSubsystem->findSampler(std::format("{}::sampler::{}", alias, model.textures[textureIndex].sampler));
+		}
+		shaderMat.textureIndices[i] = mTextures[i]->getBindlessIndex();
+		shaderMat.samplerIndices[i] = mSamplers[i]->getBindlessIndex();
 	}
 
-	if (tinyMaterial->pbrMetallicRoughness.metallicRoughnessTexture.index != -1)
+	mMaterialIndex = getVulkanBindlessHeap().registerMaterial(shaderMat);
+}
+
+lune::gltf::Material::~Material()
+{
+	getVulkanBindlessHeap().unregisterMaterial(mMaterialIndex);
+}
+
+std::span<const uint8> lune::findGlbBinChunk(std::span<const uint8> glb)
+{
+	// 12 byte header followed by chunks, each of them length, type and data padded to 4 bytes
+	constexpr uint32 BinChunkType = 0x004E4942; // "BIN\0"
+	uint64 offset = 12;
+	while (offset + 8 <= glb.size())
 	{
-		shaderMat.metallicRoughnessTextureUVSet = tinyMaterial->pbrMetallicRoughness.metallicRoughnessTexture.texCoord;
-		mTextures[1] = (vkSubsystem->findTextureImage(std::format("{}::texture::{}", alias, tinyMaterial->pbrMetallicRoughness.metallicRoughnessTexture.index)));
-		mSamplers[1] = (vkSubsystem->findSampler(std::format("{}::sampler::{}", alias, tinyModel->textures[tinyMaterial->pbrMetallicRoughness.metallicRoughnessTexture.index].sampler)));
+		uint32 length{};
+		uint32 type{};
+		std::memcpy(&length, glb.data() + offset, sizeof(uint32));
+		std::memcpy(&type, glb.data() + offset + 4, sizeof(uint32));
+
+		const uint64 dataOffset = offset + 8;
+		if (length > glb.size() - dataOffset)
+			return {};
+		if (type == BinChunkType)
+			return glb.subspan(dataOffset, length);
+		offset = dataOffset + (static_cast<uint64>(length) + 3) / 4 * 4;
 	}
+	return {};
+}
 
-	if (tinyMaterial->normalTexture.index != -1)
+bool lune::mapBuffers(const tinygltf::Model& tinyModel, const std::filesystem::path& root, std::span<const uint8> binChunk, std::vector<MappedFile>& outFiles, SourceBuffers& outBuffers)
+{
+	for (const auto& tinyBuffer : tinyModel.buffers)
 	{
-		shaderMat.normalTextureUVSet = tinyMaterial->normalTexture.texCoord;
-		mTextures[2] = (vkSubsystem->findTextureImage(std::format("{}::texture::{}", alias, tinyMaterial->normalTexture.index)));
-		mSamplers[2] = (vkSubsystem->findSampler(std::format("{}::sampler::{}", alias, tinyModel->textures[tinyMaterial->normalTexture.index].sampler)));
+		std::span<const uint8>& buffer = outBuffers.emplace_back();
+		if (!tinyBuffer.data.empty())
+		{
+			buffer = tinyBuffer.data;
+		}
+		else if (tinyBuffer.uri.empty())
+		{
+			buffer = binChunk;
+		}
+		else
+		{
+			std::string uri{};
+			tinygltf::URIDecode(tinyBuffer.uri, &uri, nullptr);
+
+			MappedFile& bufferFile = outFiles.emplace_back();
+			if (!bufferFile.open(root / uri))
+			{
+				LN_LOG(Error, GLTF::Loader, "Failed to map buffer {}", (root / uri).generic_string());
+				return false;
+			}
+			buffer = bufferFile.getSpan();
+		}
 	}
 
-	if (tinyMaterial->occlusionTexture.index != -1)
+	// every range read later checked once here, conversion trusts them
+	for (const auto& bufferView : tinyModel.bufferViews)
 	{
-		shaderMat.occlusioTextureUVSet = tinyMaterial->occlusionTexture.texCoord;
-		mTextures[3] = (vkSubsystem->findTextureImage(std::format("{}::texture::{}", alias, tinyMaterial->occlusionTexture.index)));
-		mSamplers[3] = (vkSubsystem->findSampler(std::format("{}::sampler::{}", alias, tinyModel->textures[tinyMaterial->occlusionTexture.index].sampler)));
-	}
+		if (bufferView.buffer < 0 || static_cast<size_t>(bufferView.buffer) >= outBuffers.size())
+			return false;
 
-	if (tinyMaterial->emissiveTexture.index != -1)
+		const std::span<const uint8> buffer = outBuffers[bufferView.buffer];
+		if (bufferView.byteOffset > buffer.size() || bufferView.byteLength > buffer.size() - bufferView.byteOffset)
+			return false;
+	}
+	for (const auto& accessor : tinyModel.accessors)
 	{
-		shaderMat.emissiveTextureUVSet = tinyMaterial->emissiveTexture.texCoord;
-		mTextures[4] = (vkSubsystem->findTextureImage(std::format("{}::texture::{}", alias, tinyMaterial->emissiveTexture.index)));
-		mSamplers[4] = (vkSubsystem->findSampler(std::format("{}::sampler::{}", alias, tinyModel->textures[tinyMaterial->emissiveTexture.index].sampler)));
+		if (accessor.bufferView < 0 || accessor.count == 0)
+			continue;
+		if (static_cast<size_t>(accessor.bufferView) >= tinyModel.bufferViews.size())
+			return false;
+
+		const auto& bufferView = tinyModel.bufferViews[accessor.bufferView];
+		const int32 componentSize = tinygltf::GetComponentSizeInBytes(accessor.componentType);
+		const int32 componentCount = tinygltf::GetNumComponentsInType(accessor.type);
+		const int32 stride = accessor.ByteStride(bufferView);
+		if (componentSize <= 0 || componentCount <= 0 || stride <= 0)
+			return false;
+
+		const uint64 elementSize = static_cast<uint64>(componentSize) * componentCount;
+		if (accessor.byteOffset + static_cast<uint64>(stride) * (accessor.count - 1) + elementSize > bufferView.byteLength)
+			return false;
 	}
-
-	mBuffer = vulkan::Buffer::create(vk::BufferUsageFlagBits::eUniformBuffer | vk::BufferUsageFlagBits::eTransferDst, sizeof(shaderMat), VMA_MEMORY_USAGE_AUTO, VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT);
-	mBuffer->copyTransfer(&shaderMat, 0, sizeof(shaderMat));
+	return true;
 }
 
-void lune::loadMeshes(const tinygltf::Model& tinyModel, std::string_view alias)
+const uint8* lune::findAccessorData(const tinygltf::Model& tinyModel, const SourceBuffers& buffers, int32 accessorIndex)
 {
-	uint32 totalVertexCount{};
-	std::vector<std::vector<Vertex343224>> verticies{};
+	// accessors without buffer view are all zeros
+	const auto& accessor = tinyModel.accessors[accessorIndex];
+	if (accessor.bufferView < 0)
+		return nullptr;
 
-	uint32 totalIndexSize{};
-	std::vector<std::tuple<const void* /*data*/, uint32 /*count*/, uint32 /*sizeof*/>> indices{};
+	const auto& bufferView = tinyModel.bufferViews[accessor.bufferView];
+	return buffers[bufferView.buffer].data() + bufferView.byteOffset + accessor.byteOffset;
+}
 
+void lune::convertMeshes(const tinygltf::Model& tinyModel, const SourceBuffers& buffers, lmesh::Model& outModel)
+{
+	std::vector<const tinygltf::Primitive*> tinyPrimitives{};
 	for (const auto& tinyMesh : tinyModel.meshes)
 	{
+		outModel.meshes.push_back(lmesh::Mesh{static_cast<uint32>(tinyPrimitives.size()), static_cast<uint32>(tinyMesh.primitives.size())});
 		for (const auto& tinyPrimitive : tinyMesh.primitives)
+			tinyPrimitives.push_back(&tinyPrimitive);
+	}
+
+	// ranges of primitives within data of model known from accessor counts, each index range aligned to its index size
+	// jobs convert straight into them, no copy of converted primitive made
+	uint64 verticiesSize{};
+	uint64 indicesSize{};
+	for (const tinygltf::Primitive* tinyPrimitive : tinyPrimitives)
+	{
+		lmesh::Primitive& primitive = outModel.primitives.emplace_back();
+		const auto positionAttr = tinyPrimitive->attributes.find("POSITION");
+		primitive.vertexOffset = verticiesSize;
+		primitive.vertexCount = positionAttr != tinyPrimitive->attributes.end() ? tinyModel.accessors[positionAttr->second].count : 0;
+		verticiesSize += static_cast<uint64>(primitive.vertexCount) * sizeof(Vertex343224);
+
+		// 8 bit indices widened, index buffers of them not supported everywhere
+		if (tinyPrimitive->indices != -1)
 		{
-			std::vector<Vertex343224>& vertexBuffer = verticies.emplace_back();
+			const auto& indicesAccessor = tinyModel.accessors[tinyPrimitive->indices];
+			primitive.indexSizeof = indicesAccessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT ? sizeof(uint32) : sizeof(uint16);
+			primitive.indexOffset = (indicesSize + primitive.indexSizeof - 1) / primitive.indexSizeof * primitive.indexSizeof;
+			primitive.indexCount = indicesAccessor.count;
+			indicesSize = primitive.indexOffset + static_cast<uint64>(primitive.indexCount) * primitive.indexSizeof;
+		}
 
-			int32 positionAttrIndex{-1};
-			int32 tangentAttrIndex{-1};
-			int32 normalAttrIndex{-1};
-			std::vector<int32> texCoordsAttrIndices{};
-			std::vector<int32> colorAttrIndices{};
+		primitive.material = tinyPrimitive->material;
+		primitive.mode = tinyPrimitive->mode;
+	}
+	outModel.verticies.resize(verticiesSize);
+	outModel.indices.resize(indicesSize);
 
-			for (const auto& [name, index] : tinyPrimitive.attributes)
-			{
-				if (name == "POSITION")
-				{
-					positionAttrIndex = index;
-				}
-				else if (name == "TANGENT")
-				{
-					tangentAttrIndex = index;
-				}
-				else if (name == "NORMAL")
-				{
-					normalAttrIndex = index;
-				}
-				else if (name.find("TEXCOORD_") != std::string::npos)
-				{
-					texCoordsAttrIndices.emplace_back(index);
-				}
-				else if (name.find("COLOR_") != std::string::npos)
-				{
-					colorAttrIndices.emplace_back(index);
-				}
-			}
+	// primitive per job, big ones take longest so they go first
+	const auto primitiveSize = [&outModel](uint32 primitive) -> uint32
+	{ return outModel.primitives[primitive].indexCount ? outModel.primitives[primitive].indexCount : outModel.primitives[primitive].vertexCount; };
 
-			const lnm::vec3* positionsData = nullptr;
-			const lnm::vec4* tangentData = nullptr;
-			const lnm::vec3* normalData = nullptr;
-			const lnm::uint8* uv0 = nullptr;
-			const lnm::uint8* uv1 = nullptr;
-			const lnm::uint8* color0 = nullptr;
+	std::vector<uint32> order(tinyPrimitives.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::sort(order.begin(), order.end(), [&](uint32 a, uint32 b)
+		{ return primitiveSize(a) > primitiveSize(b); });
 
-			size_t positionBufferCount = 0;
-			if (positionAttrIndex != -1)
-			{
-				const auto& accessor = tinyModel.accessors[positionAttrIndex];
-				const auto& bufferView = tinyModel.bufferViews[accessor.bufferView];
-				positionsData = reinterpret_cast<const lnm::vec3*>(tinyModel.buffers[bufferView.buffer].data.data() + bufferView.byteOffset + accessor.byteOffset);
-				positionBufferCount = accessor.count;
-			}
+	const auto convertRange = [&](uint32 begin, uint32 end)
+	{
+		for (uint32 i = begin; i < end; ++i)
+		{
+			lmesh::Primitive& primitive = outModel.primitives[order[i]];
+			const auto verticies = std::span<Vertex343224>(reinterpret_cast<Vertex343224*>(outModel.verticies.data() + primitive.vertexOffset), primitive.vertexCount);
+			const auto indices = std::span<uint8>(outModel.indices.data() + primitive.indexOffset, static_cast<size_t>(primitive.indexCount) * primitive.indexSizeof);
+			convertPrimitive(tinyModel, buffers, *tinyPrimitives[order[i]], verticies, indices, primitive);
+		}
+	};
 
-			if (tangentAttrIndex != -1)
-			{
-				const auto& accessor = tinyModel.accessors[tangentAttrIndex];
-				const auto& bufferView = tinyModel.bufferViews[accessor.bufferView];
-				tangentData = reinterpret_cast<const lnm::vec4*>(tinyModel.buffers[bufferView.buffer].data.data() + bufferView.byteOffset + accessor.byteOffset);
-			}
+	if (auto jobs = findJobSubsystem())
+		jobs->parallelFor(order.size(), 1, convertRange);
+	else
+		convertRange(0, order.size());
+}
 
-			if (normalAttrIndex != -1)
-			{
-				const auto& accessor = tinyModel.accessors[normalAttrIndex];
-				const auto& bufferView = tinyModel.bufferViews[accessor.bufferView];
-				normalData = reinterpret_cast<const lnm::vec3*>(tinyModel.buffers[bufferView.buffer].data.data() + bufferView.byteOffset + accessor.byteOffset);
-			}
+void lune::convertNodes(const tinygltf::Model& tinyModel, lmesh::Model& outModel)
+{
+	for (const auto& tinyNode : tinyModel.nodes)
+	{
+		lmesh::Node& node = outModel.nodes.emplace_back();
+		if (tinyNode.rotation.size())
+			node.rotation = lnm::quat(*reinterpret_cast<const lnm::dquat*>(tinyNode.rotation.data()));
+		if (tinyNode.scale.size())
+			node.scale = lnm::vec3(*reinterpret_cast<const lnm::dvec3*>(tinyNode.scale.data()));
+		if (tinyNode.translation.size())
+			node.translation = lnm::vec3(*reinterpret_cast<const lnm::dvec3*>(tinyNode.translation.data()));
+		if (tinyNode.matrix.size())
+			decomposeTRS(lnm::mat4(*reinterpret_cast<const lnm::dmat4x4*>(tinyNode.matrix.data())), node.translation, node.rotation, node.scale);
+
+		node.mesh = tinyNode.mesh;
+		node.firstChild = outModel.children.size();
+		node.childCount = tinyNode.children.size();
+		outModel.children.insert(outModel.children.end(), tinyNode.children.begin(), tinyNode.children.end());
+	}
+
+	// resources shared by all scenes of model, their roots spawned together
+	for (const auto& tinyScene : tinyModel.scenes)
+		outModel.roots.insert(outModel.roots.end(), tinyScene.nodes.begin(), tinyScene.nodes.end());
+}
 
-			for (size_t k = 0; k < texCoordsAttrIndices.size(); ++k)
+void lune::convertMaterials(const tinygltf::Model& tinyModel, const SourceBuffers& buffers, lmesh::Model& outModel)
+{
+	for (const auto& tinyMaterial : tinyModel.materials)
+	{
+		lmesh::Material& material = outModel.materials.emplace_back();
+		material.baseColorFactor = lnm::vec4(*reinterpret_cast<const lnm::dvec4*>(tinyMaterial.pbrMetallicRoughness.baseColorFactor.data()));
+		material.emissiveFactor = lnm::vec4(*reinterpret_cast<const lnm::dvec3*>(tinyMaterial.emissiveFactor.data()), 0.f);
+		material.metallicFactor = tinyMaterial.pbrMetallicRoughness.metallicFactor;
+		material.roughnessFactor = tinyMaterial.pbrMetallicRoughness.roughnessFactor;
+		material.normalScale = tinyMaterial.normalTexture.scale;
+		material.doubleSided = tinyMaterial.doubleSided;
+
+		// same order as texture slots of ShaderMaterialData
+		const std::array<std::pair<int32, int32>, 5> textureIndexAndUVSet = {
+			std::pair{tinyMaterial.pbrMetallicRoughness.baseColorTexture.index, tinyMaterial.pbrMetallicRoughness.baseColorTexture.texCoord},
+			std::pair{tinyMaterial.pbrMetallicRoughness.metallicRoughnessTexture.index, tinyMaterial.pbrMetallicRoughness.metallicRoughnessTexture.texCoord},
+			std::pair{tinyMaterial.normalTexture.index, tinyMaterial.normalTexture.texCoord},
+			std::pair{tinyMaterial.occlusionTexture.index, tinyMaterial.occlusionTexture.texCoord},
+			std::pair{tinyMaterial.emissiveTexture.index, tinyMaterial.emissiveTexture.texCoord}};
+
+		for (size_t i = 0; i < textureIndexAndUVSet.size(); ++i)
+			std::tie(material.textures[i], material.texCoords[i]) = textureIndexAndUVSet[i];
+	}
+
+	for (const auto& tinyTexture : tinyModel.textures)
+		outModel.textures.push_back(lmesh::Texture{tinyTexture.source, tinyTexture.sampler});
+	for (const auto& tinySampler : tinyModel.samplers)
+		outModel.samplers.push_back(lmesh::Sampler{tinySampler.magFilter, tinySampler.minFilter});
+
+	// images of glb and data uris embedded as encoded files, rest referenced by uri
+	for (size_t i = 0; i < tinyModel.images.size(); ++i)
+	{
+		const auto& tinyImage = tinyModel.images[i];
+		std::span<const uint8> data = tinyImage.image;
+		if (data.empty() && tinyImage.bufferView >= 0 && static_cast<size_t>(tinyImage.bufferView) < tinyModel.bufferViews.size())
+		{
+			const auto& bufferView = tinyModel.bufferViews[tinyImage.bufferView];
+			data = buffers[bufferView.buffer].subspan(bufferView.byteOffset, bufferView.byteLength);
+		}
+
+		lmesh::Image& image = outModel.images.emplace_back();
+		if (!data.empty())
+		{
+			image.dataOffset = static_cast<uint32>(outModel.imageData.size());
+			image.dataSize = static_cast<uint32>(data.size());
+			outModel.imageData.insert(outModel.imageData.end(), data.begin(), data.end());
+		}
+		else if (!tinyImage.uri.empty())
+		{
+			std::string uri{};
+			tinygltf::URIDecode(tinyImage.uri, &uri, nullptr);
+			image.uriOffset = static_cast<uint32>(outModel.strings.size());
+			image.uriSize = static_cast<uint32>(uri.size());
+			outModel.strings += uri;
+		}
+		else
+		{
+			LN_LOG(Warning, GLTF::Loader, "Image {} ({}) has neither data nor uri, textures of it use default one", i, tinyImage.name);
+		}
+	}
+}
+
+void lune::convertPrimitive(const tinygltf::Model& tinyModel, const SourceBuffers& buffers, const tinygltf::Primitive& tinyPrimitive, std::span<Vertex343224> outVerticies, std::span<uint8> outIndices, lmesh::Primitive& outPrimitive)
+{
+	// data of model zeroed, fields of attributes primitive lacks stay default
+	std::span<Vertex343224> vertexBuffer = outVerticies;
+
+	int32 positionAttrIndex{-1};
+	int32 tangentAttrIndex{-1};
+	int32 normalAttrIndex{-1};
+	std::vector<int32> texCoordsAttrIndices{};
+	std::vector<int32> colorAttrIndices{};
+
+	for (const auto& [name, index] : tinyPrimitive.attributes)
+	{
+		if (name == "POSITION")
+		{
+			positionAttrIndex = index;
+		}
+		else if (name == "TANGENT")
+		{
+			tangentAttrIndex = index;
+		}
+		else if (name == "NORMAL")
+		{
+			normalAttrIndex = index;
+		}
+		else if (name.find("TEXCOORD_") != std::string::npos)
+		{
+			texCoordsAttrIndices.emplace_back(index);
+		}
+		else if (name.find("COLOR_") != std::string::npos)
+		{
+			colorAttrIndices.emplace_back(index);
+		}
+	}
+
+	const lnm::vec3* positionsData = nullptr;
+	const lnm::vec4* tangentData = nullptr;
+	const lnm::vec3* normalData = nullptr;
+	const lnm::uint8* uv0 = nullptr;
+	const lnm::uint8* uv1 = nullptr;
+	const lnm::uint8* color0 = nullptr;
+
+	size_t positionBufferCount = 0;
+	if (positionAttrIndex != -1)
+	{
+		positionsData = reinterpret_cast<const lnm::vec3*>(findAccessorData(tinyModel, buffers, positionAttrIndex));
+		positionBufferCount = positionsData ? tinyModel.accessors[positionAttrIndex].count : 0;
+	}
+
+	if (tangentAttrIndex != -1)
+	{
+		tangentData = reinterpret_cast<const lnm::vec4*>(findAccessorData(tinyModel, buffers, tangentAttrIndex));
+	}
+
+	if (normalAttrIndex != -1)
+	{
+		normalData = reinterpret_cast<const lnm::vec3*>(findAccessorData(tinyModel, buffers, normalAttrIndex));
+	}
+
+	for (size_t k = 0; k < texCoordsAttrIndices.size(); ++k)
+	{
+		const uint8* data = findAccessorData(tinyModel, buffers, texCoordsAttrIndices[k]);
+		if (k == 0)
+			uv0 = data;
+		else if (k == 1)
+			uv1 = data;
+		else
+			break; // not supported
+	}
+
+	for (size_t k = 0; k < colorAttrIndices.size(); ++k)
+	{
+		const uint8* data = findAccessorData(tinyModel, buffers, colorAttrIndices[k]);
+		if (k == 0)
+			color0 = data;
+		else
+			break; // not supported
+	}
+
+	// indices without buffer view left zeroed
+	const uint8* indexData = tinyPrimitive.indices != -1 ? findAccessorData(tinyModel, buffers, tinyPrimitive.indices) : nullptr;
+	if (indexData)
+	{
+		const auto& indicesAccessor = tinyModel.accessors[tinyPrimitive.indices];
+		if (indicesAccessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE)
+		{
+			for (uint32 k = 0; k < outPrimitive.indexCount; ++k)
 			{
-				const int32 attrIndex = texCoordsAttrIndices[k];
-				const auto& accessor = tinyModel.accessors[attrIndex];
-				const auto& bufferView = tinyModel.bufferViews[accessor.bufferView];
-
-				const uint8* data = reinterpret_cast<const uint8*>(tinyModel.buffers[bufferView.buffer].data.data() + bufferView.byteOffset + accessor.byteOffset);
-				if (k == 0)
-					uv0 = data;
-				else if (k == 1)
-					uv1 = data;
-				else
-					break; // not supported
+				const uint16 index = indexData[k];
+				std::memcpy(outIndices.data() + k * sizeof(uint16), &index, sizeof(uint16));
 			}
+		}
+		else if (!outIndices.empty())
+		{
+			std::memcpy(outIndices.data(), indexData, outIndices.size());
+		}
+	}
 
-			for (size_t k = 0; k < colorAttrIndices.size(); ++k)
+	for (size_t k = 0; k < positionBufferCount; ++k)
+	{
+		vertexBuffer[k].position = *(positionsData + k);
+		if (tangentData)
+		{
+			vertexBuffer[k].tangent = *(tangentData + k);
+		}
+		if (normalData)
+		{
+			vertexBuffer[k].normal = *(normalData + k);
+		}
+		if (uv0)
+		{
+			const auto& accessor = tinyModel.accessors[texCoordsAttrIndices[0]];
+			if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT)
+				vertexBuffer[k].uv0 = *reinterpret_cast<const lnm::vec2*>(uv0 + (k * sizeof(lnm::vec2)));
+			else if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT)
+				vertexBuffer[k].uv0 = *reinterpret_cast<const lnm::u16vec2*>(uv0 + (k * sizeof(lnm::u16vec2)));
+			else if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE)
+				vertexBuffer[k].uv0 = *reinterpret_cast<const lnm::u8vec2*>(uv0 + (k * sizeof(lnm::u8vec2)));
+		}
+		if (uv1)
+		{
+			const auto& accessor = tinyModel.accessors[texCoordsAttrIndices[1]];
+			if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT)
+				vertexBuffer[k].uv1 = *reinterpret_cast<const lnm::vec2*>(uv1 + (k * sizeof(lnm::vec2)));
+			else if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT)
+				vertexBuffer[k].uv1 = *reinterpret_cast<const lnm::u16vec2*>(uv1 + (k * sizeof(lnm::u16vec2)));
+			else if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE)
+				vertexBuffer[k].uv1 = *reinterpret_cast<const lnm::u8vec2*>(uv1 + (k * sizeof(lnm::u8vec2)));
+		}
+		if (color0)
+		{
+			const auto& accessor = tinyModel.accessors[colorAttrIndices[0]];
+			if (accessor.type == TINYGLTF_TYPE_VEC4)
 			{
-				const int32 attrIndex = colorAttrIndices[k];
-				const auto& accessor = tinyModel.accessors[attrIndex];
-				const auto& bufferView = tinyModel.bufferViews[accessor.bufferView];
-				const uint8* data = reinterpret_cast<const uint8*>(tinyModel.buffers[bufferView.buffer].data.data() + bufferView.byteOffset + accessor.byteOffset);
-				if (k == 0)
-					color0 = data;
-				else
-					break; // not supported
+				if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT)
+					vertexBuffer[k].color0 = lnm::vec4(*reinterpret_cast<const lnm::vec3*>(color0 + (k * sizeof(lnm::vec3))), 1.f);
+				else if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT)
+					vertexBuffer[k].color0 = lnm::u16vec4(*reinterpret_cast<const lnm::u16vec3*>(color0 + (k * sizeof(lnm::u16vec3))), 1);
+				else if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE)
+					vertexBuffer[k].color0 = lnm::u8vec4(*reinterpret_cast<const lnm::u8vec3*>(color0 + (k * sizeof(lnm::u8vec3))), 1);
 			}
-
-			if (tinyPrimitive.indices != -1)
+			else if (accessor.type == TINYGLTF_TYPE_VEC3)
 			{
-				const auto& indicesAccessor = tinyModel.accessors[tinyPrimitive.indices];
-				const auto& indicesBufferView = tinyModel.bufferViews[indicesAccessor.bufferView];
-				const uint8* indicesData = reinterpret_cast<const uint8*>(tinyModel.buffers[indicesBufferView.buffer].data.data() + indicesBufferView.byteOffset + indicesAccessor.byteOffset);
-				size_t indiciesCount = indicesAccessor.count;
-				int32 indiciesSizeof = 0;
-				if (indicesAccessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT)
-					indiciesSizeof = sizeof(uint16);
-				else if (indicesAccessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT)
-					indiciesSizeof = sizeof(uint32);
-
-				indices.emplace_back(indicesData, (uint32)indiciesCount, (uint32)indiciesSizeof);
-				totalIndexSize += indiciesCount * indiciesSizeof;
+				if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT)
+					vertexBuffer[k].color0 = *reinterpret_cast<const lnm::vec4*>(color0 + (k * sizeof(lnm::vec4)));
+				else if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT)
+					vertexBuffer[k].color0 = *reinterpret_cast<const lnm::u16vec4*>(color0 + (k * sizeof(lnm::u16vec4)));
+				else if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE)
+					vertexBuffer[k].color0 = *reinterpret_cast<const lnm::u8vec4*>(color0 + (k * sizeof(lnm::u8vec4)));
 			}
+		}
+		else
+		{
+			vertexBuffer[k].color0 = lnm::vec4(1.f, 1.f, 1.f, 1.f);
+		}
+	}
+
+	computeBounds(tinyModel, tinyPrimitive, vertexBuffer, outPrimitive.box, outPrimitive.sphere);
+}
+
+void lune::prepareTriangles(PreparedModel& prepared, const gltf::LoadOptions& options)
+{
+	if (!options.keepTriangles)
+		return;
+
+	const lmesh::ModelView& model = prepared.view;
+	prepared.triangleMeshes.resize(model.primitives.size());
+	prepared.triangleBvhs.resize(model.primitives.size());
+
+	// primitive per job, big ones take longest so they go first
+	const auto primitiveSize = [&model](uint32 primitive) -> uint32
+	{ return model.primitives[primitive].indexCount ? model.primitives[primitive].indexCount : model.primitives[primitive].vertexCount; };
+
+	std::vector<uint32> order(model.primitives.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::sort(order.begin(), order.end(), [&](uint32 a, uint32 b)
+		{ return primitiveSize(a) > primitiveSize(b); });
 
-			vertexBuffer.resize(positionBufferCount);
-			totalVertexCount += positionBufferCount;
-			for (size_t k = 0; k < positionBufferCount; ++k)
+	const auto prepare = [&](uint32 begin, uint32 end)
+	{
+		for (uint32 i = begin; i < end; ++i)
+		{
+			const lmesh::Primitive& primitive = model.primitives[order[i]];
+			const auto vertex = std::span<const Vertex343224>(reinterpret_cast<const Vertex343224*>(model.verticies.data() + primitive.vertexOffset), primitive.vertexCount);
+			const uint8* indexData = model.indices.data() + primitive.indexOffset;
+
+			SharedTriangleMesh& triangleMesh = prepared.triangleMeshes[order[i]];
+			if (!primitive.indexCount)
+				triangleMesh = makeTriangleMesh(primitive.mode, vertex, std::span<const uint32>());
+			else if (primitive.indexSizeof == sizeof(uint16))
+				triangleMesh = makeTriangleMesh(primitive.mode, vertex, std::span<const uint16>(reinterpret_cast<const uint16*>(indexData), primitive.indexCount));
+			else
+				triangleMesh = makeTriangleMesh(primitive.mode, vertex, std::span<const uint32>(reinterpret_cast<const uint32*>(indexData), primitive.indexCount));
+
+			if (options.buildTriangleBvh && triangleMesh)
 			{
-				vertexBuffer[k].position = *(positionsData + k);
-				if (tangentData)
-				{
-					vertexBuffer[k].tangent = *(tangentData + k);
-				}
-				if (normalData)
-				{
-					vertexBuffer[k].normal = *(normalData + k);
-				}
-				if (uv0)
-				{
-					const auto& accessor = tinyModel.accessors[texCoordsAttrIndices[0]];
-					if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT)
-						vertexBuffer[k].uv0 = *reinterpret_cast<const lnm::vec2*>(uv0 + (k * sizeof(lnm::vec2)));
-					else if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT)
-						vertexBuffer[k].uv0 = *reinterpret_cast<const lnm::u16vec2*>(uv0 + (k * sizeof(lnm::u16vec2)));
-					else if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE)
-						vertexBuffer[k].uv0 = *reinterpret_cast<const lnm::u8vec2*>(uv0 + (k * sizeof(lnm::u8vec2)));
-				}
-				if (uv1)
-				{
-					const auto& accessor = tinyModel.accessors[texCoordsAttrIndices[1]];
-					if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT)
-						vertexBuffer[k].uv1 = *reinterpret_cast<const lnm::vec2*>(uv1 + (k * sizeof(lnm::vec2)));
-					else if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT)
-						vertexBuffer[k].uv1 = *reinterpret_cast<const lnm::u16vec2*>(uv1 + (k * sizeof(lnm::u16vec2)));
-					else if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE)
-						vertexBuffer[k].uv1 = *reinterpret_cast<const lnm::u8vec2*>(uv1 + (k * sizeof(lnm::u8vec2)));
-				}
-				if (color0)
-				{
-					const auto& accessor = tinyModel.accessors[colorAttrIndices[0]];
-					if (accessor.type == TINYGLTF_TYPE_VEC4)
-					{
-						if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT)
-							vertexBuffer[k].color0 = lnm::vec4(*reinterpret_cast<const lnm::vec3*>(color0 + (k * sizeof(lnm::vec3))), 1.f);
-						else if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT)
-							vertexBuffer[k].color0 = lnm::u16vec4(*reinterpret_cast<const lnm::u16vec3*>(color0 + (k * sizeof(lnm::u16vec3))), 1);
-						else if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE)
-							vertexBuffer[k].color0 = lnm::u8vec4(*reinterpret_cast<const lnm::u8vec3*>(color0 + (k * sizeof(lnm::u8vec3))), 1);
-					}
-					else if (accessor.type == TINYGLTF_TYPE_VEC3)
-					{
-						if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT)
-							vertexBuffer[k].color0 = *reinterpret_cast<const lnm::vec4*>(color0 + (k * sizeof(lnm::vec4)));
-						else if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT)
-							vertexBuffer[k].color0 = *reinterpret_cast<const lnm::u16vec4*>(color0 + (k * sizeof(lnm::u16vec4)));
-						else if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE)
-							vertexBuffer[k].color0 = *reinterpret_cast<const lnm::u8vec4*>(color0 + (k * sizeof(lnm::u8vec4)));
-					}
-				}
-				else
-				{
-					vertexBuffer[k].color0 = lnm::vec4(1.f, 1.f, 1.f, 1.f);
-				}
+				auto triangleBvh = std::make_shared<TriangleBvh>();
+				triangleBvh->build(*triangleMesh);
+				prepared.triangleBvhs[order[i]] = std::move(triangleBvh);
 			}
 		}
+	};
+
+	if (auto jobs = findJobSubsystem())
+		jobs->parallelFor(order.size(), 1, prepare);
+	else
+		prepare(0, order.size());
+}
+
+void lune::prepareImages(PreparedModel& prepared, const gltf::LoadOptions& options)
+{
+	const lmesh::ModelView& model = prepared.view;
+	prepared.images.resize(model.images.size());
+
+	// images no texture uses never decoded
+	std::vector<uint32>& usedImages = prepared.usedImages;
+	for (const lmesh::Texture& texture : model.textures)
+	{
+		if (texture.image >= 0 && std::find(usedImages.begin(), usedImages.end(), texture.image) == usedImages.end())
+			usedImages.push_back(texture.image);
 	}
 
+	const auto prepare = [&](uint32 begin, uint32 end)
+	{
+		for (uint32 i = begin; i < end; ++i)
+		{
+			const lmesh::Image& image = model.images[usedImages[i]];
+			if (image.dataSize)
+				prepareEmbeddedImage(model.getImageData(image), options, prepared.images[usedImages[i]]);
+			else if (image.uriSize)
+				prepareImage(prepared.root / model.getImageUri(image), options, prepared.images[usedImages[i]]);
+		}
+	};
+
+	if (auto jobs = findJobSubsystem())
+		jobs->parallelFor(usedImages.size(), 1, prepare);
+	else
+		prepare(0, usedImages.size());
+}
+
+void lune::createMeshBuffers(PreparedModel& prepared)
+{
+	// single pair for whole model, each primitive draws from its own range
 	constexpr vk::BufferUsageFlags vertexBufferUsageBits = vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eTransferDst;
-	vulkan::SharedBuffer vertexBuffer = vulkan::Buffer::create(vertexBufferUsageBits, totalVertexCount * sizeof(Vertex343224), VmaMemoryUsage::VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, {});
+	prepared.vertexBuffer = vulkan::Buffer::create(vertexBufferUsageBits, prepared.view.verticies.size(), VmaMemoryUsage::VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, {});
 
-	vulkan::SharedBuffer indexBuffer = nullptr;
-	if (totalIndexSize)
+	if (!prepared.view.indices.empty())
 	{
 		constexpr vk::BufferUsageFlags indexBufferUsageBits = vk::BufferUsageFlagBits::eIndexBuffer | vk::BufferUsageFlagBits::eTransferDst;
-		indexBuffer = vulkan::Buffer::create(indexBufferUsageBits, totalIndexSize, VmaMemoryUsage::VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, {});
+		prepared.indexBuffer = vulkan::Buffer::create(indexBufferUsageBits, prepared.view.indices.size(), VmaMemoryUsage::VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, {});
 	}
+}
 
+void lune::uploadMeshData(PreparedModel& prepared, const vulkan::SharedBuffer& buffer, std::span<const uint8> data, vk::DeviceSize offset, vk::DeviceSize size)
+{
+	// staged straight from mapped file of cooked model, its pages read in as they are copied
+	prepared.uploadTicket = buffer->copyTransfer(data.data() + offset, offset, size);
+}
+
+void lune::createPrimitives(const PreparedModel& prepared, std::string_view alias)
+{
+	const lmesh::ModelView& model = prepared.view;
 	auto vkSubsystem = Engine::get()->findSubsystem<VulkanSubsystem>();
+	for (size_t meshIndex = 0; meshIndex < model.meshes.size(); ++meshIndex)
+	{
+		const lmesh::Mesh& mesh = model.meshes[meshIndex];
+		for (uint32 i = 0; i < mesh.primitiveCount; ++i)
+		{
+			const uint32 primitiveIndex = mesh.firstPrimitive + i;
+			const lmesh::Primitive& meshPrimitive = model.primitives[primitiveIndex];
 
-	uint32 vertexOffset = 0;
-	uint32 vertexElem = 0;
-	uint32 indexOffset = 0;
-	size_t indexElem = 0;
+			vulkan::SharedPrimitive primitive = vulkan::Primitive::createInBuffers(meshPrimitive.vertexCount, sizeof(Vertex343224), prepared.vertexBuffer, meshPrimitive.vertexOffset,
+				meshPrimitive.indexCount, meshPrimitive.indexSizeof, prepared.indexBuffer, meshPrimitive.indexOffset, prepared.uploadTicket);
 
-	const size_t meshesSize = tinyModel.meshes.size();
-	for (size_t meshIndex = 0; meshIndex < meshesSize; ++meshIndex)
+			primitive->setBounds(meshPrimitive.box, meshPrimitive.sphere);
+			if (!prepared.triangleMeshes.empty())
+			{
+				primitive->setTriangleMesh(prepared.triangleMeshes[primitiveIndex]);
+				primitive->setTriangleBvh(prepared.triangleBvhs[primitiveIndex]);
+			}
+
+			vkSubsystem->addPrimitive(std::format("{}::mesh::{}::primitive::{}", alias, meshIndex, i), primitive);
+		}
+	}
+}
+
+void lune::computeBounds(const tinygltf::Model& tinyModel, const tinygltf::Primitive& tinyPrimitive, std::span<const Vertex343224> verticies, BoundingBox& outBox, BoundingSphere& outSphere)
+{
+	if (verticies.empty())
+		return;
+
+	// position accessor required to have min and max, computed only for files that break that
+	const auto positionAttr = tinyPrimitive.attributes.find("POSITION");
+	const tinygltf::Accessor* accessor = positionAttr != tinyPrimitive.attributes.end() ? &tinyModel.accessors[positionAttr->second] : nullptr;
+	if (accessor && accessor->minValues.size() == 3 && accessor->maxValues.size() == 3)
 	{
-		const size_t primitivesSize = tinyModel.meshes[meshIndex].primitives.size();
-		for (size_t primitiveIndex = 0; primitiveIndex < primitivesSize; ++primitiveIndex)
+		outBox.min = lnm::vec3(accessor->minValues[0], accessor->minValues[1], accessor->minValues[2]);
+		outBox.max = lnm::vec3(accessor->maxValues[0], accessor->maxValues[1], accessor->maxValues[2]);
+	}
+	else
+	{
+		outBox = BoundingBox{verticies[0].position, verticies[0].position};
+		for (const Vertex343224& vertex : verticies)
 		{
-			const std::string primitiveName = std::format("{}::mesh::{}::primitive::{}", alias, meshIndex, primitiveIndex);
+			outBox.min = lnm::min(outBox.min, vertex.position);
+			outBox.max = lnm::max(outBox.max, vertex.position);
+		}
+	}
+
+	// sphere around box center, tighter than one enclosing box corners
+	outSphere.center = outBox.getCenter();
+	float radiusSquared{};
+	for (const Vertex343224& vertex : verticies)
+	{
+		const lnm::vec3 offset = vertex.position - outSphere.center;
+		radiusSquared = std::max(radiusSquared, lnm::dot(offset, offset));
+	}
+	outSphere.radius = std::sqrt(radiusSquared);
+}
 
-			vulkan::SharedPrimitive primitive = nullptr;
+template <typename Indx>
+lune::SharedTriangleMesh lune::makeTriangleMesh(int32 mode, std::span<const Vertex343224> verticies, std::span<const Indx> indices)
+{
+	if (mode != TINYGLTF_MODE_TRIANGLES && mode != TINYGLTF_MODE_TRIANGLE_STRIP && mode != TINYGLTF_MODE_TRIANGLE_FAN)
+		return nullptr;
 
-			const auto vertex = std::span<const Vertex343224>(verticies[vertexElem]);
+	// non indexed primitives index their verticies in order
+	const uint32 count = indices.empty() ? verticies.size() : indices.size();
+	const auto index = [&indices](uint32 i) -> uint32
+	{ return indices.empty() ? i : static_cast<uint32>(indices[i]); };
 
-			if (tinyModel.meshes[meshIndex].primitives[primitiveIndex].indices != -1)
-			{
-				const auto& [indxData, indxCount, indxSizeof] = indices[indexElem];
-				if (indxSizeof == sizeof(uint16))
-				{
-					const auto index = std::span<const uint16>(reinterpret_cast<const uint16*>(indxData), indxCount);
-					primitive = vulkan::Primitive::createFromBuffers<Vertex343224, uint16>(vertex, index, vertexBuffer, vertexOffset, indexBuffer, indexOffset);
-				}
-				else if (indxSizeof == sizeof(uint32))
-				{
-					const auto index = std::span<const uint32>(reinterpret_cast<const uint32*>(indxData), indxCount);
-					primitive = vulkan::Primitive::createFromBuffers<Vertex343224, uint32>(vertex, index, vertexBuffer, vertexOffset, indexBuffer, indexOffset);
-				}
-
-				indexOffset += indxCount * indxSizeof;
-				indexElem++;
-			}
+	auto triangleMesh = std::make_shared<TriangleMesh>();
+	triangleMesh->positions.reserve(verticies.size());
+	for (const Vertex343224& vertex : verticies)
+		triangleMesh->positions.push_back(vertex.position);
+
+	// strips and fans unrolled into triangle list, winding kept
+	if (mode == TINYGLTF_MODE_TRIANGLES)
+	{
+		triangleMesh->indices.reserve(count);
+		for (uint32 i = 0; i + 2 < count; i += 3)
+			triangleMesh->indices.insert(triangleMesh->indices.end(), {index(i), index(i + 1), index(i + 2)});
+	}
+	else if (mode == TINYGLTF_MODE_TRIANGLE_STRIP)
+	{
+		for (uint32 i = 0; i + 2 < count; ++i)
+		{
+			if (i % 2 == 0)
+				triangleMesh->indices.insert(triangleMesh->indices.end(), {index(i), index(i + 1), index(i + 2)});
 			else
-			{
-				primitive = vulkan::Primitive::createFromBuffers<Vertex343224, uint16>(vertex, std::span<uint16>(), vertexBuffer, vertexOffset, nullptr, 0);
-			}
-			vertexOffset += verticies[vertexElem].size() * sizeof(Vertex343224);
-			vertexElem++;
-			vkSubsystem->addPrimitive(primitiveName, primitive);
+				triangleMesh->indices.insert(triangleMesh->indices.end(), {index(i + 1), index(i), index(i + 2)});
 		}
 	}
+	else
+	{
+		for (uint32 i = 1; i + 1 < count; ++i)
+			triangleMesh->indices.insert(triangleMesh->indices.end(), {index(0), index(i), index(i + 1)});
+	}
+
+	return triangleMesh;
 }
 
 void lune::decomposeTRS(const lnm::mat4& matrix, lnm::vec3& translation, lnm::quat& rotation, lnm::vec3& scale)
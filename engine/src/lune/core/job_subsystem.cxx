@@ -0,0 +1,123 @@
+#include "lune/core/job_subsystem.hxx"
+
+#include "lune/core/log.hxx"
+
+#include <algorithm>
+
+// more threads than that only add contention on queue for work engine has
+constexpr uint32 MaxWorkerCount = 15;
+
+lune::JobSubsystem::~JobSubsystem()
+{
+	// workers stopped and joined before queue they wait on goes away
+	mWorkers.clear();
+}
+
+void lune::JobSubsystem::initialize()
+{
+	const uint32 hardwareThreads = std::max(std::thread::hardware_concurrency(), 1u);
+	const uint32 workerCount = std::min(hardwareThreads - 1, MaxWorkerCount);
+
+	mWorkers.reserve(workerCount);
+	for (uint32 i = 0; i < workerCount; ++i)
+		mWorkers.emplace_back([this](std::stop_token stopToken)
+			{ workerLoop(stopToken); });
+
+	LN_LOG(Info, Engine::Jobs, "Started {} worker threads", workerCount);
+}
+
+void lune::JobSubsystem::submit(Job job, JobCounter* counter)
+{
+	if (counter)
+		counter->pending.fetch_add(1, std::memory_order_relaxed);
+
+	// nobody to run it otherwise
+	if (mWorkers.empty())
+	{
+		QueuedJob queuedJob{std::move(job), counter};
+		runJob(queuedJob);
+		return;
+	}
+
+	{
+		std::lock_guard lock(mMutex);
+		mJobs.push_back(QueuedJob{std::move(job), counter});
+	}
+	mCondition.notify_one();
+}
+
+void lune::JobSubsystem::wait(const JobCounter& counter)
+{
+	while (!counter.isDone())
+	{
+		if (!runQueuedJob(counter))
+			std::this_thread::yield();
+	}
+}
+
+void lune::JobSubsystem::parallelFor(uint32 count, uint32 batchSize, const std::function<void(uint32 begin, uint32 end)>& func)
+{
+	batchSize = std::max(batchSize, 1u);
+	const uint32 batchCount = (count + batchSize - 1) / batchSize;
+	if (batchCount <= 1 || mWorkers.empty())
+	{
+		if (count)
+			func(0, count);
+		return;
+	}
+
+	// first batch left for calling thread
+	JobCounter counter{};
+	for (uint32 batch = 1; batch < batchCount; ++batch)
+	{
+		const uint32 begin = batch * batchSize;
+		const uint32 end = std::min(begin + batchSize, count);
+		submit([&func, begin, end]()
+			{ func(begin, end); }, &counter);
+	}
+
+	func(0, std::min(batchSize, count));
+	wait(counter);
+}
+
+void lune::JobSubsystem::workerLoop(std::stop_token stopToken)
+{
+	while (!stopToken.stop_requested())
+	{
+		QueuedJob queuedJob{};
+		{
+			std::unique_lock lock(mMutex);
+			if (!mCondition.wait(lock, stopToken, [this]()
+					{ return !mJobs.empty(); }))
+				return;
+
+			queuedJob = std::move(mJobs.front());
+			mJobs.pop_front();
+		}
+		runJob(queuedJob);
+	}
+}
+
+bool lune::JobSubsystem::runQueuedJob(const JobCounter& counter)
+{
+	QueuedJob queuedJob{};
+	{
+		std::lock_guard lock(mMutex);
+		const auto it = std::find_if(mJobs.begin(), mJobs.end(), [&counter](const QueuedJob& job)
+			{ return job.counter == &counter; });
+		if (it == mJobs.end())
+			return false;
+
+		queuedJob = std::move(*it);
+		mJobs.erase(it);
+	}
+	runJob(queuedJob);
+	return true;
+}
+
+void lune::JobSubsystem::runJob(QueuedJob& queuedJob)
+{
+	queuedJob.job();
+	if (queuedJob.counter)
+		queuedJob.counter->pending.fetch_sub(1, std::memory_order_release);
+}
@@ -0,0 +1,319 @@
+#include "lune/core/ktx2.hxx"
+
+#include "lune/core/log.hxx"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
+#include <fstream>
+
+constexpr std::array<uint8, 12> Ktx2Identifier = {0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A};
+
+// khronos data format values used by descriptors written here
+constexpr uint8 DfModelRgbsda = 1;
+constexpr uint8 DfModelBc1a = 128;
+constexpr uint8 DfModelBc3 = 130;
+constexpr uint8 DfModelBc4 = 131;
+constexpr uint8 DfModelBc5 = 132;
+constexpr uint8 DfModelBc7 = 134;
+constexpr uint8 DfPrimariesBt709 = 1;
+constexpr uint8 DfTransferLinear = 1;
+constexpr uint8 DfTransferSrgb = 2;
+constexpr uint8 DfChannelAlpha = 15;
+constexpr uint8 DfSampleLinear = 0x10;
+
+struct Ktx2Header
+{
+	std::array<uint8, 12> identifier{};
+	uint32 vkFormat{};
+	uint32 typeSize{};
+	uint32 pixelWidth{};
+	uint32 pixelHeight{};
+	uint32 pixelDepth{};
+	uint32 layerCount{};
+	uint32 faceCount{};
+	uint32 levelCount{};
+	uint32 supercompressionScheme{};
+
+	uint32 dfdByteOffset{};
+	uint32 dfdByteLength{};
+	uint32 kvdByteOffset{};
+	uint32 kvdByteLength{};
+	uint64 sgdByteOffset{};
+	uint64 sgdByteLength{};
+};
+static_assert(sizeof(Ktx2Header) == 80);
+
+struct Ktx2LevelIndex
+{
+	uint64 byteOffset{};
+	uint64 byteLength{};
+	uint64 uncompressedByteLength{};
+};
+
+struct Ktx2Sample
+{
+	uint32 bitOffset{};
+	uint32 bitLength{};
+	uint8 channel{};
+	uint32 upper{};
+};
+
+// basic data format descriptor block with its total size in front, empty for formats not described here
+static std::vector<uint32> makeDataFormatDescriptor(vk::Format format)
+{
+	uint8 model{};
+	uint8 transfer = DfTransferLinear;
+	uint32 blockDimensions{};
+	uint32 bytesPlane0{};
+	std::vector<Ktx2Sample> samples{};
+
+	switch (format)
+	{
+	case vk::Format::eR8G8B8A8Srgb:
+		transfer = DfTransferSrgb;
+		[[fallthrough]];
+	case vk::Format::eR8G8B8A8Unorm:
+		model = DfModelRgbsda;
+		bytesPlane0 = 4;
+		samples = {{0, 8, 0, 255}, {8, 8, 1, 255}, {16, 8, 2, 255}, {24, 8, DfChannelAlpha, 255}};
+		break;
+	case vk::Format::eBc1RgbSrgbBlock:
+		transfer = DfTransferSrgb;
+		[[fallthrough]];
+	case vk::Format::eBc1RgbUnormBlock:
+		model = DfModelBc1a;
+		bytesPlane0 = 8;
+		samples = {{0, 64, 0, UINT32_MAX}};
+		break;
+	case vk::Format::eBc1RgbaSrgbBlock:
+		transfer = DfTransferSrgb;
+		[[fallthrough]];
+	case vk::Format::eBc1RgbaUnormBlock:
+		model = DfModelBc1a;
+		bytesPlane0 = 8;
+		samples = {{0, 64, DfChannelAlpha, UINT32_MAX}};
+		break;
+	case vk::Format::eBc3SrgbBlock:
+		transfer = DfTransferSrgb;
+		[[fallthrough]];
+	case vk::Format::eBc3UnormBlock:
+		model = DfModelBc3;
+		bytesPlane0 = 16;
+		samples = {{0, 64, DfChannelAlpha, UINT32_MAX}, {64, 64, 0, UINT32_MAX}};
+		break;
+	case vk::Format::eBc4UnormBlock:
+		model = DfModelBc4;
+		bytesPlane0 = 8;
+		samples = {{0, 64, 0, UINT32_MAX}};
+		break;
+	case vk::Format::eBc5UnormBlock:
+		model = DfModelBc5;
+		bytesPlane0 = 16;
+		samples = {{0, 64, 0, UINT32_MAX}, {64, 64, 1, UINT32_MAX}};
+		break;
+	case vk::Format::eBc7SrgbBlock:
+		transfer = DfTransferSrgb;
+		[[fallthrough]];
+	case vk::Format::eBc7UnormBlock:
+		model = DfModelBc7;
+		bytesPlane0 = 16;
+		samples = {{0, 128, 0, UINT32_MAX}};
+		break;
+	default:
+		return {};
+	}
+
+	if (model != DfModelRgbsda)
+		blockDimensions = 3 | (3 << 8);
+
+	const uint32 blockSize = 24 + 16 * samples.size();
+	std::vector<uint32> words{};
+	words.push_back(4 + blockSize);
+	words.push_back(0); // khronos vendor, basic descriptor type
+	words.push_back(2 | (blockSize << 16));
+	words.push_back(model | (DfPrimariesBt709 << 8) | (transfer << 16));
+	words.push_back(blockDimensions);
+	words.push_back(bytesPlane0);
+	words.push_back(0);
+	for (const Ktx2Sample& sample : samples)
+	{
+		// alpha stays linear in srgb formats
+		const uint32 channelType = sample.channel | (transfer == DfTransferSrgb && sample.channel == DfChannelAlpha ? DfSampleLinear : 0);
+		words.push_back(sample.bitOffset | ((sample.bitLength - 1) << 16) | (channelType << 24));
+		words.push_back(0);
+		words.push_back(0);
+		words.push_back(sample.upper);
+	}
+	return words;
+}
+
+uint32 lune::Ktx2Texture::getBlockSize(vk::Format format)
+{
+	switch (format)
+	{
+	case vk::Format::eBc1RgbUnormBlock:
+	case vk::Format::eBc1RgbSrgbBlock:
+	case vk::Format::eBc1RgbaUnormBlock:
+	case vk::Format::eBc1RgbaSrgbBlock:
+	case vk::Format::eBc4UnormBlock:
+	case vk::Format::eBc4SnormBlock:
+		return 8;
+	case vk::Format::eBc2UnormBlock:
+	case vk::Format::eBc2SrgbBlock:
+	case vk::Format::eBc3UnormBlock:
+	case vk::Format::eBc3SrgbBlock:
+	case vk::Format::eBc5UnormBlock:
+	case vk::Format::eBc5SnormBlock:
+	case vk::Format::eBc6HUfloatBlock:
+	case vk::Format::eBc6HSfloatBlock:
+	case vk::Format::eBc7UnormBlock:
+	case vk::Format::eBc7SrgbBlock:
+		return 16;
+	default:
+		return 0;
+	}
+}
+
+uint64 lune::Ktx2Texture::getFaceSize(vk::Format format, uint32 width, uint32 height)
+{
+	if (const uint32 blockSize = getBlockSize(format))
+		return static_cast<uint64>((width + 3) / 4) * ((height + 3) / 4) * blockSize;
+
+	switch (format)
+	{
+	case vk::Format::eR8G8B8A8Unorm:
+	case vk::Format::eR8G8B8A8Srgb:
+	case vk::Format::eB8G8R8A8Unorm:
+	case vk::Format::eB8G8R8A8Srgb:
+		return static_cast<uint64>(width) * height * 4;
+	default:
+		return 0;
+	}
+}
+
+bool lune::ktx2::read(const std::filesystem::path& path, Ktx2Texture& outTexture)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open())
+		return false;
+
+	Ktx2Header header{};
+	file.read(reinterpret_cast<char*>(&header), sizeof(header));
+	if (!file || header.identifier != Ktx2Identifier)
+	{
+		LN_LOG(Error, Ktx2::Read, "Not a KTX2 file: {}", path.generic_string());
+		return false;
+	}
+	if (header.supercompressionScheme != 0 || header.pixelDepth > 1 || header.layerCount > 1 || (header.faceCount != 1 && header.faceCount != 6))
+	{
+		LN_LOG(Error, Ktx2::Read, "Supercompressed, 3D and array textures not supported: {}", path.generic_string());
+		return false;
+	}
+
+	const vk::Format format = static_cast<vk::Format>(header.vkFormat);
+	if (Ktx2Texture::getFaceSize(format, 1, 1) == 0)
+	{
+		LN_LOG(Error, Ktx2::Read, "Unsupported format {} in {}", vk::to_string(format), path.generic_string());
+		return false;
+	}
+
+	if (header.pixelWidth == 0)
+	{
+		LN_LOG(Error, Ktx2::Read, "Zero width in {}", path.generic_string());
+		return false;
+	}
+
+	// zero level count leaves mip generation to loader, engine uses stored first level only then
+	// count from file bounded by full mip chain, levels past it never read
+	const uint32 maxLevelCount = std::bit_width(std::max(header.pixelWidth, std::max(header.pixelHeight, 1u)));
+	if (header.levelCount > maxLevelCount)
+	{
+		LN_LOG(Warning, Ktx2::Read, "{} claims {} levels, only {} read", path.generic_string(), header.levelCount, maxLevelCount);
+	}
+	const uint32 levelCount = std::clamp(header.levelCount, 1u, maxLevelCount);
+	std::vector<Ktx2LevelIndex> levelIndex(levelCount);
+	file.read(reinterpret_cast<char*>(levelIndex.data()), levelCount * sizeof(Ktx2LevelIndex));
+	if (!file || file.gcount() != static_cast<std::streamsize>(levelCount * sizeof(Ktx2LevelIndex)))
+	{
+		LN_LOG(Error, Ktx2::Read, "Truncated level index in {}", path.generic_string());
+		return false;
+	}
+
+	// sizes checked against file before anything allocated for levels
+	std::error_code error{};
+	const uint64 fileSize = std::filesystem::file_size(path, error);
+
+	outTexture.format = format;
+	outTexture.width = header.pixelWidth;
+	outTexture.height = std::max(header.pixelHeight, 1u);
+	outTexture.faceCount = header.faceCount;
+	outTexture.levels.resize(levelCount);
+	for (uint32 level = 0; level < levelCount; ++level)
+	{
+		const uint64 expectedSize = Ktx2Texture::getFaceSize(format, std::max(outTexture.width >> level, 1u), std::max(outTexture.height >> level, 1u)) * outTexture.faceCount;
+		if (levelIndex[level].byteLength != expectedSize || levelIndex[level].byteOffset > fileSize || expectedSize > fileSize - levelIndex[level].byteOffset)
+		{
+			LN_LOG(Error, Ktx2::Read, "Level {} of {} has unexpected size or lies past end of file", level, path.generic_string());
+			return false;
+		}
+
+		std::vector<uint8>& data = outTexture.levels[level];
+		data.resize(expectedSize);
+		file.seekg(levelIndex[level].byteOffset);
+		file.read(reinterpret_cast<char*>(data.data()), data.size());
+		if (!file || file.gcount() != static_cast<std::streamsize>(data.size()))
+		{
+			LN_LOG(Error, Ktx2::Read, "Truncated level {} in {}", level, path.generic_string());
+			return false;
+		}
+	}
+	return true;
+}
+
+bool lune::ktx2::write(const std::filesystem::path& path, const Ktx2Texture& texture)
+{
+	const std::vector<uint32> dataFormatDescriptor = makeDataFormatDescriptor(texture.format);
+	if (dataFormatDescriptor.empty() || texture.levels.empty())
+		return false;
+
+	const uint32 blockSize = Ktx2Texture::getBlockSize(texture.format);
+	const uint64 levelAlignment = blockSize ? blockSize : 4;
+
+	Ktx2Header header{};
+	header.identifier = Ktx2Identifier;
+	header.vkFormat = static_cast<uint32>(texture.format);
+	header.typeSize = 1;
+	header.pixelWidth = texture.width;
+	header.pixelHeight = texture.height;
+	header.faceCount = texture.faceCount;
+	header.levelCount = texture.levels.size();
+	header.dfdByteOffset = sizeof(Ktx2Header) + texture.levels.size() * sizeof(Ktx2LevelIndex);
+	header.dfdByteLength = dataFormatDescriptor.size() * sizeof(uint32);
+
+	// smallest level stored first, each aligned to texel block
+	std::vector<Ktx2LevelIndex> levelIndex(texture.levels.size());
+	uint64 offset = header.dfdByteOffset + header.dfdByteLength;
+	for (size_t level = texture.levels.size(); level-- > 0;)
+	{
+		offset = (offset + levelAlignment - 1) / levelAlignment * levelAlignment;
+		levelIndex[level] = Ktx2LevelIndex{offset, texture.levels[level].size(), texture.levels[level].size()};
+		offset += texture.levels[level].size();
+	}
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+		return false;
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(levelIndex.data()), levelIndex.size() * sizeof(Ktx2LevelIndex));
+	file.write(reinterpret_cast<const char*>(dataFormatDescriptor.data()), header.dfdByteLength);
+	for (size_t level = texture.levels.size(); level-- > 0;)
+	{
+		const std::vector<char> padding(levelIndex[level].byteOffset - static_cast<uint64>(file.tellp()));
+		file.write(padding.data(), padding.size());
+		file.write(reinterpret_cast<const char*>(texture.levels[level].data()), texture.levels[level].size());
+	}
+	return static_cast<bool>(file);
+}
@@ -0,0 +1,225 @@
+#include "lune/core/lmesh.hxx"
+
+#include "lune/core/log.hxx"
+
+#include <cstring>
+#include <fstream>
+
+constexpr uint32 LmeshMagic = 0x48534D4C; // "LMSH"
+constexpr uint32 LmeshVersion = 2;
+
+// every section starts aligned to that, enough for any table record and vertex attribute
+constexpr uint64 LmeshAlignment = 16;
+
+struct LmeshSectionRange
+{
+	uint64 offset{};
+	uint64 size{};
+};
+
+struct LmeshHeader
+{
+	enum Section : uint32
+	{
+		Verticies,
+		Indices,
+		Primitives,
+		Meshes,
+		Nodes,
+		Children,
+		Roots,
+		Materials,
+		Textures,
+		Samplers,
+		Images,
+		Strings,
+		ImageData,
+		SectionCount
+	};
+
+	uint32 magic{};
+	uint32 version{};
+
+	// records of other layout can't be mapped, file needs cooking again
+	uint32 vertexSize{};
+	uint32 primitiveSize{};
+	uint32 nodeSize{};
+	uint32 materialSize{};
+	uint64 padding{};
+
+	LmeshSectionRange sections[LmeshHeader::SectionCount]{};
+};
+static_assert(sizeof(LmeshHeader) % LmeshAlignment == 0);
+
+template <typename T>
+std::span<const uint8> asBytes(std::span<const T> span)
+{
+	return std::span<const uint8>(reinterpret_cast<const uint8*>(span.data()), span.size_bytes());
+}
+
+template <typename T>
+bool mapSection(const lune::MappedFile& file, const LmeshHeader& header, LmeshHeader::Section section, std::span<const T>& outSpan)
+{
+	const LmeshSectionRange& range = header.sections[section];
+	if (range.offset % LmeshAlignment != 0 || range.size % sizeof(T) != 0 || range.offset > file.getSize() || range.size > file.getSize() - range.offset)
+		return false;
+
+	outSpan = std::span<const T>(reinterpret_cast<const T*>(file.getData() + range.offset), range.size / sizeof(T));
+	return true;
+}
+
+bool lune::lmesh::ModelView::isValid() const
+{
+	for (const Primitive& primitive : primitives)
+	{
+		if (primitive.vertexOffset % sizeof(Vertex343224) != 0 || primitive.vertexOffset + static_cast<uint64>(primitive.vertexCount) * sizeof(Vertex343224) > verticies.size())
+			return false;
+		if (primitive.indexCount && (primitive.indexSizeof != sizeof(uint16) && primitive.indexSizeof != sizeof(uint32)))
+			return false;
+		if (primitive.indexCount && (primitive.indexOffset % primitive.indexSizeof != 0 || primitive.indexOffset + static_cast<uint64>(primitive.indexCount) * primitive.indexSizeof > indices.size()))
+			return false;
+		if (primitive.material >= static_cast<int64>(materials.size()))
+			return false;
+	}
+	for (const Mesh& mesh : meshes)
+	{
+		if (static_cast<uint64>(mesh.firstPrimitive) + mesh.primitiveCount > primitives.size())
+			return false;
+	}
+	for (const Node& node : nodes)
+	{
+		if (node.mesh >= static_cast<int64>(meshes.size()) || static_cast<uint64>(node.firstChild) + node.childCount > children.size())
+			return false;
+	}
+	for (const uint32 node : children)
+	{
+		if (node >= nodes.size())
+			return false;
+	}
+	for (const uint32 node : roots)
+	{
+		if (node >= nodes.size())
+			return false;
+	}
+	for (const Material& material : materials)
+	{
+		for (const int32 texture : material.textures)
+		{
+			if (texture >= static_cast<int64>(textures.size()))
+				return false;
+		}
+	}
+	for (const Texture& texture : textures)
+	{
+		if (texture.image >= static_cast<int64>(images.size()) || texture.sampler >= static_cast<int64>(samplers.size()))
+			return false;
+	}
+	for (const Image& image : images)
+	{
+		if (static_cast<uint64>(image.uriOffset) + image.uriSize > strings.size() || static_cast<uint64>(image.dataOffset) + image.dataSize > imageData.size())
+			return false;
+	}
+	return true;
+}
+
+lune::lmesh::ModelView lune::lmesh::Model::getView() const
+{
+	return ModelView{verticies, indices, primitives, meshes, nodes, children, roots, materials, textures, samplers, images, strings, imageData};
+}
+
+bool lune::lmesh::read(const std::filesystem::path& path, MappedFile& outFile, ModelView& outModel)
+{
+	if (!outFile.open(path))
+		return false;
+
+	LmeshHeader header{};
+	if (outFile.getSize() < sizeof(LmeshHeader))
+	{
+		LN_LOG(Error, LMesh::Read, "File {} too small", path.generic_string());
+		outFile.close();
+		return false;
+	}
+	std::memcpy(&header, outFile.getData(), sizeof(LmeshHeader));
+
+	if (header.magic != LmeshMagic || header.version != LmeshVersion || header.vertexSize != sizeof(Vertex343224) ||
+		header.primitiveSize != sizeof(Primitive) || header.nodeSize != sizeof(Node) || header.materialSize != sizeof(Material))
+	{
+		LN_LOG(Warning, LMesh::Read, "File {} written by different version, needs cooking again", path.generic_string());
+		outFile.close();
+		return false;
+	}
+
+	std::span<const char> strings{};
+	ModelView model{};
+	const bool mapped =
+		mapSection(outFile, header, LmeshHeader::Verticies, model.verticies) &&
+		mapSection(outFile, header, LmeshHeader::Indices, model.indices) &&
+		mapSection(outFile, header, LmeshHeader::Primitives, model.primitives) &&
+		mapSection(outFile, header, LmeshHeader::Meshes, model.meshes) &&
+		mapSection(outFile, header, LmeshHeader::Nodes, model.nodes) &&
+		mapSection(outFile, header, LmeshHeader::Children, model.children) &&
+		mapSection(outFile, header, LmeshHeader::Roots, model.roots) &&
+		mapSection(outFile, header, LmeshHeader::Materials, model.materials) &&
+		mapSection(outFile, header, LmeshHeader::Textures, model.textures) &&
+		mapSection(outFile, header, LmeshHeader::Samplers, model.samplers) &&
+		mapSection(outFile, header, LmeshHeader::Images, model.images) &&
+		mapSection(outFile, header, LmeshHeader::Strings, strings) &&
+		mapSection(outFile, header, LmeshHeader::ImageData, model.imageData);
+	model.strings = std::string_view(strings.data(), strings.size());
+
+	if (!mapped || !model.isValid())
+	{
+		LN_LOG(Error, LMesh::Read, "File {} malformed", path.generic_string());
+		outFile.close();
+		return false;
+	}
+
+	outModel = model;
+	return true;
+}
+
+bool lune::lmesh::write(const std::filesystem::path& path, const ModelView& model)
+{
+	const std::span<const uint8> sections[LmeshHeader::SectionCount] = {
+		model.verticies,
+		model.indices,
+		asBytes(model.primitives),
+		asBytes(model.meshes),
+		asBytes(model.nodes),
+		asBytes(model.children),
+		asBytes(model.roots),
+		asBytes(model.materials),
+		asBytes(model.textures),
+		asBytes(model.samplers),
+		asBytes(model.images),
+		asBytes(std::span<const char>(model.strings)),
+		model.imageData};
+
+	LmeshHeader header{};
+	header.magic = LmeshMagic;
+	header.version = LmeshVersion;
+	header.vertexSize = sizeof(Vertex343224);
+	header.primitiveSize = sizeof(Primitive);
+	header.nodeSize = sizeof(Node);
+	header.materialSize = sizeof(Material);
+
+	uint64 offset = sizeof(LmeshHeader);
+	for (uint32 i = 0; i < LmeshHeader::SectionCount; ++i)
+	{
+		header.sections[i] = LmeshSectionRange{offset, sections[i].size()};
+		offset = (offset + sections[i].size() + LmeshAlignment - 1) / LmeshAlignment * LmeshAlignment;
+	}
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file)
+		return false;
+
+	constexpr char zeros[LmeshAlignment]{};
+	file.write(reinterpret_cast<const char*>(&header), sizeof(LmeshHeader));
+	for (uint32 i = 0; i < LmeshHeader::SectionCount; ++i)
+	{
+		file.write(reinterpret_cast<const char*>(sections[i].data()), sections[i].size());
+		file.write(zeros, (LmeshAlignment - sections[i].size() % LmeshAlignment) % LmeshAlignment);
+	}
+	return static_cast<bool>(file);
+}
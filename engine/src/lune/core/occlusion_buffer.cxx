@@ -0,0 +1,385 @@
+#include "lune/core/occlusion_buffer.hxx"
+
+#include "lune/core/job_subsystem.hxx"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define LUNE_OCCLUSION_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LUNE_OCCLUSION_SSE
+#endif
+
+// all pixels of tile covered
+constexpr uint32 FullCoverage = 0xFFFFFFFFu;
+
+// clip w below that treated as crossing near plane
+constexpr float OcclusionMinW = 1e-5f;
+
+// triangles per job of vertex transform and setup
+constexpr uint32 OcclusionSetupBatch = 1024;
+
+// boxes and triangles projected to screen, pixel position with depth
+static lnm::vec3 projectToScreen(const lnm::vec4& clip, float width, float height)
+{
+	const float invW = 1.f / clip.w;
+	return lnm::vec3((clip.x * invW * 0.5f + 0.5f) * width, (clip.y * invW * 0.5f + 0.5f) * height, clip.z * invW);
+}
+
+void lune::OcclusionBuffer::resize(uint32 width, uint32 height)
+{
+	const uint32 tilesX = (std::max(width, 1u) + TileWidth - 1) / TileWidth;
+	const uint32 tilesY = (std::max(height, 1u) + TileHeight - 1) / TileHeight;
+	if (tilesX == mTilesX && tilesY == mTilesY)
+		return;
+
+	mTilesX = tilesX;
+	mTilesY = tilesY;
+	mWidth = mTilesX * TileWidth;
+	mHeight = mTilesY * TileHeight;
+
+	mMasks.assign(mTilesX * mTilesY, 0);
+	mLayerDepths.assign(mTilesX * mTilesY, 1.f);
+	mReferenceDepths.assign(mTilesX * mTilesY, 1.f);
+}
+
+void lune::OcclusionBuffer::begin(const lnm::mat4& viewProj)
+{
+	mViewProj = viewProj;
+
+	std::fill(mMasks.begin(), mMasks.end(), 0);
+	std::fill(mLayerDepths.begin(), mLayerDepths.end(), 1.f);
+	std::fill(mReferenceDepths.begin(), mReferenceDepths.end(), 1.f);
+
+	mOccluders.clear();
+	mTriangles.clear();
+	mRasterizedCount = 0;
+}
+
+void lune::OcclusionBuffer::addOccluder(const lnm::mat4& model, const TriangleMesh& mesh)
+{
+	if (mesh.getTriangleCount() == 0)
+		return;
+
+	mOccluders.push_back(Occluder{mViewProj * model, &mesh, static_cast<uint32>(mTriangles.size())});
+	mTriangles.resize(mTriangles.size() + mesh.getTriangleCount());
+}
+
+void lune::OcclusionBuffer::rasterize(JobSubsystem* jobs)
+{
+	if (mTriangles.empty() || mMasks.empty())
+		return;
+
+	// vertices transformed per triangle, shared ones more than once but every batch stays independent
+	std::atomic<uint32> rasterizedCount{};
+	const auto setup = [this, &rasterizedCount](uint32 begin, uint32 end)
+	{
+		auto occluder = std::upper_bound(mOccluders.begin(), mOccluders.end(), begin, [](uint32 triangle, const Occluder& occluder)
+						{ return triangle < occluder.firstTriangle; }) -
+						1;
+
+		uint32 count{};
+		for (uint32 t = begin; t < end; ++t)
+		{
+			while (occluder + 1 != mOccluders.end() && (occluder + 1)->firstTriangle <= t)
+				++occluder;
+
+			const TriangleMesh& mesh = *occluder->mesh;
+			const uint32* index = mesh.indices.data() + (t - occluder->firstTriangle) * 3;
+			ScreenTriangle& triangle = mTriangles[t];
+			if (setupTriangle(occluder->modelViewProj, mesh.positions[index[0]], mesh.positions[index[1]], mesh.positions[index[2]], triangle))
+				++count;
+			else
+				triangle = ScreenTriangle{};
+		}
+		rasterizedCount.fetch_add(count, std::memory_order_relaxed);
+	};
+
+	// bands of tile rows never share tile, every band walks all triangles
+	const uint32 threadCount = jobs ? jobs->getWorkerCount() + 1 : 1;
+	const uint32 bandRows = (mTilesY + threadCount - 1) / threadCount;
+	const auto raster = [this](uint32 begin, uint32 end)
+	{ rasterizeTileRows(begin, end); };
+
+	if (jobs)
+	{
+		jobs->parallelFor(mTriangles.size(), OcclusionSetupBatch, setup);
+		jobs->parallelFor(mTilesY, bandRows, raster);
+	}
+	else
+	{
+		setup(0, mTriangles.size());
+		raster(0, mTilesY);
+	}
+
+	mRasterizedCount = rasterizedCount.load(std::memory_order_relaxed);
+}
+
+bool lune::OcclusionBuffer::isOccluded(const BoundingBox& box) const
+{
+	if (mMasks.empty())
+		return false;
+
+	lnm::vec2 screenMin(std::numeric_limits<float>::max());
+	lnm::vec2 screenMax(std::numeric_limits<float>::lowest());
+	float minDepth = std::numeric_limits<float>::max();
+	for (uint32 corner = 0; corner < 8; ++corner)
+	{
+		const lnm::vec3 position((corner & 1) ? box.max.x : box.min.x, (corner & 2) ? box.max.y : box.min.y, (corner & 4) ? box.max.z : box.min.z);
+		const lnm::vec4 clip = mViewProj * lnm::vec4(position, 1.f);
+		if (clip.w < OcclusionMinW || clip.z < -clip.w)
+			return false;
+
+		const lnm::vec3 screen = projectToScreen(clip, mWidth, mHeight);
+		screenMin = lnm::min(screenMin, lnm::vec2(screen));
+		screenMax = lnm::max(screenMax, lnm::vec2(screen));
+		minDepth = std::min(minDepth, screen.z);
+	}
+
+	// every pixel box touches, not only ones whose centers it covers
+	int32 minX{}, minY{}, endX{}, endY{};
+	if (!clampToScreen(screenMin, screenMax, minX, minY, endX, endY))
+		return false;
+
+	for (int32 tileY = minY / TileHeight; tileY * static_cast<int32>(TileHeight) < endY; ++tileY)
+	{
+		const int32 pixelY = tileY * TileHeight;
+		const uint32 firstRow = std::max(minY - pixelY, 0);
+		const uint32 endRow = std::min(endY - pixelY, static_cast<int32>(TileHeight));
+
+		for (int32 tileX = minX / TileWidth; tileX * static_cast<int32>(TileWidth) < endX; ++tileX)
+		{
+			const int32 pixelX = tileX * TileWidth;
+			const uint32 firstColumn = std::max(minX - pixelX, 0);
+			const uint32 endColumn = std::min(endX - pixelX, static_cast<int32>(TileWidth));
+
+			const uint32 rowBits = ((1u << endColumn) - 1) & ~((1u << firstColumn) - 1);
+			uint32 rectMask{};
+			for (uint32 row = firstRow; row < endRow; ++row)
+				rectMask |= rowBits << (row * TileWidth);
+
+			// pixels of working layer nearer than reference, box has to be behind whichever bound applies to all it touches
+			const uint32 tile = tileY * mTilesX + tileX;
+			const float tileDepth = (rectMask & ~mMasks[tile]) ? mReferenceDepths[tile] : std::min(mLayerDepths[tile], mReferenceDepths[tile]);
+			if (minDepth <= tileDepth)
+				return false;
+		}
+	}
+	return true;
+}
+
+void lune::OcclusionBuffer::resolveDepth(std::vector<float>& outDepth) const
+{
+	outDepth.resize(mWidth * mHeight);
+	for (uint32 y = 0; y < mHeight; ++y)
+	{
+		for (uint32 x = 0; x < mWidth; ++x)
+		{
+			const uint32 tile = (y / TileHeight) * mTilesX + x / TileWidth;
+			const uint32 bit = (y % TileHeight) * TileWidth + x % TileWidth;
+			const bool inLayer = (mMasks[tile] >> bit) & 1;
+			outDepth[y * mWidth + x] = inLayer ? std::min(mLayerDepths[tile], mReferenceDepths[tile]) : mReferenceDepths[tile];
+		}
+	}
+}
+
+bool lune::OcclusionBuffer::setupTriangle(const lnm::mat4& modelViewProj, const lnm::vec3& p0, const lnm::vec3& p1, const lnm::vec3& p2, ScreenTriangle& outTriangle) const
+{
+	// triangles crossing near plane dropped instead of clipped, only less gets occluded
+	std::array<lnm::vec3, 3> screen{};
+	const std::array<const lnm::vec3*, 3> positions{&p0, &p1, &p2};
+	for (uint32 i = 0; i < 3; ++i)
+	{
+		const lnm::vec4 clip = modelViewProj * lnm::vec4(*positions[i], 1.f);
+		if (clip.w < OcclusionMinW || clip.z < -clip.w)
+			return false;
+		screen[i] = projectToScreen(clip, mWidth, mHeight);
+	}
+
+	// both windings rasterized, occluders seen from inside still occlude
+	float area = (screen[1].x - screen[0].x) * (screen[2].y - screen[0].y) - (screen[2].x - screen[0].x) * (screen[1].y - screen[0].y);
+	if (std::abs(area) < 1e-6f)
+		return false;
+	if (area < 0.f)
+	{
+		std::swap(screen[1], screen[2]);
+		area = -area;
+	}
+
+	const lnm::vec2 screenMin = lnm::min(lnm::min(lnm::vec2(screen[0]), lnm::vec2(screen[1])), lnm::vec2(screen[2]));
+	const lnm::vec2 screenMax = lnm::max(lnm::max(lnm::vec2(screen[0]), lnm::vec2(screen[1])), lnm::vec2(screen[2]));
+	int32 minX{}, minY{}, endX{}, endY{};
+	if (!clampToScreen(screenMin, screenMax, minX, minY, endX, endY))
+		return false;
+
+	outTriangle.minTileX = minX / TileWidth;
+	outTriangle.minTileY = minY / TileHeight;
+	outTriangle.endTileX = (endX + TileWidth - 1) / TileWidth;
+	outTriangle.endTileY = (endY + TileHeight - 1) / TileHeight;
+
+	for (uint32 i = 0; i < 3; ++i)
+	{
+		const lnm::vec3& from = screen[i];
+		const lnm::vec3& to = screen[(i + 1) % 3];
+		outTriangle.edgeA[i] = from.y - to.y;
+		outTriangle.edgeB[i] = to.x - from.x;
+		outTriangle.edgeC[i] = from.x * to.y - from.y * to.x;
+	}
+
+	// z / w interpolates linearly in screen space
+	const lnm::vec3 d1 = screen[1] - screen[0];
+	const lnm::vec3 d2 = screen[2] - screen[0];
+	outTriangle.depthA = (d1.z * d2.y - d2.z * d1.y) / area;
+	outTriangle.depthB = (d2.z * d1.x - d1.z * d2.x) / area;
+	outTriangle.depthC = screen[0].z - outTriangle.depthA * screen[0].x - outTriangle.depthB * screen[0].y;
+	outTriangle.maxDepth = std::min(std::max({screen[0].z, screen[1].z, screen[2].z}), 1.f);
+	return true;
+}
+
+bool lune::OcclusionBuffer::clampToScreen(const lnm::vec2& screenMin, const lnm::vec2& screenMax, int32& outMinX, int32& outMinY, int32& outEndX, int32& outEndY) const
+{
+	// clamped before conversion, far off screen points don't fit in int
+	const lnm::vec2 size(mWidth, mHeight);
+	const lnm::vec2 rectMin = lnm::floor(lnm::clamp(screenMin, lnm::vec2(0.f), size));
+	const lnm::vec2 rectMax = lnm::ceil(lnm::clamp(screenMax, lnm::vec2(0.f), size));
+	outMinX = static_cast<int32>(rectMin.x);
+	outMinY = static_cast<int32>(rectMin.y);
+	outEndX = static_cast<int32>(rectMax.x);
+	outEndY = static_cast<int32>(rectMax.y);
+	return outMinX < outEndX && outMinY < outEndY;
+}
+
+void lune::OcclusionBuffer::rasterizeTileRows(uint32 firstTileRow, uint32 endTileRow)
+{
+	for (const ScreenTriangle& triangle : mTriangles)
+	{
+		const uint32 minTileY = std::max(triangle.minTileY, firstTileRow);
+		const uint32 endTileY = std::min(triangle.endTileY, endTileRow);
+		for (uint32 tileY = minTileY; tileY < endTileY; ++tileY)
+		{
+			const float pixelY = static_cast<float>(tileY * TileHeight);
+			for (uint32 tileX = triangle.minTileX; tileX < triangle.endTileX; ++tileX)
+			{
+				const float pixelX = static_cast<float>(tileX * TileWidth);
+				const uint32 coverage = computeCoverage(triangle, pixelX, pixelY);
+				if (coverage == 0)
+					continue;
+
+				// plane farthest at one of tile corners, never farther than farthest vertex
+				const float cornerDepth = triangle.depthA * pixelX + triangle.depthB * pixelY + triangle.depthC +
+										  std::max(triangle.depthA * TileWidth, 0.f) + std::max(triangle.depthB * TileHeight, 0.f);
+				updateTile(tileY * mTilesX + tileX, coverage, std::min(cornerDepth, triangle.maxDepth));
+			}
+		}
+	}
+}
+
+uint32 lune::OcclusionBuffer::computeCoverage(const ScreenTriangle& triangle, float tileX, float tileY) const
+{
+	// sampled at pixel centers
+	uint32 coverage{};
+
+#if defined(LUNE_OCCLUSION_AVX)
+	const __m256 x = _mm256_add_ps(_mm256_set1_ps(tileX), _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f));
+	__m256 edgeX[3]{};
+	for (uint32 e = 0; e < 3; ++e)
+		edgeX[e] = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(triangle.edgeA[e]), x), _mm256_set1_ps(triangle.edgeC[e]));
+
+	const __m256 zero = _mm256_setzero_ps();
+	for (uint32 row = 0; row < TileHeight; ++row)
+	{
+		const float y = tileY + row + 0.5f;
+		__m256 inside = _mm256_cmp_ps(zero, zero, _CMP_EQ_OQ);
+		for (uint32 e = 0; e < 3; ++e)
+		{
+#if defined(__FMA__)
+			const __m256 edge = _mm256_fmadd_ps(_mm256_set1_ps(triangle.edgeB[e]), _mm256_set1_ps(y), edgeX[e]);
+#else
+			const __m256 edge = _mm256_add_ps(_mm256_set1_ps(triangle.edgeB[e] * y), edgeX[e]);
+#endif
+			inside = _mm256_and_ps(inside, _mm256_cmp_ps(edge, zero, _CMP_GE_OQ));
+		}
+		coverage |= static_cast<uint32>(_mm256_movemask_ps(inside)) << (row * TileWidth);
+	}
+#elif defined(LUNE_OCCLUSION_SSE)
+	const __m128 xLow = _mm_add_ps(_mm_set1_ps(tileX), _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f));
+	const __m128 xHigh = _mm_add_ps(xLow, _mm_set1_ps(4.f));
+	__m128 edgeLow[3]{};
+	__m128 edgeHigh[3]{};
+	for (uint32 e = 0; e < 3; ++e)
+	{
+		const __m128 a = _mm_set1_ps(triangle.edgeA[e]);
+		const __m128 c = _mm_set1_ps(triangle.edgeC[e]);
+		edgeLow[e] = _mm_add_ps(_mm_mul_ps(a, xLow), c);
+		edgeHigh[e] = _mm_add_ps(_mm_mul_ps(a, xHigh), c);
+	}
+
+	const __m128 zero = _mm_setzero_ps();
+	for (uint32 row = 0; row < TileHeight; ++row)
+	{
+		const float y = tileY + row + 0.5f;
+		__m128 insideLow = _mm_cmpeq_ps(zero, zero);
+		__m128 insideHigh = insideLow;
+		for (uint32 e = 0; e < 3; ++e)
+		{
+			const __m128 by = _mm_set1_ps(triangle.edgeB[e] * y);
+			insideLow = _mm_and_ps(insideLow, _mm_cmpge_ps(_mm_add_ps(edgeLow[e], by), zero));
+			insideHigh = _mm_and_ps(insideHigh, _mm_cmpge_ps(_mm_add_ps(edgeHigh[e], by), zero));
+		}
+		const uint32 rowBits = _mm_movemask_ps(insideLow) | (_mm_movemask_ps(insideHigh) << 4);
+		coverage |= rowBits << (row * TileWidth);
+	}
+#else
+	for (uint32 row = 0; row < TileHeight; ++row)
+	{
+		const float y = tileY + row + 0.5f;
+		for (uint32 column = 0; column < TileWidth; ++column)
+		{
+			const float x = tileX + column + 0.5f;
+			bool inside = true;
+			for (uint32 e = 0; e < 3; ++e)
+				inside &= triangle.edgeA[e] * x + triangle.edgeB[e] * y + triangle.edgeC[e] >= 0.f;
+			coverage |= static_cast<uint32>(inside) << (row * TileWidth + column);
+		}
+	}
+#endif
+
+	return coverage;
+}
+
+void lune::OcclusionBuffer::updateTile(uint32 tile, uint32 coverage, float maxDepth)
+{
+	uint32& mask = mMasks[tile];
+	float& layerDepth = mLayerDepths[tile];
+	float& referenceDepth = mReferenceDepths[tile];
+
+	// nothing nearer than what whole tile already has
+	if (maxDepth >= referenceDepth)
+		return;
+
+	if (coverage == FullCoverage)
+	{
+		referenceDepth = maxDepth;
+		if (mask && layerDepth >= referenceDepth)
+			mask = 0;
+		return;
+	}
+
+	// merged into working layer, its depth only grows farther, once it covers tile it becomes reference
+	layerDepth = mask ? std::max(layerDepth, maxDepth) : maxDepth;
+	mask |= coverage;
+	if (mask == FullCoverage)
+	{
+		referenceDepth = std::min(referenceDepth, layerDepth);
+		mask = 0;
+	}
+	else if (layerDepth >= referenceDepth)
+	{
+		mask = 0;
+	}
+}
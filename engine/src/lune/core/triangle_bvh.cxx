@@ -0,0 +1,422 @@
+#include "lune/core/triangle_bvh.hxx"
+
+#include "lune/core/job_subsystem.hxx"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LUNE_BVH_SSE
+#endif
+
+// split candidates per axis
+constexpr uint32 BvhBinCount = 16;
+
+// past that depth nodes split at median, keeps depth bounded for meshes heuristic can't split evenly
+constexpr uint32 BvhMedianSplitDepth = 40;
+
+// enough for median split depth and halving of any triangle count after it
+constexpr uint32 BvhStackSize = 128;
+
+// rays per job of batch
+constexpr uint32 BvhRaysPerJob = 64;
+
+namespace lune
+{
+	// full surface area, split costs only compared with each other
+	static float surfaceArea(const BoundingBox& box)
+	{
+		const lnm::vec3 size = box.max - box.min;
+		return 2.f * (size.x * size.y + size.y * size.z + size.z * size.x);
+	}
+
+	static BoundingBox growBox(const BoundingBox& box, const BoundingBox& other)
+	{
+		return BoundingBox{lnm::min(box.min, other.min), lnm::max(box.max, other.max)};
+	}
+
+	// ray prepared once for all node and triangle tests of traversal
+	struct BvhRay
+	{
+		lnm::vec3 origin{};
+		lnm::vec3 direction{};
+		lnm::vec3 invDirection{};
+#if defined(LUNE_BVH_SSE)
+		// components broadcast to all lanes for triangle tests
+		std::array<__m128, 3> originLanes{};
+		std::array<__m128, 3> directionLanes{};
+
+		// xyz with zero in fourth lane for box tests
+		__m128 originXyz{};
+		__m128 invDirectionXyz{};
+#endif
+	};
+
+	static BvhRay makeBvhRay(const Ray& ray)
+	{
+		BvhRay bvhRay{};
+		bvhRay.origin = ray.origin;
+		bvhRay.direction = ray.direction;
+		bvhRay.invDirection = 1.f / ray.direction;
+#if defined(LUNE_BVH_SSE)
+		for (uint32 axis = 0; axis < 3; ++axis)
+		{
+			bvhRay.originLanes[axis] = _mm_set1_ps(ray.origin[axis]);
+			bvhRay.directionLanes[axis] = _mm_set1_ps(ray.direction[axis]);
+		}
+		bvhRay.originXyz = _mm_setr_ps(bvhRay.origin.x, bvhRay.origin.y, bvhRay.origin.z, 0.f);
+		bvhRay.invDirectionXyz = _mm_setr_ps(bvhRay.invDirection.x, bvhRay.invDirection.y, bvhRay.invDirection.z, 0.f);
+#endif
+		return bvhRay;
+	}
+
+	// node bounds as min and max followed by one more value each, as in bvh node layout
+	static bool intersectBvhBox(const float* boxMin, const float* boxMax, const BvhRay& ray, float maxDistance, float& outEntry)
+	{
+#if defined(LUNE_BVH_SSE)
+		// fourth lane holds node index and count, cleared so it acts as ray start and replaced by max distance on exit side
+		const __m128 xyzMask = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+		const __m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_and_ps(_mm_loadu_ps(boxMin), xyzMask), ray.originXyz), ray.invDirectionXyz);
+		const __m128 t2 = _mm_mul_ps(_mm_sub_ps(_mm_and_ps(_mm_loadu_ps(boxMax), xyzMask), ray.originXyz), ray.invDirectionXyz);
+		__m128 entry = _mm_and_ps(_mm_min_ps(t1, t2), xyzMask);
+		__m128 exit = _mm_or_ps(_mm_and_ps(_mm_max_ps(t1, t2), xyzMask), _mm_andnot_ps(xyzMask, _mm_set1_ps(maxDistance)));
+
+		entry = _mm_max_ps(entry, _mm_shuffle_ps(entry, entry, _MM_SHUFFLE(2, 3, 0, 1)));
+		entry = _mm_max_ps(entry, _mm_shuffle_ps(entry, entry, _MM_SHUFFLE(1, 0, 3, 2)));
+		exit = _mm_min_ps(exit, _mm_shuffle_ps(exit, exit, _MM_SHUFFLE(2, 3, 0, 1)));
+		exit = _mm_min_ps(exit, _mm_shuffle_ps(exit, exit, _MM_SHUFFLE(1, 0, 3, 2)));
+
+		outEntry = _mm_cvtss_f32(entry);
+		return outEntry <= _mm_cvtss_f32(exit);
+#else
+		const lnm::vec3 t1 = (lnm::vec3(boxMin[0], boxMin[1], boxMin[2]) - ray.origin) * ray.invDirection;
+		const lnm::vec3 t2 = (lnm::vec3(boxMax[0], boxMax[1], boxMax[2]) - ray.origin) * ray.invDirection;
+		const lnm::vec3 tNear = lnm::min(t1, t2);
+		const lnm::vec3 tFar = lnm::max(t1, t2);
+		outEntry = std::max({tNear.x, tNear.y, tNear.z, 0.f});
+		return outEntry <= std::min({tFar.x, tFar.y, tFar.z, maxDistance});
+#endif
+	}
+} // namespace lune
+
+void lune::TriangleBvh::build(const TriangleMesh& mesh)
+{
+	mNodes.clear();
+	mPackets.clear();
+	mTriangleCount = mesh.getTriangleCount();
+	mDepth = 0;
+	if (mTriangleCount == 0)
+		return;
+
+	std::vector<BuildTriangle> triangles(mTriangleCount);
+	for (uint32 t = 0; t < mTriangleCount; ++t)
+	{
+		const lnm::vec3& p0 = mesh.positions[mesh.indices[t * 3]];
+		const lnm::vec3& p1 = mesh.positions[mesh.indices[t * 3 + 1]];
+		const lnm::vec3& p2 = mesh.positions[mesh.indices[t * 3 + 2]];
+
+		BuildTriangle& triangle = triangles[t];
+		triangle.box = BoundingBox{lnm::min(p0, lnm::min(p1, p2)), lnm::max(p0, lnm::max(p1, p2))};
+		triangle.centroid = triangle.box.getCenter();
+		triangle.index = t;
+	}
+
+	// binary tree with at least one triangle per leaf
+	mNodes.reserve(2 * mTriangleCount);
+	mPackets.reserve((mTriangleCount + LeafSize - 1) / LeafSize * 2);
+	mNodes.emplace_back();
+	buildNode(0, mesh, triangles, 1);
+}
+
+bool lune::TriangleBvh::raycast(const Ray& ray, TriangleRayHit& outHit) const
+{
+	return traverse<false>(ray, outHit);
+}
+
+bool lune::TriangleBvh::intersects(const Ray& ray) const
+{
+	TriangleRayHit hit{};
+	return traverse<true>(ray, hit);
+}
+
+void lune::TriangleBvh::raycastBatch(std::span<const Ray> rays, std::span<TriangleRayHit> outHits, JobSubsystem* jobs) const
+{
+	const auto trace = [this, rays, outHits](uint32 begin, uint32 end)
+	{
+		for (uint32 i = begin; i < end; ++i)
+		{
+			outHits[i] = TriangleRayHit{};
+			traverse<false>(rays[i], outHits[i]);
+		}
+	};
+
+	if (jobs)
+		jobs->parallelFor(rays.size(), BvhRaysPerJob, trace);
+	else
+		trace(0, rays.size());
+}
+
+lune::BoundingBox lune::TriangleBvh::getBoundingBox() const
+{
+	return mNodes.empty() ? BoundingBox{} : BoundingBox{mNodes[0].min, mNodes[0].max};
+}
+
+void lune::TriangleBvh::buildNode(uint32 node, const TriangleMesh& mesh, std::span<BuildTriangle> triangles, uint32 depth)
+{
+	BoundingBox box = triangles[0].box;
+	BoundingBox centroidBox{triangles[0].centroid, triangles[0].centroid};
+	for (const BuildTriangle& triangle : triangles)
+	{
+		box = growBox(box, triangle.box);
+		centroidBox = growBox(centroidBox, BoundingBox{triangle.centroid, triangle.centroid});
+	}
+	mNodes[node].min = box.min;
+	mNodes[node].max = box.max;
+	mDepth = std::max(mDepth, depth);
+
+	if (triangles.size() <= LeafSize)
+	{
+		mNodes[node].first = mPackets.size();
+		mNodes[node].count = triangles.size();
+
+		TrianglePacket& packet = mPackets.emplace_back();
+		std::fill(std::begin(packet.triangles), std::end(packet.triangles), TriangleRayHit::NoTriangle);
+		for (uint32 lane = 0; lane < triangles.size(); ++lane)
+		{
+			const uint32 t = triangles[lane].index;
+			const lnm::vec3& p0 = mesh.positions[mesh.indices[t * 3]];
+			const lnm::vec3 edge1 = mesh.positions[mesh.indices[t * 3 + 1]] - p0;
+			const lnm::vec3 edge2 = mesh.positions[mesh.indices[t * 3 + 2]] - p0;
+			for (uint32 axis = 0; axis < 3; ++axis)
+			{
+				packet.vertex[axis][lane] = p0[axis];
+				packet.edge1[axis][lane] = edge1[axis];
+				packet.edge2[axis][lane] = edge2[axis];
+			}
+			packet.triangles[lane] = t;
+		}
+		return;
+	}
+
+	const lnm::vec3 centroidSize = centroidBox.max - centroidBox.min;
+
+	// cost of split is area of each side times triangles in it, lowest over bin boundaries of all axes taken
+	float bestCost = std::numeric_limits<float>::max();
+	int32 bestAxis = -1;
+	uint32 bestBin{};
+	for (uint32 axis = 0; axis < 3 && depth < BvhMedianSplitDepth; ++axis)
+	{
+		if (centroidSize[axis] <= 0.f)
+			continue;
+
+		std::array<BoundingBox, BvhBinCount> binBoxes{};
+		std::array<uint32, BvhBinCount> binCounts{};
+		const float binScale = BvhBinCount / centroidSize[axis];
+		for (const BuildTriangle& triangle : triangles)
+		{
+			const uint32 bin = std::min(static_cast<uint32>((triangle.centroid[axis] - centroidBox.min[axis]) * binScale), BvhBinCount - 1);
+			binBoxes[bin] = binCounts[bin] ? growBox(binBoxes[bin], triangle.box) : triangle.box;
+			++binCounts[bin];
+		}
+
+		// right side costs swept from last bin, split after bin i leaves bins past it on right
+		std::array<float, BvhBinCount> rightCosts{};
+		std::array<uint32, BvhBinCount> rightCounts{};
+		BoundingBox sideBox{};
+		uint32 sideCount{};
+		for (uint32 bin = BvhBinCount - 1; bin > 0; --bin)
+		{
+			if (binCounts[bin])
+				sideBox = sideCount ? growBox(sideBox, binBoxes[bin]) : binBoxes[bin];
+			sideCount += binCounts[bin];
+			rightCounts[bin - 1] = sideCount;
+			rightCosts[bin - 1] = sideCount ? surfaceArea(sideBox) * sideCount : 0.f;
+		}
+
+		sideCount = 0;
+		for (uint32 bin = 0; bin + 1 < BvhBinCount; ++bin)
+		{
+			if (binCounts[bin])
+				sideBox = sideCount ? growBox(sideBox, binBoxes[bin]) : binBoxes[bin];
+			sideCount += binCounts[bin];
+			if (!sideCount || !rightCounts[bin])
+				continue;
+
+			const float cost = surfaceArea(sideBox) * sideCount + rightCosts[bin];
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestAxis = axis;
+				bestBin = bin;
+			}
+		}
+	}
+
+	size_t split{};
+	if (bestAxis >= 0)
+	{
+		const float binScale = BvhBinCount / centroidSize[bestAxis];
+		const float binMin = centroidBox.min[bestAxis];
+		const auto left = std::partition(triangles.begin(), triangles.end(), [bestAxis, bestBin, binScale, binMin](const BuildTriangle& triangle)
+			{ return std::min(static_cast<uint32>((triangle.centroid[bestAxis] - binMin) * binScale), BvhBinCount - 1) <= bestBin; });
+		split = left - triangles.begin();
+	}
+	else
+	{
+		// all centroids at one point or too deep, halves along longest axis
+		const uint32 axis = centroidSize.x >= centroidSize.y && centroidSize.x >= centroidSize.z ? 0 : (centroidSize.y >= centroidSize.z ? 1 : 2);
+		split = triangles.size() / 2;
+		std::nth_element(triangles.begin(), triangles.begin() + split, triangles.end(), [axis](const BuildTriangle& a, const BuildTriangle& b)
+			{ return a.centroid[axis] < b.centroid[axis]; });
+	}
+
+	const uint32 left = mNodes.size();
+	mNodes[node].first = left;
+	mNodes[node].count = 0;
+	mNodes.emplace_back();
+	mNodes.emplace_back();
+
+	buildNode(left, mesh, triangles.subspan(0, split), depth + 1);
+	buildNode(left + 1, mesh, triangles.subspan(split), depth + 1);
+}
+
+template <bool AnyHit>
+bool lune::TriangleBvh::traverse(const Ray& ray, TriangleRayHit& outHit) const
+{
+	if (mNodes.empty())
+		return false;
+
+	const BvhRay bvhRay = makeBvhRay(ray);
+	float nearest = ray.maxDistance;
+	bool hit{};
+
+	float rootEntry{};
+	if (!intersectBvhBox(&mNodes[0].min.x, &mNodes[0].max.x, bvhRay, nearest, rootEntry))
+		return false;
+
+	// nearer child visited first, farther one waits with its entry distance and skipped if hit found before it
+	std::array<std::pair<uint32, float>, BvhStackSize> stack{};
+	uint32 stackSize{};
+	uint32 index{};
+	while (true)
+	{
+		const Node& node = mNodes[index];
+		if (node.count == 0)
+		{
+			const Node& child1 = mNodes[node.first];
+			const Node& child2 = mNodes[node.first + 1];
+			float entry1{}, entry2{};
+			const bool hit1 = intersectBvhBox(&child1.min.x, &child1.max.x, bvhRay, nearest, entry1);
+			const bool hit2 = intersectBvhBox(&child2.min.x, &child2.max.x, bvhRay, nearest, entry2);
+			if (hit1 && hit2)
+			{
+				const bool firstNearer = entry1 <= entry2;
+				stack[stackSize++] = firstNearer ? std::make_pair(node.first + 1, entry2) : std::make_pair(node.first, entry1);
+				index = firstNearer ? node.first : node.first + 1;
+				continue;
+			}
+			if (hit1 || hit2)
+			{
+				index = hit1 ? node.first : node.first + 1;
+				continue;
+			}
+		}
+		else
+		{
+			const TrianglePacket& packet = mPackets[node.first];
+
+			// Moller-Trumbore for all four triangles, lanes with t in range and barycentrics inside triangle hit
+			std::array<float, LeafSize> distances{};
+			std::array<float, LeafSize> us{};
+			std::array<float, LeafSize> vs{};
+			uint32 hitLanes{};
+#if defined(LUNE_BVH_SSE)
+			const __m128 e1x = _mm_load_ps(packet.edge1[0]);
+			const __m128 e1y = _mm_load_ps(packet.edge1[1]);
+			const __m128 e1z = _mm_load_ps(packet.edge1[2]);
+			const __m128 e2x = _mm_load_ps(packet.edge2[0]);
+			const __m128 e2y = _mm_load_ps(packet.edge2[1]);
+			const __m128 e2z = _mm_load_ps(packet.edge2[2]);
+			const auto& [dx, dy, dz] = bvhRay.directionLanes;
+
+			const __m128 px = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+			const __m128 py = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+			const __m128 pz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+			const __m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+			const __m128 invDet = _mm_div_ps(_mm_set1_ps(1.f), det);
+
+			const __m128 sx = _mm_sub_ps(bvhRay.originLanes[0], _mm_load_ps(packet.vertex[0]));
+			const __m128 sy = _mm_sub_ps(bvhRay.originLanes[1], _mm_load_ps(packet.vertex[1]));
+			const __m128 sz = _mm_sub_ps(bvhRay.originLanes[2], _mm_load_ps(packet.vertex[2]));
+			const __m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, px), _mm_mul_ps(sy, py)), _mm_mul_ps(sz, pz)), invDet);
+
+			const __m128 qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y));
+			const __m128 qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z));
+			const __m128 qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x));
+			const __m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)), _mm_mul_ps(dz, qz)), invDet);
+			const __m128 t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), invDet);
+
+			// degenerate and padding triangles have zero determinant
+			const __m128 zero = _mm_setzero_ps();
+			__m128 mask = _mm_cmpneq_ps(det, zero);
+			mask = _mm_and_ps(mask, _mm_cmpge_ps(u, zero));
+			mask = _mm_and_ps(mask, _mm_cmpge_ps(v, zero));
+			mask = _mm_and_ps(mask, _mm_cmple_ps(_mm_add_ps(u, v), _mm_set1_ps(1.f)));
+			mask = _mm_and_ps(mask, _mm_cmpge_ps(t, zero));
+			mask = _mm_and_ps(mask, _mm_cmple_ps(t, _mm_set1_ps(nearest)));
+			hitLanes = _mm_movemask_ps(mask);
+			if (hitLanes)
+			{
+				_mm_storeu_ps(distances.data(), t);
+				_mm_storeu_ps(us.data(), u);
+				_mm_storeu_ps(vs.data(), v);
+			}
+#else
+			for (uint32 lane = 0; lane < node.count; ++lane)
+			{
+				const lnm::vec3 edge1(packet.edge1[0][lane], packet.edge1[1][lane], packet.edge1[2][lane]);
+				const lnm::vec3 edge2(packet.edge2[0][lane], packet.edge2[1][lane], packet.edge2[2][lane]);
+				const lnm::vec3 p = lnm::cross(bvhRay.direction, edge2);
+				const float det = lnm::dot(edge1, p);
+				if (det == 0.f)
+					continue;
+
+				const float invDet = 1.f / det;
+				const lnm::vec3 s = bvhRay.origin - lnm::vec3(packet.vertex[0][lane], packet.vertex[1][lane], packet.vertex[2][lane]);
+				const lnm::vec3 q = lnm::cross(s, edge1);
+				us[lane] = lnm::dot(s, p) * invDet;
+				vs[lane] = lnm::dot(bvhRay.direction, q) * invDet;
+				distances[lane] = lnm::dot(edge2, q) * invDet;
+				if (us[lane] >= 0.f && vs[lane] >= 0.f && us[lane] + vs[lane] <= 1.f && distances[lane] >= 0.f && distances[lane] <= nearest)
+					hitLanes |= 1u << lane;
+			}
+#endif
+			for (uint32 lane = 0; hitLanes; ++lane, hitLanes >>= 1)
+			{
+				if (!(hitLanes & 1) || distances[lane] > nearest)
+					continue;
+
+				outHit = TriangleRayHit{packet.triangles[lane], distances[lane], us[lane], vs[lane]};
+				nearest = distances[lane];
+				hit = true;
+				if constexpr (AnyHit)
+					return true;
+			}
+		}
+
+		// next subtree from stack not entered past nearest hit
+		bool found{};
+		while (stackSize && !found)
+		{
+			const auto [stackIndex, entry] = stack[--stackSize];
+			found = entry <= nearest;
+			index = stackIndex;
+		}
+		if (!found)
+			break;
+	}
+	return hit;
+}
@@ -63,6 +63,8 @@ void lune::Scene::onEntityComponentAdded(const EntityBase* entity, ComponentBase
 {
 	auto [it, res] = mRegistry.componentEntities.try_emplace(typeid(*comp), std::set<uint64>{});
 	it->second.emplace(entity->getId());
+
+	onComponentAddedDelegate.execute(std::move(entity), std::move(comp));
 }
 
 void lune::Scene::onEntityComponentRemoved(const EntityBase* entity, ComponentBase* comp)
@@ -73,4 +75,6 @@ void lune::Scene::onEntityComponentRemoved(const EntityBase* entity, ComponentBa
 	{
 		mRegistry.componentEntities.at(type).erase(entity->getId());
 	}
+
+	onComponentRemovedDelegate.execute(std::move(entity), std::move(comp));
 }
@@ -10,6 +10,7 @@
 void lune::CameraSystem::update(Scene* scene, double deltaTime)
 {
 	mViewsProjs.clear();
+	mFrustums.clear();
 
 	const auto& eIds = scene->getComponentEntities<PerspectiveCameraComponent>();
 	for (auto eId : eIds)
@@ -51,6 +52,7 @@ void lune::CameraSystem::update(Scene* scene, double deltaTime)
 			//viewProj.view = glm::scale(glm::mat4(1.0f), glm::vec3(1.0f, -1.0f, -1.0f)) * viewProj.view;
 			viewProj.proj = lnm::perspective(lnm::radians(fov), aspectRatio * viewAspectRatio, nearPlane, farPlane);
 			viewProj.viewProj = viewProj.proj * viewProj.view;
+			mFrustums[viewId] = Frustum::fromViewProjection(viewProj.viewProj);
 		}
 	}
 }
@@ -67,41 +69,43 @@ void lune::CameraSystem::prepareRender(Scene* scene)
 		mViewProjStagingBuffer = vulkan::Buffer::create(vk::BufferUsageFlagBits::eTransferSrc, sizeof(ViewProj), VMA_MEMORY_USAGE_AUTO, VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT);
 
 	if (!mViewProjBuffer)
-		mViewProjBuffer = vulkan::Buffer::create(vk::BufferUsageFlagBits::eUniformBuffer | vk::BufferUsageFlagBits::eTransferDst, sizeof(lnm::mat4), VMA_MEMORY_USAGE_AUTO, VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT);
+		mViewProjBuffer = vulkan::Buffer::create(vk::BufferUsageFlagBits::eUniformBuffer | vk::BufferUsageFlagBits::eTransferDst, sizeof(lnm::mat4), VMA_MEMORY_USAGE_AUTO, {});
 	if (!mViewBuffer)
-		mViewBuffer = vulkan::Buffer::create(vk::BufferUsageFlagBits::eUniformBuffer | vk::BufferUsageFlagBits::eTransferDst, sizeof(lnm::mat4), VMA_MEMORY_USAGE_AUTO, VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT);
+		mViewBuffer = vulkan::Buffer::create(vk::BufferUsageFlagBits::eUniformBuffer | vk::BufferUsageFlagBits::eTransferDst, sizeof(lnm::mat4), VMA_MEMORY_USAGE_AUTO, {});
 	if (!mProjBuffer)
-		mProjBuffer = vulkan::Buffer::create(vk::BufferUsageFlagBits::eUniformBuffer | vk::BufferUsageFlagBits::eTransferDst, sizeof(lnm::mat4), VMA_MEMORY_USAGE_AUTO, VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT);
+		mProjBuffer = vulkan::Buffer::create(vk::BufferUsageFlagBits::eUniformBuffer | vk::BufferUsageFlagBits::eTransferDst, sizeof(lnm::mat4), VMA_MEMORY_USAGE_AUTO, {});
 
 	auto findRes = mViewsProjs.find(viewId);
 	if (findRes == mViewsProjs.end())
 		return;
 
-	uint8* pStageBuffer = mViewProjStagingBuffer->map();
-
-	if (const uint32 diff = memcmp(pStageBuffer, &findRes->second.viewProj, sizeof(lnm::mat4)); diff != 0)
+	// compare with cpu copy, reading back from write-combined staging memory is slow
+	const ViewProj& viewProj = findRes->second;
+	if (mStagedViewProj.viewProj != viewProj.viewProj)
 	{
-		memcpy(pStageBuffer, &findRes->second.viewProj, sizeof(lnm::mat4));
+		mStagedViewProj.viewProj = viewProj.viewProj;
+		mViewProjStagingBuffer->write(viewProj.viewProj, offsetof(ViewProj, viewProj));
 		const vk::BufferCopy bufferCopy = vk::BufferCopy()
-											  .setSrcOffset(0)
+											  .setSrcOffset(offsetof(ViewProj, viewProj))
 											  .setSize(sizeof(lnm::mat4));
 		commandBuffer.copyBuffer(mViewProjStagingBuffer->getBuffer(), mViewProjBuffer->getBuffer(), bufferCopy);
 	}
-	if (const uint32 diff = memcmp(pStageBuffer + offsetof(ViewProj, view), &findRes->second.view, sizeof(lnm::mat4)); diff != 0)
+	if (mStagedViewProj.view != viewProj.view)
 	{
-		memcpy(pStageBuffer + offsetof(ViewProj, view), &findRes->second.view, sizeof(lnm::mat4));
+		mStagedViewProj.view = viewProj.view;
+		mViewProjStagingBuffer->write(viewProj.view, offsetof(ViewProj, view));
 		const vk::BufferCopy bufferCopy = vk::BufferCopy()
 											  .setSrcOffset(offsetof(ViewProj, view))
 											  .setSize(sizeof(lnm::mat4));
 		commandBuffer.copyBuffer(mViewProjStagingBuffer->getBuffer(), mViewBuffer->getBuffer(), bufferCopy);
 	}
-	if (const uint32 diff = memcmp(pStageBuffer + offsetof(ViewProj, proj), &findRes->second.proj, sizeof(lnm::mat4)); diff != 0)
+	if (mStagedViewProj.proj != viewProj.proj)
 	{
-		memcpy(pStageBuffer + offsetof(ViewProj, proj), &findRes->second.proj, sizeof(lnm::mat4));
+		mStagedViewProj.proj = viewProj.proj;
+		mViewProjStagingBuffer->write(viewProj.proj, offsetof(ViewProj, proj));
 		const vk::BufferCopy bufferCopy = vk::BufferCopy()
 											  .setSrcOffset(offsetof(ViewProj, proj))
 											  .setSize(sizeof(lnm::mat4));
 		commandBuffer.copyBuffer(mViewProjStagingBuffer->getBuffer(), mProjBuffer->getBuffer(), bufferCopy);
 	}
-	mViewProjStagingBuffer->unmap();
 }
\ No newline at end of file
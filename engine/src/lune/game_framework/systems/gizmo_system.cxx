@@ -5,6 +5,7 @@
 #include "lune/game_framework/systems/camera_system.hxx"
 #include "lune/vulkan/pipeline.hxx"
 #include "lune/vulkan/primitive.hxx"
+#include "lune/vulkan/render_queue.hxx"
 #include "lune/vulkan/vulkan_subsystem.hxx"
 
 #include <vulkan/vulkan_handles.hpp>
@@ -21,7 +22,7 @@ void lune::GizmoSystem::render(Scene* scene)
 		return;
 
 	auto vkSubsystem = Engine::get()->findSubsystem<VulkanSubsystem>();
-	vk::CommandBuffer commandBuffer = vkSubsystem->getFrameInfo().renderCommandBuffer;
+	const FrameInfo frameInfo = vkSubsystem->getFrameInfo();
 
 	auto gizmoX = vkSubsystem->findPrimitive("lune::gizmoX");
 	auto gizmoY = vkSubsystem->findPrimitive("lune::gizmoY");
@@ -32,19 +33,16 @@ void lune::GizmoSystem::render(Scene* scene)
 	{
 		mDescriptorSets = vulkan::DescriptorSets::create(pipeline, 1);
 		mDescriptorSets->setBufferInfo("viewProj", 0, cameraSystem->getViewProjectionBuffer()->getBuffer(), 0, sizeof(lnm::mat4));
-		mDescriptorSets->updateSets(0);
+		mDescriptorSets->updateSet(0, vulkan::DescriptorSetFrequency::PerFrame);
 	}
 
-	pipeline->cmdBind(commandBuffer);
+	vulkan::RenderPacket packet{};
+	packet.pipeline = pipeline.get();
+	packet.descriptorSets[0] = mDescriptorSets->getDescriptorSet(0, vulkan::DescriptorSetFrequency::PerFrame);
 
-	mDescriptorSets->cmdBind(commandBuffer, 0);
-
-	gizmoX->cmdBind(commandBuffer);
-	gizmoX->cmdDraw(commandBuffer);
-
-	gizmoY->cmdBind(commandBuffer);
-	gizmoY->cmdDraw(commandBuffer);
-
-	gizmoZ->cmdBind(commandBuffer);
-	gizmoZ->cmdDraw(commandBuffer);
-}
\ No newline at end of file
+	for (const auto& gizmo : {gizmoX, gizmoY, gizmoZ})
+	{
+		packet.primitive = gizmo.get();
+		frameInfo.renderQueue->submit(vulkan::RenderQueue::makeSortKey(vulkan::RenderLayer::Overlay, pipeline->getId(), 0, gizmo->getId(), 0.f), packet);
+	}
+}
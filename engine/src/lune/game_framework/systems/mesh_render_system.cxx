@@ -2,20 +2,31 @@
 
 #include "lune/core/engine.hxx"
 #include "lune/core/gltf.hxx"
+#include "lune/core/job_subsystem.hxx"
 #include "lune/game_framework/components/mesh.hxx"
+#include "lune/game_framework/components/occluder.hxx"
 #include "lune/game_framework/components/parent_child.hxx"
 #include "lune/game_framework/components/transform.hxx"
 #include "lune/game_framework/entities/entity.hxx"
 #include "lune/game_framework/systems/camera_system.hxx"
+#include "lune/vulkan/bindless_heap.hxx"
 #include "lune/vulkan/buffer.hxx"
 #include "lune/vulkan/descriptor_sets.hxx"
 #include "lune/vulkan/material.hxx"
 #include "lune/vulkan/pipeline.hxx"
 #include "lune/vulkan/primitive.hxx"
+#include "lune/vulkan/render_queue.hxx"
 #include "lune/vulkan/sampler.hxx"
 #include "lune/vulkan/texture_image.hxx"
+#include "lune/vulkan/texture_streamer.hxx"
 #include "lune/vulkan/vulkan_subsystem.hxx"
 
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <map>
+#include <span>
+#include <tuple>
 #include <vulkan/vulkan_enums.hpp>
 #include <vulkan/vulkan_handles.hpp>
 
@@ -28,7 +39,7 @@ namespace lune
 		{
 			auto transformComp = entity->findComponent<TransformComponent>();
 			if (transformComp)
-				model = lnm::translate(model, transformComp->mPosition) * lnm::mat4(transformComp->mOrientation) * lnm::scale(model, transformComp->mScale);
+				model = transformComp->getMatrix();
 			auto parentChildComp = entity->findComponent<ParentChildComponent>();
 			if (parentChildComp && parentChildComp->mParentId)
 				return findTransform(scene, scene->findEntity(parentChildComp->mParentId)) * model;
@@ -37,85 +48,199 @@ namespace lune
 	}
 } // namespace lune
 
+// local size of gltf/cull.comp
+constexpr uint32 CullGroupSize = 64;
+
+// software occlusion buffer width, height follows aspect of view
+constexpr uint32 SoftwareOcclusionWidth = 256;
+
+// objects per job of software occlusion test
+constexpr uint32 SoftwareOcclusionBatch = 256;
+
+// objects closer than this to camera count as this far for texture streaming, camera inside bounds wants finest mips
+constexpr float MinStreamingDistance = 0.01f;
+
+// primitives without bounds always pass culling
+constexpr lune::BoundingBox UnboundedBox = lune::BoundingBox{lnm::vec3(-1e30f), lnm::vec3(1e30f)};
+
+// free object slots never pass culling, negative extent puts them behind every plane
+constexpr lune::BoundingBox EmptyBox = lune::BoundingBox{lnm::vec3(1e30f), lnm::vec3(-1e30f)};
+
 lune::MeshRenderSystem::MeshRenderSystem()
 {
 	addDependecy<CameraSystem>();
+
+	mGpuDriven = getVulkanConfig().drawIndirectCount;
+	mSoftwareOcclusion = !mGpuDriven;
+}
+
+lune::MeshRenderSystem::~MeshRenderSystem()
+{
+	if (mScene)
+		mScene->onComponentRemovedDelegate.unbind(this);
+}
+
+void lune::MeshRenderSystem::setGpuDriven(bool gpuDriven)
+{
+	mGpuDriven = gpuDriven && getVulkanConfig().drawIndirectCount;
+}
+
+void lune::MeshRenderSystem::bindScene(Scene* scene)
+{
+	mScene = scene;
+	mScene->onComponentRemovedDelegate.bindObject(this, &MeshRenderSystem::onComponentRemoved, std::placeholders::_1, std::placeholders::_2);
+}
+
+void lune::MeshRenderSystem::onComponentRemoved(const EntityBase* entity, ComponentBase* comp)
+{
+	auto meshComponent = dynamic_cast<MeshComponent*>(comp);
+	auto findRes = meshComponent ? mResources.find(meshComponent) : mResources.end();
+	if (findRes == mResources.end())
+		return;
+
+	// slots stay in buffers until reused, cull shader skips them by index count and cpu culler by bounds
+	for (uint32 objectIndex : findRes->second.objects)
+	{
+		mObjects[objectIndex] = ObjectData{};
+		mCuller.setBox(objectIndex, EmptyBox);
+		mFreeObjects.push_back(objectIndex);
+	}
+	mResources.erase(findRes);
+	mDrawGroupsDirty = true;
 }
 
 void lune::MeshRenderSystem::prepareRender(class Scene* scene)
 {
+	if (!mScene)
+		bindScene(scene);
+
 	const auto& entities = scene->getEntities();
 	auto vkSubsystem = Engine::get()->findSubsystem<VulkanSubsystem>();
-	vk::CommandBuffer commandBuffer = vkSubsystem->getFrameInfo().copyCommandBuffer;
+	const FrameInfo frameInfo = vkSubsystem->getFrameInfo();
+	vk::CommandBuffer commandBuffer = frameInfo.copyCommandBuffer;
 
 	auto cameraSystem = scene->findSystem<CameraSystem>();
 	if (!cameraSystem)
 		return;
 
+	if (!mCullPipeline && getVulkanConfig().drawIndirectCount)
+		mCullPipeline = vkSubsystem->findComputePipeline("lune::gltf::cull");
+
+	// takes effect on next frame, until then only frustum culled
+	const bool occlusionCulling = mGpuDriven && mCullPipeline && mOcclusionCulling;
+	if (auto view = vkSubsystem->findView(frameInfo.viewId))
+		view->setDepthPyramidEnabled(occlusionCulling);
+
+	std::vector<vk::BufferCopy> bufferCopies{};
+
 	auto eIds = scene->getComponentEntities<MeshComponent>();
 	for (uint64 eId : eIds)
 	{
 		auto entity = scene->findEntity(eId);
 		auto meshComponent = entity->findComponent<MeshComponent>();
 
-		MeshResources* res{};
-		if (auto it = mResources.find(meshComponent); it == mResources.end())
+		auto it = mResources.find(meshComponent);
+		if (it == mResources.end())
 		{
+			// one object per primitive, model same for all of them, slots of removed meshes taken first
 			MeshResources resources{};
-
-			resources.stagingModelBuffer = vulkan::Buffer::create(vk::BufferUsageFlagBits::eTransferSrc, sizeof(lnm::mat4), VMA_MEMORY_USAGE_AUTO, VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT);
-			resources.modelBuffer = vulkan::Buffer::create(vk::BufferUsageFlagBits::eUniformBuffer | vk::BufferUsageFlagBits::eTransferDst, sizeof(lnm::mat4), VMA_MEMORY_USAGE_AUTO, VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT);
-
 			for (auto& primitive : meshComponent->primitives)
 			{
-				resources.primitives.emplace_back(vkSubsystem->findPrimitive(primitive.primitiveName));
-
-				auto& material = resources.materials.emplace_back(vkSubsystem->findMaterial(primitive.materialName));
-
-				auto& descSet = resources.descSets.emplace_back(vulkan::DescriptorSets::create(material->getPipeline(), 1));
-				descSet->setBufferInfo("viewProj", 0, cameraSystem->getViewProjectionBuffer()->getBuffer(), 0, cameraSystem->getViewProjectionBuffer()->getSize());
-				descSet->setBufferInfo("model", 0, resources.modelBuffer->getBuffer(), 0, resources.modelBuffer->getSize());
-
-				const auto& textures = material->getTextures();
-				const auto& samplers = material->getSamplers();
-				const auto& matBufffer = material->getBuffer();
+				const auto& newPrimitive = resources.primitives.emplace_back(vkSubsystem->findPrimitive(primitive.primitiveName));
+				const auto& material = resources.materials.emplace_back(vkSubsystem->findMaterial(primitive.materialName));
 
-				const size_t size = material->getTextures().size();
-				for (size_t i = 0; i < size; ++i)
+				uint32 objectIndex = static_cast<uint32>(mObjects.size());
+				if (!mFreeObjects.empty())
 				{
-					const auto& tex = textures.at(i);
-					const auto& sampler = samplers.at(i);
-					descSet->setImageInfo("textures", 0, tex->getImageView(), sampler->getSampler(), i);
+					objectIndex = mFreeObjects.back();
+					mFreeObjects.pop_back();
 				}
+				else
+				{
+					mObjects.emplace_back();
+				}
+				resources.objects.push_back(objectIndex);
 
-				descSet->setBufferInfo("material", 0, matBufffer->getBuffer(), 0, matBufffer->getSize());
+				ObjectData& object = mObjects[objectIndex];
+				object = ObjectData{};
+				object.model = lnm::mat4(0.f);
+				object.materialIndex = material->getMaterialIndex();
 
-				descSet->updateSets(0);
+				// only indexed primitives drawn indirectly, others stay on cpu path
+				if (newPrimitive->getIndexBuffer())
+				{
+					object.indexCount = newPrimitive->getIndexCount();
+					object.firstIndex = newPrimitive->getFirstIndex();
+					object.vertexOffset = newPrimitive->getVertexOffset();
+				}
 			}
+			mCuller.resize(mObjects.size());
+			mDrawGroupsDirty = true;
 
 			it = mResources.emplace(meshComponent, std::move(resources)).first;
-			res = &it->second;
-		}
-		else
-		{
-			res = &it->second;
 		}
 
-		auto& resources = mResources.find(meshComponent)->second;
+		const auto& res = it->second;
+		const lnm::mat4 model = findTransform(scene, entity);
+
+		if (res.primitives.empty() || mObjects[res.objects[0]].model == model)
+			continue;
 
-		lnm::mat4 model = findTransform(scene, entity);
+		for (uint32 i = 0; i < res.primitives.size(); ++i)
+		{
+			const auto& primitive = res.primitives[i];
+			const uint32 objectIndex = res.objects[i];
+			const BoundingBox worldBox = primitive->hasBounds() ? primitive->getBoundingBox().transform(model) : UnboundedBox;
+			mCuller.setBox(objectIndex, worldBox);
+
+			ObjectData& object = mObjects[objectIndex];
+			object.model = model;
+			object.boundsCenter = lnm::vec4(worldBox.getCenter(), 0.f);
+			object.boundsExtent = lnm::vec4(worldBox.getExtent(), 0.f);
+
+			// slots of new meshes follow each other unless they reuse freed ones
+			const vk::DeviceSize offset = objectIndex * sizeof(ObjectData);
+			if (!bufferCopies.empty() && bufferCopies.back().srcOffset + bufferCopies.back().size == offset)
+				bufferCopies.back().size += sizeof(ObjectData);
+			else
+				bufferCopies.emplace_back(vk::BufferCopy().setSrcOffset(offset).setDstOffset(offset).setSize(sizeof(ObjectData)));
+		}
+	}
 
-		int diff{};
-		uint8* pStageBuffer = res->stagingModelBuffer->map();
-		if (diff = memcmp(pStageBuffer, &model, sizeof(model)); diff != 0)
-			memcpy(pStageBuffer, &model, sizeof(model));
-		res->stagingModelBuffer->unmap();
+	// group indices written into objects, all of them uploaded again
+	if (mDrawGroupsDirty && mCullPipeline)
+	{
+		rebuildDrawGroups(commandBuffer, cameraSystem);
+		bufferCopies.assign(1, vk::BufferCopy().setSize(mObjects.size() * sizeof(ObjectData)));
+	}
+	mDrawGroupsDirty = false;
 
-		if (diff)
+	if (mObjects.size() > mObjectsCapacity)
+	{
+		// whole buffer copied on grow, no need for partial copies
+		reserveObjects(commandBuffer, std::max(static_cast<uint32>(mObjects.size()), mObjectsCapacity * 2));
+	}
+	else if (!bufferCopies.empty())
+	{
+		for (const auto& copy : bufferCopies)
 		{
-			const vk::BufferCopy bufferCopy = vk::BufferCopy().setSize(sizeof(model));
-			commandBuffer.copyBuffer(res->stagingModelBuffer->getBuffer(), res->modelBuffer->getBuffer(), bufferCopy);
+			const auto bytes = std::as_bytes(std::span(mObjects)).subspan(copy.srcOffset, copy.size);
+			std::memcpy(mObjectsStagingBuffer->getMappedData() + copy.srcOffset, bytes.data(), bytes.size());
+			mObjectsStagingBuffer->flush(copy.srcOffset, copy.size);
 		}
+		commandBuffer.copyBuffer(mObjectsStagingBuffer->getBuffer(), mObjectsBuffer->getBuffer(), bufferCopies);
+	}
+
+	mLateCull = false;
+	if (mGpuDriven && mCullPipeline && !mDrawGroups.empty() && cameraSystem->hasView(frameInfo.viewId))
+	{
+		// frames don't overlap, counters of last cull complete by now
+		mCullStatsBuffer->invalidate(0, sizeof(CullStats));
+		std::memcpy(&mCullStats, mCullStatsBuffer->getMappedData(), sizeof(CullStats));
+
+		mLateCull = occlusionCulling && frameInfo.depthPyramid;
+		updateCullPyramid(mLateCull ? frameInfo.depthPyramid : nullptr);
+		cmdCull(commandBuffer, cameraSystem->getFrustum(frameInfo.viewId), mLateCull ? CullPhase::Early : CullPhase::Frustum);
 	}
 }
 
@@ -123,15 +248,82 @@ void lune::MeshRenderSystem::render(class Scene* scene)
 {
 	const auto& entities = scene->getEntities();
 	auto vkSubsystem = Engine::get()->findSubsystem<VulkanSubsystem>();
-	vk::CommandBuffer commandBuffer = vkSubsystem->getFrameInfo().renderCommandBuffer;
+	const FrameInfo frameInfo = vkSubsystem->getFrameInfo();
 
 	auto cameraSystem = scene->findSystem<CameraSystem>();
-	if (!cameraSystem)
+	if (!cameraSystem || !cameraSystem->hasView(frameInfo.viewId) || !mObjectsBuffer)
 		return;
 
-	vulkan::GraphicsPipeline* pipeline{};
-	vulkan::Buffer* vertBuffer{};
-	vulkan::Buffer* indxBuffer{};
+	const lnm::mat4& view = cameraSystem->getView(frameInfo.viewId);
+
+	// per frame set rewritten every frame into transient pool, reset in bulk once frame completed
+	// created with first drawn primitive below, written by createFrameDescriptorSets then
+	if (mFrameDescSets)
+		mFrameDescSets->updateTransientSet(0, vulkan::DescriptorSetFrequency::PerFrame);
+
+	if (mCulling)
+	{
+		mVisibleCount = mCuller.cull(cameraSystem->getFrustum(frameInfo.viewId), mVisible);
+	}
+	else
+	{
+		mVisible.assign(mCuller.getCount(), 1);
+		for (uint32 objectIndex : mFreeObjects)
+			mVisible[objectIndex] = 0;
+		mVisibleCount = mCuller.getCount() - mFreeObjects.size();
+	}
+
+	mSoftwareOccludedCount = 0;
+	if (mSoftwareOcclusion)
+		cullSoftwareOcclusion(scene, cameraSystem, frameInfo.viewId);
+
+	requestTextureMips(cameraSystem, frameInfo.viewId);
+
+	// indexed primitives culled and drawn by cull shader output, one indirect draw per group
+	const bool gpuDriven = mGpuDriven && mCullPipeline && !mDrawGroups.empty();
+	if (gpuDriven)
+	{
+		for (uint32 i = 0; i < mDrawGroups.size(); ++i)
+		{
+			const DrawGroup& group = mDrawGroups[i];
+			if (!mFrameDescSets)
+				createFrameDescriptorSets(cameraSystem, group.pipeline);
+
+			vulkan::RenderPacket packet{};
+			packet.pipeline = group.pipeline.get();
+			packet.primitive = group.primitive.get();
+			packet.descriptorSets[0] = mFrameDescSets->getDescriptorSet(0, vulkan::DescriptorSetFrequency::PerFrame);
+			packet.descriptorSets[vulkan::BindlessHeap::SetIndex] = getVulkanBindlessHeap().getDescriptorSet();
+			packet.indirectBuffer = mDrawCommandsBuffer->getBuffer();
+			packet.indirectOffset = group.firstCommand * sizeof(vk::DrawIndexedIndirectCommand);
+			packet.countBuffer = mDrawCountsBuffer->getBuffer();
+			packet.countOffset = i * sizeof(uint32);
+			packet.maxDrawCount = group.objectCount;
+
+			const uint64 sortKey = vulkan::RenderQueue::makeSortKey(vulkan::RenderLayer::Opaque, packet.pipeline->getId(), 0, group.primitive->getId(), 0.f);
+			frameInfo.renderQueue->submit(sortKey, packet);
+
+			if (mLateCull)
+			{
+				// objects found visible by late phase, commands and counts follow early ones
+				packet.indirectOffset = (mCommandCount + group.firstCommand) * sizeof(vk::DrawIndexedIndirectCommand);
+				packet.countOffset = (mDrawGroups.size() + i) * sizeof(uint32);
+
+				const uint64 lateSortKey = vulkan::RenderQueue::makeSortKey(vulkan::RenderLayer::LateOpaque, packet.pipeline->getId(), 0, group.primitive->getId(), 0.f);
+				frameInfo.renderQueue->submit(lateSortKey, packet);
+			}
+		}
+
+		if (mLateCull)
+		{
+			const auto lateCull = [this, depthPyramid = frameInfo.depthPyramid, frustum = cameraSystem->getFrustum(frameInfo.viewId)](vk::CommandBuffer commandBuffer)
+			{
+				depthPyramid->cmdBuild(commandBuffer);
+				cmdCull(commandBuffer, frustum, CullPhase::Late);
+			};
+			frameInfo.renderQueue->submitPassBreak(lateCull);
+		}
+	}
 
 	const auto& eIds = scene->getComponentEntities<MeshComponent>();
 	for (uint64 eId : eIds)
@@ -149,33 +341,307 @@ void lune::MeshRenderSystem::render(class Scene* scene)
 			const auto& [comp, res] = *findRes;
 
 			const size_t size = res.primitives.size();
+			if (size == 0)
+				continue;
+
+			// distance along view direction, same for all primitives of mesh
+			const float depth = -(view * mObjects[res.objects[0]].model[3]).z;
 
 			for (size_t i = 0; i < size; ++i)
 			{
+				if (!mVisible[res.objects[i]] || (gpuDriven && mObjects[res.objects[i]].indexCount))
+					continue;
+
 				auto& primitive = res.primitives[i];
-				auto& descSet = res.descSets[i];
+				auto& material = res.materials[i];
+
+				// per frame set and bindless heap layouts same for all primitive pipelines
+				if (!mFrameDescSets)
+					createFrameDescriptorSets(cameraSystem, material->getPipeline());
+
+				vulkan::RenderPacket packet{};
+				packet.pipeline = material->getPipeline().get();
+				packet.primitive = primitive.get();
+				packet.descriptorSets[0] = mFrameDescSets->getDescriptorSet(0, vulkan::DescriptorSetFrequency::PerFrame);
+				packet.descriptorSets[vulkan::BindlessHeap::SetIndex] = getVulkanBindlessHeap().getDescriptorSet();
+				// object index passed as firstInstance, read in shader with gl_InstanceIndex
+				packet.firstInstance = res.objects[i];
+
+				const uint64 sortKey = vulkan::RenderQueue::makeSortKey(vulkan::RenderLayer::Opaque, packet.pipeline->getId(), material->getMaterialIndex(), primitive->getId(), depth);
+				frameInfo.renderQueue->submit(sortKey, packet);
+			}
+		}
+	}
+}
 
-				descSet->cmdBind(commandBuffer, 0);
-				if (pipeline != descSet->getPipeline().get())
-				{
-					descSet->getPipeline()->cmdBind(commandBuffer);
-					pipeline = descSet->getPipeline().get();
-				}
+void lune::MeshRenderSystem::cullSoftwareOcclusion(Scene* scene, CameraSystem* cameraSystem, uint32 viewId)
+{
+	auto vkSubsystem = Engine::get()->findSubsystem<VulkanSubsystem>();
+	auto view = vkSubsystem->findView(viewId);
+	if (!view)
+		return;
 
-				if (auto v = primitive->getVertexBuffer(); vertBuffer != v.get())
-				{
-					commandBuffer.bindVertexBuffers(0, v->getBuffer(), primitive->getVertexOffsets());
-					vertBuffer = v.get();
-				}
+	const vk::Extent2D extent = view->getCurrentExtent();
+	mOcclusionBuffer.resize(SoftwareOcclusionWidth, SoftwareOcclusionWidth * extent.height / std::max(extent.width, 1u));
+
+	mOcclusionBuffer.begin(cameraSystem->getViewProjection(viewId));
+	mOccluderObjects.assign(mObjects.size(), 0);
 
-				if (auto i = primitive->getIndexBuffer(); indxBuffer != i.get())
+	for (uint64 eId : scene->getComponentEntities<OccluderComponent>())
+	{
+		auto entity = scene->findEntity(eId);
+		auto meshComponent = entity ? entity->findComponent<MeshComponent>() : nullptr;
+		auto findRes = meshComponent ? mResources.find(meshComponent) : mResources.end();
+		if (findRes == mResources.end())
+			continue;
+
+		const MeshResources& res = findRes->second;
+		for (size_t i = 0; i < res.primitives.size(); ++i)
+		{
+			const uint32 objectIndex = res.objects[i];
+			mOccluderObjects[objectIndex] = 1;
+
+			// occluders outside of frustum can't hide anything inside it
+			const SharedTriangleMesh& triangleMesh = res.primitives[i]->getTriangleMesh();
+			if (triangleMesh && mVisible[objectIndex])
+				mOcclusionBuffer.addOccluder(mObjects[objectIndex].model, *triangleMesh);
+		}
+	}
+
+	if (mOcclusionBuffer.getTriangleCount() == 0)
+		return;
+
+	auto jobs = Engine::get()->findSubsystem<JobSubsystem>();
+	mOcclusionBuffer.rasterize(jobs);
+
+	std::atomic<uint32> occludedCount{};
+	jobs->parallelFor(mObjects.size(), SoftwareOcclusionBatch, [this, &occludedCount](uint32 begin, uint32 end)
+		{
+			uint32 count{};
+			for (uint32 i = begin; i < end; ++i)
+			{
+				if (!mVisible[i] || mOccluderObjects[i])
+					continue;
+
+				const ObjectData& object = mObjects[i];
+				const lnm::vec3 center = lnm::vec3(object.boundsCenter);
+				const lnm::vec3 extent = lnm::vec3(object.boundsExtent);
+				if (mOcclusionBuffer.isOccluded(BoundingBox{center - extent, center + extent}))
 				{
-					commandBuffer.bindIndexBuffer(i->getBuffer(), 0, primitive->getIndexType());
-					indxBuffer = i.get();
+					mVisible[i] = 0;
+					++count;
 				}
-
-				primitive->cmdDraw(commandBuffer);
 			}
+			occludedCount.fetch_add(count, std::memory_order_relaxed); });
+
+	mSoftwareOccludedCount = occludedCount.load(std::memory_order_relaxed);
+	mVisibleCount -= mSoftwareOccludedCount;
+}
+
+void lune::MeshRenderSystem::requestTextureMips(CameraSystem* cameraSystem, uint32 viewId)
+{
+	auto& streamer = getVulkanTextureStreamer();
+	auto view = Engine::get()->findSubsystem<VulkanSubsystem>()->findView(viewId);
+	if (streamer.getTextureCount() == 0 || !view)
+		return;
+
+	// pixels covered by unit size at unit distance
+	const float pixelScale = std::abs(cameraSystem->getProjection(viewId)[1][1]) * view->getCurrentExtent().height * 0.5f;
+	const lnm::vec3 cameraPosition = lnm::vec3(lnm::inverse(cameraSystem->getView(viewId))[3]);
+
+	for (const auto& [comp, res] : mResources)
+	{
+		for (uint32 i = 0; i < res.primitives.size(); ++i)
+		{
+			const uint32 objectIndex = res.objects[i];
+			if (!mVisible[objectIndex])
+				continue;
+
+			// bounding sphere of world box, its nearest point decides
+			const ObjectData& object = mObjects[objectIndex];
+			const float radius = lnm::length(lnm::vec3(object.boundsExtent));
+			const float distance = std::max(lnm::length(lnm::vec3(object.boundsCenter) - cameraPosition) - radius, MinStreamingDistance);
+			const float screenSize = 2.f * radius * pixelScale / distance;
+
+			for (const auto& texture : res.materials[i]->getTextures())
+				streamer.requestScreenSize(texture.get(), screenSize);
+		}
+	}
+}
+
+void lune::MeshRenderSystem::reserveObjects(vk::CommandBuffer commandBuffer, uint32 capacity)
+{
+	const vk::DeviceSize size = capacity * sizeof(ObjectData);
+	mObjectsCapacity = capacity;
+	mObjectsStagingBuffer = vulkan::Buffer::create(vk::BufferUsageFlagBits::eTransferSrc, size, VMA_MEMORY_USAGE_AUTO, VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT);
+	mObjectsBuffer = vulkan::Buffer::create(vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst, size, VMA_MEMORY_USAGE_AUTO, {});
+
+	const vk::DeviceSize usedSize = mObjects.size() * sizeof(ObjectData);
+	mObjectsStagingBuffer->write(std::as_bytes(std::span(mObjects)));
+
+	const vk::BufferCopy bufferCopy = vk::BufferCopy().setSize(usedSize);
+	commandBuffer.copyBuffer(mObjectsStagingBuffer->getBuffer(), mObjectsBuffer->getBuffer(), bufferCopy);
+
+	// point per frame set to new buffer, written with it on next render
+	if (mFrameDescSets)
+	{
+		const uint32 objectsSlot = mFrameDescSets->getPipeline()->findBindingSlot("objects");
+		mFrameDescSets->setBufferInfo(objectsSlot, 0, mObjectsBuffer->getBuffer(), 0, mObjectsBuffer->getSize());
+	}
+	if (mCullDescSets)
+	{
+		mCullDescSets->setBufferInfo("objects", 0, mObjectsBuffer->getBuffer(), 0, mObjectsBuffer->getSize());
+		mCullDescSets->updateSet(0, vulkan::DescriptorSetFrequency::PerFrame);
+	}
+}
+
+void lune::MeshRenderSystem::rebuildDrawGroups(vk::CommandBuffer commandBuffer, CameraSystem* cameraSystem)
+{
+	mDrawGroups.clear();
+
+	// one indirect draw can't switch pipeline, vertex or index buffer
+	std::map<std::tuple<uint32, VkBuffer, VkBuffer, vk::IndexType>, uint32> groupIndices{};
+	for (const auto& [comp, res] : mResources)
+	{
+		for (uint32 i = 0; i < res.primitives.size(); ++i)
+		{
+			ObjectData& object = mObjects[res.objects[i]];
+			if (!object.indexCount)
+				continue;
+
+			const auto& primitive = res.primitives[i];
+			const auto& pipeline = res.materials[i]->getPipeline();
+			const auto key = std::make_tuple(pipeline->getId(), static_cast<VkBuffer>(primitive->getVertexBuffer()->getBuffer()), static_cast<VkBuffer>(primitive->getIndexBuffer()->getBuffer()), primitive->getIndexType());
+
+			const auto [it, inserted] = groupIndices.try_emplace(key, static_cast<uint32>(mDrawGroups.size()));
+			if (inserted)
+				mDrawGroups.push_back(DrawGroup{pipeline, primitive});
+
+			object.drawGroup = it->second;
+			++mDrawGroups[it->second].objectCount;
 		}
 	}
-}
\ No newline at end of file
+
+	if (mDrawGroups.empty())
+		return;
+
+	// command ranges follow each other, each big enough for every object of group
+	std::vector<uint32> firstCommands{};
+	uint32 commandCount{};
+	for (DrawGroup& group : mDrawGroups)
+	{
+		group.firstCommand = commandCount;
+		firstCommands.push_back(commandCount);
+		commandCount += group.objectCount;
+	}
+
+	mCommandCount = commandCount;
+	mDrawGroupsBuffer = vulkan::Buffer::create(vk::BufferUsageFlagBits::eStorageBuffer, firstCommands.size() * sizeof(uint32), VMA_MEMORY_USAGE_AUTO, VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT);
+	mDrawGroupsBuffer->write(std::as_bytes(std::span(firstCommands)));
+
+	// early phase commands and counts followed by late phase ones
+	constexpr vk::BufferUsageFlags indirectUsage = vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer | vk::BufferUsageFlagBits::eTransferDst;
+	mDrawCommandsBuffer = vulkan::Buffer::create(indirectUsage, 2 * commandCount * sizeof(vk::DrawIndexedIndirectCommand), VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, {});
+	mDrawCountsBuffer = vulkan::Buffer::create(indirectUsage, 2 * mDrawGroups.size() * sizeof(uint32), VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, {});
+
+	// nothing visible yet, everything goes through late phase on first frame
+	mVisibilityBuffer = vulkan::Buffer::create(vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst, mObjects.size() * sizeof(uint32), VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, {});
+	commandBuffer.fillBuffer(mVisibilityBuffer->getBuffer(), 0, VK_WHOLE_SIZE, 0);
+
+	if (!mCullStatsBuffer)
+	{
+		mCullStatsBuffer = vulkan::Buffer::create(vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst, sizeof(CullStats), VMA_MEMORY_USAGE_AUTO, VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT);
+		std::memset(mCullStatsBuffer->getMappedData(), 0, sizeof(CullStats));
+		mCullStatsBuffer->flush(0, sizeof(CullStats));
+	}
+
+	if (!mCullDescSets)
+	{
+		mCullDescSets = vulkan::DescriptorSets::create(mCullPipeline, 1);
+		updateCullPyramid(nullptr);
+	}
+
+	// objects buffer may not exist yet, set once it's created in reserveObjects
+	if (mObjectsBuffer)
+		mCullDescSets->setBufferInfo("objects", 0, mObjectsBuffer->getBuffer(), 0, mObjectsBuffer->getSize());
+	mCullDescSets->setBufferInfo("drawGroups", 0, mDrawGroupsBuffer->getBuffer(), 0, mDrawGroupsBuffer->getSize());
+	mCullDescSets->setBufferInfo("drawCommands", 0, mDrawCommandsBuffer->getBuffer(), 0, mDrawCommandsBuffer->getSize());
+	mCullDescSets->setBufferInfo("drawCounts", 0, mDrawCountsBuffer->getBuffer(), 0, mDrawCountsBuffer->getSize());
+	mCullDescSets->setBufferInfo("visibility", 0, mVisibilityBuffer->getBuffer(), 0, mVisibilityBuffer->getSize());
+	mCullDescSets->setBufferInfo("stats", 0, mCullStatsBuffer->getBuffer(), 0, mCullStatsBuffer->getSize());
+	mCullDescSets->setBufferInfo("viewProj", 0, cameraSystem->getViewProjectionBuffer()->getBuffer(), 0, cameraSystem->getViewProjectionBuffer()->getSize());
+	if (mObjectsBuffer)
+		mCullDescSets->updateSet(0, vulkan::DescriptorSetFrequency::PerFrame);
+}
+
+void lune::MeshRenderSystem::cmdCull(vk::CommandBuffer commandBuffer, const Frustum& frustum, CullPhase phase)
+{
+	// draws of previous view may still read commands, same queue so execution barrier orders against them
+	commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eDrawIndirect, vk::PipelineStageFlagBits::eTransfer | vk::PipelineStageFlagBits::eComputeShader, {}, {}, {}, {});
+
+	// late phase keeps early counts, draws before pass break already consumed them
+	const vk::DeviceSize countsSize = mDrawGroups.size() * sizeof(uint32);
+	if (phase == CullPhase::Late)
+	{
+		commandBuffer.fillBuffer(mDrawCountsBuffer->getBuffer(), countsSize, countsSize, 0);
+	}
+	else
+	{
+		commandBuffer.fillBuffer(mDrawCountsBuffer->getBuffer(), 0, countsSize, 0);
+		commandBuffer.fillBuffer(mCullStatsBuffer->getBuffer(), 0, VK_WHOLE_SIZE, 0);
+	}
+
+	// counts cleared and objects copied before culling reads them
+	const auto transferBarrier = vk::MemoryBarrier()
+									 .setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+									 .setDstAccessMask(vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite);
+	commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eComputeShader, {}, transferBarrier, {}, {});
+
+	CullConstants constants{};
+	std::copy(frustum.planes.begin(), frustum.planes.end(), constants.planes.begin());
+	constants.objectCount = mObjects.size();
+	constants.phase = phase;
+	constants.commandCount = mCommandCount;
+	constants.groupCount = mDrawGroups.size();
+
+	mCullPipeline->cmdBind(commandBuffer);
+	mCullDescSets->cmdBind(commandBuffer, 0, vulkan::DescriptorSetFrequency::PerFrame);
+	commandBuffer.pushConstants(mCullPipeline->getPipelineLayout(), vk::ShaderStageFlagBits::eCompute, 0, sizeof(CullConstants), &constants);
+	commandBuffer.dispatch((constants.objectCount + CullGroupSize - 1) / CullGroupSize, 1, 1);
+
+	const auto cullBarrier = vk::MemoryBarrier()
+								 .setSrcAccessMask(vk::AccessFlagBits::eShaderWrite)
+								 .setDstAccessMask(vk::AccessFlagBits::eIndirectCommandRead);
+	commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eDrawIndirect, {}, cullBarrier, {}, {});
+
+	// stats read on host once frame completes
+	const auto statsBarrier = vk::MemoryBarrier()
+								  .setSrcAccessMask(vk::AccessFlagBits::eShaderWrite)
+								  .setDstAccessMask(vk::AccessFlagBits::eHostRead);
+	commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eHost, {}, statsBarrier, {}, {});
+}
+
+void lune::MeshRenderSystem::updateCullPyramid(const vulkan::DepthPyramid* depthPyramid)
+{
+	// never read without pyramid, any sampled image keeps set valid
+	auto vkSubsystem = Engine::get()->findSubsystem<VulkanSubsystem>();
+	const vk::ImageView imageView = depthPyramid ? depthPyramid->getImageView() : vkSubsystem->findTextureImage("lune::default")->getImageView();
+	if (imageView == mCullPyramidView)
+		return;
+
+	mCullPyramidView = imageView;
+	const vk::ImageLayout layout = depthPyramid ? vk::ImageLayout::eGeneral : vk::ImageLayout::eShaderReadOnlyOptimal;
+	mCullDescSets->setImageInfo("depthPyramid", 0, imageView, vkSubsystem->findSampler("lune::nearest")->getSampler(), 0, layout);
+
+	// objects buffer may not exist yet, set updated once it's created in reserveObjects
+	if (mObjectsBuffer)
+		mCullDescSets->updateSet(0, vulkan::DescriptorSetFrequency::PerFrame);
+}
+
+void lune::MeshRenderSystem::createFrameDescriptorSets(CameraSystem* cameraSystem, const vulkan::SharedGraphicsPipeline& pipeline)
+{
+	mFrameDescSets = vulkan::DescriptorSets::create(pipeline, 1);
+	mFrameDescSets->setBufferInfo("viewProj", 0, cameraSystem->getViewProjectionBuffer()->getBuffer(), 0, cameraSystem->getViewProjectionBuffer()->getSize());
+	mFrameDescSets->setBufferInfo("objects", 0, mObjectsBuffer->getBuffer(), 0, mObjectsBuffer->getSize());
+	mFrameDescSets->updateTransientSet(0, vulkan::DescriptorSetFrequency::PerFrame);
+}
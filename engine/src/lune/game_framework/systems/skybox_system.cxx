@@ -4,8 +4,10 @@
 #include "lune/game_framework/components/skybox.hxx"
 #include "lune/game_framework/scene.hxx"
 #include "lune/game_framework/systems/camera_system.hxx"
+#include "lune/vulkan/bindless_heap.hxx"
 #include "lune/vulkan/pipeline.hxx"
 #include "lune/vulkan/primitive.hxx"
+#include "lune/vulkan/render_queue.hxx"
 #include "lune/vulkan/sampler.hxx"
 #include "lune/vulkan/texture_image.hxx"
 #include "lune/vulkan/vulkan_core.hxx"
@@ -42,12 +44,14 @@ void lune::SkyboxSystem::prepareRender(class Scene* scene)
 
 			SkyboxResources resources;
 			resources.mTextureImage = vkSubsystem->findTextureImage(skyboxComp->imageName);
+			resources.mConstants.textureIndex = resources.mTextureImage->getBindlessIndex();
+			resources.mConstants.samplerIndex = mSampler->getBindlessIndex();
 
+			// only camera buffers in set, cubemap sampled through bindless heap
 			resources.mDescriptorSets = vulkan::DescriptorSets::create(mPipeline, 1);
 			resources.mDescriptorSets->setBufferInfo("view", 0, cameraSystem->getViewBuffer()->getBuffer(), 0, sizeof(lnm::mat4));
 			resources.mDescriptorSets->setBufferInfo("proj", 0, cameraSystem->getProjectionBuffer()->getBuffer(), 0, sizeof(lnm::mat4));
-			resources.mDescriptorSets->setImageInfo("cubemap", 0, resources.mTextureImage->getImageView(), mSampler->getSampler());
-			resources.mDescriptorSets->updateSets(0);
+			resources.mDescriptorSets->updateSet(0, vulkan::DescriptorSetFrequency::PerFrame);
 
 			mSkyboxes.emplace(eId, std::move(resources));
 		}
@@ -57,13 +61,22 @@ void lune::SkyboxSystem::prepareRender(class Scene* scene)
 void lune::SkyboxSystem::render(class Scene* scene)
 {
 	auto vkSubsystem = Engine::get()->findSubsystem<VulkanSubsystem>();
-	vk::CommandBuffer commandBuffer = vkSubsystem->getFrameInfo().renderCommandBuffer;
+	const FrameInfo frameInfo = vkSubsystem->getFrameInfo();
+
+	if (mSkyboxes.empty())
+		return;
+
+	vulkan::RenderPacket packet{};
+	packet.pipeline = mPipeline.get();
+	packet.primitive = mBox.get();
+	packet.descriptorSets[vulkan::BindlessHeap::SetIndex] = getVulkanBindlessHeap().getDescriptorSet();
+
+	// drawn without depth test, has to go before everything else
+	const uint64 sortKey = vulkan::RenderQueue::makeSortKey(vulkan::RenderLayer::Background, mPipeline->getId(), 0, mBox->getId(), 0.f);
 
 	for (const auto& [eId, skybox] : mSkyboxes)
 	{
-		mBox->cmdBind(commandBuffer);
-		mPipeline->cmdBind(commandBuffer);
-		skybox.mDescriptorSets->cmdBind(commandBuffer, 0);
-		mBox->cmdDraw(commandBuffer);
+		packet.descriptorSets[0] = skybox.mDescriptorSets->getDescriptorSet(0, vulkan::DescriptorSetFrequency::PerFrame);
+		frameInfo.renderQueue->submit(sortKey, packet, vk::ShaderStageFlagBits::eFragment, skybox.mConstants);
 	}
-}
\ No newline at end of file
+}
@@ -0,0 +1,315 @@
+#include "lune/game_framework/systems/spatial_index_system.hxx"
+
+#include "lune/core/engine.hxx"
+#include "lune/core/job_subsystem.hxx"
+#include "lune/game_framework/components/bounds.hxx"
+#include "lune/game_framework/components/mesh.hxx"
+#include "lune/game_framework/components/parent_child.hxx"
+#include "lune/game_framework/components/transform.hxx"
+#include "lune/game_framework/entities/entity.hxx"
+#include "lune/game_framework/scene.hxx"
+#include "lune/vulkan/primitive.hxx"
+#include "lune/vulkan/vulkan_subsystem.hxx"
+
+#include <algorithm>
+
+// boxes of entities that moved once grown by that part of their size, later small moves don't touch tree
+constexpr float DynamicMarginScale = 0.25f;
+constexpr float MinDynamicMargin = 0.05f;
+
+// rays per job of mesh raycast batch
+constexpr uint32 MeshRaysPerJob = 64;
+
+lune::SpatialIndexSystem::~SpatialIndexSystem()
+{
+	// systems go before entities, transforms still alive here
+	for (const auto& [eId, proxy] : mProxies)
+		proxy.transform->onChangedDelegate.unbind(this);
+
+	if (mScene)
+	{
+		mScene->onComponentAddedDelegate.unbind(this);
+		mScene->onComponentRemovedDelegate.unbind(this);
+	}
+}
+
+void lune::SpatialIndexSystem::update(Scene* scene, double deltaTime)
+{
+	if (!mScene)
+		bindScene(scene);
+
+	mRefitCount = 0;
+	mReinsertCount = 0;
+
+	// children move with their parents without reporting it, list grows while walked
+	for (size_t i = 0; i < mDirty.size(); ++i)
+	{
+		auto entity = scene->findEntity(mDirty[i]);
+		auto parentChildComp = entity ? entity->findComponent<ParentChildComponent>() : nullptr;
+		if (!parentChildComp)
+			continue;
+
+		for (uint64 childId : parentChildComp->mChildren)
+			markDirty(childId);
+	}
+
+	// many new entities at once, like whole scene loaded, get tree built top down instead of inserted one by one
+	const bool bulkInsert = mPendingInserts.size() > mTree.getProxyCount() / 2;
+	for (uint64 eId : mPendingInserts)
+	{
+		auto findRes = mProxies.find(eId);
+		if (findRes == mProxies.end() || findRes->second.treeProxy != AabbTree::NullNode)
+			continue;
+
+		Proxy& proxy = findRes->second;
+		const BoundingBox box = computeWorldBounds(scene, eId);
+		proxy.treeProxy = bulkInsert ? mTree.insertDeferred(box, eId) : mTree.insert(box, eId);
+		proxy.dirty = false;
+	}
+	if (bulkInsert && !mPendingInserts.empty())
+		mTree.rebuild();
+	mPendingInserts.clear();
+
+	for (uint64 eId : mDirty)
+	{
+		auto findRes = mProxies.find(eId);
+		if (findRes == mProxies.end() || !findRes->second.dirty || findRes->second.treeProxy == AabbTree::NullNode)
+			continue;
+
+		Proxy& proxy = findRes->second;
+		proxy.dirty = false;
+
+		const BoundingBox box = computeWorldBounds(scene, eId);
+		const float margin = std::max(lnm::length(box.getExtent()) * DynamicMarginScale, MinDynamicMargin);
+		mReinsertCount += mTree.move(proxy.treeProxy, box, margin);
+		++mRefitCount;
+	}
+	mDirty.clear();
+}
+
+void lune::SpatialIndexSystem::markDirty(uint64 eId)
+{
+	auto findRes = mProxies.find(eId);
+	if (findRes == mProxies.end() || findRes->second.dirty)
+		return;
+
+	findRes->second.dirty = true;
+	mDirty.push_back(eId);
+}
+
+void lune::SpatialIndexSystem::queryBox(const BoundingBox& box, std::vector<uint64>& outEntities) const
+{
+	outEntities.clear();
+	mTree.queryBox(box, outEntities);
+}
+
+void lune::SpatialIndexSystem::querySphere(const BoundingSphere& sphere, std::vector<uint64>& outEntities) const
+{
+	outEntities.clear();
+	mTree.querySphere(sphere, outEntities);
+}
+
+void lune::SpatialIndexSystem::queryFrustum(const Frustum& frustum, std::vector<uint64>& outEntities) const
+{
+	outEntities.clear();
+	mTree.queryFrustum(frustum, outEntities);
+}
+
+void lune::SpatialIndexSystem::queryRay(const lnm::vec3& origin, const lnm::vec3& direction, float maxDistance, std::vector<uint64>& outEntities) const
+{
+	outEntities.clear();
+	mTree.queryRay(origin, direction, maxDistance, outEntities);
+}
+
+bool lune::SpatialIndexSystem::raycast(const lnm::vec3& origin, const lnm::vec3& direction, float maxDistance, AabbTree::RayHit& outHit) const
+{
+	return mTree.raycast(origin, direction, maxDistance, outHit);
+}
+
+bool lune::SpatialIndexSystem::raycastMeshes(const Ray& ray, MeshRayHit& outHit) const
+{
+	return traceMeshes(ray, false, outHit);
+}
+
+bool lune::SpatialIndexSystem::hasLineOfSight(const lnm::vec3& from, const lnm::vec3& to) const
+{
+	MeshRayHit hit{};
+	return !traceMeshes(Ray{from, to - from, 1.f}, true, hit);
+}
+
+void lune::SpatialIndexSystem::raycastMeshesBatch(std::span<const Ray> rays, std::span<MeshRayHit> outHits, JobSubsystem* jobs) const
+{
+	const auto trace = [this, rays, outHits](uint32 begin, uint32 end)
+	{
+		for (uint32 i = begin; i < end; ++i)
+		{
+			outHits[i] = MeshRayHit{};
+			traceMeshes(rays[i], false, outHits[i]);
+		}
+	};
+
+	if (jobs)
+		jobs->parallelFor(rays.size(), MeshRaysPerJob, trace);
+	else
+		trace(0, rays.size());
+}
+
+void lune::SpatialIndexSystem::bindScene(Scene* scene)
+{
+	mScene = scene;
+	mScene->onComponentAddedDelegate.bindObject(this, &SpatialIndexSystem::onComponentAdded, std::placeholders::_1, std::placeholders::_2);
+	mScene->onComponentRemovedDelegate.bindObject(this, &SpatialIndexSystem::onComponentRemoved, std::placeholders::_1, std::placeholders::_2);
+
+	// entities added before system saw scene
+	for (uint64 eId : scene->getComponentEntities<TransformComponent>())
+	{
+		if (auto entity = scene->findEntity(eId))
+			onComponentAdded(entity, entity->findComponent<TransformComponent>());
+	}
+}
+
+void lune::SpatialIndexSystem::onComponentAdded(const EntityBase* entity, ComponentBase* comp)
+{
+	const uint64 eId = entity->getId();
+	auto transform = dynamic_cast<TransformComponent*>(comp);
+	if (!transform)
+	{
+		// anything bounds are computed from
+		if (dynamic_cast<MeshComponent*>(comp) || dynamic_cast<BoundsComponent*>(comp) || dynamic_cast<ParentChildComponent*>(comp))
+			markDirty(eId);
+		return;
+	}
+
+	if (!mProxies.try_emplace(eId, Proxy{AabbTree::NullNode, transform, false}).second)
+		return;
+
+	mTransformEntities.emplace(transform, eId);
+	transform->onChangedDelegate.bindObject(this, &SpatialIndexSystem::onTransformChanged, std::placeholders::_1);
+	mPendingInserts.push_back(eId);
+}
+
+void lune::SpatialIndexSystem::onComponentRemoved(const EntityBase* entity, ComponentBase* comp)
+{
+	const uint64 eId = entity->getId();
+	auto transform = dynamic_cast<TransformComponent*>(comp);
+	if (!transform)
+	{
+		markDirty(eId);
+		return;
+	}
+
+	auto findRes = mProxies.find(eId);
+	if (findRes == mProxies.end())
+		return;
+
+	if (findRes->second.treeProxy != AabbTree::NullNode)
+		mTree.remove(findRes->second.treeProxy);
+
+	transform->onChangedDelegate.unbind(this);
+	mTransformEntities.erase(transform);
+	mProxies.erase(findRes);
+}
+
+void lune::SpatialIndexSystem::onTransformChanged(TransformComponent* transform)
+{
+	if (auto findRes = mTransformEntities.find(transform); findRes != mTransformEntities.end())
+		markDirty(findRes->second);
+}
+
+lnm::mat4 lune::SpatialIndexSystem::computeWorldMatrix(Scene* scene, uint64 eId) const
+{
+	lnm::mat4 model = lnm::mat4(1.f);
+	for (auto current = scene->findEntity(eId); current;)
+	{
+		if (auto transformComp = current->findComponent<TransformComponent>())
+			model = transformComp->getMatrix() * model;
+
+		auto parentChildComp = current->findComponent<ParentChildComponent>();
+		current = parentChildComp && parentChildComp->mParentId ? scene->findEntity(parentChildComp->mParentId) : nullptr;
+	}
+	return model;
+}
+
+lune::BoundingBox lune::SpatialIndexSystem::computeWorldBounds(Scene* scene, uint64 eId) const
+{
+	auto entity = scene->findEntity(eId);
+	if (!entity)
+		return BoundingBox{};
+
+	const lnm::mat4 model = computeWorldMatrix(scene, eId);
+
+	if (auto boundsComp = entity->findComponent<BoundsComponent>())
+		return boundsComp->box.transform(model);
+
+	if (auto meshComp = entity->findComponent<MeshComponent>())
+	{
+		auto vkSubsystem = Engine::get()->findSubsystem<VulkanSubsystem>();
+
+		bool hasBounds{};
+		BoundingBox localBox{};
+		for (const auto& primitive : meshComp->primitives)
+		{
+			auto meshPrimitive = vkSubsystem->findPrimitive(primitive.primitiveName);
+			if (!meshPrimitive || !meshPrimitive->hasBounds())
+				continue;
+
+			const BoundingBox& primitiveBox = meshPrimitive->getBoundingBox();
+			localBox = hasBounds ? BoundingBox{lnm::min(localBox.min, primitiveBox.min), lnm::max(localBox.max, primitiveBox.max)} : primitiveBox;
+			hasBounds = true;
+		}
+		if (hasBounds)
+			return localBox.transform(model);
+	}
+
+	const lnm::vec3 position = lnm::vec3(model[3]);
+	return BoundingBox{position, position};
+}
+
+bool lune::SpatialIndexSystem::traceMeshes(const Ray& ray, bool anyHit, MeshRayHit& outHit) const
+{
+	if (!mScene)
+		return false;
+
+	std::vector<uint64> candidates{};
+	mTree.queryRay(ray.origin, ray.direction, ray.maxDistance, candidates);
+
+	auto vkSubsystem = Engine::get()->findSubsystem<VulkanSubsystem>();
+	float nearest = ray.maxDistance;
+	bool hit{};
+	for (uint64 eId : candidates)
+	{
+		auto entity = mScene->findEntity(eId);
+		auto meshComp = entity ? entity->findComponent<MeshComponent>() : nullptr;
+		if (!meshComp)
+			continue;
+
+		// ray moved into mesh space with direction left unnormalized keeps distances of world ray
+		const lnm::mat4 invModel = lnm::inverse(computeWorldMatrix(mScene, eId));
+		const lnm::vec3 localOrigin = lnm::vec3(invModel * lnm::vec4(ray.origin, 1.f));
+		const lnm::vec3 localDirection = lnm::vec3(invModel * lnm::vec4(ray.direction, 0.f));
+		for (uint32 i = 0; i < meshComp->primitives.size(); ++i)
+		{
+			auto primitive = vkSubsystem->findPrimitive(meshComp->primitives[i].primitiveName);
+			const TriangleBvh* triangleBvh = primitive ? primitive->getTriangleBvh().get() : nullptr;
+			if (!triangleBvh)
+				continue;
+
+			const Ray localRay{localOrigin, localDirection, nearest};
+			if (anyHit)
+			{
+				if (triangleBvh->intersects(localRay))
+					return true;
+				continue;
+			}
+
+			TriangleRayHit triangleHit{};
+			if (triangleBvh->raycast(localRay, triangleHit))
+			{
+				nearest = triangleHit.distance;
+				outHit = MeshRayHit{eId, i, triangleHit};
+				hit = true;
+			}
+		}
+	}
+	return hit;
+}
@@ -6,14 +6,19 @@
 #include "lune/game_framework/entities/entity.hxx"
 #include "lune/game_framework/scene.hxx"
 #include "lune/game_framework/systems/camera_system.hxx"
+#include "lune/vulkan/bindless_heap.hxx"
 #include "lune/vulkan/pipeline.hxx"
 #include "lune/vulkan/primitive.hxx"
+#include "lune/vulkan/render_queue.hxx"
 #include "lune/vulkan/sampler.hxx"
 #include "lune/vulkan/texture_image.hxx"
 #include "lune/vulkan/vulkan_subsystem.hxx"
 
+#include <algorithm>
 #include <vulkan/vulkan_handles.hpp>
 
+constexpr uint32 InitialInstanceCapacity = 1024;
+
 void lune::SpriteRenderSystem::update(Scene* scene, double deltaTime)
 {
 }
@@ -22,10 +27,10 @@ void lune::SpriteRenderSystem::prepareRender(Scene* scene)
 {
 	const auto& entities = scene->getEntities();
 	auto vkSubsystem = Engine::get()->findSubsystem<VulkanSubsystem>();
-	vk::CommandBuffer commandBuffer = vkSubsystem->getFrameInfo().copyCommandBuffer;
+	const FrameInfo frameInfo = vkSubsystem->getFrameInfo();
 
 	auto cameraSystem = scene->findSystem<CameraSystem>();
-	if (!cameraSystem)
+	if (!cameraSystem || !cameraSystem->hasView(frameInfo.viewId))
 		return;
 
 	if (!mPrimitive)
@@ -37,6 +42,20 @@ void lune::SpriteRenderSystem::prepareRender(Scene* scene)
 	if (!mSampler)
 		mSampler = vkSubsystem->findSampler("lune::nearest");
 
+	if (!mFrameDescSets)
+	{
+		mFrameDescSets = vulkan::DescriptorSets::create(mPipeline, 1);
+		mFrameDescSets->setBufferInfo("viewProj", 0, cameraSystem->getViewProjectionBuffer()->getBuffer(), 0, sizeof(lnm::mat4));
+		reserveInstances(InitialInstanceCapacity);
+	}
+
+	const lnm::mat4& view = cameraSystem->getView(frameInfo.viewId);
+
+	mInstances.clear();
+	mInstanceInfos.clear();
+	mBatches.clear();
+	mTextureBatches.clear();
+
 	const auto& eIds = scene->getComponentEntities<SpriteComponent>();
 	for (auto eId : eIds)
 	{
@@ -53,21 +72,10 @@ void lune::SpriteRenderSystem::prepareRender(Scene* scene)
 		{
 			SpriteResources resources{};
 
-			auto pipeline = vkSubsystem->findPipeline("lune::sprite");
-
-			resources.texImage = vkSubsystem->findTextureImage(spriteComp->imageName);
+			resources.texImage = vkSubsystem->findImage(spriteComp->imageName, resources.uvRect);
 			if (!resources.texImage)
 				continue;
 
-			resources.stagingModelBuffer = vulkan::Buffer::create(vk::BufferUsageFlagBits::eTransferSrc, sizeof(lnm::mat4), VMA_MEMORY_USAGE_AUTO, VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT);
-			resources.modelBuffer = vulkan::Buffer::create(vk::BufferUsageFlagBits::eUniformBuffer | vk::BufferUsageFlagBits::eTransferDst, sizeof(lnm::mat4), VMA_MEMORY_USAGE_AUTO, VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT);
-
-			resources.descSets = vulkan::DescriptorSets::create(pipeline, 1);
-			resources.descSets->setBufferInfo("viewProj", 0, cameraSystem->getViewProjectionBuffer()->getBuffer(), 0, sizeof(lnm::mat4));
-			resources.descSets->setBufferInfo("model", 0, resources.modelBuffer->getBuffer(), 0, sizeof(lnm::mat4));
-			resources.descSets->setImageInfo("texSampler", 0, resources.texImage->getImageView(), mSampler->getSampler());
-			resources.descSets->updateSets(0);
-
 			const auto [it, result] = mResources.emplace(spriteComp, std::move(resources));
 			res = &it->second;
 		}
@@ -79,52 +87,108 @@ void lune::SpriteRenderSystem::prepareRender(Scene* scene)
 		lnm::mat4 model = lnm::mat4(1.f);
 		auto transformComp = entity->findComponent<TransformComponent>();
 		if (transformComp)
-			model = lnm::translate(model, transformComp->mPosition) * lnm::mat4(transformComp->mOrientation) * lnm::scale(model, transformComp->mScale);
+			model = transformComp->getMatrix();
+
+		SpriteInstance& instance = mInstances.emplace_back();
+		instance.model = lnm::translate(model, spriteComp->position);
+		// source rect relative to image, remapped into region of atlas page
+		const lnm::vec4& uv = res->uvRect;
+		instance.srcRect = lnm::vec4(lnm::vec2(uv) + lnm::vec2(spriteComp->srcRect) * lnm::vec2(uv.z, uv.w), lnm::vec2(spriteComp->srcRect.z, spriteComp->srcRect.w) * lnm::vec2(uv.z, uv.w));
+		instance.dstRect = spriteComp->dstRect;
+		instance.textureIndex = res->texImage->getBindlessIndex();
+		instance.samplerIndex = mSampler->getBindlessIndex();
+
+		const float depth = -(view * instance.model[3]).z;
+
+		const auto [it, inserted] = mTextureBatches.try_emplace(instance.textureIndex, static_cast<uint32>(mBatches.size()));
+		if (inserted)
+			mBatches.push_back(Batch{instance.textureIndex, 0, 0, depth});
+
+		Batch& batch = mBatches[it->second];
+		++batch.instanceCount;
+		batch.depth = std::max(batch.depth, depth);
+		mInstanceInfos.push_back(InstanceInfo{it->second, depth});
+	}
 
-		model = lnm::translate(model, spriteComp->position);
+	mInstanceCount = mInstances.size();
+	if (mInstanceCount == 0)
+		return;
 
-		int diff{};
-		uint8* pStageBuffer = res->stagingModelBuffer->map();
-		if (diff = memcmp(pStageBuffer, &model, sizeof(model)); diff != 0)
-			memcpy(pStageBuffer, &model, sizeof(model));
-		res->stagingModelBuffer->unmap();
+	if (mInstanceCount > mInstanceCapacity)
+		reserveInstances(std::max(mInstanceCount, mInstanceCapacity * 2));
 
-		if (diff)
-		{
-			const vk::BufferCopy bufferCopy = vk::BufferCopy().setSize(sizeof(model));
-			commandBuffer.copyBuffer(res->stagingModelBuffer->getBuffer(), res->modelBuffer->getBuffer(), bufferCopy);
-		}
+	// counting sort by batch straight into mapped buffer, instances of batch stay in entity order
+	std::vector<uint32> cursors(mBatches.size());
+	uint32 firstInstance{};
+	for (size_t i = 0; i < mBatches.size(); ++i)
+	{
+		mBatches[i].firstInstance = firstInstance;
+		cursors[i] = firstInstance;
+		firstInstance += mBatches[i].instanceCount;
 	}
+
+	mInstanceDepths.resize(mInstanceCount);
+	auto mapped = reinterpret_cast<SpriteInstance*>(mInstanceBuffer->getMappedData());
+	for (uint32 i = 0; i < mInstanceCount; ++i)
+	{
+		const uint32 dst = cursors[mInstanceInfos[i].batch]++;
+		mapped[dst] = mInstances[i];
+		mInstanceDepths[dst] = mInstanceInfos[i].depth;
+	}
+	mInstanceBuffer->flush(0, mInstanceCount * sizeof(SpriteInstance));
 }
 
 void lune::SpriteRenderSystem::render(Scene* scene)
 {
 	const auto& entities = scene->getEntities();
 	auto vkSubsystem = Engine::get()->findSubsystem<VulkanSubsystem>();
-	vk::CommandBuffer commandBuffer = vkSubsystem->getFrameInfo().renderCommandBuffer;
+	const FrameInfo frameInfo = vkSubsystem->getFrameInfo();
 
-	auto cameraSystem = scene->findSystem<CameraSystem>();
-	if (!cameraSystem)
+	if (!mFrameDescSets || mInstanceCount == 0)
 		return;
 
-	const auto& eIds = scene->getComponentEntities<SpriteComponent>();
-	for (auto eId : eIds)
+	vulkan::RenderPacket packet{};
+	packet.pipeline = mPipeline.get();
+	packet.primitive = mPrimitive.get();
+	// per frame set rewritten every frame into transient pool, reset in bulk once frame completed
+	mFrameDescSets->updateTransientSet(0, vulkan::DescriptorSetFrequency::PerFrame);
+
+	packet.descriptorSets[0] = mFrameDescSets->getDescriptorSet(0, vulkan::DescriptorSetFrequency::PerFrame);
+	packet.descriptorSets[vulkan::BindlessHeap::SetIndex] = getVulkanBindlessHeap().getDescriptorSet();
+
+	// blended, batches sorted back to front by farthest instance
+	if (mInstancing)
 	{
-		auto entity = scene->findEntity(eId);
-		if (!entity)
-			continue;
+		for (const Batch& batch : mBatches)
+		{
+			packet.firstInstance = batch.firstInstance;
+			packet.instanceCount = batch.instanceCount;
 
-		auto spriteComp = entity->findComponent<SpriteComponent>();
-		if (!spriteComp)
-			continue;
-		if (auto findRes = mResources.find(spriteComp); findRes != mResources.end())
+			const uint64 sortKey = vulkan::RenderQueue::makeSortKey(vulkan::RenderLayer::Transparent, mPipeline->getId(), batch.textureIndex, mPrimitive->getId(), batch.depth);
+			frameInfo.renderQueue->submit(sortKey, packet);
+		}
+		return;
+	}
+
+	for (const Batch& batch : mBatches)
+	{
+		for (uint32 i = batch.firstInstance; i < batch.firstInstance + batch.instanceCount; ++i)
 		{
-			const auto& [comp, res] = *findRes;
+			packet.firstInstance = i;
+			packet.instanceCount = 1;
 
-			res.descSets->getPipeline()->cmdBind(commandBuffer);
-			res.descSets->cmdBind(commandBuffer, 0);
-			mPrimitive->cmdBind(commandBuffer);
-			mPrimitive->cmdDraw(commandBuffer);
+			const uint64 sortKey = vulkan::RenderQueue::makeSortKey(vulkan::RenderLayer::Transparent, mPipeline->getId(), batch.textureIndex, mPrimitive->getId(), mInstanceDepths[i]);
+			frameInfo.renderQueue->submit(sortKey, packet);
 		}
 	}
 }
+
+void lune::SpriteRenderSystem::reserveInstances(uint32 capacity)
+{
+	// single frame in flight, buffer free to rewrite once previous frame finished
+	mInstanceCapacity = capacity;
+	mInstanceBuffer = vulkan::Buffer::create(vk::BufferUsageFlagBits::eStorageBuffer, capacity * sizeof(SpriteInstance), VMA_MEMORY_USAGE_AUTO, VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT);
+
+	// set written with new buffer on next render
+	mFrameDescSets->setBufferInfo("instances", 0, mInstanceBuffer->getBuffer(), 0, mInstanceBuffer->getSize());
+}
@@ -0,0 +1,219 @@
+#include "lune/vulkan/bindless_heap.hxx"
+
+#include "lune/core/log.hxx"
+#include "lune/vulkan/upload_context.hxx"
+
+#include <algorithm>
+#include <array>
+
+// upper bounds, clamped by device update after bind limits
+constexpr uint32 MaxBindlessTextures = 16384;
+constexpr uint32 MaxBindlessSamplers = 256;
+
+constexpr uint32 InitialMaterialsCapacity = 256;
+
+lune::vulkan::BindlessHeap& lune::getVulkanBindlessHeap() noexcept
+{
+	static vulkan::BindlessHeap heap{};
+	return heap;
+}
+
+void lune::vulkan::BindlessHeap::init()
+{
+	const auto& device = getVulkanContext().device;
+
+	const auto properties = getVulkanContext().physicalDevice.getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceDescriptorIndexingProperties>();
+	const auto& indexingProperties = properties.get<vk::PhysicalDeviceDescriptorIndexingProperties>();
+
+	mMaxTextures = std::min(MaxBindlessTextures, indexingProperties.maxDescriptorSetUpdateAfterBindSampledImages);
+	mMaxSamplers = std::min(MaxBindlessSamplers, indexingProperties.maxDescriptorSetUpdateAfterBindSamplers);
+
+	const auto stages = vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment | vk::ShaderStageFlagBits::eCompute;
+	const std::array<vk::DescriptorSetLayoutBinding, 3> bindings{
+		vk::DescriptorSetLayoutBinding()
+			.setBinding(TexturesBinding)
+			.setDescriptorType(vk::DescriptorType::eSampledImage)
+			.setDescriptorCount(mMaxTextures)
+			.setStageFlags(stages),
+		vk::DescriptorSetLayoutBinding()
+			.setBinding(SamplersBinding)
+			.setDescriptorType(vk::DescriptorType::eSampler)
+			.setDescriptorCount(mMaxSamplers)
+			.setStageFlags(stages),
+		vk::DescriptorSetLayoutBinding()
+			.setBinding(MaterialsBinding)
+			.setDescriptorType(vk::DescriptorType::eStorageBuffer)
+			.setDescriptorCount(1)
+			.setStageFlags(stages)};
+
+	// unregistered slots never written, textures and samplers updated while set bound
+	const vk::DescriptorBindingFlags arrayFlags = vk::DescriptorBindingFlagBits::ePartiallyBound | vk::DescriptorBindingFlagBits::eUpdateAfterBind | vk::DescriptorBindingFlagBits::eUpdateUnusedWhilePending;
+	const std::array<vk::DescriptorBindingFlags, 3> bindingFlags{arrayFlags, arrayFlags, vk::DescriptorBindingFlagBits::eUpdateAfterBind};
+
+	auto bindingFlagsCreateInfo = vk::DescriptorSetLayoutBindingFlagsCreateInfo()
+									  .setBindingFlags(bindingFlags);
+
+	const auto layoutCreateInfo = vk::DescriptorSetLayoutCreateInfo()
+									  .setPNext(&bindingFlagsCreateInfo)
+									  .setFlags(vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPool)
+									  .setBindings(bindings);
+	mDescriptorSetLayout = device.createDescriptorSetLayout(layoutCreateInfo);
+
+	const std::array<vk::DescriptorPoolSize, 3> poolSizes{
+		vk::DescriptorPoolSize(vk::DescriptorType::eSampledImage, mMaxTextures),
+		vk::DescriptorPoolSize(vk::DescriptorType::eSampler, mMaxSamplers),
+		vk::DescriptorPoolSize(vk::DescriptorType::eStorageBuffer, 1)};
+
+	const auto poolCreateInfo = vk::DescriptorPoolCreateInfo()
+									.setFlags(vk::DescriptorPoolCreateFlagBits::eUpdateAfterBind)
+									.setPoolSizes(poolSizes)
+									.setMaxSets(1);
+	mDescriptorPool = device.createDescriptorPool(poolCreateInfo);
+
+	const auto allocInfo = vk::DescriptorSetAllocateInfo()
+							   .setDescriptorPool(mDescriptorPool)
+							   .setSetLayouts(mDescriptorSetLayout);
+	mDescriptorSet = device.allocateDescriptorSets(allocInfo)[0];
+
+	reserveMaterials(InitialMaterialsCapacity);
+
+	LN_LOG(Info, Vulkan::BindlessHeap, "Bindless heap: {} textures, {} samplers", mMaxTextures, mMaxSamplers);
+}
+
+void lune::vulkan::BindlessHeap::shutdown()
+{
+	if (!mDescriptorPool)
+		return;
+
+	mMaterialsBuffer.reset();
+
+	getVulkanContext().device.destroyDescriptorPool(mDescriptorPool);
+	getVulkanContext().device.destroyDescriptorSetLayout(mDescriptorSetLayout);
+	mDescriptorPool = nullptr;
+	mDescriptorSetLayout = nullptr;
+	mDescriptorSet = nullptr;
+}
+
+uint32 lune::vulkan::BindlessHeap::registerTexture(vk::ImageView imageView)
+{
+	const uint32 index = allocateSlot(mFreeTextureSlots, mNextTextureSlot, mMaxTextures);
+	updateTexture(index, imageView);
+	return index;
+}
+
+void lune::vulkan::BindlessHeap::updateTexture(uint32 index, vk::ImageView imageView)
+{
+	const auto imageInfo = vk::DescriptorImageInfo()
+							   .setImageView(imageView)
+							   .setImageLayout(vk::ImageLayout::eShaderReadOnlyOptimal);
+	const auto write = vk::WriteDescriptorSet()
+						   .setDstSet(mDescriptorSet)
+						   .setDstBinding(TexturesBinding)
+						   .setDstArrayElement(index)
+						   .setDescriptorType(vk::DescriptorType::eSampledImage)
+						   .setImageInfo(imageInfo);
+	getVulkanContext().device.updateDescriptorSets(write, {});
+}
+
+void lune::vulkan::BindlessHeap::unregisterTexture(uint32 index)
+{
+	// descriptor left as is, partially bound array allows stale slots as long as shaders don't access them
+	mFreeTextureSlots.push_back(index);
+}
+
+uint32 lune::vulkan::BindlessHeap::registerSampler(vk::Sampler sampler)
+{
+	const uint32 index = allocateSlot(mFreeSamplerSlots, mNextSamplerSlot, mMaxSamplers);
+
+	const auto imageInfo = vk::DescriptorImageInfo()
+							   .setSampler(sampler);
+	const auto write = vk::WriteDescriptorSet()
+						   .setDstSet(mDescriptorSet)
+						   .setDstBinding(SamplersBinding)
+						   .setDstArrayElement(index)
+						   .setDescriptorType(vk::DescriptorType::eSampler)
+						   .setImageInfo(imageInfo);
+	getVulkanContext().device.updateDescriptorSets(write, {});
+
+	return index;
+}
+
+void lune::vulkan::BindlessHeap::unregisterSampler(uint32 index)
+{
+	mFreeSamplerSlots.push_back(index);
+}
+
+uint32 lune::vulkan::BindlessHeap::registerMaterial(const ShaderMaterialData& material)
+{
+	uint32 index{};
+	if (!mFreeMaterialSlots.empty())
+	{
+		index = mFreeMaterialSlots.back();
+		mFreeMaterialSlots.pop_back();
+	}
+	else
+	{
+		index = mMaterials.size();
+		mMaterials.emplace_back();
+		if (mMaterials.size() > mMaterialsCapacity)
+			reserveMaterials(mMaterialsCapacity * 2);
+	}
+
+	updateMaterial(index, material);
+	return index;
+}
+
+void lune::vulkan::BindlessHeap::updateMaterial(uint32 index, const ShaderMaterialData& material)
+{
+	mMaterials[index] = material;
+	getVulkanUploadContext().uploadBuffer(mMaterialsBuffer->getBuffer(), index * sizeof(ShaderMaterialData), &material, sizeof(ShaderMaterialData));
+}
+
+void lune::vulkan::BindlessHeap::unregisterMaterial(uint32 index)
+{
+	mFreeMaterialSlots.push_back(index);
+}
+
+void lune::vulkan::BindlessHeap::cmdBind(vk::CommandBuffer commandBuffer, vk::PipelineLayout pipelineLayout, vk::PipelineBindPoint bindPoint)
+{
+	commandBuffer.bindDescriptorSets(bindPoint, pipelineLayout, SetIndex, mDescriptorSet, {});
+}
+
+uint32 lune::vulkan::BindlessHeap::allocateSlot(std::vector<uint32>& freeSlots, uint32& nextSlot, uint32 maxSlots)
+{
+	if (!freeSlots.empty())
+	{
+		const uint32 index = freeSlots.back();
+		freeSlots.pop_back();
+		return index;
+	}
+
+	if (nextSlot >= maxSlots)
+	{
+		LN_LOG(Fatal, Vulkan::BindlessHeap, "Out of bindless slots ({})", maxSlots);
+		return 0;
+	}
+	return nextSlot++;
+}
+
+void lune::vulkan::BindlessHeap::reserveMaterials(uint32 capacity)
+{
+	mMaterialsCapacity = capacity;
+	mMaterialsBuffer = Buffer::create(vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst, capacity * sizeof(ShaderMaterialData), VMA_MEMORY_USAGE_AUTO, {});
+
+	// old buffer released through delete queue, new one gets everything registered so far
+	if (!mMaterials.empty())
+		getVulkanUploadContext().uploadBuffer(mMaterialsBuffer->getBuffer(), 0, mMaterials.data(), mMaterials.size() * sizeof(ShaderMaterialData));
+
+	const auto bufferInfo = vk::DescriptorBufferInfo()
+								.setBuffer(mMaterialsBuffer->getBuffer())
+								.setOffset(0)
+								.setRange(VK_WHOLE_SIZE);
+	const auto write = vk::WriteDescriptorSet()
+						   .setDstSet(mDescriptorSet)
+						   .setDstBinding(MaterialsBinding)
+						   .setDstArrayElement(0)
+						   .setDescriptorType(vk::DescriptorType::eStorageBuffer)
+						   .setBufferInfo(bufferInfo);
+	getVulkanContext().device.updateDescriptorSets(write, {});
+}
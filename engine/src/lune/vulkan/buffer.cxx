@@ -1,11 +1,16 @@
 #include "lune/vulkan/buffer.hxx"
 
 #include "lune/core/log.hxx"
+#include "lune/vulkan/upload_context.hxx"
+#include "lune/vulkan/vma.hxx"
 
 lune::vulkan::Buffer::~Buffer()
 {
-	const auto cleanBufferLam = [buffer = mBuffer, allocation = mVmaAllocation]() -> bool
+	// copies recorded in background batches may still be in flight after frames using buffer completed
+	const auto cleanBufferLam = [buffer = mBuffer, allocation = mVmaAllocation, ticket = mUploadTicket]() -> bool
 	{
+		if (!getVulkanUploadContext().isComplete(ticket))
+			return false;
 		vmaDestroyBuffer(getVulkanContext().vmaAllocator, buffer, allocation);
 		return true;
 	};
@@ -31,13 +36,23 @@ void lune::vulkan::Buffer::init(vk::BufferUsageFlags usage, vk::DeviceSize size,
 	VmaAllocationCreateInfo vmaCreateInfo{};
 	vmaCreateInfo.usage = vmaUsage;
 	vmaCreateInfo.flags = vmaFlags;
+	vmaCreateInfo.pool = vma::findSmallBufferPool(getVulkanContext().vmaAllocator, bufferCreateInfo, vmaCreateInfo);
 
 	VmaAllocationInfo info{};
 	vmaCreateBuffer(getVulkanContext().vmaAllocator, reinterpret_cast<const VkBufferCreateInfo*>(&bufferCreateInfo), &vmaCreateInfo, reinterpret_cast<VkBuffer*>(&mBuffer), &mVmaAllocation, &info);
+
+	mMappedData = static_cast<uint8*>(info.pMappedData);
+
+	VkMemoryPropertyFlags memoryProperties{};
+	vmaGetAllocationMemoryProperties(getVulkanContext().vmaAllocator, mVmaAllocation, &memoryProperties);
+	mHostCoherent = memoryProperties & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
 }
 
 uint8* lune::vulkan::Buffer::map() const
 {
+	if (mMappedData) [[likely]]
+		return mMappedData;
+
 	uint8* pBuffer{};
 	VkResult mapRes = vmaMapMemory(getVulkanContext().vmaAllocator, mVmaAllocation, reinterpret_cast<void**>(&pBuffer));
 	if (mapRes != VK_SUCCESS) [[unlikely]]
@@ -50,57 +65,42 @@ uint8* lune::vulkan::Buffer::map() const
 
 void lune::vulkan::Buffer::unmap() const
 {
+	if (mMappedData) [[likely]]
+		return;
+
 	vmaUnmapMemory(getVulkanContext().vmaAllocator, mVmaAllocation);
 }
 
-void lune::vulkan::Buffer::copyMap(const void* data, size_t offset, size_t size)
+void lune::vulkan::Buffer::write(std::span<const std::byte> bytes, vk::DeviceSize offset)
 {
 	uint8* pBuffer = map();
 	if (pBuffer)
 	{
-		memcpy(pBuffer + offset, data, size);
+		memcpy(pBuffer + offset, bytes.data(), bytes.size());
+		flush(offset, bytes.size());
 		unmap();
 	}
 }
 
-void lune::vulkan::Buffer::copyTransfer(const void* data, size_t offset, size_t size)
+void lune::vulkan::Buffer::flush(vk::DeviceSize offset, vk::DeviceSize size) const
 {
-	const auto vmaUsage = VMA_MEMORY_USAGE_AUTO_PREFER_HOST;
-	const auto vmaFlags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT;
-	UniqueBuffer stagingBuffer = create(vk::BufferUsageFlagBits::eTransferSrc, size, vmaUsage, vmaFlags);
-
-	stagingBuffer->copyMap(data, 0, size);
-
-	const vk::CommandBufferAllocateInfo commandBufferAllocateInfo =
-		vk::CommandBufferAllocateInfo()
-			.setCommandPool(getVulkanContext().transferCommandPool)
-			.setLevel(vk::CommandBufferLevel::ePrimary)
-			.setCommandBufferCount(1);
-
-	const vk::CommandBuffer commandBuffer = getVulkanContext().device.allocateCommandBuffers(commandBufferAllocateInfo)[0];
-
-	const vk::CommandBufferBeginInfo commandBufferBeginInfo =
-		vk::CommandBufferBeginInfo()
-			.setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
-
-	commandBuffer.begin(commandBufferBeginInfo);
-
-	const vk::BufferCopy copyRegion = vk::BufferCopy()
-										  .setSrcOffset(0)
-										  .setDstOffset(offset)
-										  .setSize(size);
-
-	commandBuffer.copyBuffer(stagingBuffer->getBuffer(), getBuffer(), copyRegion);
+	if (!mHostCoherent)
+		vmaFlushAllocation(getVulkanContext().vmaAllocator, mVmaAllocation, offset, size);
+}
 
-	commandBuffer.end();
+void lune::vulkan::Buffer::invalidate(vk::DeviceSize offset, vk::DeviceSize size) const
+{
+	if (!mHostCoherent)
+		vmaInvalidateAllocation(getVulkanContext().vmaAllocator, mVmaAllocation, offset, size);
+}
 
-	const vk::Fence transferFence = getVulkanContext().device.createFence(vk::FenceCreateInfo());
-	const vk::SubmitInfo submitInfo =
-		vk::SubmitInfo()
-			.setCommandBufferCount(1)
-			.setPCommandBuffers(&commandBuffer);
+void lune::vulkan::Buffer::copyMap(const void* data, size_t offset, size_t size)
+{
+	write(std::span<const std::byte>(static_cast<const std::byte*>(data), size), offset);
+}
 
-	getVulkanContext().transferQueue.submit(submitInfo, transferFence);
-	[[maybe_unused]] vk::Result waitRes = getVulkanContext().device.waitForFences(transferFence, true, UINT64_MAX);
-	getVulkanContext().device.destroyFence(transferFence);
+lune::vulkan::UploadTicket lune::vulkan::Buffer::copyTransfer(const void* data, size_t offset, size_t size)
+{
+	mUploadTicket = getVulkanUploadContext().uploadBuffer(mBuffer, offset, data, size);
+	return mUploadTicket;
 }
@@ -30,6 +30,7 @@ void lune::vulkan::DepthImage::init(vk::Extent2D extent)
 {
 	mFormat = getVulkanConfig().depthFormat;
 	mSampleCount = getVulkanConfig().sampleCount;
+	mExtent = extent;
 
 	createImage(extent);
 	createImageView();
@@ -39,6 +40,11 @@ void lune::vulkan::DepthImage::init(vk::Extent2D extent)
 
 void lune::vulkan::DepthImage::createImage(vk::Extent2D extent)
 {
+	// sampled when building depth pyramid
+	vk::ImageUsageFlags usage = vk::ImageUsageFlagBits::eDepthStencilAttachment;
+	if (getVulkanConfig().sampledDepth)
+		usage |= vk::ImageUsageFlagBits::eSampled;
+
 	const vk::ImageCreateInfo imageCreateInfo =
 		vk::ImageCreateInfo()
 			.setImageType(vk::ImageType::e2D)
@@ -48,13 +54,14 @@ void lune::vulkan::DepthImage::createImage(vk::Extent2D extent)
 			.setArrayLayers(1)
 			.setSamples(mSampleCount)
 			.setTiling(vk::ImageTiling::eOptimal)
-			.setUsage(vk::ImageUsageFlagBits::eDepthStencilAttachment)
+			.setUsage(usage)
 			.setInitialLayout(vk::ImageLayout::eUndefined)
 			.setQueueFamilyIndices(getVulkanContext().queueFamilyIndices)
 			.setSharingMode(vk::SharingMode::eExclusive);
 
 	VmaAllocationCreateInfo vmaAllocCreateInfo{};
 	vmaAllocCreateInfo.usage = VMA_MEMORY_USAGE_AUTO;
+	vmaAllocCreateInfo.flags = VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT;
 	VmaAllocationInfo allocInfo{};
 	vmaCreateImage(getVulkanContext().vmaAllocator, reinterpret_cast<const VkImageCreateInfo*>(&imageCreateInfo), &vmaAllocCreateInfo, reinterpret_cast<VkImage*>(&mImage), &mVmaAllocation, &allocInfo);
 }
@@ -78,7 +85,7 @@ void lune::vulkan::DepthImage::transitionImageLayout(vk::ImageLayout oldLayout,
 		vk::CommandBufferAllocateInfo()
 			.setLevel(vk::CommandBufferLevel::ePrimary)
 			.setCommandBufferCount(1)
-			.setCommandPool(getVulkanContext().transferCommandPool);
+			.setCommandPool(getVulkanContext().graphicsCommandPool);
 
 	vk::CommandBuffer commandBuffer = getVulkanContext().device.allocateCommandBuffers(commandBufferAllocateInfo)[0];
 
@@ -108,5 +115,5 @@ void lune::vulkan::DepthImage::transitionImageLayout(vk::ImageLayout oldLayout,
 		vk::SubmitInfo()
 			.setCommandBuffers({commandBuffer});
 
-	getVulkanContext().transferQueue.submit(submitInfo, nullptr);
+	getVulkanContext().graphicsQueue.submit(submitInfo, nullptr);
 }
@@ -0,0 +1,180 @@
+#include "lune/vulkan/depth_pyramid.hxx"
+
+#include "lune/core/engine.hxx"
+#include "lune/core/log.hxx"
+#include "lune/vulkan/depth_image.hxx"
+#include "lune/vulkan/pipeline.hxx"
+#include "lune/vulkan/sampler.hxx"
+#include "lune/vulkan/vulkan_subsystem.hxx"
+
+#include <bit>
+
+// local size of hiz/copy_depth.comp, hiz/copy_depth_ms.comp and hiz/reduce.comp
+constexpr uint32 DepthPyramidGroupSize = 8;
+
+// matches push constants of hiz/copy_depth_ms.comp
+struct CopyDepthConstants
+{
+	uint32 sampleCount{};
+};
+
+static uint32 groupCount(uint32 size)
+{
+	return (size + DepthPyramidGroupSize - 1) / DepthPyramidGroupSize;
+}
+
+lune::vulkan::DepthPyramid::~DepthPyramid()
+{
+	const auto cleanImageViews = [imageView = mImageView, levelViews = mLevelViews]() -> bool
+	{
+		getVulkanContext().device.destroyImageView(imageView);
+		for (vk::ImageView levelView : levelViews)
+			getVulkanContext().device.destroyImageView(levelView);
+		return true;
+	};
+	const auto cleanImageAlloc = [image = mImage, vmaAlloc = mVmaAllocation]() -> bool
+	{
+		vmaDestroyImage(getVulkanContext().vmaAllocator, image, vmaAlloc);
+		return true;
+	};
+	getVulkanDeleteQueue().push(cleanImageViews);
+	getVulkanDeleteQueue().push(cleanImageAlloc);
+}
+
+lune::vulkan::UniqueDepthPyramid lune::vulkan::DepthPyramid::create(const DepthImage& depthImage)
+{
+	auto newDepthPyramid = std::make_unique<DepthPyramid>();
+	newDepthPyramid->init(depthImage);
+	return std::move(newDepthPyramid);
+}
+
+void lune::vulkan::DepthPyramid::init(const DepthImage& depthImage)
+{
+	mDepthExtent = depthImage.getExtent();
+	mDepthSampleCount = static_cast<uint32>(depthImage.getSampleCount());
+
+	// power of two levels halve exactly, first level texel covers up to 3x3 depth texels
+	mExtent = vk::Extent2D(std::bit_floor(mDepthExtent.width), std::bit_floor(mDepthExtent.height));
+	mLevelCount = std::bit_width(std::max(mExtent.width, mExtent.height));
+
+	auto vkSubsystem = Engine::get()->findSubsystem<VulkanSubsystem>();
+	mCopyPipeline = vkSubsystem->findComputePipeline(mDepthSampleCount > 1 ? "lune::hiz::copyDepthMs" : "lune::hiz::copyDepth");
+	mReducePipeline = vkSubsystem->findComputePipeline("lune::hiz::reduce");
+
+	createImage();
+	createImageViews();
+	createDescriptorSets(depthImage);
+}
+
+void lune::vulkan::DepthPyramid::cmdBuild(vk::CommandBuffer commandBuffer)
+{
+	// previous content discarded, reads of last build done by now
+	const vk::ImageMemoryBarrier discardBarrier =
+		vk::ImageMemoryBarrier()
+			.setSrcAccessMask(vk::AccessFlagBits::eShaderRead)
+			.setDstAccessMask(vk::AccessFlagBits::eShaderWrite)
+			.setOldLayout(vk::ImageLayout::eUndefined)
+			.setNewLayout(vk::ImageLayout::eGeneral)
+			.setImage(mImage)
+			.setSubresourceRange(vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, mLevelCount, 0, 1));
+	commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader, {}, {}, {}, discardBarrier);
+
+	mCopyPipeline->cmdBind(commandBuffer);
+	mCopyDescSets->cmdBind(commandBuffer, 0, DescriptorSetFrequency::PerFrame);
+	if (mDepthSampleCount > 1)
+	{
+		const CopyDepthConstants constants{mDepthSampleCount};
+		commandBuffer.pushConstants(mCopyPipeline->getPipelineLayout(), vk::ShaderStageFlagBits::eCompute, 0, sizeof(CopyDepthConstants), &constants);
+	}
+	commandBuffer.dispatch(groupCount(mExtent.width), groupCount(mExtent.height), 1);
+
+	mReducePipeline->cmdBind(commandBuffer);
+	for (uint32 level = 1; level < mLevelCount; ++level)
+	{
+		// previous level written before reading it
+		const vk::ImageMemoryBarrier levelBarrier =
+			vk::ImageMemoryBarrier()
+				.setSrcAccessMask(vk::AccessFlagBits::eShaderWrite)
+				.setDstAccessMask(vk::AccessFlagBits::eShaderRead)
+				.setOldLayout(vk::ImageLayout::eGeneral)
+				.setNewLayout(vk::ImageLayout::eGeneral)
+				.setImage(mImage)
+				.setSubresourceRange(vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, level - 1, 1, 0, 1));
+		commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader, {}, {}, {}, levelBarrier);
+
+		mReduceDescSets->cmdBind(commandBuffer, level, DescriptorSetFrequency::PerFrame);
+		commandBuffer.dispatch(groupCount(std::max(mExtent.width >> level, 1u)), groupCount(std::max(mExtent.height >> level, 1u)), 1);
+	}
+
+	const vk::ImageMemoryBarrier lastLevelBarrier =
+		vk::ImageMemoryBarrier()
+			.setSrcAccessMask(vk::AccessFlagBits::eShaderWrite)
+			.setDstAccessMask(vk::AccessFlagBits::eShaderRead)
+			.setOldLayout(vk::ImageLayout::eGeneral)
+			.setNewLayout(vk::ImageLayout::eGeneral)
+			.setImage(mImage)
+			.setSubresourceRange(vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, mLevelCount - 1, 1, 0, 1));
+	commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader, {}, {}, {}, lastLevelBarrier);
+}
+
+void lune::vulkan::DepthPyramid::createImage()
+{
+	const vk::ImageCreateInfo imageCreateInfo =
+		vk::ImageCreateInfo()
+			.setImageType(vk::ImageType::e2D)
+			.setFormat(vk::Format::eR32Sfloat)
+			.setExtent(vk::Extent3D(mExtent, 1))
+			.setMipLevels(mLevelCount)
+			.setArrayLayers(1)
+			.setSamples(vk::SampleCountFlagBits::e1)
+			.setTiling(vk::ImageTiling::eOptimal)
+			.setUsage(vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eSampled)
+			.setInitialLayout(vk::ImageLayout::eUndefined)
+			.setQueueFamilyIndices(getVulkanContext().queueFamilyIndices)
+			.setSharingMode(vk::SharingMode::eExclusive);
+
+	VmaAllocationCreateInfo vmaAllocCreateInfo{};
+	vmaAllocCreateInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+	VmaAllocationInfo allocInfo{};
+	vmaCreateImage(getVulkanContext().vmaAllocator, reinterpret_cast<const VkImageCreateInfo*>(&imageCreateInfo), &vmaAllocCreateInfo, reinterpret_cast<VkImage*>(&mImage), &mVmaAllocation, &allocInfo);
+}
+
+void lune::vulkan::DepthPyramid::createImageViews()
+{
+	vk::ImageViewCreateInfo imageViewCreateInfo =
+		vk::ImageViewCreateInfo()
+			.setImage(mImage)
+			.setViewType(vk::ImageViewType::e2D)
+			.setFormat(vk::Format::eR32Sfloat)
+			.setComponents(vk::ComponentMapping())
+			.setSubresourceRange(vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, mLevelCount, 0, 1));
+	mImageView = getVulkanContext().device.createImageView(imageViewCreateInfo);
+
+	// storage image views limited to single level
+	mLevelViews.resize(mLevelCount);
+	for (uint32 level = 0; level < mLevelCount; ++level)
+	{
+		imageViewCreateInfo.setSubresourceRange(vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, level, 1, 0, 1));
+		mLevelViews[level] = getVulkanContext().device.createImageView(imageViewCreateInfo);
+	}
+}
+
+void lune::vulkan::DepthPyramid::createDescriptorSets(const DepthImage& depthImage)
+{
+	// texelFetch ignores sampler state, any sampler will do
+	const vk::Sampler sampler = Engine::get()->findSubsystem<VulkanSubsystem>()->findSampler("lune::nearest")->getSampler();
+
+	mCopyDescSets = DescriptorSets::create(mCopyPipeline, 1);
+	mCopyDescSets->setImageInfo("depth", 0, depthImage.getImageView(), sampler, 0, vk::ImageLayout::eDepthStencilReadOnlyOptimal);
+	mCopyDescSets->setImageInfo("destination", 0, mLevelViews[0], nullptr, 0, vk::ImageLayout::eGeneral);
+	mCopyDescSets->updateSet(0, DescriptorSetFrequency::PerFrame);
+
+	// allocation per destination level, first one unused
+	mReduceDescSets = DescriptorSets::create(mReducePipeline, mLevelCount);
+	for (uint32 level = 1; level < mLevelCount; ++level)
+	{
+		mReduceDescSets->setImageInfo("source", level, mLevelViews[level - 1], nullptr, 0, vk::ImageLayout::eGeneral);
+		mReduceDescSets->setImageInfo("destination", level, mLevelViews[level], nullptr, 0, vk::ImageLayout::eGeneral);
+		mReduceDescSets->updateSet(level, DescriptorSetFrequency::PerFrame);
+	}
+}
@@ -0,0 +1,257 @@
+#include "lune/vulkan/descriptor_allocator.hxx"
+
+#include "lune/core/log.hxx"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// sets in first pool, each next persistent pool twice as big up to max
+constexpr uint32 InitialPoolSets = 64;
+constexpr uint32 MaxPoolSets = 4096;
+
+constexpr uint32 TransientPoolSets = 256;
+
+lune::vulkan::DescriptorAllocator& lune::getVulkanDescriptorAllocator() noexcept
+{
+	static vulkan::DescriptorAllocator allocator{};
+	return allocator;
+}
+
+size_t lune::vulkan::DescriptorAllocator::CacheKeyHash::operator()(const CacheKey& key) const noexcept
+{
+	// FNV-1a
+	uint64 hash = 14695981039346656037ULL;
+	for (uint64 value : key)
+	{
+		hash ^= value;
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+void lune::vulkan::DescriptorAllocator::init()
+{
+	// something reasonable until pipelines registered
+	mDescriptorCounts = {
+		{vk::DescriptorType::eUniformBuffer, 2},
+		{vk::DescriptorType::eStorageBuffer, 1},
+		{vk::DescriptorType::eCombinedImageSampler, 4}};
+	mSetCount = 1;
+	mNextPoolSets = InitialPoolSets;
+}
+
+void lune::vulkan::DescriptorAllocator::shutdown()
+{
+	const auto& device = getVulkanContext().device;
+
+	if (!mCache.empty())
+		LN_LOG(Warning, Vulkan::DescriptorAllocator, "{} cached descriptor sets still acquired on shutdown", mCache.size());
+
+	for (auto& pool : mPools)
+		device.destroyDescriptorPool(pool.pool);
+	for (auto pool : mTransientPools)
+		device.destroyDescriptorPool(pool);
+	for (auto pool : mFreeTransientPools)
+		device.destroyDescriptorPool(pool);
+
+	mPools.clear();
+	mTransientPools.clear();
+	mFreeTransientPools.clear();
+	mSetPools.clear();
+	mLayoutSizes.clear();
+	mCache.clear();
+	mCacheKeys.clear();
+}
+
+void lune::vulkan::DescriptorAllocator::addPoolSizes(std::span<const vk::DescriptorPoolSize> poolSizes, uint32 setCount)
+{
+	for (const auto& poolSize : poolSizes)
+		mDescriptorCounts[poolSize.type] += poolSize.descriptorCount;
+	mSetCount += setCount;
+}
+
+void lune::vulkan::DescriptorAllocator::registerLayout(vk::DescriptorSetLayout layout, std::span<const vk::DescriptorPoolSize> layoutSizes)
+{
+	mLayoutSizes[layout].assign(layoutSizes.begin(), layoutSizes.end());
+}
+
+void lune::vulkan::DescriptorAllocator::unregisterLayout(vk::DescriptorSetLayout layout)
+{
+	mLayoutSizes.erase(layout);
+}
+
+vk::DescriptorSet lune::vulkan::DescriptorAllocator::allocate(vk::DescriptorSetLayout layout)
+{
+	vk::DescriptorSet set{};
+
+	// most recent pools most likely to have space
+	for (auto it = mPools.rbegin(); it != mPools.rend(); ++it)
+	{
+		if (it->full)
+			continue;
+
+		if (tryAllocate(it->pool, layout, set))
+		{
+			mSetPools.emplace(set, it->pool);
+			return set;
+		}
+		it->full = true;
+	}
+
+	auto& pool = mPools.emplace_back(Pool{createPool(mNextPoolSets, vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet, layout)});
+	mNextPoolSets = std::min(mNextPoolSets * 2, MaxPoolSets);
+
+	if (!tryAllocate(pool.pool, layout, set))
+	{
+		LN_LOG(Fatal, Vulkan::DescriptorAllocator, "Failed to allocate descriptor set from new pool");
+		return nullptr;
+	}
+	mSetPools.emplace(set, pool.pool);
+	return set;
+}
+
+void lune::vulkan::DescriptorAllocator::free(vk::DescriptorSet set)
+{
+	if (!set)
+		return;
+
+	const auto findRes = mSetPools.find(set);
+	if (findRes == mSetPools.end())
+	{
+		LN_LOG(Error, Vulkan::DescriptorAllocator, "Trying to free descriptor set not allocated by allocator");
+		return;
+	}
+
+	const vk::DescriptorPool pool = findRes->second;
+	getVulkanContext().device.freeDescriptorSets(pool, set);
+	mSetPools.erase(findRes);
+
+	auto poolIt = std::find_if(mPools.begin(), mPools.end(), [pool](const Pool& p)
+		{ return p.pool == pool; });
+	if (poolIt != mPools.end())
+		poolIt->full = false;
+}
+
+vk::DescriptorSet lune::vulkan::DescriptorAllocator::acquire(vk::DescriptorSetLayout layout, vk::DescriptorUpdateTemplate updateTemplate, std::span<const std::byte> data)
+{
+	// descriptor infos made of 64-bit handles and sizes, padded to 8 bytes just in case
+	CacheKey key((data.size() + sizeof(uint64) - 1) / sizeof(uint64) + 1, 0);
+	key[0] = reinterpret_cast<uint64>(static_cast<VkDescriptorSetLayout>(layout));
+	std::memcpy(key.data() + 1, data.data(), data.size());
+
+	if (auto findRes = mCache.find(key); findRes != mCache.end())
+	{
+		++findRes->second.refCount;
+		return findRes->second.set;
+	}
+
+	const vk::DescriptorSet set = allocate(layout);
+	getVulkanContext().device.updateDescriptorSetWithTemplate(set, updateTemplate, data.data());
+
+	mCacheKeys.emplace(set, key);
+	mCache.emplace(std::move(key), CachedSet{set, 1});
+	return set;
+}
+
+void lune::vulkan::DescriptorAllocator::release(vk::DescriptorSet set)
+{
+	const auto keyIt = mCacheKeys.find(set);
+	if (keyIt == mCacheKeys.end())
+	{
+		LN_LOG(Error, Vulkan::DescriptorAllocator, "Trying to release descriptor set not acquired from cache");
+		return;
+	}
+
+	const auto cacheIt = mCache.find(keyIt->second);
+	if (--cacheIt->second.refCount > 0)
+		return;
+
+	mCache.erase(cacheIt);
+	mCacheKeys.erase(keyIt);
+	free(set);
+}
+
+vk::DescriptorSet lune::vulkan::DescriptorAllocator::allocateTransient(vk::DescriptorSetLayout layout)
+{
+	vk::DescriptorSet set{};
+	if (!mTransientPools.empty() && tryAllocate(mTransientPools.back(), layout, set))
+		return set;
+
+	if (!mFreeTransientPools.empty())
+	{
+		mTransientPools.push_back(mFreeTransientPools.back());
+		mFreeTransientPools.pop_back();
+
+		// recycled pool sized for other layout may not fit this one
+		if (tryAllocate(mTransientPools.back(), layout, set))
+			return set;
+	}
+	mTransientPools.push_back(createPool(TransientPoolSets, {}, layout));
+
+	if (!tryAllocate(mTransientPools.back(), layout, set))
+	{
+		LN_LOG(Fatal, Vulkan::DescriptorAllocator, "Failed to allocate transient descriptor set from new pool");
+		return nullptr;
+	}
+	return set;
+}
+
+void lune::vulkan::DescriptorAllocator::resetTransient()
+{
+	for (auto pool : mTransientPools)
+	{
+		getVulkanContext().device.resetDescriptorPool(pool);
+		mFreeTransientPools.push_back(pool);
+	}
+	mTransientPools.clear();
+}
+
+vk::DescriptorPool lune::vulkan::DescriptorAllocator::createPool(uint32 maxSets, vk::DescriptorPoolCreateFlags flags, vk::DescriptorSetLayout layout)
+{
+	std::map<vk::DescriptorType, uint32> typeCounts{};
+	for (const auto& [type, count] : mDescriptorCounts)
+	{
+		const double ratio = static_cast<double>(count) / static_cast<double>(mSetCount);
+		typeCounts[type] = std::max<uint32>(1, static_cast<uint32>(std::ceil(ratio * maxSets)));
+	}
+
+	// average ratio can be below what single big layout needs, pool made for it must fit it
+	if (const auto findRes = mLayoutSizes.find(layout); findRes != mLayoutSizes.end())
+	{
+		for (const auto& layoutSize : findRes->second)
+			typeCounts[layoutSize.type] = std::max(typeCounts[layoutSize.type], layoutSize.descriptorCount);
+	}
+
+	std::vector<vk::DescriptorPoolSize> poolSizes{};
+	poolSizes.reserve(typeCounts.size());
+	for (const auto& [type, count] : typeCounts)
+	{
+		poolSizes.push_back(vk::DescriptorPoolSize()
+				.setType(type)
+				.setDescriptorCount(count));
+	}
+
+	const auto createInfo = vk::DescriptorPoolCreateInfo()
+								.setFlags(flags)
+								.setPoolSizes(poolSizes)
+								.setMaxSets(maxSets);
+
+	return getVulkanContext().device.createDescriptorPool(createInfo);
+}
+
+bool lune::vulkan::DescriptorAllocator::tryAllocate(vk::DescriptorPool pool, vk::DescriptorSetLayout layout, vk::DescriptorSet& outSet)
+{
+	const auto allocInfo = vk::DescriptorSetAllocateInfo()
+							   .setDescriptorPool(pool)
+							   .setSetLayouts(layout);
+
+	const vk::Result result = getVulkanContext().device.allocateDescriptorSets(&allocInfo, &outSet);
+	if (result == vk::Result::eSuccess)
+		return true;
+
+	if (result != vk::Result::eErrorOutOfPoolMemory && result != vk::Result::eErrorFragmentedPool)
+		LN_LOG(Fatal, Vulkan::DescriptorAllocator, "Failed to allocate descriptor set: {}", vk::to_string(result));
+
+	return false;
+}
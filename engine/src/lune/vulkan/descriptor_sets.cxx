@@ -1,9 +1,12 @@
 #include "lune/vulkan/descriptor_sets.hxx"
 
 #include "lune/core/log.hxx"
+#include "lune/vulkan/descriptor_allocator.hxx"
 #include "lune/vulkan/pipeline.hxx"
 
-lune::vulkan::DescriptorSets::DescriptorSets(SharedGraphicsPipeline pipeline, uint32 maxSets)
+#include <span>
+
+lune::vulkan::DescriptorSets::DescriptorSets(SharedPipeline pipeline, uint32 maxSets)
 	: DescriptorSets()
 {
 	mPipeline = pipeline;
@@ -12,15 +15,19 @@ lune::vulkan::DescriptorSets::DescriptorSets(SharedGraphicsPipeline pipeline, ui
 
 lune::vulkan::DescriptorSets::~DescriptorSets()
 {
-	const auto cleanDescPoolLam = [descPool = mDescriptorPool]() -> bool
+	const auto releaseSetsLam = [sets = mDescriptorSets, transientSets = mTransientSets]() -> bool
 	{
-		getVulkanContext().device.destroyDescriptorPool(descPool);
+		for (size_t i = 0; i < sets.size(); ++i)
+		{
+			if (sets[i] && !transientSets[i])
+				getVulkanDescriptorAllocator().release(sets[i]);
+		}
 		return true;
 	};
-	getVulkanDeleteQueue().push(cleanDescPoolLam);
+	getVulkanDeleteQueue().push(releaseSetsLam);
 }
 
-lune::vulkan::UniqueDescriptorSets lune::vulkan::DescriptorSets::create(SharedGraphicsPipeline pipeline, uint32 maxSets)
+lune::vulkan::UniqueDescriptorSets lune::vulkan::DescriptorSets::create(SharedPipeline pipeline, uint32 maxSets)
 {
 	auto newDescSets = std::make_unique<DescriptorSets>(pipeline, maxSets);
 	newDescSets->init();
@@ -29,112 +36,137 @@ lune::vulkan::UniqueDescriptorSets lune::vulkan::DescriptorSets::create(SharedGr
 
 void lune::vulkan::DescriptorSets::init()
 {
-	mBufferInfos.resize(mMaxAllocations);
-	mImageInfos.resize(mMaxAllocations);
+	const uint32 setCount = mPipeline->getDescriptorLayouts().size();
+	const auto& infoCounts = mPipeline->getDescriptorInfoCounts();
 
-	createDescriptorPool();
-	allocateDescriptorSets();
+	mDescriptorInfos.resize(setCount * mMaxAllocations);
+	for (uint32 i = 0; i < mDescriptorInfos.size(); ++i)
+		mDescriptorInfos[i].resize(infoCounts[i % setCount], DescriptorInfo{});
+
+	mDescriptorSets.resize(setCount * mMaxAllocations);
+	mTransientSets.resize(setCount * mMaxAllocations);
 }
 
-void lune::vulkan::DescriptorSets::setBufferInfo(std::string_view name, uint32 allocId, vk::Buffer buffer, vk::DeviceSize offset, vk::DeviceSize range)
+void lune::vulkan::DescriptorSets::setBufferInfo(uint32 slot, uint32 allocId, vk::Buffer buffer, vk::DeviceSize offset, vk::DeviceSize range)
 {
-	auto bufferInfo = vk::DescriptorBufferInfo()
-						  .setBuffer(buffer)
-						  .setOffset(offset)
-						  .setRange(range);
-	mBufferInfos[allocId].insert_or_assign(std::string(name), std::move(bufferInfo));
+	const auto& bindingSlot = mPipeline->getBindingSlots()[slot];
+	auto& info = mDescriptorInfos[allocId * mPipeline->getDescriptorLayouts().size() + bindingSlot.set][bindingSlot.infoOffset];
+	info.buffer = vk::DescriptorBufferInfo()
+					  .setBuffer(buffer)
+					  .setOffset(offset)
+					  .setRange(range);
 }
 
-void lune::vulkan::DescriptorSets::setImageInfo(std::string_view name, uint32 allocId, vk::ImageView imageView, vk::Sampler sampler, uint32 dstArrayElem)
+void lune::vulkan::DescriptorSets::setImageInfo(uint32 slot, uint32 allocId, vk::ImageView imageView, vk::Sampler sampler, uint32 dstArrayElem, vk::ImageLayout layout)
 {
-	auto imageInfo = vk::DescriptorImageInfo()
-						 .setImageLayout(vk::ImageLayout::eShaderReadOnlyOptimal)
-						 .setImageView(imageView)
-						 .setSampler(sampler);
-	auto [it, res] = mImageInfos[allocId].try_emplace(std::string(name));
-	it->second.insert_or_assign(dstArrayElem, std::move(imageInfo));
+	const auto& bindingSlot = mPipeline->getBindingSlots()[slot];
+	if (dstArrayElem >= bindingSlot.count)
+	{
+		LN_LOG(Error, Vulkan::DescriptorSets, "Array element {} out of range of binding {} (count {})", dstArrayElem, bindingSlot.binding, bindingSlot.count);
+		return;
+	}
+
+	auto& info = mDescriptorInfos[allocId * mPipeline->getDescriptorLayouts().size() + bindingSlot.set][bindingSlot.infoOffset + dstArrayElem];
+	info.image = vk::DescriptorImageInfo()
+					 .setImageLayout(layout)
+					 .setImageView(imageView)
+					 .setSampler(sampler);
 }
 
-void lune::vulkan::DescriptorSets::updateSets(uint32 index)
+void lune::vulkan::DescriptorSets::setBufferInfo(std::string_view name, uint32 allocId, vk::Buffer buffer, vk::DeviceSize offset, vk::DeviceSize range)
 {
-	const uint32 descriptorSetOffset = mPipeline->getDescriptorLayouts().size() * index;
+	const uint32 slot = mPipeline->findBindingSlot(name);
+	if (slot == Pipeline::InvalidBindingSlot)
+	{
+		LN_LOG(Error, Vulkan::DescriptorSets, "Binding {} not found in pipeline", name);
+		return;
+	}
+	setBufferInfo(slot, allocId, buffer, offset, range);
+}
 
-	std::vector<vk::WriteDescriptorSet> writes;
+void lune::vulkan::DescriptorSets::setImageInfo(std::string_view name, uint32 allocId, vk::ImageView imageView, vk::Sampler sampler, uint32 dstArrayElem, vk::ImageLayout layout)
+{
+	const uint32 slot = mPipeline->findBindingSlot(name);
+	if (slot == Pipeline::InvalidBindingSlot)
+	{
+		LN_LOG(Error, Vulkan::DescriptorSets, "Binding {} not found in pipeline", name);
+		return;
+	}
+	setImageInfo(slot, allocId, imageView, sampler, dstArrayElem, layout);
+}
 
-	const auto createWritesLam = [&](const SpvReflectShaderModule refl)
+void lune::vulkan::DescriptorSets::updateSets(uint32 allocId)
+{
+	const uint32 setCount = mPipeline->getDescriptorLayouts().size();
+	for (uint32 i = 0; i < setCount; ++i)
+		updateSet(allocId, static_cast<DescriptorSetFrequency>(i));
+}
+
+void lune::vulkan::DescriptorSets::updateSet(uint32 allocId, DescriptorSetFrequency set)
+{
+	const uint32 setIndex = static_cast<uint32>(set);
+	const auto& layouts = mPipeline->getDescriptorLayouts();
+	const auto& templates = mPipeline->getDescriptorUpdateTemplates();
+	if (setIndex >= layouts.size() || !templates[setIndex])
+		return;
+
+	const uint32 index = allocId * layouts.size() + setIndex;
+
+	// identical sets shared through allocator cache, previous set released once frames using it completed
+	auto& descSet = mDescriptorSets[index];
+	const vk::DescriptorSet newSet = getVulkanDescriptorAllocator().acquire(layouts[setIndex], templates[setIndex], std::as_bytes(std::span(mDescriptorInfos[index])));
+	if (descSet && !mTransientSets[index])
 	{
-		for (uint32 i = 0; i < refl.descriptor_set_count; i++)
-		{
-			const auto& reflDescSet = refl.descriptor_sets[i];
-			for (uint32 k = 0; k < reflDescSet.binding_count; k++)
+		getVulkanDeleteQueue().push([oldSet = descSet]() -> bool
 			{
-				const auto& reflBinding = refl.descriptor_bindings[k];
-
-				vk::WriteDescriptorSet write = vk::WriteDescriptorSet()
-												   .setDstSet(mDescriptorSets[reflDescSet.set + descriptorSetOffset])
-												   .setDstBinding(reflBinding.binding)
-												   .setDstArrayElement(0)
-												   .setDescriptorCount(reflBinding.count)
-												   .setDescriptorType(static_cast<vk::DescriptorType>(reflBinding.descriptor_type));
-
-				if (write.descriptorType == vk::DescriptorType::eUniformBuffer)
-				{
-					write.setBufferInfo(mBufferInfos[index].at(reflBinding.name));
-					writes.emplace_back(write);
-				}
-				else if (write.descriptorType == vk::DescriptorType::eCombinedImageSampler)
-				{
-					const auto& images = mImageInfos[index].at(reflBinding.name);
-					for (const auto& [elem, image] : images)
-					{
-						write.setImageInfo(image);
-						write.setDstArrayElement(elem);
-						writes.emplace_back(write);
-					}
-				}
-				else
-				{
-					LN_LOG(Fatal, Vulkan::DescriptorSets, "Type {} - not supported", static_cast<int32>(write.descriptorType))
-				}
-			}
-		}
-	};
-
-	createWritesLam(mPipeline->getVertShader()->getReflectModule());
-	createWritesLam(mPipeline->getFragShader()->getReflectModule());
+				getVulkanDescriptorAllocator().release(oldSet);
+				return true;
+			});
+	}
+	descSet = newSet;
+	mTransientSets[index] = false;
+}
 
-	getVulkanContext().device.updateDescriptorSets(writes, {});
+void lune::vulkan::DescriptorSets::updateTransientSet(uint32 allocId, DescriptorSetFrequency set)
+{
+	const uint32 setIndex = static_cast<uint32>(set);
+	const auto& layouts = mPipeline->getDescriptorLayouts();
+	const auto& templates = mPipeline->getDescriptorUpdateTemplates();
+	if (setIndex >= layouts.size() || !templates[setIndex])
+		return;
+
+	const uint32 index = allocId * layouts.size() + setIndex;
+
+	// written every frame anyway, hashing infos for cache lookup would cost more than plain write
+	auto& descSet = mDescriptorSets[index];
+	const vk::DescriptorSet newSet = getVulkanDescriptorAllocator().allocateTransient(layouts[setIndex]);
+	getVulkanContext().device.updateDescriptorSetWithTemplate(newSet, templates[setIndex], mDescriptorInfos[index].data());
+	if (descSet && !mTransientSets[index])
+	{
+		getVulkanDeleteQueue().push([oldSet = descSet]() -> bool
+			{
+				getVulkanDescriptorAllocator().release(oldSet);
+				return true;
+			});
+	}
+	descSet = newSet;
+	mTransientSets[index] = true;
 }
 
 void lune::vulkan::DescriptorSets::cmdBind(vk::CommandBuffer commandBuffer, uint32 offsetSets)
 {
 	uint32 count = mPipeline->getDescriptorLayouts().size();
-	commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, mPipeline->getPipelineLayout(), 0, count, mDescriptorSets.data() + offsetSets, 0, nullptr);
+	commandBuffer.bindDescriptorSets(mPipeline->getBindPoint(), mPipeline->getPipelineLayout(), 0, count, mDescriptorSets.data() + offsetSets, 0, nullptr);
 }
 
-void lune::vulkan::DescriptorSets::createDescriptorPool()
+void lune::vulkan::DescriptorSets::cmdBind(vk::CommandBuffer commandBuffer, uint32 allocId, DescriptorSetFrequency set)
 {
-	const auto& poolSizes = mPipeline->getDescriptorPoolSizes();
-	const uint32 maxSets = mPipeline->getDescriptorLayouts().size() * mMaxAllocations;
-
-	const vk::DescriptorPoolCreateInfo createInfo = vk::DescriptorPoolCreateInfo()
-														.setFlags(vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet)
-														.setPoolSizes(poolSizes)
-														.setMaxSets(maxSets);
-
-	mDescriptorPool = getVulkanContext().device.createDescriptorPool(createInfo);
+	const uint32 setIndex = static_cast<uint32>(set);
+	const vk::DescriptorSet descSet = getDescriptorSet(allocId, set);
+	commandBuffer.bindDescriptorSets(mPipeline->getBindPoint(), mPipeline->getPipelineLayout(), setIndex, 1, &descSet, 0, nullptr);
 }
 
-void lune::vulkan::DescriptorSets::allocateDescriptorSets()
+vk::DescriptorSet lune::vulkan::DescriptorSets::getDescriptorSet(uint32 allocId, DescriptorSetFrequency set) const
 {
-	const auto& Layouts = mPipeline->getDescriptorLayouts();
-	for (uint32 i = 0; i < mMaxAllocations; ++i)
-	{
-		vk::DescriptorSetAllocateInfo allocInfo = vk::DescriptorSetAllocateInfo()
-													  .setDescriptorPool(mDescriptorPool)
-													  .setSetLayouts(Layouts);
-
-		auto newSets = getVulkanContext().device.allocateDescriptorSets(allocInfo);
-		std::move(newSets.begin(), newSets.end(), std::back_inserter(mDescriptorSets));
-	}
+	return mDescriptorSets[allocId * mPipeline->getDescriptorLayouts().size() + static_cast<uint32>(set)];
 }
@@ -52,6 +52,7 @@ void lune::vulkan::MsaaImage::createImage(vk::Extent2D extent)
 
 	VmaAllocationCreateInfo vmaAllocCreateInfo{};
 	vmaAllocCreateInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+	vmaAllocCreateInfo.flags = VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT;
 	VmaAllocationInfo allocInfo{};
 	vmaCreateImage(getVulkanContext().vmaAllocator, reinterpret_cast<const VkImageCreateInfo*>(&imageCreateInfo), &vmaAllocCreateInfo, reinterpret_cast<VkImage*>(&mImage), &mVmaAllocation, &allocInfo);
 }
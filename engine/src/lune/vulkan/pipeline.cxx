@@ -1,8 +1,13 @@
 #include "lune/vulkan/pipeline.hxx"
 
 #include "lune/core/log.hxx"
+#include "lune/vulkan/bindless_heap.hxx"
+#include "lune/vulkan/descriptor_allocator.hxx"
+#include "lune/vulkan/descriptor_sets.hxx"
 #include "lune/vulkan/vulkan_subsystem.hxx"
 
+#include <algorithm>
+#include <map>
 #include <utility>
 #include <vulkan/vulkan_enums.hpp>
 
@@ -61,7 +66,7 @@ const vk::PipelineDepthStencilStateCreateInfo& lune::vulkan::GraphicsPipeline::d
 	return state;
 }
 
-lune::vulkan::GraphicsPipeline::~GraphicsPipeline()
+lune::vulkan::Pipeline::~Pipeline()
 {
 	const auto cleanPipelineLam = [pipeline = mPipeline, pipelineLayout = mPipelineLayout]() -> bool
 	{
@@ -69,11 +74,24 @@ lune::vulkan::GraphicsPipeline::~GraphicsPipeline()
 		getVulkanContext().device.destroyPipelineLayout(pipelineLayout);
 		return true;
 	};
-	const auto cleanDescriptorLayouts = [layouts = mDescriptorSetLayouts]() -> bool
+	auto layouts = mDescriptorSetLayouts;
+	if (mBindless && layouts.size() > BindlessHeap::SetIndex)
+		layouts[BindlessHeap::SetIndex] = nullptr;
+
+	const auto cleanDescriptorLayouts = [layouts = std::move(layouts), templates = mDescriptorUpdateTemplates]() -> bool
 	{
+		for (const auto& updateTemplate : templates)
+		{
+			if (updateTemplate)
+				getVulkanContext().device.destroyDescriptorUpdateTemplate(updateTemplate);
+		}
 		for (const auto& layout : layouts)
 		{
-			getVulkanContext().device.destroyDescriptorSetLayout(layout);
+			if (layout)
+			{
+				getVulkanDescriptorAllocator().unregisterLayout(layout);
+				getVulkanContext().device.destroyDescriptorSetLayout(layout);
+			}
 		}
 		return true;
 	};
@@ -121,30 +139,60 @@ vk::PipelineShaderStageCreateInfo reflShaderStage(const std::shared_ptr<lune::vu
 		.setPName(shader->getReflectModule().entry_point_name);
 }
 
-std::vector<std::vector<vk::DescriptorSetLayoutBinding>> relfDescriptorSetBindings(const SpvReflectShaderModule& reflModule)
+// ids shared by graphics and compute pipelines
+uint32 makePipelineId()
 {
-	std::vector<std::vector<vk::DescriptorSetLayoutBinding>> result{reflModule.descriptor_set_count, std::vector<vk::DescriptorSetLayoutBinding>()};
+	static uint32 nextId{};
+	return nextId++;
+}
 
+// FNV-1a over raw bytes, chained with previous hash
+uint64 hashBytes(uint64 hash, const void* data, size_t size)
+{
+	const auto bytes = static_cast<const uint8*>(data);
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+struct ReflDescriptorBinding
+{
+	vk::DescriptorSetLayoutBinding binding{};
+	std::string name{};
+};
+
+// bindings of shader merged into sets (by set index) and bindings (by binding index), stages of matching bindings combined
+void reflDescriptorSetBindings(const SpvReflectShaderModule& reflModule, std::map<uint32, std::map<uint32, ReflDescriptorBinding>>& outSets)
+{
 	for (uint32 i = 0; i < reflModule.descriptor_set_count; i++)
 	{
 		const auto& reflSet = reflModule.descriptor_sets[i];
-		auto& set = result[i];
+		auto& set = outSets[reflSet.set];
 
-		set = std::vector<vk::DescriptorSetLayoutBinding>(reflSet.binding_count, vk::DescriptorSetLayoutBinding());
 		for (uint32 k = 0; k < reflSet.binding_count; k++)
 		{
-			const auto& reflBinding = reflModule.descriptor_bindings[k];
-			auto& binding = set[k];
-
-			binding = vk::DescriptorSetLayoutBinding()
-						  .setBinding(reflBinding.binding)
-						  .setDescriptorType(static_cast<vk::DescriptorType>(reflBinding.descriptor_type))
-						  .setDescriptorCount(reflBinding.count)
-						  .setStageFlags(static_cast<vk::ShaderStageFlagBits>(reflModule.shader_stage));
+			const auto& reflBinding = *reflSet.bindings[k];
+			const auto stage = static_cast<vk::ShaderStageFlagBits>(reflModule.shader_stage);
+
+			auto [it, inserted] = set.try_emplace(reflBinding.binding);
+			auto& binding = it->second;
+			if (!inserted)
+			{
+				binding.binding.stageFlags |= stage;
+				continue;
+			}
+
+			binding.name = reflBinding.name;
+			binding.binding = vk::DescriptorSetLayoutBinding()
+								  .setBinding(reflBinding.binding)
+								  .setDescriptorType(static_cast<vk::DescriptorType>(reflBinding.descriptor_type))
+								  .setDescriptorCount(reflBinding.count)
+								  .setStageFlags(stage);
 		}
 	}
-
-	return result;
 }
 
 std::vector<vk::PushConstantRange> reflPushConstantRanges(const SpvReflectShaderModule& reflModule)
@@ -191,65 +239,169 @@ lune::vulkan::SharedGraphicsPipeline lune::vulkan::GraphicsPipeline::create(std:
 
 void lune::vulkan::GraphicsPipeline::init(std::shared_ptr<Shader> vertShader, std::shared_ptr<Shader> fragShader, const StatesOverride& statesOverride)
 {
+	mId = makePipelineId();
+	mBindPoint = vk::PipelineBindPoint::eGraphics;
+
 	mVertShader = vertShader;
 	mFragShader = fragShader;
 
-	createDescriptorLayoutsAndPoolSizes();
-	createPipelineLayout();
+	createDescriptorLayoutsAndPoolSizes({mVertShader, mFragShader}, statesOverride.bindless);
+	createPipelineLayout({mVertShader, mFragShader});
 	createPipeline(statesOverride);
 }
 
-void lune::vulkan::GraphicsPipeline::cmdBind(vk::CommandBuffer commandBuffer)
+lune::vulkan::SharedComputePipeline lune::vulkan::ComputePipeline::create(std::shared_ptr<Shader> compShader, bool bindless)
 {
-	commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, mPipeline);
+	if (!compShader || compShader->getReflectModule().shader_stage != SpvReflectShaderStageFlagBits::SPV_REFLECT_SHADER_STAGE_COMPUTE_BIT)
+	{
+		LN_LOG(Fatal, Vulkan::Pipeline, "Failed to initialize pipeline: compute shader invalid");
+		return nullptr;
+	}
+
+	auto newPipeline = std::make_shared<ComputePipeline>();
+	newPipeline->init(compShader, bindless);
+	return std::move(newPipeline);
 }
 
-void lune::vulkan::GraphicsPipeline::createDescriptorLayoutsAndPoolSizes()
+void lune::vulkan::ComputePipeline::init(std::shared_ptr<Shader> compShader, bool bindless)
 {
-	std::vector<std::vector<vk::DescriptorSetLayoutBinding>> totalBindings{};
-	{
-		const auto shaderBinds = relfDescriptorSetBindings(mVertShader->getReflectModule());
-		std::move(shaderBinds.begin(), shaderBinds.end(), std::back_inserter(totalBindings));
-	}
+	mId = makePipelineId();
+	mBindPoint = vk::PipelineBindPoint::eCompute;
+
+	mCompShader = compShader;
+
+	createDescriptorLayoutsAndPoolSizes({mCompShader}, bindless);
+	createPipelineLayout({mCompShader});
+	createPipeline();
+}
+
+void lune::vulkan::ComputePipeline::createPipeline()
+{
+	const auto pipelineCreateInfo = vk::ComputePipelineCreateInfo()
+										.setStage(reflShaderStage(mCompShader))
+										.setLayout(mPipelineLayout);
+
+	const auto createResult = getVulkanContext().device.createComputePipeline(nullptr, pipelineCreateInfo);
+	if (createResult.result != vk::Result::eSuccess)
 	{
-		const auto shaderBinds = relfDescriptorSetBindings(mFragShader->getReflectModule());
-		std::move(shaderBinds.begin(), shaderBinds.end(), std::back_inserter(totalBindings));
+		LN_LOG(Fatal, Vulkan::Pipeline, "Failed to create compute pipeline: {}", vk::to_string(createResult.result));
 	}
+	mPipeline = createResult.value;
+}
+
+void lune::vulkan::Pipeline::cmdBind(vk::CommandBuffer commandBuffer)
+{
+	commandBuffer.bindPipeline(mBindPoint, mPipeline);
+}
+
+uint32 lune::vulkan::Pipeline::findBindingSlot(std::string_view name) const
+{
+	const auto findRes = mBindingNames.find(name);
+	return findRes != mBindingNames.end() ? findRes->second : InvalidBindingSlot;
+}
+
+void lune::vulkan::Pipeline::createDescriptorLayoutsAndPoolSizes(const std::vector<SharedShader>& shaders, bool bindless)
+{
+	mBindless = bindless;
+
+	std::map<uint32, std::map<uint32, ReflDescriptorBinding>> sets{};
+	for (const auto& shader : shaders)
+		reflDescriptorSetBindings(shader->getReflectModule(), sets);
 
 	std::map<vk::DescriptorType, uint32> descriptorTypesCount{};
 
-	for (const auto& bindings : totalBindings)
+	// set indices from shaders used as is, gaps filled with empty layouts
+	uint32 setCount = sets.empty() ? 0 : sets.rbegin()->first + 1;
+	if (mBindless)
+		setCount = std::max(setCount, BindlessHeap::SetIndex + 1);
+
+	for (uint32 setIndex = 0; setIndex < setCount; ++setIndex)
 	{
+		if (mBindless && setIndex == BindlessHeap::SetIndex)
+		{
+			const vk::DescriptorSetLayout heapLayout = mDescriptorSetLayouts.emplace_back(getVulkanBindlessHeap().getDescriptorSetLayout());
+			mDescriptorUpdateTemplates.push_back(nullptr);
+			mDescriptorInfoCounts.push_back(0);
+			mSetCompatibilityHashes.push_back(reinterpret_cast<uint64>(static_cast<VkDescriptorSetLayout>(heapLayout)));
+			continue;
+		}
+
+		std::vector<vk::DescriptorSetLayoutBinding> bindings{};
+		std::vector<vk::DescriptorUpdateTemplateEntry> templateEntries{};
+		uint32 infoCount{};
+		uint64 setHash = 14695981039346656037ULL;
+
+		if (auto findRes = sets.find(setIndex); findRes != sets.end())
+		{
+			for (const auto& [bindingIndex, reflBinding] : findRes->second)
+			{
+				const auto& binding = bindings.emplace_back(reflBinding.binding);
+
+				const std::array<uint32, 4> bindingDesc{binding.binding, static_cast<uint32>(binding.descriptorType), binding.descriptorCount, static_cast<uint32>(binding.stageFlags)};
+				setHash = hashBytes(setHash, bindingDesc.data(), sizeof(bindingDesc));
+
+				mBindingNames.emplace(reflBinding.name, static_cast<uint32>(mBindingSlots.size()));
+				mBindingSlots.push_back(BindingSlot{setIndex, binding.binding, binding.descriptorType, binding.descriptorCount, infoCount});
+
+				templateEntries.push_back(vk::DescriptorUpdateTemplateEntry()
+						.setDstBinding(binding.binding)
+						.setDstArrayElement(0)
+						.setDescriptorCount(binding.descriptorCount)
+						.setDescriptorType(binding.descriptorType)
+						.setOffset(infoCount * sizeof(DescriptorInfo))
+						.setStride(sizeof(DescriptorInfo)));
+
+				infoCount += binding.descriptorCount;
+
+				const auto [it, result] = descriptorTypesCount.try_emplace(binding.descriptorType, 0);
+				auto& [type, count] = *it;
+				count += binding.descriptorCount;
+			}
+		}
+
 		const auto layoutCreateInfo = vk::DescriptorSetLayoutCreateInfo()
 										  .setBindings(bindings);
+		const vk::DescriptorSetLayout layout = mDescriptorSetLayouts.emplace_back(getVulkanContext().device.createDescriptorSetLayout(layoutCreateInfo));
 
-		mDescriptorSetLayouts.push_back(getVulkanContext().device.createDescriptorSetLayout(layoutCreateInfo));
-
+		std::map<vk::DescriptorType, uint32> layoutTypesCount{};
 		for (const auto& binding : bindings)
+			layoutTypesCount[binding.descriptorType] += binding.descriptorCount;
+
+		std::vector<vk::DescriptorPoolSize> layoutSizes{};
+		for (auto [type, count] : layoutTypesCount)
+			layoutSizes.push_back(vk::DescriptorPoolSize().setType(type).setDescriptorCount(count));
+		getVulkanDescriptorAllocator().registerLayout(layout, layoutSizes);
+
+		vk::DescriptorUpdateTemplate updateTemplate{};
+		if (!templateEntries.empty())
 		{
-			const auto [it, result] = descriptorTypesCount.try_emplace(binding.descriptorType, 0);
-			auto& [type, count] = *it;
-			count += binding.descriptorCount;
+			const auto templateCreateInfo = vk::DescriptorUpdateTemplateCreateInfo()
+												.setTemplateType(vk::DescriptorUpdateTemplateType::eDescriptorSet)
+												.setDescriptorSetLayout(layout)
+												.setDescriptorUpdateEntries(templateEntries);
+			updateTemplate = getVulkanContext().device.createDescriptorUpdateTemplate(templateCreateInfo);
 		}
+		mDescriptorUpdateTemplates.push_back(updateTemplate);
+		mDescriptorInfoCounts.push_back(infoCount);
+		mSetCompatibilityHashes.push_back(setHash);
 	}
 
 	for (auto [type, count] : descriptorTypesCount)
 	{
 		mPoolSizes.push_back(vk::DescriptorPoolSize()
 				.setType(type)
-				.setDescriptorCount(count)); // might be missing * 2!
+				.setDescriptorCount(count));
 	}
+
+	getVulkanDescriptorAllocator().addPoolSizes(mPoolSizes, mDescriptorSetLayouts.size());
 }
 
-void lune::vulkan::GraphicsPipeline::createPipelineLayout()
+void lune::vulkan::Pipeline::createPipelineLayout(const std::vector<SharedShader>& shaders)
 {
 	std::vector<vk::PushConstantRange> pushConstantRanges{};
+	for (const auto& shader : shaders)
 	{
-		const auto shaderRanges = reflPushConstantRanges(mVertShader->getReflectModule());
-		std::move(shaderRanges.begin(), shaderRanges.end(), std::back_inserter(pushConstantRanges));
-	}
-	{
-		const auto shaderRanges = reflPushConstantRanges(mFragShader->getReflectModule());
+		const auto shaderRanges = reflPushConstantRanges(shader->getReflectModule());
 		std::move(shaderRanges.begin(), shaderRanges.end(), std::back_inserter(pushConstantRanges));
 	}
 
@@ -259,6 +411,19 @@ void lune::vulkan::GraphicsPipeline::createPipelineLayout()
 			.setPushConstantRanges(pushConstantRanges);
 
 	mPipelineLayout = getVulkanContext().device.createPipelineLayout(pipelineLayoutCreateInfo);
+
+	// layouts compatible for set N only when push constants and all sets up to N match
+	uint64 hash = 14695981039346656037ULL;
+	for (const auto& range : pushConstantRanges)
+	{
+		const std::array<uint32, 3> rangeDesc{static_cast<uint32>(range.stageFlags), range.offset, range.size};
+		hash = hashBytes(hash, rangeDesc.data(), sizeof(rangeDesc));
+	}
+	for (auto& setHash : mSetCompatibilityHashes)
+	{
+		hash = hashBytes(hash, &setHash, sizeof(setHash));
+		setHash = hash;
+	}
 }
 
 void lune::vulkan::GraphicsPipeline::createPipeline(const StatesOverride& statesOverride)
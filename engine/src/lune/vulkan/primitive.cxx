@@ -9,28 +9,54 @@ lune::vulkan::SharedPrimitive lune::vulkan::Primitive::create(const void* vertDa
 	return std::move(newPrimitive);
 }
 
+lune::vulkan::SharedPrimitive lune::vulkan::Primitive::createInBuffers(uint32 vertCount, uint32 vertSizeof, SharedBuffer vertBuffer, uint32 vertOffset, uint32 indxCount, uint32 indxSizeof, SharedBuffer indxBuffer, uint32 indxOffset, UploadTicket uploadTicket)
+{
+	auto newPrimitive = std::make_shared<Primitive>();
+	newPrimitive->mVertexBuffer = std::move(vertBuffer);
+	newPrimitive->mVerticiesOffset = vertOffset;
+	if (indxCount)
+	{
+		newPrimitive->mIndexBuffer = std::move(indxBuffer);
+		newPrimitive->mIndicesOffset = indxOffset;
+	}
+	newPrimitive->initLayout(vertCount, vertSizeof, indxCount, indxSizeof);
+	newPrimitive->mUploadTicket = uploadTicket;
+	return std::move(newPrimitive);
+}
+
 void lune::vulkan::Primitive::init(const void* vertData, uint32 vertDataSize, uint32 vertSize, const void* indexData, uint32 indexDataSize, uint32 indexSize)
 {
-	mVerticiesSize = vertDataSize * vertSize;
-	mVerticiesCount = mVerticiesSize / vertSize;
-	mVerticiesSizeof = vertSize;
+	initLayout(vertDataSize, vertSize, indexDataSize, indexSize);
 
 	constexpr vk::BufferUsageFlags vertexBufferUsageBits = vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eTransferDst;
 	if (!mVertexBuffer)
 		mVertexBuffer = Buffer::create(vertexBufferUsageBits, mVerticiesSize, VmaMemoryUsage::VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, {});
-	mVertexBuffer->copyTransfer(vertData, mVerticiesOffset, mVerticiesSize);
+	mUploadTicket = mVertexBuffer->copyTransfer(vertData, mVerticiesOffset, mVerticiesSize);
 
-	mIndicesSize = indexDataSize * indexSize;
 	if (mIndicesSize)
 	{
-		mIndicesCount = mIndicesSize / indexSize;
-		mIndicesType = indexSize == sizeof(uint32) ? vk::IndexType::eUint32 : vk::IndexType::eUint16;
-		mIndicesSizeof = indexSize;
-
 		constexpr vk::BufferUsageFlags indexBufferUsageBits = vk::BufferUsageFlagBits::eIndexBuffer | vk::BufferUsageFlagBits::eTransferDst;
 		if (!mIndexBuffer)
-			mIndexBuffer = Buffer::create(indexBufferUsageBits, mVerticiesSize, VmaMemoryUsage::VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, {});
-		mIndexBuffer->copyTransfer(indexData, mIndicesOffset, mIndicesSize);
+			mIndexBuffer = Buffer::create(indexBufferUsageBits, mIndicesSize, VmaMemoryUsage::VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, {});
+		mUploadTicket = mIndexBuffer->copyTransfer(indexData, mIndicesOffset, mIndicesSize);
+	}
+}
+
+void lune::vulkan::Primitive::initLayout(uint32 vertCount, uint32 vertSize, uint32 indexCount, uint32 indexSize)
+{
+	static uint32 nextId{};
+	mId = nextId++;
+
+	mVerticiesSize = vertCount * vertSize;
+	mVerticiesCount = vertCount;
+	mVerticiesSizeof = vertSize;
+
+	mIndicesSize = indexCount * indexSize;
+	if (mIndicesSize)
+	{
+		mIndicesCount = indexCount;
+		mIndicesType = indexSize == sizeof(uint32) ? vk::IndexType::eUint32 : vk::IndexType::eUint16;
+		mIndicesSizeof = indexSize;
 	}
 }
 
@@ -55,4 +81,11 @@ void lune::vulkan::Primitive::cmdDraw(vk::CommandBuffer commandBuffer, uint32 in
 	{
 		commandBuffer.draw(mVerticiesCount, instanceCount, mVerticiesOffset / mVerticiesSizeof, firstInstance);
 	}
-}
\ No newline at end of file
+}
+
+void lune::vulkan::Primitive::setBounds(const BoundingBox& box, const BoundingSphere& sphere)
+{
+	mHasBounds = true;
+	mBoundingBox = box;
+	mBoundingSphere = sphere;
+}
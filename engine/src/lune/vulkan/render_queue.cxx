@@ -0,0 +1,208 @@
+#include "lune/vulkan/render_queue.hxx"
+
+#include "lune/vulkan/pipeline.hxx"
+#include "lune/vulkan/primitive.hxx"
+
+#include <algorithm>
+#include <bit>
+
+// top 16 bits of positive float keep its order, precision relative to value
+static uint64 quantizeDepth(float depth)
+{
+	return std::bit_cast<uint32>(std::max(depth, 0.f)) >> 16;
+}
+
+uint64 lune::vulkan::RenderQueue::makeSortKey(RenderLayer layer, uint32 pipelineId, uint32 materialId, uint32 meshId, float depth)
+{
+	const uint64 layerBits = static_cast<uint64>(layer) & 0xF;
+	const uint64 pipelineBits = pipelineId & 0xFFF;
+	const uint64 materialBits = materialId & 0xFFFF;
+	const uint64 meshBits = meshId & 0xFFFF;
+	const uint64 depthBits = quantizeDepth(depth);
+
+	if (layer == RenderLayer::Transparent)
+		return layerBits << 60 | (0xFFFF - depthBits) << 44 | pipelineBits << 32 | materialBits << 16 | meshBits;
+
+	return layerBits << 60 | pipelineBits << 48 | materialBits << 32 | meshBits << 16 | depthBits;
+}
+
+void lune::vulkan::RenderQueue::submit(uint64 sortKey, const RenderPacket& packet)
+{
+	mSortItems.push_back(SortItem{sortKey, static_cast<uint32>(mPackets.size())});
+	mPackets.push_back(packet);
+}
+
+void lune::vulkan::RenderQueue::submitPassBreak(std::function<void(vk::CommandBuffer)> commands)
+{
+	mPassBreaks.push_back(std::move(commands));
+}
+
+void lune::vulkan::RenderQueue::execute(vk::CommandBuffer commandBuffer, const std::function<void()>& endPass, const std::function<void()>& resumePass)
+{
+	mStats = RenderQueueStats();
+	mStats.packets = mPackets.size();
+
+	sort();
+
+	GraphicsPipeline* boundPipeline{};
+	std::array<vk::DescriptorSet, RenderPacket::MaxDescriptorSets> boundSets{};
+	std::array<uint64, RenderPacket::MaxDescriptorSets> boundSetHashes{};
+	vk::Buffer boundVertexBuffer{};
+	vk::Buffer boundIndexBuffer{};
+
+	bool passBroken = !endPass;
+	const auto breakPass = [&]()
+	{
+		endPass();
+		for (const auto& commands : mPassBreaks)
+			commands(commandBuffer);
+		resumePass();
+		++mStats.passBreaks;
+		passBroken = true;
+
+		// break commands may bind anything, start over with clean state
+		boundPipeline = nullptr;
+		boundSets = {};
+		boundSetHashes = {};
+		boundVertexBuffer = nullptr;
+		boundIndexBuffer = nullptr;
+	};
+
+	for (const SortItem& item : mSortItems)
+	{
+		// layer in top 4 bits of every key
+		if (!passBroken && (item.key >> 60) >= static_cast<uint64>(RenderLayer::LateOpaque))
+			breakPass();
+
+		const RenderPacket& packet = mPackets[item.index];
+
+		if (boundPipeline != packet.pipeline)
+		{
+			packet.pipeline->cmdBind(commandBuffer);
+			++mStats.pipelineBinds;
+
+			// sets bound with previous layout disturbed unless layouts compatible up to set
+			for (uint32 set = 0; set < RenderPacket::MaxDescriptorSets; ++set)
+			{
+				if (boundSetHashes[set] != packet.pipeline->getSetCompatibilityHash(set))
+					boundSets[set] = nullptr;
+			}
+			boundPipeline = packet.pipeline;
+		}
+		else
+		{
+			++mStats.bindsSaved;
+		}
+
+		for (uint32 set = 0; set < RenderPacket::MaxDescriptorSets; ++set)
+		{
+			const vk::DescriptorSet descriptorSet = packet.descriptorSets[set];
+			if (!descriptorSet)
+				continue;
+
+			if (boundSets[set] == descriptorSet)
+			{
+				++mStats.bindsSaved;
+				continue;
+			}
+
+			commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, packet.pipeline->getPipelineLayout(), set, descriptorSet, {});
+			++mStats.descriptorSetBinds;
+
+			boundSets[set] = descriptorSet;
+			boundSetHashes[set] = packet.pipeline->getSetCompatibilityHash(set);
+
+			// binding set disturbs higher sets bound with incompatible layout
+			for (uint32 higherSet = set + 1; higherSet < RenderPacket::MaxDescriptorSets; ++higherSet)
+			{
+				if (boundSetHashes[higherSet] != packet.pipeline->getSetCompatibilityHash(higherSet))
+					boundSets[higherSet] = nullptr;
+			}
+		}
+
+		if (packet.pushConstantsSize)
+			commandBuffer.pushConstants(packet.pipeline->getPipelineLayout(), packet.pushConstantsStages, 0, packet.pushConstantsSize, mPushConstants.data() + packet.pushConstantsOffset);
+
+		const vk::Buffer vertexBuffer = packet.primitive->getVertexBuffer()->getBuffer();
+		if (boundVertexBuffer != vertexBuffer)
+		{
+			commandBuffer.bindVertexBuffers(0, vertexBuffer, packet.primitive->getVertexOffsets());
+			++mStats.vertexBufferBinds;
+			boundVertexBuffer = vertexBuffer;
+		}
+		else
+		{
+			++mStats.bindsSaved;
+		}
+
+		if (const auto& indexBuffer = packet.primitive->getIndexBuffer())
+		{
+			if (boundIndexBuffer != indexBuffer->getBuffer())
+			{
+				commandBuffer.bindIndexBuffer(indexBuffer->getBuffer(), 0, packet.primitive->getIndexType());
+				++mStats.indexBufferBinds;
+				boundIndexBuffer = indexBuffer->getBuffer();
+			}
+			else
+			{
+				++mStats.bindsSaved;
+			}
+		}
+
+		if (packet.indirectBuffer)
+		{
+			commandBuffer.drawIndexedIndirectCount(packet.indirectBuffer, packet.indirectOffset, packet.countBuffer, packet.countOffset, packet.maxDrawCount, sizeof(vk::DrawIndexedIndirectCommand));
+			++mStats.indirectDraws;
+		}
+		else
+		{
+			packet.primitive->cmdDraw(commandBuffer, packet.instanceCount, packet.firstInstance);
+		}
+	}
+
+	if (!passBroken)
+		breakPass();
+
+	clear();
+}
+
+void lune::vulkan::RenderQueue::clear()
+{
+	mPackets.clear();
+	mPushConstants.clear();
+	mPassBreaks.clear();
+	mSortItems.clear();
+}
+
+void lune::vulkan::RenderQueue::sort()
+{
+	const size_t count = mSortItems.size();
+	if (count < 2)
+		return;
+
+	mSortScratch.resize(count);
+
+	for (uint32 shift = 0; shift < 64; shift += 8)
+	{
+		std::array<uint32, 256> offsets{};
+		for (const SortItem& item : mSortItems)
+			++offsets[(item.key >> shift) & 0xFF];
+
+		// every key has same byte, order unchanged
+		if (offsets[(mSortItems[0].key >> shift) & 0xFF] == count)
+			continue;
+
+		uint32 sum{};
+		for (uint32& offset : offsets)
+		{
+			const uint32 bucketCount = offset;
+			offset = sum;
+			sum += bucketCount;
+		}
+
+		for (const SortItem& item : mSortItems)
+			mSortScratch[offsets[(item.key >> shift) & 0xFF]++] = item;
+
+		mSortItems.swap(mSortScratch);
+	}
+}
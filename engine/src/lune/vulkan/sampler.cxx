@@ -1,10 +1,13 @@
 #include "lune/vulkan/sampler.hxx"
 
+#include "lune/vulkan/bindless_heap.hxx"
+
 lune::vulkan::Sampler::~Sampler()
 {
-	const auto cleanSamplerLam = [sampler = mSampler]() -> bool
+	const auto cleanSamplerLam = [sampler = mSampler, index = mBindlessIndex]() -> bool
 	{
 		getVulkanContext().device.destroySampler(sampler);
+		getVulkanBindlessHeap().unregisterSampler(index);
 		return true;
 	};
 	getVulkanDeleteQueue().push(cleanSamplerLam);
@@ -26,7 +29,7 @@ vk::SamplerCreateInfo lune::vulkan::Sampler::defaultCreateInfo()
 			.setCompareEnable(VK_FALSE)
 			.setCompareOp(vk::CompareOp::eNever)
 			.setMinLod(0)
-			.setMaxLod(0)
+			.setMaxLod(VK_LOD_CLAMP_NONE)
 			.setBorderColor(vk::BorderColor::eIntOpaqueBlack)
 			.setUnnormalizedCoordinates(VK_FALSE);
 	return samplerCreateInfo;
@@ -42,4 +45,5 @@ lune::vulkan::UniqueSampler lune::vulkan::Sampler::create(const vk::SamplerCreat
 void lune::vulkan::Sampler::init(const vk::SamplerCreateInfo& createInfo)
 {
 	mSampler = getVulkanContext().device.createSampler(createInfo);
+	mBindlessIndex = getVulkanBindlessHeap().registerSampler(mSampler);
 }
\ No newline at end of file
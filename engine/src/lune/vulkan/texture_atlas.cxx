@@ -0,0 +1,278 @@
+#include "lune/vulkan/texture_atlas.hxx"
+
+#include "lune/core/log.hxx"
+#include "lune/vulkan/texture_image.hxx"
+
+#include <cstring>
+#include <format>
+#include <fstream>
+
+// own private copy of packer, imgui compiles its one as static too
+#define STBRP_STATIC
+#define STB_RECT_PACK_IMPLEMENTATION
+#include "imstb_rectpack.h"
+
+constexpr std::string_view AtlasIndexMagic = "lune-atlas";
+constexpr uint32 AtlasIndexVersion = 1;
+
+struct lune::vulkan::TextureAtlas::Page
+{
+	UniqueSDLSurface surface{};
+	SharedTextureImage texture{}; // created on first commit
+
+	stbrp_context context{};
+	std::vector<stbrp_node> nodes{};
+
+	std::vector<SDL_Rect> dirtyRects{};
+};
+
+static std::filesystem::path atlasPagePath(const std::filesystem::path& indexPath, uint32 page)
+{
+	return indexPath.parent_path() / std::format("{}_{}.png", indexPath.stem().string(), page);
+}
+
+lune::vulkan::TextureAtlas::~TextureAtlas() = default;
+
+lune::vulkan::UniqueTextureAtlas lune::vulkan::TextureAtlas::create(uint32 pageSize)
+{
+	auto newAtlas = std::make_unique<TextureAtlas>();
+	newAtlas->mPageSize = pageSize;
+	return newAtlas;
+}
+
+lune::vulkan::UniqueTextureAtlas lune::vulkan::TextureAtlas::load(const std::filesystem::path& indexPath)
+{
+	std::ifstream file(indexPath);
+	if (!file.is_open())
+		return nullptr;
+
+	std::string magic{};
+	uint32 version{};
+	file >> magic >> version;
+	if (magic != AtlasIndexMagic || version != AtlasIndexVersion)
+	{
+		LN_LOG(Warning, Vulkan::TextureAtlas, "Atlas cache {} has unknown format", indexPath.string());
+		return nullptr;
+	}
+
+	uint32 pageSize{}, pageCount{};
+	file >> pageSize >> pageCount;
+
+	auto newAtlas = create(pageSize);
+	for (uint32 i = 0; i < pageCount; ++i)
+	{
+		Page& page = newAtlas->addPage();
+
+		auto loaded = UniqueSDLSurface(IMG_Load(atlasPagePath(indexPath, i).string().c_str()));
+		if (!loaded || loaded->w != static_cast<int32>(pageSize) || loaded->h != static_cast<int32>(pageSize))
+		{
+			LN_LOG(Warning, Vulkan::TextureAtlas, "Atlas cache {} page {} missing or invalid", indexPath.string(), i);
+			return nullptr;
+		}
+		page.surface = loaded->format == SDL_PIXELFORMAT_RGBA32 ? std::move(loaded) : UniqueSDLSurface(SDL_ConvertSurface(loaded.get(), SDL_PIXELFORMAT_RGBA32));
+		page.dirtyRects.push_back(SDL_Rect{0, 0, page.surface->w, page.surface->h});
+
+		// restore skyline so new images keep packing around saved ones
+		uint32 skylineCount{};
+		file >> skylineCount;
+		if (!file || skylineCount == 0 || skylineCount > page.nodes.size())
+		{
+			LN_LOG(Warning, Vulkan::TextureAtlas, "Atlas cache {} page {} has invalid skyline of {} nodes", indexPath.string(), i, skylineCount);
+			return nullptr;
+		}
+
+		for (uint32 k = 0; k < skylineCount; ++k)
+		{
+			file >> page.nodes[k].x >> page.nodes[k].y;
+			page.nodes[k].next = k + 1 < skylineCount ? &page.nodes[k + 1] : &page.context.extra[1];
+		}
+		page.context.active_head = &page.nodes[0];
+		page.context.free_head = skylineCount < page.nodes.size() ? &page.nodes[skylineCount] : nullptr;
+	}
+
+	uint32 regionCount{};
+	file >> regionCount;
+	for (uint32 i = 0; i < regionCount; ++i)
+	{
+		AtlasRegion region{};
+		file >> region.page >> region.rect.x >> region.rect.y >> region.rect.w >> region.rect.h;
+
+		// name is rest of line, may contain spaces
+		std::string name{};
+		std::getline(file >> std::ws, name);
+
+		if (!file || region.page >= pageCount)
+		{
+			LN_LOG(Warning, Vulkan::TextureAtlas, "Atlas cache {} has invalid region", indexPath.string());
+			return nullptr;
+		}
+
+		const float invPageSize = 1.f / pageSize;
+		region.uvRect = lnm::vec4(region.rect.x, region.rect.y, region.rect.w, region.rect.h) * invPageSize;
+		newAtlas->mRegions.emplace(std::move(name), region);
+	}
+
+	return newAtlas;
+}
+
+bool lune::vulkan::TextureAtlas::add(const std::string& name, const SDL_Surface* surface)
+{
+	if (mRegions.contains(name))
+		return false;
+
+	UniqueSDLSurface converted{};
+	if (surface->format != SDL_PIXELFORMAT_RGBA32)
+	{
+		converted = UniqueSDLSurface(SDL_ConvertSurface(const_cast<SDL_Surface*>(surface), SDL_PIXELFORMAT_RGBA32));
+		if (!converted)
+		{
+			LN_LOG(Error, Vulkan::TextureAtlas, "Failed to convert image {}: {}", name, SDL_GetError());
+			return false;
+		}
+		surface = converted.get();
+	}
+
+	AtlasRegion region{};
+	SDL_Rect packed{};
+	if (!pack(surface->w + Padding * 2, surface->h + Padding * 2, region.page, packed))
+	{
+		LN_LOG(Error, Vulkan::TextureAtlas, "Image {} ({}x{}) doesn't fit in atlas page", name, surface->w, surface->h);
+		return false;
+	}
+
+	region.rect = SDL_Rect{packed.x + static_cast<int32>(Padding), packed.y + static_cast<int32>(Padding), surface->w, surface->h};
+	region.uvRect = lnm::vec4(region.rect.x, region.rect.y, region.rect.w, region.rect.h) * (1.f / mPageSize);
+
+	Page& page = *mPages[region.page];
+	const uint32 rowSize = surface->w * SDL_BYTESPERPIXEL(SDL_PIXELFORMAT_RGBA32);
+	for (int32 y = 0; y < surface->h; ++y)
+	{
+		uint8* dst = static_cast<uint8*>(page.surface->pixels) + (region.rect.y + y) * page.surface->pitch + region.rect.x * SDL_BYTESPERPIXEL(SDL_PIXELFORMAT_RGBA32);
+		const uint8* src = static_cast<const uint8*>(surface->pixels) + y * surface->pitch;
+		std::memcpy(dst, src, rowSize);
+	}
+	page.dirtyRects.push_back(region.rect);
+
+	mRegions.emplace(name, region);
+	return true;
+}
+
+void lune::vulkan::TextureAtlas::commit()
+{
+	for (auto& page : mPages)
+	{
+		if (page->dirtyRects.empty())
+			continue;
+
+		if (!page->texture)
+		{
+			// sprites packed edge to edge would bleed into each other in smaller mips, pages also updated in place
+			page->texture = TextureImage::create(page->surface.get(), false);
+		}
+		else
+		{
+			// single upload of bounds of all changes
+			// with queue ownership transfer page contents can't be kept, updateRegion uploads whole page then
+			SDL_Rect bounds = page->dirtyRects.front();
+			for (const SDL_Rect& rect : page->dirtyRects)
+			{
+				const SDL_Rect previous = bounds;
+				SDL_GetRectUnion(&previous, &rect, &bounds);
+			}
+			page->texture->updateRegion(page->surface.get(), bounds);
+		}
+		page->dirtyRects.clear();
+	}
+}
+
+bool lune::vulkan::TextureAtlas::save(const std::filesystem::path& indexPath) const
+{
+	std::ofstream file(indexPath, std::ios::trunc);
+	if (!file.is_open())
+	{
+		LN_LOG(Error, Vulkan::TextureAtlas, "Failed to open {} for writing", indexPath.string());
+		return false;
+	}
+
+	file << AtlasIndexMagic << ' ' << AtlasIndexVersion << '\n';
+	file << mPageSize << ' ' << mPages.size() << '\n';
+
+	for (uint32 i = 0; i < mPages.size(); ++i)
+	{
+		const Page& page = *mPages[i];
+		if (!IMG_SavePNG(page.surface.get(), atlasPagePath(indexPath, i).string().c_str()))
+		{
+			LN_LOG(Error, Vulkan::TextureAtlas, "Failed to save atlas page {}: {}", i, SDL_GetError());
+			return false;
+		}
+
+		// skyline ends with sentinel node that has no next
+		std::vector<const stbrp_node*> skyline{};
+		for (const stbrp_node* node = page.context.active_head; node->next; node = node->next)
+			skyline.push_back(node);
+
+		file << skyline.size();
+		for (const stbrp_node* node : skyline)
+			file << ' ' << node->x << ' ' << node->y;
+		file << '\n';
+	}
+
+	file << mRegions.size() << '\n';
+	for (const auto& [name, region] : mRegions)
+		file << region.page << ' ' << region.rect.x << ' ' << region.rect.y << ' ' << region.rect.w << ' ' << region.rect.h << ' ' << name << '\n';
+
+	return file.good();
+}
+
+const lune::vulkan::AtlasRegion* lune::vulkan::TextureAtlas::findRegion(std::string_view name) const
+{
+	const auto findRes = mRegions.find(name);
+	return findRes != mRegions.end() ? &findRes->second : nullptr;
+}
+
+const lune::vulkan::SharedTextureImage& lune::vulkan::TextureAtlas::getPageTexture(uint32 page) const
+{
+	return mPages.at(page)->texture;
+}
+
+lune::vulkan::TextureAtlas::Page& lune::vulkan::TextureAtlas::addPage()
+{
+	auto& page = mPages.emplace_back(std::make_unique<Page>());
+
+	page->surface = UniqueSDLSurface(SDL_CreateSurface(mPageSize, mPageSize, SDL_PIXELFORMAT_RGBA32));
+	std::memset(page->surface->pixels, 0, page->surface->pitch * page->surface->h);
+
+	page->nodes.resize(mPageSize);
+	stbrp_init_target(&page->context, mPageSize, mPageSize, page->nodes.data(), page->nodes.size());
+
+	return *page;
+}
+
+bool lune::vulkan::TextureAtlas::pack(uint32 width, uint32 height, uint32& outPage, SDL_Rect& outRect)
+{
+	if (width > mPageSize || height > mPageSize)
+		return false;
+
+	stbrp_rect rect{};
+	rect.w = width;
+	rect.h = height;
+
+	// failed attempt leaves skyline of page untouched
+	for (uint32 i = 0; i < mPages.size(); ++i)
+	{
+		if (stbrp_pack_rects(&mPages[i]->context, &rect, 1))
+		{
+			outPage = i;
+			outRect = SDL_Rect{rect.x, rect.y, rect.w, rect.h};
+			return true;
+		}
+	}
+
+	Page& page = addPage();
+	if (!stbrp_pack_rects(&page.context, &rect, 1))
+		return false;
+
+	outPage = mPages.size() - 1;
+	outRect = SDL_Rect{rect.x, rect.y, rect.w, rect.h};
+	return true;
+}
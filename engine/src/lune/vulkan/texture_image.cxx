@@ -1,10 +1,15 @@
 #include "lune/vulkan/texture_image.hxx"
 
+#include "lune/core/ktx2.hxx"
 #include "lune/core/log.hxx"
-#include "lune/vulkan/buffer.hxx"
+#include "lune/vulkan/bindless_heap.hxx"
+#include "lune/vulkan/upload_context.hxx"
 #include "lune/vulkan/vulkan_subsystem.hxx"
 
-vk::Format sdlFormatToVulkan(SDL_PixelFormat format)
+#include <algorithm>
+#include <bit>
+
+static vk::Format sdlFormatToVulkan(SDL_PixelFormat format)
 {
 	switch (format)
 	{
@@ -18,6 +23,37 @@ vk::Format sdlFormatToVulkan(SDL_PixelFormat format)
 	}
 }
 
+// mips of all sizes down to 1x1
+static uint32 computeMipLevels(uint32 width, uint32 height)
+{
+	return static_cast<uint32>(std::bit_width(std::max(width, height)));
+}
+
+static bool supportsLinearBlit(vk::Format format)
+{
+	const vk::FormatFeatureFlags required = vk::FormatFeatureFlagBits::eBlitSrc | vk::FormatFeatureFlagBits::eBlitDst | vk::FormatFeatureFlagBits::eSampledImageFilterLinear;
+	return (lune::getVulkanContext().physicalDevice.getFormatProperties(format).optimalTilingFeatures & required) == required;
+}
+
+// next mip of tightly packed 4 byte texels, average of 2x2 texels, odd last row and column folded into previous ones
+static void downsampleBox(const uint8* src, uint32 width, uint32 height, uint8* dst)
+{
+	const uint32 dstWidth = std::max(width / 2, 1u);
+	const uint32 dstHeight = std::max(height / 2, 1u);
+	for (uint32 y = 0; y < dstHeight; ++y)
+	{
+		const uint8* row0 = src + std::min(y * 2, height - 1) * width * 4;
+		const uint8* row1 = src + std::min(y * 2 + 1, height - 1) * width * 4;
+		for (uint32 x = 0; x < dstWidth; ++x)
+		{
+			const uint32 x0 = std::min(x * 2, width - 1) * 4;
+			const uint32 x1 = std::min(x * 2 + 1, width - 1) * 4;
+			for (uint32 c = 0; c < 4; ++c)
+				dst[(y * dstWidth + x) * 4 + c] = static_cast<uint8>((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) / 4);
+		}
+	}
+}
+
 lune::vulkan::TextureImage::~TextureImage()
 {
 	const auto cleanSampler = [sampler = mSampler]() -> bool
@@ -30,31 +66,252 @@ lune::vulkan::TextureImage::~TextureImage()
 		getVulkanContext().device.destroyImageView(imageView);
 		return true;
 	};
-	const auto cleanImageAlloc = [image = mImage, vmaAlloc = mVmaAllocation]() -> bool
+	// uploads recorded in background batches may outlive frames that used texture
+	const auto cleanImageAlloc = [image = mImage, vmaAlloc = mVmaAllocation, ticket = mUploadTicket]() -> bool
 	{
+		if (!getVulkanUploadContext().isComplete(ticket))
+			return false;
 		vmaDestroyImage(getVulkanContext().vmaAllocator, image, vmaAlloc);
 		return true;
 	};
+	const auto releaseBindlessIndex = [index = mBindlessIndex]() -> bool
+	{
+		getVulkanBindlessHeap().unregisterTexture(index);
+		return true;
+	};
 	getVulkanDeleteQueue().push(cleanSampler);
 	getVulkanDeleteQueue().push(cleanImageView);
 	getVulkanDeleteQueue().push(cleanImageAlloc);
+	getVulkanDeleteQueue().push(releaseBindlessIndex);
+	releaseStreamImage();
+}
+
+lune::vulkan::UniqueTextureImage lune::vulkan::TextureImage::create(std::span<const SDL_Surface*, 6> cubeSurfaces, bool mipmaps)
+{
+	auto newTexImage = std::make_unique<TextureImage>();
+	newTexImage->init(cubeSurfaces, mipmaps);
+	return newTexImage;
+}
+
+lune::vulkan::UniqueTextureImage lune::vulkan::TextureImage::create(const SDL_Surface* surface, bool mipmaps)
+{
+	auto newTexImage = std::make_unique<TextureImage>();
+	newTexImage->init(std::span<const SDL_Surface*>(&(surface), 1), mipmaps);
+	return newTexImage;
 }
 
-lune::vulkan::UniqueTextureImage lune::vulkan::TextureImage::create(std::span<const SDL_Surface*, 6> cubeSurfaces)
+lune::vulkan::UniqueTextureImage lune::vulkan::TextureImage::create(const Ktx2Texture& texture)
 {
+	if (!canSample(texture.format))
+		return nullptr;
+
 	auto newTexImage = std::make_unique<TextureImage>();
-	newTexImage->init(cubeSurfaces);
+	newTexImage->init(texture);
 	return newTexImage;
 }
 
-lune::vulkan::UniqueTextureImage lune::vulkan::TextureImage::create(const SDL_Surface* surface)
+lune::vulkan::UniqueTextureImage lune::vulkan::TextureImage::createStreamed(std::shared_ptr<const Ktx2Texture> mips, uint32 residentSize)
 {
+	if (!canSample(mips->format))
+		return nullptr;
+
+	// smallest mips stay resident for good, texture never has nothing to sample
+	uint32 firstMip{};
+	while (firstMip + 1 < mips->levels.size() && std::max(mips->width >> firstMip, mips->height >> firstMip) > residentSize)
+		++firstMip;
+
 	auto newTexImage = std::make_unique<TextureImage>();
-	newTexImage->init(std::span<const SDL_Surface*>(&(surface), 1));
+	newTexImage->mStreamedMips = std::move(mips);
+	newTexImage->mFirstResidentMip = firstMip;
+	newTexImage->mSmallImageMip = firstMip;
+	newTexImage->initLevels(*newTexImage->mStreamedMips, firstMip);
+	newTexImage->mBindlessIndex = getVulkanBindlessHeap().registerTexture(newTexImage->mImageView);
 	return newTexImage;
 }
 
-void lune::vulkan::TextureImage::init(std::span<const SDL_Surface*> surfaces)
+bool lune::vulkan::TextureImage::canSample(vk::Format format)
+{
+	if (Ktx2Texture::getBlockSize(format) && !getVulkanConfig().textureCompressionBC)
+		return false;
+	return static_cast<bool>(getVulkanContext().physicalDevice.getFormatProperties(format).optimalTilingFeatures & vk::FormatFeatureFlagBits::eSampledImage);
+}
+
+lune::Ktx2Texture lune::vulkan::TextureImage::buildMipChain(const SDL_Surface* surface)
+{
+	Ktx2Texture mips{};
+	mips.format = sdlFormatToVulkan(surface->format);
+	mips.width = surface->w;
+	mips.height = surface->h;
+	mips.levels.resize(computeMipLevels(mips.width, mips.height));
+
+	// rows of surface may be padded, first level packed tightly like rest of them
+	mips.levels[0].resize(Ktx2Texture::getFaceSize(mips.format, mips.width, mips.height));
+	for (uint32 y = 0; y < mips.height; ++y)
+		memcpy(mips.levels[0].data() + y * mips.width * 4, static_cast<const uint8*>(surface->pixels) + y * surface->pitch, mips.width * 4);
+
+	for (uint32 level = 1; level < mips.levels.size(); ++level)
+	{
+		const uint32 width = std::max(mips.width >> (level - 1), 1u);
+		const uint32 height = std::max(mips.height >> (level - 1), 1u);
+		mips.levels[level].resize(Ktx2Texture::getFaceSize(mips.format, std::max(width / 2, 1u), std::max(height / 2, 1u)));
+		downsampleBox(mips.levels[level - 1].data(), width, height, mips.levels[level].data());
+	}
+	return mips;
+}
+
+vk::DeviceSize lune::vulkan::TextureImage::setFirstResidentMip(uint32 firstMip)
+{
+	// image of pending upload neither released nor narrowed till its view got swapped in
+	if (mUploadPending)
+		return 0;
+
+	firstMip = std::min(firstMip, mSmallImageMip);
+	if (firstMip == mFirstResidentMip)
+		return 0;
+
+	// small image never left gpu, full one only released
+	if (firstMip == mSmallImageMip)
+	{
+		releaseStreamImage();
+		mFirstResidentMip = firstMip;
+		getVulkanBindlessHeap().updateTexture(mBindlessIndex, mImageView);
+		return 0;
+	}
+
+	const Ktx2Texture& mips = *mStreamedMips;
+	const bool cube = mips.faceCount == 6;
+	const uint32 levelCount = mips.levels.size();
+	if (!mStreamImage)
+	{
+		createImage(cube ? vk::ImageCreateFlagBits::eCubeCompatible : vk::ImageCreateFlagBits(), mips.faceCount, vk::Extent3D(mips.width, mips.height, 1), levelCount, mStreamImage, mStreamAllocation);
+		mUploadedMip = levelCount;
+	}
+
+	// levels uploaded since full image got created kept there, narrowed view brought back without upload
+	if (firstMip >= mUploadedMip)
+	{
+		swapStreamView(firstMip);
+		return 0;
+	}
+
+	// previous view keeps being sampled till updateStreaming sees upload complete
+	vk::DeviceSize uploadedBytes{};
+	mUploadTicket = uploadLevels(mips, mStreamImage, 0, firstMip, mUploadedMip);
+	for (uint32 level = firstMip; level < mUploadedMip; ++level)
+		uploadedBytes += mips.levels[level].size();
+	mUploadedMip = firstMip;
+	mUploadPending = true;
+	return uploadedBytes;
+}
+
+void lune::vulkan::TextureImage::updateStreaming()
+{
+	if (!mUploadPending || !getVulkanUploadContext().isComplete(mUploadTicket))
+		return;
+
+	mUploadPending = false;
+	swapStreamView(mUploadedMip);
+}
+
+void lune::vulkan::TextureImage::swapStreamView(uint32 firstMip)
+{
+	// frames using previous view completed before delete queue gets to it
+	if (mStreamImageView)
+	{
+		const auto cleanImageView = [imageView = mStreamImageView]() -> bool
+		{
+			getVulkanContext().device.destroyImageView(imageView);
+			return true;
+		};
+		getVulkanDeleteQueue().push(cleanImageView);
+	}
+
+	const Ktx2Texture& mips = *mStreamedMips;
+	const bool cube = mips.faceCount == 6;
+	mFirstResidentMip = firstMip;
+	mStreamImageView = createImageView(mStreamImage, cube ? vk::ImageViewType::eCube : vk::ImageViewType::e2D, mips.faceCount, firstMip, mips.levels.size() - firstMip);
+	getVulkanBindlessHeap().updateTexture(mBindlessIndex, mStreamImageView);
+}
+
+void lune::vulkan::TextureImage::releaseStreamImage()
+{
+	if (mStreamImageView)
+	{
+		const auto cleanImageView = [imageView = mStreamImageView]() -> bool
+		{
+			getVulkanContext().device.destroyImageView(imageView);
+			return true;
+		};
+		getVulkanDeleteQueue().push(cleanImageView);
+	}
+	if (mStreamImage)
+	{
+		const auto cleanImageAlloc = [image = mStreamImage, vmaAlloc = mStreamAllocation, ticket = mUploadTicket]() -> bool
+		{
+			if (!getVulkanUploadContext().isComplete(ticket))
+				return false;
+			vmaDestroyImage(getVulkanContext().vmaAllocator, image, vmaAlloc);
+			return true;
+		};
+		getVulkanDeleteQueue().push(cleanImageAlloc);
+	}
+	mStreamImageView = nullptr;
+	mStreamImage = nullptr;
+	mStreamAllocation = nullptr;
+	mUploadPending = false;
+}
+
+vk::DeviceSize lune::vulkan::TextureImage::getMemorySize() const
+{
+	vk::DeviceSize size = mVmaAllocation ? vma::getAllocationSize(mVmaAllocation) : 0;
+	if (mStreamAllocation)
+		size += vma::getAllocationSize(mStreamAllocation);
+	return size;
+}
+
+void lune::vulkan::TextureImage::init(const Ktx2Texture& texture)
+{
+	initLevels(texture, 0);
+	mBindlessIndex = getVulkanBindlessHeap().registerTexture(mImageView);
+}
+
+void lune::vulkan::TextureImage::initLevels(const Ktx2Texture& texture, uint32 firstMip)
+{
+	const bool cube = texture.faceCount == 6;
+	const auto extent = vk::Extent3D(std::max(texture.width >> firstMip, 1u), std::max(texture.height >> firstMip, 1u), 1);
+
+	mFormat = texture.format;
+	mMipLevels = texture.levels.size() - firstMip;
+	createImage(cube ? vk::ImageCreateFlagBits::eCubeCompatible : vk::ImageCreateFlagBits(), texture.faceCount, extent, mMipLevels, mImage, mVmaAllocation);
+	mImageView = createImageView(mImage, cube ? vk::ImageViewType::eCube : vk::ImageViewType::e2D, texture.faceCount, 0, mMipLevels);
+	mUploadTicket = uploadLevels(texture, mImage, firstMip, firstMip, texture.levels.size());
+}
+
+lune::vulkan::UploadTicket lune::vulkan::TextureImage::uploadLevels(const Ktx2Texture& texture, vk::Image image, uint32 imageMip, uint32 firstLevel, uint32 endLevel)
+{
+	// levels packed one after another, faces of level already consecutive as copy of all layers expects
+	std::vector<uint8> data{};
+	std::vector<vk::BufferImageCopy> regions{};
+	for (uint32 level = firstLevel; level < endLevel; ++level)
+	{
+		regions.push_back(
+			vk::BufferImageCopy()
+				.setBufferOffset(data.size())
+				.setBufferRowLength(0)
+				.setBufferImageHeight(0)
+				.setImageSubresource(vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, level - imageMip, 0, texture.faceCount))
+				.setImageOffset(vk::Offset3D(0, 0, 0))
+				.setImageExtent(vk::Extent3D(std::max(texture.width >> level, 1u), std::max(texture.height >> level, 1u), 1)));
+		const std::vector<uint8>& levelData = texture.levels[level];
+		data.insert(data.end(), levelData.begin(), levelData.end());
+	}
+
+	// levels outside range untouched, sampled ones keep their layout and contents
+	const vk::ImageSubresourceRange subresourceRange = vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, firstLevel - imageMip, endLevel - firstLevel, 0, texture.faceCount);
+	return getVulkanUploadContext().uploadImage(image, subresourceRange, regions, data.data(), data.size());
+}
+
+void lune::vulkan::TextureImage::init(std::span<const SDL_Surface*> surfaces, bool mipmaps)
 {
 	const auto imageCreateFlags = surfaces.size() == 6 ? vk::ImageCreateFlagBits::eCubeCompatible : vk::ImageCreateFlagBits();
 	const uint32 layerCount = surfaces.size();
@@ -62,13 +319,16 @@ void lune::vulkan::TextureImage::init(std::span<const SDL_Surface*> surfaces)
 	const auto imageViewType = surfaces.size() == 6 ? vk::ImageViewType::eCube : vk::ImageViewType::e2D;
 
 	mFormat = sdlFormatToVulkan(surfaces[0]->format);
-	createImage(imageCreateFlags, layerCount, extent);
-	createImageView(imageViewType, layerCount);
+	mMipLevels = mipmaps ? computeMipLevels(extent.width, extent.height) : 1;
+	createImage(imageCreateFlags, layerCount, extent, mMipLevels, mImage, mVmaAllocation);
+	mImageView = createImageView(mImage, imageViewType, layerCount, 0, mMipLevels);
 
 	copyPixelsToImage(surfaces, layerCount, extent);
+
+	mBindlessIndex = getVulkanBindlessHeap().registerTexture(mImageView);
 }
 
-void lune::vulkan::TextureImage::createImage(vk::ImageCreateFlagBits flags, uint32 arrayLayers, vk::Extent3D extent)
+void lune::vulkan::TextureImage::createImage(vk::ImageCreateFlagBits flags, uint32 arrayLayers, vk::Extent3D extent, uint32 mipLevels, vk::Image& outImage, VmaAllocation& outAllocation) const
 {
 	const vk::ImageCreateInfo imageCreateInfo =
 		vk::ImageCreateInfo()
@@ -76,146 +336,176 @@ void lune::vulkan::TextureImage::createImage(vk::ImageCreateFlagBits flags, uint
 			.setImageType(vk::ImageType::e2D)
 			.setFormat(mFormat)
 			.setExtent(extent)
-			.setMipLevels(1)
+			.setMipLevels(mipLevels)
 			.setArrayLayers(arrayLayers)
 			.setSamples(vk::SampleCountFlagBits::e1)
 			.setTiling(vk::ImageTiling::eOptimal)
-			.setUsage(vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst)
+			.setUsage(vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eTransferSrc)
 			.setInitialLayout(vk::ImageLayout::eUndefined)
 			.setQueueFamilyIndices(getVulkanContext().queueFamilyIndices)
 			.setSharingMode(vk::SharingMode::eExclusive);
 
 	VmaAllocationCreateInfo allocationCreateInfo{};
 	allocationCreateInfo.usage = VMA_MEMORY_USAGE_AUTO;
-	allocationCreateInfo.flags = VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT;
 
 	VmaAllocationInfo allocationInfo = {};
-	vmaCreateImage(getVulkanContext().vmaAllocator, reinterpret_cast<const VkImageCreateInfo*>(&imageCreateInfo), &allocationCreateInfo, reinterpret_cast<VkImage*>(&mImage), &mVmaAllocation, &allocationInfo);
+	vmaCreateImage(getVulkanContext().vmaAllocator, reinterpret_cast<const VkImageCreateInfo*>(&imageCreateInfo), &allocationCreateInfo, reinterpret_cast<VkImage*>(&outImage), &outAllocation, &allocationInfo);
 }
 
-void lune::vulkan::TextureImage::createImageView(vk::ImageViewType type, uint32 layerCount)
+vk::ImageView lune::vulkan::TextureImage::createImageView(vk::Image image, vk::ImageViewType type, uint32 layerCount, uint32 baseMip, uint32 mipLevels) const
 {
 	const vk::ImageSubresourceRange subresourceRange =
 		vk::ImageSubresourceRange()
 			.setAspectMask(vk::ImageAspectFlagBits::eColor)
-			.setBaseMipLevel(0)
-			.setLevelCount(1)
+			.setBaseMipLevel(baseMip)
+			.setLevelCount(mipLevels)
 			.setBaseArrayLayer(0)
 			.setLayerCount(layerCount);
 
 	const vk::ImageViewCreateInfo imageViewCreateInfo =
 		vk::ImageViewCreateInfo()
-			.setImage(mImage)
+			.setImage(image)
 			.setViewType(type)
 			.setFormat(mFormat)
 			.setSubresourceRange(subresourceRange);
 
-	mImageView = getVulkanContext().device.createImageView(imageViewCreateInfo);
+	return getVulkanContext().device.createImageView(imageViewCreateInfo);
 }
 
 void lune::vulkan::TextureImage::copyPixelsToImage(std::span<const SDL_Surface*> surfaces, uint32 layerCount, vk::Extent3D extent)
 {
-	const auto vmaUsage = VMA_MEMORY_USAGE_AUTO_PREFER_HOST;
-	const auto vmaFlags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT;
-	UniqueBuffer stagingBuffer = Buffer::create(vk::BufferUsageFlagBits::eTransferSrc, vma::getAllocationSize(mVmaAllocation), vmaUsage, vmaFlags);
+	const bool blitMips = mMipLevels > 1 && supportsLinearBlit(mFormat);
+	if (mMipLevels > 1 && !blitMips)
+	{
+		copyMipsToImage(surfaces, layerCount, extent);
+		return;
+	}
+
+	const uint32 layerSize = surfaces[0]->h * surfaces[0]->pitch;
 
-	const uint32 size = surfaces[0]->w * surfaces[0]->pitch;
+	std::vector<uint8> pixels(layerSize * surfaces.size());
 	uint32 offset = 0;
 	for (const SDL_Surface* surface : surfaces)
 	{
-		const uint8* pixels = static_cast<const uint8*>(surface->pixels);
-		stagingBuffer->copyMap(pixels, offset, size);
-		offset += size;
+		memcpy(pixels.data() + offset, surface->pixels, layerSize);
+		offset += layerSize;
 	}
 
-	const vk::CommandBufferAllocateInfo commandBufferAllocateInfo =
-		vk::CommandBufferAllocateInfo()
-			.setCommandPool(getVulkanContext().transferCommandPool)
-			.setLevel(vk::CommandBufferLevel::ePrimary)
-			.setCommandBufferCount(1);
-
-	const vk::CommandBuffer commandBuffer = getVulkanContext().device.allocateCommandBuffers(commandBufferAllocateInfo)[0];
-
-	const vk::CommandBufferBeginInfo commandBufferBeginInfo =
-		vk::CommandBufferBeginInfo()
-			.setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
-
-	commandBuffer.begin(commandBufferBeginInfo);
-
-	{ // Copy staging buffer to image
+	const vk::ImageSubresourceRange subresourceRange =
+		vk::ImageSubresourceRange()
+			.setAspectMask(vk::ImageAspectFlagBits::eColor)
+			.setBaseMipLevel(0)
+			.setLevelCount(mMipLevels)
+			.setBaseArrayLayer(0)
+			.setLayerCount(layerCount);
 
-		const vk::ImageSubresourceRange subresourceRange =
-			vk::ImageSubresourceRange()
-				.setAspectMask(vk::ImageAspectFlagBits::eColor)
-				.setBaseMipLevel(0)
-				.setLevelCount(1)
-				.setBaseArrayLayer(0)
-				.setLayerCount(layerCount);
+	const vk::ImageSubresourceLayers imageSubresourceLayers =
+		vk::ImageSubresourceLayers()
+			.setAspectMask(vk::ImageAspectFlagBits::eColor)
+			.setMipLevel(0)
+			.setBaseArrayLayer(0)
+			.setLayerCount(layerCount);
 
-		const vk::ImageMemoryBarrier imageMemoryBarrier =
-			vk::ImageMemoryBarrier()
-				.setSrcAccessMask({})
-				.setDstAccessMask(vk::AccessFlagBits::eTransferWrite)
-				.setOldLayout(vk::ImageLayout::eUndefined)
-				.setNewLayout(vk::ImageLayout::eTransferDstOptimal)
-				.setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
-				.setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
-				.setImage(mImage)
-				.setSubresourceRange(subresourceRange);
+	const vk::BufferImageCopy bufferImageCopy =
+		vk::BufferImageCopy()
+			.setBufferOffset(0)
+			.setBufferRowLength(surfaces[0]->pitch / SDL_BYTESPERPIXEL(surfaces[0]->format))
+			.setBufferImageHeight(0)
+			.setImageSubresource(imageSubresourceLayers)
+			.setImageOffset(vk::Offset3D(0, 0, 0))
+			.setImageExtent(extent);
+
+	if (blitMips)
+		mUploadTicket = getVulkanUploadContext().uploadImageWithMips(mImage, subresourceRange, vk::Extent2D(extent.width, extent.height), {&bufferImageCopy, 1}, pixels.data(), pixels.size());
+	else
+		mUploadTicket = getVulkanUploadContext().uploadImage(mImage, subresourceRange, {&bufferImageCopy, 1}, pixels.data(), pixels.size());
+}
 
-		commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer, {}, {}, {}, imageMemoryBarrier);
+void lune::vulkan::TextureImage::copyMipsToImage(std::span<const SDL_Surface*> surfaces, uint32 layerCount, vk::Extent3D extent)
+{
+	// mip after mip, layers of each mip one after another, rows tightly packed
+	std::vector<vk::DeviceSize> mipOffsets(mMipLevels);
+	vk::DeviceSize totalSize{};
+	for (uint32 level = 0; level < mMipLevels; ++level)
+	{
+		mipOffsets[level] = totalSize;
+		totalSize += static_cast<vk::DeviceSize>(std::max(extent.width >> level, 1u)) * std::max(extent.height >> level, 1u) * 4 * layerCount;
+	}
 
-		const vk::ImageSubresourceLayers imageSubresourceLayers =
-			vk::ImageSubresourceLayers()
-				.setAspectMask(vk::ImageAspectFlagBits::eColor)
-				.setMipLevel(0)
-				.setBaseArrayLayer(0)
-				.setLayerCount(layerCount);
+	std::vector<uint8> pixels(totalSize);
+	const uint32 rowSize = extent.width * 4;
+	for (uint32 layer = 0; layer < layerCount; ++layer)
+	{
+		uint8* dst = pixels.data() + layer * rowSize * extent.height;
+		for (uint32 y = 0; y < extent.height; ++y)
+			memcpy(dst + y * rowSize, static_cast<const uint8*>(surfaces[layer]->pixels) + y * surfaces[layer]->pitch, rowSize);
+	}
 
-		const vk::BufferImageCopy bufferImageCopy =
+	std::vector<vk::BufferImageCopy> regions(mMipLevels);
+	for (uint32 level = 0; level < mMipLevels; ++level)
+	{
+		const uint32 width = std::max(extent.width >> level, 1u);
+		const uint32 height = std::max(extent.height >> level, 1u);
+		if (level > 0)
+		{
+			const uint32 prevWidth = std::max(extent.width >> (level - 1), 1u);
+			const uint32 prevHeight = std::max(extent.height >> (level - 1), 1u);
+			for (uint32 layer = 0; layer < layerCount; ++layer)
+			{
+				const uint8* src = pixels.data() + mipOffsets[level - 1] + layer * prevWidth * prevHeight * 4;
+				uint8* dst = pixels.data() + mipOffsets[level] + layer * width * height * 4;
+				downsampleBox(src, prevWidth, prevHeight, dst);
+			}
+		}
+
+		regions[level] =
 			vk::BufferImageCopy()
-				.setBufferOffset(0)
+				.setBufferOffset(mipOffsets[level])
 				.setBufferRowLength(0)
 				.setBufferImageHeight(0)
-				.setImageSubresource(imageSubresourceLayers)
+				.setImageSubresource(vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, level, 0, layerCount))
 				.setImageOffset(vk::Offset3D(0, 0, 0))
-				.setImageExtent(extent);
-
-		commandBuffer.copyBufferToImage(stagingBuffer->getBuffer(), mImage, vk::ImageLayout::eTransferDstOptimal, bufferImageCopy);
+				.setImageExtent(vk::Extent3D(width, height, 1));
 	}
 
-	{ // Transition image layout
-		const vk::ImageSubresourceRange subresourceRange =
-			vk::ImageSubresourceRange()
-				.setAspectMask(vk::ImageAspectFlagBits::eColor)
-				.setBaseMipLevel(0)
-				.setLevelCount(1)
-				.setBaseArrayLayer(0)
-				.setLayerCount(layerCount);
-
-		const vk::ImageMemoryBarrier imageMemoryBarrier =
-			vk::ImageMemoryBarrier()
-				.setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
-				.setDstAccessMask(vk::AccessFlagBits::eShaderRead)
-				.setOldLayout(vk::ImageLayout::eTransferDstOptimal)
-				.setNewLayout(vk::ImageLayout::eShaderReadOnlyOptimal)
-				.setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
-				.setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
-				.setImage(mImage)
-				.setSubresourceRange(subresourceRange);
-
-		commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader, {}, {}, {}, imageMemoryBarrier);
+	const vk::ImageSubresourceRange subresourceRange = vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, mMipLevels, 0, layerCount);
+	mUploadTicket = getVulkanUploadContext().uploadImage(mImage, subresourceRange, regions, pixels.data(), pixels.size());
+}
 
-		commandBuffer.end();
+void lune::vulkan::TextureImage::updateRegion(const SDL_Surface* surface, const SDL_Rect& rect)
+{
+	if (getVulkanUploadContext().isOwnershipTransferRequired())
+	{
+		copyPixelsToImage(std::span<const SDL_Surface*>(&surface, 1), 1, vk::Extent3D(surface->w, surface->h, 1));
+		return;
+	}
 
-		const vk::Fence transferFence = getVulkanContext().device.createFence(vk::FenceCreateInfo());
-		const vk::SubmitInfo submitInfo =
-			vk::SubmitInfo()
-				.setCommandBufferCount(1)
-				.setPCommandBuffers(&commandBuffer);
+	const uint32 bytesPerPixel = SDL_BYTESPERPIXEL(surface->format);
+	const uint32 rowSize = rect.w * bytesPerPixel;
 
-		getVulkanContext().transferQueue.submit(submitInfo, transferFence);
-		[[maybe_unused]] vk::Result waitRes = getVulkanContext().device.waitForFences(transferFence, true, UINT64_MAX);
-		getVulkanContext().device.destroyFence(transferFence);
+	std::vector<uint8> pixels(rowSize * rect.h);
+	for (int32 y = 0; y < rect.h; ++y)
+	{
+		const uint8* src = static_cast<const uint8*>(surface->pixels) + (rect.y + y) * surface->pitch + rect.x * bytesPerPixel;
+		memcpy(pixels.data() + y * rowSize, src, rowSize);
 	}
+
+	const vk::ImageSubresourceRange subresourceRange =
+		vk::ImageSubresourceRange()
+			.setAspectMask(vk::ImageAspectFlagBits::eColor)
+			.setBaseMipLevel(0)
+			.setLevelCount(1)
+			.setBaseArrayLayer(0)
+			.setLayerCount(1);
+
+	const vk::BufferImageCopy bufferImageCopy =
+		vk::BufferImageCopy()
+			.setBufferOffset(0)
+			.setBufferRowLength(0)
+			.setBufferImageHeight(0)
+			.setImageSubresource(vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, 0, 1))
+			.setImageOffset(vk::Offset3D(rect.x, rect.y, 0))
+			.setImageExtent(vk::Extent3D(rect.w, rect.h, 1));
+
+	mUploadTicket = getVulkanUploadContext().uploadImage(mImage, subresourceRange, {&bufferImageCopy, 1}, pixels.data(), pixels.size(), vk::ImageLayout::eShaderReadOnlyOptimal);
 }
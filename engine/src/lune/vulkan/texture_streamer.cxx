@@ -0,0 +1,186 @@
+#include "lune/vulkan/texture_streamer.hxx"
+
+#include "lune/core/ktx2.hxx"
+#include "lune/vulkan/texture_image.hxx"
+#include "lune/vulkan/vma.hxx"
+
+#include <algorithm>
+#include <cmath>
+
+// bytes of levels from first mip down, what full image of streamed texture takes roughly when first mip is zero
+static vk::DeviceSize sumLevelSizes(const lune::Ktx2Texture& mips, uint32 firstMip)
+{
+	vk::DeviceSize size{};
+	for (uint32 level = firstMip; level < mips.levels.size(); ++level)
+		size += mips.levels[level].size();
+	return size;
+}
+
+lune::vulkan::TextureStreamer& lune::getVulkanTextureStreamer() noexcept
+{
+	static vulkan::TextureStreamer streamer{};
+	return streamer;
+}
+
+void lune::vulkan::TextureStreamer::shutdown()
+{
+	mEntries.clear();
+}
+
+lune::vulkan::SharedTextureImage lune::vulkan::TextureStreamer::add(Ktx2Texture&& mips)
+{
+	SharedTextureImage texture = TextureImage::createStreamed(std::make_shared<const Ktx2Texture>(std::move(mips)), mSettings.residentSize);
+	if (!texture)
+		return nullptr;
+
+	// address of released texture may come back, its entry gets replaced then
+	mEntries.insert_or_assign(texture.get(), Entry{texture, texture->getFirstResidentMip(), 0.f, 0.f, mUpdateCount});
+	return texture;
+}
+
+void lune::vulkan::TextureStreamer::requestScreenSize(const TextureImage* texture, float screenSize)
+{
+	if (auto findRes = mEntries.find(texture); findRes != mEntries.end())
+		findRes->second.requestedSize = std::max(findRes->second.requestedSize, screenSize);
+}
+
+void lune::vulkan::TextureStreamer::update()
+{
+	++mUpdateCount;
+	mStats = TextureStreamerStats{};
+
+	std::vector<Candidate> candidates{};
+	candidates.reserve(mEntries.size());
+	for (auto it = mEntries.begin(); it != mEntries.end();)
+	{
+		auto texture = it->second.texture.lock();
+		if (!texture)
+		{
+			it = mEntries.erase(it);
+			continue;
+		}
+
+		// finer mips swapped in once their upload completed, frames never wait for them
+		texture->updateStreaming();
+
+		Entry& entry = it->second;
+		const Ktx2Texture& mips = *texture->getStreamedMips();
+		if (entry.requestedSize > 0.f)
+		{
+			entry.wantedMip = findWantedMip(mips, entry.requestedSize);
+			entry.lastSize = entry.requestedSize;
+			entry.lastRequest = mUpdateCount;
+		}
+		else if (mUpdateCount - entry.lastRequest > mSettings.retainUpdates)
+		{
+			entry.wantedMip = findResidentMip(mips);
+		}
+		entry.requestedSize = 0.f;
+
+		candidates.push_back(Candidate{std::move(texture), &entry});
+		++it;
+	}
+
+	// usage lowered by eviction and raised by upgrades as they go, vma sees it once delete queue releases old images
+	const vma::Budget budget = vma::getDeviceLocalBudget(getVulkanContext().vmaAllocator);
+	const vk::DeviceSize limit = static_cast<vk::DeviceSize>(budget.budget * mSettings.budgetUsage);
+	vk::DeviceSize usage = budget.usage;
+	if (usage > limit)
+		evict(candidates, limit, usage);
+	upgrade(candidates, limit, usage);
+
+	for (const Candidate& candidate : candidates)
+	{
+		const Ktx2Texture& mips = *candidate.texture->getStreamedMips();
+		const uint32 firstMip = candidate.texture->getFirstResidentMip();
+		mStats.residentBytes += sumLevelSizes(mips, firstMip);
+		mStats.wantedBytes += sumLevelSizes(mips, candidate.entry->wantedMip);
+		mStats.pendingCount += candidate.entry->wantedMip < firstMip;
+	}
+	mStats.textureCount = candidates.size();
+	mStats.limitBytes = limit;
+	mStats.usageBytes = usage;
+}
+
+uint32 lune::vulkan::TextureStreamer::findWantedMip(const Ktx2Texture& mips, float screenSize) const
+{
+	const float texels = static_cast<float>(std::max(mips.width, mips.height));
+	const float mip = std::floor(std::log2(std::max(texels / std::max(screenSize, 1.f), 1.f)));
+	return std::min(static_cast<uint32>(mip), findResidentMip(mips));
+}
+
+uint32 lune::vulkan::TextureStreamer::findResidentMip(const Ktx2Texture& mips) const
+{
+	uint32 mip{};
+	while (mip + 1 < mips.levels.size() && std::max(mips.width >> mip, mips.height >> mip) > mSettings.residentSize)
+		++mip;
+	return mip;
+}
+
+void lune::vulkan::TextureStreamer::evict(std::vector<Candidate>& candidates, vk::DeviceSize limit, vk::DeviceSize& usage)
+{
+	// textures not seen for longest go first, smaller on screen first among those seen together
+	std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b)
+		{ return a.entry->lastRequest != b.entry->lastRequest ? a.entry->lastRequest < b.entry->lastRequest : a.entry->lastSize < b.entry->lastSize; });
+
+	// nothing uploaded either way, narrowed view only hides mips while going back to small image frees full one
+	const auto dropTo = [this, &usage](const Candidate& candidate, uint32 firstMip)
+	{
+		const vk::DeviceSize before = candidate.texture->getMemorySize();
+		candidate.texture->setFirstResidentMip(firstMip);
+		usage -= std::min(usage, before - candidate.texture->getMemorySize());
+		++mStats.evictionCount;
+	};
+
+	// mips no longer wanted
+	for (const Candidate& candidate : candidates)
+	{
+		if (usage <= limit)
+			return;
+		const uint32 wantedMip = std::min(candidate.entry->wantedMip, candidate.texture->getSmallImageMip());
+		if (!candidate.texture->isUploadPending() && candidate.texture->getFirstResidentMip() < wantedMip)
+			dropTo(candidate, wantedMip);
+	}
+
+	// then wanted ones, whole texture back to small image as only that frees memory, requests bring mips back once there is room
+	for (const Candidate& candidate : candidates)
+	{
+		if (usage <= limit)
+			return;
+		if (!candidate.texture->isUploadPending() && candidate.texture->getFirstResidentMip() < candidate.texture->getSmallImageMip())
+			dropTo(candidate, candidate.texture->getSmallImageMip());
+	}
+}
+
+void lune::vulkan::TextureStreamer::upgrade(std::vector<Candidate>& candidates, vk::DeviceSize limit, vk::DeviceSize& usage)
+{
+	// textures lacking most mips first, larger on screen first among equal ones
+	std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b)
+		{
+			const int32 aMissing = static_cast<int32>(a.texture->getFirstResidentMip()) - static_cast<int32>(a.entry->wantedMip);
+			const int32 bMissing = static_cast<int32>(b.texture->getFirstResidentMip()) - static_cast<int32>(b.entry->wantedMip);
+			return aMissing != bMissing ? aMissing > bMissing : a.entry->lastSize > b.entry->lastSize; });
+
+	for (const Candidate& candidate : candidates)
+	{
+		const uint32 firstMip = candidate.texture->getFirstResidentMip();
+		if (firstMip <= candidate.entry->wantedMip)
+			break;
+		if (mStats.uploadedBytes >= mSettings.uploadBudget && mStats.upgradeCount > 0)
+			break;
+		if (candidate.texture->isUploadPending())
+			continue;
+
+		// one level at a time, texture gets sharper step by step and budget splits between more of them
+		// first step past small image allocates full mip chain, later ones take no more memory
+		const Ktx2Texture& mips = *candidate.texture->getStreamedMips();
+		const vk::DeviceSize added = firstMip == candidate.texture->getSmallImageMip() ? sumLevelSizes(mips, 0) : 0;
+		if (usage + added > limit)
+			continue;
+
+		const vk::DeviceSize before = candidate.texture->getMemorySize();
+		mStats.uploadedBytes += candidate.texture->setFirstResidentMip(firstMip - 1);
+		usage += candidate.texture->getMemorySize() - before;
+		++mStats.upgradeCount;
+	}
+}
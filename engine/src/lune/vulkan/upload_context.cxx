@@ -0,0 +1,553 @@
+#include "lune/vulkan/upload_context.hxx"
+
+#include "lune/core/log.hxx"
+
+#include <algorithm>
+
+// size of recyclable staging page, uploads larger than that get own page
+constexpr vk::DeviceSize StagingPageSize = 16 * 1024 * 1024;
+
+// enough for texel block of any format and buffer copy alignment
+constexpr vk::DeviceSize StagingAlignment = 16;
+
+// stages and accesses uploaded resources consumed with on graphics queue
+constexpr vk::PipelineStageFlags ConsumerStages = vk::PipelineStageFlagBits::eVertexInput | vk::PipelineStageFlagBits::eVertexShader | vk::PipelineStageFlagBits::eFragmentShader | vk::PipelineStageFlagBits::eComputeShader;
+constexpr vk::AccessFlags ConsumerBufferAccess = vk::AccessFlagBits::eVertexAttributeRead | vk::AccessFlagBits::eIndexRead | vk::AccessFlagBits::eUniformRead | vk::AccessFlagBits::eShaderRead;
+
+static vk::Semaphore createTimelineSemaphore()
+{
+	auto semaphoreTypeCreateInfo = vk::SemaphoreTypeCreateInfo()
+									   .setSemaphoreType(vk::SemaphoreType::eTimeline)
+									   .setInitialValue(0);
+	const vk::SemaphoreCreateInfo semaphoreCreateInfo = vk::SemaphoreCreateInfo().setPNext(&semaphoreTypeCreateInfo);
+	return lune::getVulkanContext().device.createSemaphore(semaphoreCreateInfo);
+}
+
+lune::vulkan::UploadContext& lune::getVulkanUploadContext() noexcept
+{
+	static vulkan::UploadContext context{};
+	return context;
+}
+
+void lune::vulkan::UploadContext::init()
+{
+	const auto& context = getVulkanContext();
+
+	mOwnershipTransfer = context.transferQueueIndex != context.graphicsQueueIndex;
+
+	const vk::CommandPoolCreateInfo commandPoolCreateInfo =
+		vk::CommandPoolCreateInfo()
+			.setFlags(vk::CommandPoolCreateFlagBits::eResetCommandBuffer | vk::CommandPoolCreateFlagBits::eTransient)
+			.setQueueFamilyIndex(context.transferQueueIndex);
+	mCommandPool = context.device.createCommandPool(commandPoolCreateInfo);
+
+	mSemaphore = createTimelineSemaphore();
+
+	if (mOwnershipTransfer)
+	{
+		const vk::CommandPoolCreateInfo acquirePoolCreateInfo =
+			vk::CommandPoolCreateInfo()
+				.setFlags(vk::CommandPoolCreateFlagBits::eResetCommandBuffer | vk::CommandPoolCreateFlagBits::eTransient)
+				.setQueueFamilyIndex(context.graphicsQueueIndex);
+		mAcquireCommandPool = context.device.createCommandPool(acquirePoolCreateInfo);
+
+		mTransferSemaphore = createTimelineSemaphore();
+	}
+
+	mSubmittedValue = 0;
+	mRequiredValue = 0;
+	mBackground = false;
+}
+
+void lune::vulkan::UploadContext::shutdown()
+{
+	if (!mSemaphore)
+		return;
+
+	wait(submit());
+	collect();
+
+	mFreePages.clear();
+	mFreeBatches.clear();
+
+	getVulkanContext().device.destroyCommandPool(mCommandPool);
+	getVulkanContext().device.destroySemaphore(mSemaphore);
+	mCommandPool = nullptr;
+	mSemaphore = nullptr;
+
+	if (mOwnershipTransfer)
+	{
+		getVulkanContext().device.destroyCommandPool(mAcquireCommandPool);
+		getVulkanContext().device.destroySemaphore(mTransferSemaphore);
+		mAcquireCommandPool = nullptr;
+		mTransferSemaphore = nullptr;
+	}
+}
+
+lune::vulkan::UploadTicket lune::vulkan::UploadContext::uploadBuffer(vk::Buffer dstBuffer, vk::DeviceSize dstOffset, const void* data, vk::DeviceSize size)
+{
+	Batch& batch = getRecordingBatch();
+
+	vk::DeviceSize stagingOffset{};
+	const StagingPage& page = writeStaging(data, size, stagingOffset);
+
+	const vk::BufferCopy copyRegion = vk::BufferCopy()
+										  .setSrcOffset(stagingOffset)
+										  .setDstOffset(dstOffset)
+										  .setSize(size);
+
+	batch.commandBuffer.copyBuffer(page.buffer->getBuffer(), dstBuffer, copyRegion);
+
+	if (mOwnershipTransfer)
+	{
+		const vk::BufferMemoryBarrier releaseBarrier =
+			vk::BufferMemoryBarrier()
+				.setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+				.setDstAccessMask({})
+				.setSrcQueueFamilyIndex(getVulkanContext().transferQueueIndex)
+				.setDstQueueFamilyIndex(getVulkanContext().graphicsQueueIndex)
+				.setBuffer(dstBuffer)
+				.setOffset(dstOffset)
+				.setSize(size);
+
+		batch.commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eBottomOfPipe, {}, {}, releaseBarrier, {});
+
+		const vk::BufferMemoryBarrier acquireBarrier =
+			vk::BufferMemoryBarrier(releaseBarrier)
+				.setSrcAccessMask({})
+				.setDstAccessMask(ConsumerBufferAccess);
+
+		batch.acquireCommandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, ConsumerStages, {}, {}, acquireBarrier, {});
+	}
+
+	return batch.ticket;
+}
+
+lune::vulkan::UploadTicket lune::vulkan::UploadContext::uploadImage(vk::Image dstImage, const vk::ImageSubresourceRange& range, std::span<const vk::BufferImageCopy> regions, const void* data, vk::DeviceSize size, vk::ImageLayout oldLayout)
+{
+	// transfer queue never owned contents of image, release from graphics queue would have to come first
+	if (mOwnershipTransfer && oldLayout != vk::ImageLayout::eUndefined) [[unlikely]]
+	{
+		LN_LOG(Error, Vulkan::UploadContext, "Image contents can't be kept when ownership transfer required, upload skipped");
+		return UploadTicket{};
+	}
+
+	Batch& batch = getRecordingBatch();
+
+	vk::DeviceSize stagingOffset{};
+	const StagingPage& page = writeStaging(data, size, stagingOffset);
+
+	const vk::ImageMemoryBarrier transferDstBarrier =
+		vk::ImageMemoryBarrier()
+			.setSrcAccessMask({})
+			.setDstAccessMask(vk::AccessFlagBits::eTransferWrite)
+			.setOldLayout(oldLayout)
+			.setNewLayout(vk::ImageLayout::eTransferDstOptimal)
+			.setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+			.setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+			.setImage(dstImage)
+			.setSubresourceRange(range);
+
+	batch.commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer, {}, {}, {}, transferDstBarrier);
+
+	std::vector<vk::BufferImageCopy> stagingRegions(regions.begin(), regions.end());
+	for (auto& region : stagingRegions)
+		region.bufferOffset += stagingOffset;
+
+	batch.commandBuffer.copyBufferToImage(page.buffer->getBuffer(), dstImage, vk::ImageLayout::eTransferDstOptimal, stagingRegions);
+
+	// with ownership transfer, same layout transition recorded on both queues, first as release then as acquire
+	const vk::ImageMemoryBarrier shaderReadBarrier =
+		vk::ImageMemoryBarrier()
+			.setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+			.setDstAccessMask(mOwnershipTransfer ? vk::AccessFlags() : vk::AccessFlagBits::eShaderRead)
+			.setOldLayout(vk::ImageLayout::eTransferDstOptimal)
+			.setNewLayout(vk::ImageLayout::eShaderReadOnlyOptimal)
+			.setSrcQueueFamilyIndex(mOwnershipTransfer ? getVulkanContext().transferQueueIndex : VK_QUEUE_FAMILY_IGNORED)
+			.setDstQueueFamilyIndex(mOwnershipTransfer ? getVulkanContext().graphicsQueueIndex : VK_QUEUE_FAMILY_IGNORED)
+			.setImage(dstImage)
+			.setSubresourceRange(range);
+
+	const vk::PipelineStageFlags releaseDstStage = mOwnershipTransfer ? vk::PipelineStageFlagBits::eBottomOfPipe : ConsumerStages;
+	batch.commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, releaseDstStage, {}, {}, {}, shaderReadBarrier);
+
+	if (mOwnershipTransfer)
+	{
+		const vk::ImageMemoryBarrier acquireBarrier =
+			vk::ImageMemoryBarrier(shaderReadBarrier)
+				.setSrcAccessMask({})
+				.setDstAccessMask(vk::AccessFlagBits::eShaderRead);
+
+		batch.acquireCommandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, ConsumerStages, {}, {}, {}, acquireBarrier);
+	}
+
+	return batch.ticket;
+}
+
+lune::vulkan::UploadTicket lune::vulkan::UploadContext::uploadImageWithMips(vk::Image dstImage, const vk::ImageSubresourceRange& range, vk::Extent2D extent, std::span<const vk::BufferImageCopy> regions, const void* data, vk::DeviceSize size)
+{
+	Batch& batch = getRecordingBatch();
+
+	vk::DeviceSize stagingOffset{};
+	const StagingPage& page = writeStaging(data, size, stagingOffset);
+
+	const vk::ImageMemoryBarrier transferDstBarrier =
+		vk::ImageMemoryBarrier()
+			.setSrcAccessMask({})
+			.setDstAccessMask(vk::AccessFlagBits::eTransferWrite)
+			.setOldLayout(vk::ImageLayout::eUndefined)
+			.setNewLayout(vk::ImageLayout::eTransferDstOptimal)
+			.setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+			.setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+			.setImage(dstImage)
+			.setSubresourceRange(range);
+
+	batch.commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer, {}, {}, {}, transferDstBarrier);
+
+	std::vector<vk::BufferImageCopy> stagingRegions(regions.begin(), regions.end());
+	for (auto& region : stagingRegions)
+		region.bufferOffset += stagingOffset;
+
+	batch.commandBuffer.copyBufferToImage(page.buffer->getBuffer(), dstImage, vk::ImageLayout::eTransferDstOptimal, stagingRegions);
+
+	if (!mOwnershipTransfer)
+	{
+		recordMipBlits(batch.commandBuffer, dstImage, range, extent);
+		return batch.ticket;
+	}
+
+	// layout kept while ownership moves, graphics queue blits and transitions
+	const vk::ImageMemoryBarrier releaseBarrier =
+		vk::ImageMemoryBarrier()
+			.setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+			.setDstAccessMask({})
+			.setOldLayout(vk::ImageLayout::eTransferDstOptimal)
+			.setNewLayout(vk::ImageLayout::eTransferDstOptimal)
+			.setSrcQueueFamilyIndex(getVulkanContext().transferQueueIndex)
+			.setDstQueueFamilyIndex(getVulkanContext().graphicsQueueIndex)
+			.setImage(dstImage)
+			.setSubresourceRange(range);
+
+	batch.commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eBottomOfPipe, {}, {}, {}, releaseBarrier);
+
+	const vk::ImageMemoryBarrier acquireBarrier =
+		vk::ImageMemoryBarrier(releaseBarrier)
+			.setSrcAccessMask({})
+			.setDstAccessMask(vk::AccessFlagBits::eTransferRead | vk::AccessFlagBits::eTransferWrite);
+
+	batch.acquireCommandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer, {}, {}, {}, acquireBarrier);
+
+	recordMipBlits(batch.acquireCommandBuffer, dstImage, range, extent);
+	return batch.ticket;
+}
+
+lune::vulkan::UploadTicket lune::vulkan::UploadContext::submit()
+{
+	if (!mRecording)
+		return mSubmittedValue;
+
+	Batch batch = std::move(*mRecording);
+	mRecording.reset();
+
+	batch.commandBuffer.end();
+
+	if (mOwnershipTransfer)
+	{
+		batch.acquireCommandBuffer.end();
+
+		const auto releaseTimelineInfo = vk::TimelineSemaphoreSubmitInfo()
+											 .setSignalSemaphoreValues(batch.ticket);
+
+		const vk::SubmitInfo releaseSubmitInfo =
+			vk::SubmitInfo()
+				.setPNext(&releaseTimelineInfo)
+				.setCommandBuffers(batch.commandBuffer)
+				.setSignalSemaphores(mTransferSemaphore);
+
+		getVulkanContext().transferQueue.submit(releaseSubmitInfo);
+
+		const auto acquireTimelineInfo = vk::TimelineSemaphoreSubmitInfo()
+											 .setWaitSemaphoreValues(batch.ticket)
+											 .setSignalSemaphoreValues(batch.ticket);
+
+		const vk::PipelineStageFlags acquireWaitStage = vk::PipelineStageFlagBits::eAllCommands;
+		const vk::SubmitInfo acquireSubmitInfo =
+			vk::SubmitInfo()
+				.setPNext(&acquireTimelineInfo)
+				.setWaitSemaphores(mTransferSemaphore)
+				.setWaitDstStageMask(acquireWaitStage)
+				.setCommandBuffers(batch.acquireCommandBuffer)
+				.setSignalSemaphores(mSemaphore);
+
+		getVulkanContext().graphicsQueue.submit(acquireSubmitInfo);
+	}
+	else
+	{
+		const auto timelineSubmitInfo = vk::TimelineSemaphoreSubmitInfo()
+											.setSignalSemaphoreValues(batch.ticket);
+
+		const vk::SubmitInfo submitInfo =
+			vk::SubmitInfo()
+				.setPNext(&timelineSubmitInfo)
+				.setCommandBuffers(batch.commandBuffer)
+				.setSignalSemaphores(mSemaphore);
+
+		getVulkanContext().transferQueue.submit(submitInfo);
+	}
+
+	mSubmittedValue = batch.ticket;
+	if (batch.required)
+		mRequiredValue = batch.ticket;
+	mInFlight.push_back(std::move(batch));
+
+	return mSubmittedValue;
+}
+
+void lune::vulkan::UploadContext::beginBackground()
+{
+	// uploads recorded so far stay in batch frame waits for
+	submit();
+	mBackground = true;
+}
+
+void lune::vulkan::UploadContext::endBackground()
+{
+	submit();
+	mBackground = false;
+}
+
+lune::vulkan::UploadTicket lune::vulkan::UploadContext::getFrameTicket() const
+{
+	// background batch observed complete makes its uploads visible only with semaphore wait covering it
+	const uint64 completedValue = getVulkanContext().device.getSemaphoreCounterValue(mSemaphore);
+	return std::max(mRequiredValue, completedValue);
+}
+
+bool lune::vulkan::UploadContext::isComplete(UploadTicket ticket) const
+{
+	if (!mSemaphore)
+		return true;
+
+	if (ticket > mSubmittedValue)
+		return false;
+
+	return getVulkanContext().device.getSemaphoreCounterValue(mSemaphore) >= ticket;
+}
+
+void lune::vulkan::UploadContext::wait(UploadTicket ticket)
+{
+	if (ticket > mSubmittedValue)
+		submit();
+
+	// never handed out, semaphore would never reach it
+	if (ticket > mSubmittedValue) [[unlikely]]
+	{
+		LN_LOG(Error, Vulkan::UploadContext, "Upload ticket {} was never recorded, latest one is {}", ticket, mSubmittedValue);
+		return;
+	}
+
+	const auto waitInfo = vk::SemaphoreWaitInfo()
+							  .setSemaphores(mSemaphore)
+							  .setValues(ticket);
+
+	const vk::Result waitRes = getVulkanContext().device.waitSemaphores(waitInfo, UINT64_MAX);
+	if (waitRes != vk::Result::eSuccess) [[unlikely]]
+	{
+		LN_LOG(Error, Vulkan::UploadContext, "Failed to wait for upload ticket {}: {}", ticket, vk::to_string(waitRes));
+	}
+}
+
+void lune::vulkan::UploadContext::collect()
+{
+	if (mInFlight.empty())
+		return;
+
+	const uint64 completedValue = getVulkanContext().device.getSemaphoreCounterValue(mSemaphore);
+	while (!mInFlight.empty() && mInFlight.front().ticket <= completedValue)
+	{
+		Batch& batch = mInFlight.front();
+		for (auto& page : batch.pages)
+			releaseStagingPage(std::move(page));
+		batch.pages.clear();
+
+		mFreeBatches.push_back(std::move(batch));
+		mInFlight.pop_front();
+	}
+}
+
+lune::vulkan::UploadContext::Batch& lune::vulkan::UploadContext::getRecordingBatch()
+{
+	if (mRecording) [[likely]]
+	{
+		mRecording->required |= !mBackground;
+		return *mRecording;
+	}
+
+	collect();
+
+	Batch& batch = mRecording.emplace();
+	if (!mFreeBatches.empty())
+	{
+		batch = std::move(mFreeBatches.back());
+		mFreeBatches.pop_back();
+
+		batch.commandBuffer.reset();
+		if (mOwnershipTransfer)
+			batch.acquireCommandBuffer.reset();
+	}
+	else
+	{
+		batch.commandBuffer = allocateCommandBuffer(mCommandPool);
+		if (mOwnershipTransfer)
+			batch.acquireCommandBuffer = allocateCommandBuffer(mAcquireCommandPool);
+	}
+	batch.ticket = mSubmittedValue + 1;
+	batch.required = !mBackground;
+
+	const vk::CommandBufferBeginInfo commandBufferBeginInfo =
+		vk::CommandBufferBeginInfo()
+			.setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
+
+	batch.commandBuffer.begin(commandBufferBeginInfo);
+	if (mOwnershipTransfer)
+		batch.acquireCommandBuffer.begin(commandBufferBeginInfo);
+
+	return batch;
+}
+
+lune::vulkan::UploadContext::StagingPage& lune::vulkan::UploadContext::writeStaging(const void* data, vk::DeviceSize size, vk::DeviceSize& outOffset)
+{
+	Batch& batch = getRecordingBatch();
+
+	StagingPage* page = nullptr;
+	if (!batch.pages.empty())
+	{
+		StagingPage& lastPage = batch.pages.back();
+		const vk::DeviceSize alignedOffset = (lastPage.used + StagingAlignment - 1) & ~(StagingAlignment - 1);
+		if (alignedOffset + size <= lastPage.buffer->getSize())
+		{
+			lastPage.used = alignedOffset;
+			page = &lastPage;
+		}
+	}
+
+	if (!page)
+	{
+		if (size <= StagingPageSize && !mFreePages.empty())
+		{
+			batch.pages.push_back(std::move(mFreePages.back()));
+			mFreePages.pop_back();
+		}
+		else
+		{
+			batch.pages.push_back(createStagingPage(std::max(size, StagingPageSize)));
+		}
+		page = &batch.pages.back();
+		page->used = 0;
+	}
+
+	outOffset = page->used;
+	memcpy(page->data + outOffset, data, size);
+	page->buffer->flush(outOffset, size);
+	page->used += size;
+
+	return *page;
+}
+
+lune::vulkan::UploadContext::StagingPage lune::vulkan::UploadContext::createStagingPage(vk::DeviceSize size)
+{
+	const auto vmaUsage = VMA_MEMORY_USAGE_AUTO_PREFER_HOST;
+	const auto vmaFlags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT;
+
+	StagingPage page{};
+	page.buffer = Buffer::create(vk::BufferUsageFlagBits::eTransferSrc, size, vmaUsage, vmaFlags);
+	page.data = page.buffer->getMappedData();
+	return page;
+}
+
+void lune::vulkan::UploadContext::releaseStagingPage(StagingPage&& page)
+{
+	// oversized pages not worth keeping around
+	if (page.buffer->getSize() == StagingPageSize)
+	{
+		page.used = 0;
+		mFreePages.push_back(std::move(page));
+	}
+}
+
+vk::CommandBuffer lune::vulkan::UploadContext::allocateCommandBuffer(vk::CommandPool pool)
+{
+	const vk::CommandBufferAllocateInfo commandBufferAllocateInfo =
+		vk::CommandBufferAllocateInfo()
+			.setCommandPool(pool)
+			.setLevel(vk::CommandBufferLevel::ePrimary)
+			.setCommandBufferCount(1);
+	return getVulkanContext().device.allocateCommandBuffers(commandBufferAllocateInfo)[0];
+}
+
+void lune::vulkan::UploadContext::recordMipBlits(vk::CommandBuffer commandBuffer, vk::Image image, const vk::ImageSubresourceRange& range, vk::Extent2D extent)
+{
+	const uint32 lastLevel = range.baseMipLevel + range.levelCount - 1;
+
+	int32 width = extent.width;
+	int32 height = extent.height;
+	for (uint32 level = range.baseMipLevel + 1; level <= lastLevel; ++level)
+	{
+		// previous mip written by copy or blit before, read from now on
+		const vk::ImageMemoryBarrier srcBarrier =
+			vk::ImageMemoryBarrier()
+				.setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+				.setDstAccessMask(vk::AccessFlagBits::eTransferRead)
+				.setOldLayout(vk::ImageLayout::eTransferDstOptimal)
+				.setNewLayout(vk::ImageLayout::eTransferSrcOptimal)
+				.setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+				.setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+				.setImage(image)
+				.setSubresourceRange(vk::ImageSubresourceRange(range.aspectMask, level - 1, 1, range.baseArrayLayer, range.layerCount));
+
+		commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eTransfer, {}, {}, {}, srcBarrier);
+
+		const int32 nextWidth = std::max(width / 2, 1);
+		const int32 nextHeight = std::max(height / 2, 1);
+
+		const vk::ImageBlit blit =
+			vk::ImageBlit()
+				.setSrcSubresource(vk::ImageSubresourceLayers(range.aspectMask, level - 1, range.baseArrayLayer, range.layerCount))
+				.setSrcOffsets({vk::Offset3D(0, 0, 0), vk::Offset3D(width, height, 1)})
+				.setDstSubresource(vk::ImageSubresourceLayers(range.aspectMask, level, range.baseArrayLayer, range.layerCount))
+				.setDstOffsets({vk::Offset3D(0, 0, 0), vk::Offset3D(nextWidth, nextHeight, 1)});
+
+		commandBuffer.blitImage(image, vk::ImageLayout::eTransferSrcOptimal, image, vk::ImageLayout::eTransferDstOptimal, blit, vk::Filter::eLinear);
+
+		width = nextWidth;
+		height = nextHeight;
+	}
+
+	// every mip but last one was blit source
+	std::vector<vk::ImageMemoryBarrier> shaderReadBarriers{};
+	if (range.levelCount > 1)
+	{
+		shaderReadBarriers.push_back(
+			vk::ImageMemoryBarrier()
+				.setSrcAccessMask(vk::AccessFlagBits::eTransferRead)
+				.setDstAccessMask(vk::AccessFlagBits::eShaderRead)
+				.setOldLayout(vk::ImageLayout::eTransferSrcOptimal)
+				.setNewLayout(vk::ImageLayout::eShaderReadOnlyOptimal)
+				.setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+				.setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+				.setImage(image)
+				.setSubresourceRange(vk::ImageSubresourceRange(range.aspectMask, range.baseMipLevel, range.levelCount - 1, range.baseArrayLayer, range.layerCount)));
+	}
+	shaderReadBarriers.push_back(
+		vk::ImageMemoryBarrier()
+			.setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+			.setDstAccessMask(vk::AccessFlagBits::eShaderRead)
+			.setOldLayout(vk::ImageLayout::eTransferDstOptimal)
+			.setNewLayout(vk::ImageLayout::eShaderReadOnlyOptimal)
+			.setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+			.setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+			.setImage(image)
+			.setSubresourceRange(vk::ImageSubresourceRange(range.aspectMask, lastLevel, 1, range.baseArrayLayer, range.layerCount)));
+
+	commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, ConsumerStages, {}, {}, {}, shaderReadBarriers);
+}
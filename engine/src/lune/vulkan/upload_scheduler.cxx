@@ -0,0 +1,82 @@
+#include "lune/vulkan/upload_scheduler.hxx"
+
+#include <algorithm>
+#include <iterator>
+
+static float millisecondsSince(std::chrono::steady_clock::time_point time, std::chrono::steady_clock::time_point now)
+{
+	return std::chrono::duration<float, std::milli>(now - time).count();
+}
+
+lune::vulkan::UploadScheduler& lune::getVulkanUploadScheduler() noexcept
+{
+	static vulkan::UploadScheduler scheduler{};
+	return scheduler;
+}
+
+void lune::vulkan::UploadScheduler::shutdown()
+{
+	mJobs.clear();
+}
+
+void lune::vulkan::UploadScheduler::enqueue(Job job, vk::DeviceSize size, float priority, uint64 group)
+{
+	mJobs.push_back(QueuedJob{std::move(job), size, priority, group, mSequence++, std::chrono::steady_clock::now()});
+}
+
+void lune::vulkan::UploadScheduler::setGroupPriority(uint64 group, float priority)
+{
+	for (QueuedJob& queued : mJobs)
+	{
+		if (queued.group == group)
+			queued.priority = priority;
+	}
+}
+
+void lune::vulkan::UploadScheduler::cancelGroup(uint64 group)
+{
+	std::erase_if(mJobs, [group](const QueuedJob& queued)
+		{ return queued.group == group; });
+}
+
+void lune::vulkan::UploadScheduler::drain()
+{
+	mStats = UploadSchedulerStats{};
+
+	// jobs may enqueue more while running, those wait for next drain
+	std::vector<QueuedJob> jobs = std::move(mJobs);
+	mJobs.clear();
+	std::sort(jobs.begin(), jobs.end(), [](const QueuedJob& a, const QueuedJob& b)
+		{ return a.priority != b.priority ? a.priority > b.priority : a.sequence < b.sequence; });
+
+	const auto beginTime = std::chrono::steady_clock::now();
+	float latencySum{};
+	size_t drained{};
+	for (; drained < jobs.size(); ++drained)
+	{
+		QueuedJob& queued = jobs[drained];
+		const auto now = std::chrono::steady_clock::now();
+		if (drained > 0 && (mStats.drainedBytes + queued.size > mSettings.byteBudget || millisecondsSince(beginTime, now) >= mSettings.timeBudgetMs))
+			break;
+
+		const float latency = millisecondsSince(queued.enqueueTime, now);
+		latencySum += latency;
+		mStats.maxLatencyMs = std::max(mStats.maxLatencyMs, latency);
+		mStats.drainedBytes += queued.size;
+		++mStats.drainedCount;
+
+		queued.job();
+	}
+
+	const auto endTime = std::chrono::steady_clock::now();
+	mStats.drainMs = millisecondsSince(beginTime, endTime);
+	mStats.averageLatencyMs = drained > 0 ? latencySum / drained : 0.f;
+
+	mJobs.insert(mJobs.end(), std::make_move_iterator(jobs.begin() + drained), std::make_move_iterator(jobs.end()));
+	for (const QueuedJob& queued : mJobs)
+	{
+		mStats.queuedBytes += queued.size;
+		mStats.oldestWaitMs = std::max(mStats.oldestWaitMs, millisecondsSince(queued.enqueueTime, endTime));
+	}
+	mStats.queuedCount = mJobs.size();
+}
@@ -3,6 +3,7 @@
 #include "backends/imgui_impl_sdl3.h"
 #include "backends/imgui_impl_vulkan.h"
 #include "lune/core/log.hxx"
+#include "lune/vulkan/upload_context.hxx"
 #include "lune/vulkan/vulkan_core.hxx"
 #include "lune/vulkan/vulkan_subsystem.hxx"
 
@@ -136,6 +137,9 @@ void lune::vulkan::View::recreateSwapchain()
 	if (mDepthImage)
 		mDepthImage = DepthImage::create(getCurrentExtent());
 
+	if (mDepthPyramid)
+		mDepthPyramid = DepthPyramid::create(*mDepthImage);
+
 	if (mMsaaImage)
 		mMsaaImage = MsaaImage::create(getCurrentExtent());
 
@@ -185,7 +189,7 @@ bool lune::vulkan::View::beginNextFrame()
 			vk::CommandBufferAllocateInfo()
 				.setLevel(vk::CommandBufferLevel::ePrimary)
 				.setCommandBufferCount(1)
-				.setCommandPool(getVulkanContext().transferCommandPool);
+				.setCommandPool(getVulkanContext().graphicsCommandPool);
 		mCopyCommandBuffer = getVulkanContext().device.allocateCommandBuffers(commandBufferAllocateInfo)[0];
 	}
 	{
@@ -208,6 +212,18 @@ bool lune::vulkan::View::beginNextFrame()
 }
 
 void lune::vulkan::View::beginRenderPass()
+{
+	if (!mDepthPyramidEnabled)
+		mDepthPyramid.reset();
+	else if (!mDepthPyramid && getVulkanConfig().sampledDepth)
+		mDepthPyramid = DepthPyramid::create(*mDepthImage);
+
+	// decided before systems record anything, they find out from getDepthPyramid
+	mSplitPass = mDepthPyramid != nullptr;
+	beginRenderPass(mSplitPass ? getVulkanContext().splitRenderPass : getVulkanContext().renderPass);
+}
+
+void lune::vulkan::View::beginRenderPass(vk::RenderPass renderPass)
 {
 	std::array<vk::ClearValue, 2> clearValues{};
 	clearValues[0].color = vk::ClearColorValue(std::array<float, 4>{0.0F, 0.0F, 0.0F, 1.0F});
@@ -215,7 +231,7 @@ void lune::vulkan::View::beginRenderPass()
 
 	const vk::RenderPassBeginInfo renderPassBeginInfo =
 		vk::RenderPassBeginInfo()
-			.setRenderPass(getVulkanContext().renderPass)
+			.setRenderPass(renderPass)
 			.setFramebuffer(mFramebuffers[mImageIndex])
 			.setRenderArea(vk::Rect2D(vk::Offset2D(0, 0), mCurrentExtent))
 			.setClearValues(clearValues);
@@ -232,7 +248,7 @@ void lune::vulkan::View::sumbit()
 	ImGui::Render();
 	ImGui::EndFrame();
 
-	{ // submit copy command buffer
+	{ // submit copy command buffer, per frame data consumed right away so it stays on graphics queue
 		mCopyCommandBuffer.end();
 		const std::array<vk::Semaphore, 1> submitWaitSemaphores = {mSemaphoreImageAvailable};
 		const std::array<vk::Semaphore, 1> submitSignalSemaphores = {mSemaphoreCopyComplete};
@@ -244,10 +260,27 @@ void lune::vulkan::View::sumbit()
 				.setSignalSemaphores(submitSignalSemaphores)
 				.setWaitDstStageMask(submitWaitDstStages)
 				.setCommandBuffers(submitCommandBuffers);
-		getVulkanContext().transferQueue.submit(submitInfo);
+		getVulkanContext().graphicsQueue.submit(submitInfo);
 		mCopyCommandBuffer = nullptr;
 	}
 
+	if (mSplitPass)
+	{
+		const auto endPass = [this]()
+		{
+			mImageCommandBuffer.endRenderPass();
+		};
+		const auto resumePass = [this]()
+		{
+			beginRenderPass(getVulkanContext().resumeRenderPass);
+		};
+		mRenderQueue.execute(mImageCommandBuffer, endPass, resumePass);
+	}
+	else
+	{
+		mRenderQueue.execute(mImageCommandBuffer);
+	}
+
 	ImGui::SetCurrentContext(mImGuiContext);
 	auto drawData = ImGui::GetDrawData();
 	ImGui_ImplVulkan_RenderDrawData(drawData, mImageCommandBuffer);
@@ -255,13 +288,25 @@ void lune::vulkan::View::sumbit()
 	mImageCommandBuffer.endRenderPass();
 	mImageCommandBuffer.end();
 
-	const std::array<vk::Semaphore, 1> submitWaitSemaphores = {mSemaphoreCopyComplete};
+	// resources uploaded during frame must be ready before rendering, background ones only once swapped in by their users
+	getVulkanUploadContext().submit();
+	const UploadTicket uploadTicket = getVulkanUploadContext().getFrameTicket();
+
+	const std::array<vk::Semaphore, 2> submitWaitSemaphores = {mSemaphoreCopyComplete, getVulkanUploadContext().getSemaphore()};
+	const std::array<uint64, 2> submitWaitValues = {0, uploadTicket};
 	const std::array<vk::Semaphore, 1> submitSignalSemaphores = {mSemaphoresRenderFinished[mImageIndex]};
-	const std::array<vk::PipelineStageFlags, 1> submitWaitDstStages = {vk::PipelineStageFlagBits::eColorAttachmentOutput};
+	const std::array<uint64, 1> submitSignalValues = {0};
+	const std::array<vk::PipelineStageFlags, 2> submitWaitDstStages = {vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eVertexShader | vk::PipelineStageFlagBits::eFragmentShader, vk::PipelineStageFlagBits::eVertexInput | vk::PipelineStageFlagBits::eVertexShader | vk::PipelineStageFlagBits::eFragmentShader};
 	const std::array<vk::CommandBuffer, 1> submitCommandBuffers = {mImageCommandBuffer};
 
+	const auto timelineSubmitInfo =
+		vk::TimelineSemaphoreSubmitInfo()
+			.setWaitSemaphoreValues(submitWaitValues)
+			.setSignalSemaphoreValues(submitSignalValues);
+
 	const vk::SubmitInfo submitInfo =
 		vk::SubmitInfo()
+			.setPNext(&timelineSubmitInfo)
 			.setWaitSemaphores(submitWaitSemaphores)
 			.setSignalSemaphores(submitSignalSemaphores)
 			.setWaitDstStageMask(submitWaitDstStages)
@@ -5,7 +5,189 @@
 #define VMA_IMPLEMENTATION
 #include "lune/vulkan/vma.hxx"
 
+#include "lune/core/log.hxx"
+
+#include <algorithm>
+#include <array>
+#include <map>
+#include <tuple>
+
+namespace
+{
+	struct SmallBufferSizeClass
+	{
+		vk::DeviceSize maxSize{};
+		vk::DeviceSize blockSize{};
+	};
+
+	// each size class gets own pool per memory type, so tiny uniform buffers do not fragment blocks of larger ones
+	constexpr std::array<SmallBufferSizeClass, 3> SmallBufferSizeClasses = {
+		SmallBufferSizeClass{256, 256 * 1024},
+		SmallBufferSizeClass{4 * 1024, 2 * 1024 * 1024},
+		SmallBufferSizeClass{64 * 1024, 16 * 1024 * 1024}};
+
+	// (memory type index, size class index) -> pool
+	using SmallBufferPoolMap = std::map<std::tuple<uint32, uint32>, VmaPool>;
+
+	SmallBufferPoolMap& getSmallBufferPools()
+	{
+		static SmallBufferPoolMap pools{};
+		return pools;
+	}
+} // namespace
+
 vk::DeviceSize vma::getAllocationSize(VmaAllocation allocation)
 {
 	return vk::DeviceSize(allocation->GetSize());
-}
\ No newline at end of file
+}
+
+VmaPool vma::findSmallBufferPool(VmaAllocator allocator, const vk::BufferCreateInfo& bufferCreateInfo, const VmaAllocationCreateInfo& allocationCreateInfo)
+{
+	constexpr vk::BufferUsageFlags pooledUsage = vk::BufferUsageFlagBits::eUniformBuffer | vk::BufferUsageFlagBits::eStorageBuffer;
+	if (!(bufferCreateInfo.usage & pooledUsage))
+		return nullptr;
+	if (allocationCreateInfo.pool || allocationCreateInfo.flags & VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT)
+		return nullptr;
+
+	const auto sizeClassIt = std::find_if(SmallBufferSizeClasses.begin(), SmallBufferSizeClasses.end(), [size = bufferCreateInfo.size](const SmallBufferSizeClass& sizeClass)
+		{ return size <= sizeClass.maxSize; });
+	if (sizeClassIt == SmallBufferSizeClasses.end())
+		return nullptr;
+
+	const uint32 sizeClassIndex = std::distance(SmallBufferSizeClasses.begin(), sizeClassIt);
+
+	uint32 memoryTypeIndex{};
+	const VkResult findRes = vmaFindMemoryTypeIndexForBufferInfo(allocator, reinterpret_cast<const VkBufferCreateInfo*>(&bufferCreateInfo), &allocationCreateInfo, &memoryTypeIndex);
+	if (findRes != VK_SUCCESS) [[unlikely]]
+		return nullptr;
+
+	auto& pools = getSmallBufferPools();
+	if (auto it = pools.find({memoryTypeIndex, sizeClassIndex}); it != pools.end()) [[likely]]
+		return it->second;
+
+	VmaPoolCreateInfo poolCreateInfo{};
+	poolCreateInfo.memoryTypeIndex = memoryTypeIndex;
+	poolCreateInfo.blockSize = sizeClassIt->blockSize;
+
+	VmaPool pool{};
+	if (vmaCreatePool(allocator, &poolCreateInfo, &pool) != VK_SUCCESS) [[unlikely]]
+	{
+		LN_LOG(Warning, Vulkan::Vma, "Failed to create small buffer pool for memory type {}, size class {}", memoryTypeIndex, sizeClassIt->maxSize);
+		return nullptr;
+	}
+
+	vmaSetPoolName(allocator, pool, "lune::smallBufferPool");
+	pools.emplace(std::make_tuple(memoryTypeIndex, sizeClassIndex), pool);
+	return pool;
+}
+
+void vma::destroySmallBufferPools(VmaAllocator allocator)
+{
+	auto& pools = getSmallBufferPools();
+	for (auto& [key, pool] : pools)
+		vmaDestroyPool(allocator, pool);
+	pools.clear();
+}
+
+vma::Statistics vma::calculateStatistics(VmaAllocator allocator)
+{
+	VmaTotalStatistics totalStatistics{};
+	vmaCalculateStatistics(allocator, &totalStatistics);
+
+	const VmaDetailedStatistics& total = totalStatistics.total;
+
+	Statistics result{};
+	result.allocationCount = total.statistics.allocationCount;
+	result.blockCount = total.statistics.blockCount;
+	result.unusedRangeCount = total.unusedRangeCount;
+	result.allocationBytes = total.statistics.allocationBytes;
+	result.blockBytes = total.statistics.blockBytes;
+
+	// free ranges of different heaps can never be merged, so fragmentation only means something per heap
+	const VkPhysicalDeviceMemoryProperties* memoryProperties{};
+	vmaGetMemoryProperties(allocator, &memoryProperties);
+	for (uint32 i = 0; i < memoryProperties->memoryHeapCount; ++i)
+	{
+		const VmaDetailedStatistics& heap = totalStatistics.memoryHeap[i];
+
+		auto& heapResult = result.heaps.emplace_back();
+		heapResult.heapIndex = i;
+		heapResult.deviceLocal = memoryProperties->memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
+		heapResult.blockCount = heap.statistics.blockCount;
+		heapResult.allocationBytes = heap.statistics.allocationBytes;
+		heapResult.blockBytes = heap.statistics.blockBytes;
+		heapResult.largestUnusedRange = heap.unusedRangeCount ? heap.unusedRangeSizeMax : 0;
+
+		const vk::DeviceSize unusedBytes = heapResult.blockBytes - heapResult.allocationBytes;
+		heapResult.fragmentation = unusedBytes ? 1.f - static_cast<float>(heapResult.largestUnusedRange) / static_cast<float>(unusedBytes) : 0.f;
+	}
+
+	for (const auto& [key, pool] : getSmallBufferPools())
+	{
+		VmaStatistics poolStatistics{};
+		vmaGetPoolStatistics(allocator, pool, &poolStatistics);
+
+		auto& poolResult = result.smallBufferPools.emplace_back();
+		poolResult.memoryTypeIndex = std::get<0>(key);
+		poolResult.sizeClass = SmallBufferSizeClasses[std::get<1>(key)].maxSize;
+		poolResult.allocationCount = poolStatistics.allocationCount;
+		poolResult.blockCount = poolStatistics.blockCount;
+		poolResult.allocationBytes = poolStatistics.allocationBytes;
+		poolResult.blockBytes = poolStatistics.blockBytes;
+	}
+
+	return result;
+}
+
+std::vector<vma::HeapBudget> vma::getHeapBudgets(VmaAllocator allocator)
+{
+	const VkPhysicalDeviceMemoryProperties* memoryProperties{};
+	vmaGetMemoryProperties(allocator, &memoryProperties);
+
+	std::array<VmaBudget, VK_MAX_MEMORY_HEAPS> heapBudgets{};
+	vmaGetHeapBudgets(allocator, heapBudgets.data());
+
+	std::vector<HeapBudget> result(memoryProperties->memoryHeapCount);
+	for (uint32 i = 0; i < memoryProperties->memoryHeapCount; ++i)
+	{
+		result[i].heapIndex = i;
+		result[i].deviceLocal = memoryProperties->memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
+		result[i].allocationCount = heapBudgets[i].statistics.allocationCount;
+		result[i].allocationBytes = heapBudgets[i].statistics.allocationBytes;
+		result[i].blockBytes = heapBudgets[i].statistics.blockBytes;
+		result[i].usage = heapBudgets[i].usage;
+		result[i].budget = heapBudgets[i].budget;
+	}
+	return result;
+}
+
+vma::Budget vma::getDeviceLocalBudget(VmaAllocator allocator)
+{
+	Budget result{};
+	for (const HeapBudget& heap : getHeapBudgets(allocator))
+	{
+		if (!heap.deviceLocal)
+			continue;
+
+		result.usage += heap.usage;
+		result.budget += heap.budget;
+	}
+	return result;
+}
+
+void vma::logStatistics(VmaAllocator allocator)
+{
+	const Statistics stats = calculateStatistics(allocator);
+	LN_LOG(Info, Vulkan::Vma, "Allocations: {0}, device memory blocks: {1}, used {2} / {3} bytes", stats.allocationCount, stats.blockCount, stats.allocationBytes, stats.blockBytes);
+	for (const auto& heap : stats.heaps)
+	{
+		if (!heap.blockCount)
+			continue;
+
+		LN_LOG(Info, Vulkan::Vma, "	heap {0}{1}: blocks: {2}, used {3} / {4} bytes, fragmentation {5:.3f}", heap.heapIndex, heap.deviceLocal ? " (device local)" : "", heap.blockCount, heap.allocationBytes, heap.blockBytes, heap.fragmentation);
+	}
+	for (const auto& pool : stats.smallBufferPools)
+	{
+		LN_LOG(Info, Vulkan::Vma, "	small pool <= {0} bytes (memory type {1}): allocations: {2}, blocks: {3}, used {4} / {5} bytes", pool.sizeClass, pool.memoryTypeIndex, pool.allocationCount, pool.blockCount, pool.allocationBytes, pool.blockBytes);
+	}
+}
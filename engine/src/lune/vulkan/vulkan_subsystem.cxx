@@ -7,14 +7,21 @@
 #include "lune/core/log.hxx"
 #include "lune/core/sdl.hxx"
 #include "lune/lune.hxx"
+#include "lune/vulkan/bindless_heap.hxx"
+#include "lune/vulkan/descriptor_allocator.hxx"
 #include "lune/vulkan/material.hxx"
 #include "lune/vulkan/pipeline.hxx"
 #include "lune/vulkan/primitive.hxx"
 #include "lune/vulkan/sampler.hxx"
 #include "lune/vulkan/shader.hxx"
 #include "lune/vulkan/texture_image.hxx"
+#include "lune/vulkan/texture_streamer.hxx"
+#include "lune/vulkan/upload_context.hxx"
+#include "lune/vulkan/upload_scheduler.hxx"
+#include "lune/vulkan/vma.hxx"
 #include "lune/vulkan/vulkan_core.hxx"
 
+#include <optional>
 #include <vector>
 #include <vulkan/vulkan_core.h>
 #include <vulkan/vulkan_structs.hpp>
@@ -48,27 +55,44 @@ lune::VulkanSubsystem::~VulkanSubsystem()
 {
 	getVulkanContext().device.waitIdle();
 
+	vma::logStatistics(getVulkanContext().vmaAllocator);
+
+	getVulkanUploadScheduler().shutdown();
+	getVulkanTextureStreamer().shutdown();
+	mTextureAtlases.clear();
 	mTextureImages.clear();
 	mSamplers.clear();
 	mGraphicsPipelines.clear();
+	mComputePipelines.clear();
 	mShaders.clear();
 	mPrimitives.clear();
 	mMaterials.clear();
 	mViews.clear();
 
+	getVulkanBindlessHeap().shutdown();
+	getVulkanUploadContext().shutdown();
+
 	getVulkanDeleteQueue().cleanup();
 
+	getVulkanDescriptorAllocator().shutdown();
+
 	if (getVulkanContext().graphicsCommandPool)
 		getVulkanContext().device.destroyCommandPool(getVulkanContext().graphicsCommandPool);
 
 	if (getVulkanContext().transferCommandPool)
 		getVulkanContext().device.destroyCommandPool(getVulkanContext().transferCommandPool);
 
-	if (getVulkanContext().renderPass)
-		getVulkanContext().device.destroyRenderPass(getVulkanContext().renderPass);
+	for (vk::RenderPass renderPass : {getVulkanContext().renderPass, getVulkanContext().splitRenderPass, getVulkanContext().resumeRenderPass})
+	{
+		if (renderPass)
+			getVulkanContext().device.destroyRenderPass(renderPass);
+	}
 
 	if (getVulkanContext().vmaAllocator)
+	{
+		vma::destroySmallBufferPools(getVulkanContext().vmaAllocator);
 		vmaDestroyAllocator(getVulkanContext().vmaAllocator);
+	}
 
 	if (getVulkanContext().device)
 		getVulkanContext().device.destroy();
@@ -116,10 +140,21 @@ void lune::VulkanSubsystem::initialize()
 
 	getVulkanConfig().colorFormat = vk::Format::eB8G8R8A8Unorm;
 	getVulkanConfig().depthFormat = findSupportedDepthFormat(getVulkanContext().physicalDevice);
-	getVulkanConfig().sampleCount = vk::SampleCountFlagBits::e8;
-
+	getVulkanConfig().sampledDepth = static_cast<bool>(getVulkanContext().physicalDevice.getFormatProperties(getVulkanConfig().depthFormat).optimalTilingFeatures & vk::FormatFeatureFlagBits::eSampledImage);
 	const auto mPhysicalDeviceProperies = getVulkanContext().physicalDevice.getProperties();
 
+	// up to 8 samples, software implementations often stop at 4
+	const vk::SampleCountFlags sampleCounts = mPhysicalDeviceProperies.limits.framebufferColorSampleCounts & mPhysicalDeviceProperies.limits.framebufferDepthSampleCounts;
+	getVulkanConfig().sampleCount = vk::SampleCountFlagBits::e1;
+	for (const auto sampleCount : {vk::SampleCountFlagBits::e8, vk::SampleCountFlagBits::e4, vk::SampleCountFlagBits::e2})
+	{
+		if (sampleCounts & sampleCount)
+		{
+			getVulkanConfig().sampleCount = sampleCount;
+			break;
+		}
+	}
+
 	const uint32 deviceApiVersion = mPhysicalDeviceProperies.apiVersion;
 	LN_LOG(Info, Vulkan, "Selected device:", mPhysicalDeviceProperies.deviceName.data(), mPhysicalDeviceProperies.deviceID);
 	LN_LOG(Info, Vulkan, "	GPU: {0} (id: {1})", mPhysicalDeviceProperies.deviceName.data(), mPhysicalDeviceProperies.deviceID);
@@ -132,6 +167,10 @@ void lune::VulkanSubsystem::initialize()
 	vulkan::createTransferCommandPool(getVulkanContext());
 	vulkan::createVmaAllocator(getVulkanContext());
 
+	getVulkanUploadContext().init();
+	getVulkanDescriptorAllocator().init();
+	getVulkanBindlessHeap().init();
+
 	loadDefaultAssets();
 }
 
@@ -203,6 +242,22 @@ lune::vulkan::SharedGraphicsPipeline lune::VulkanSubsystem::findPipeline(const s
 	return findRes != mGraphicsPipelines.end() ? findRes->second : nullptr;
 }
 
+void lune::VulkanSubsystem::addComputePipeline(std::string name, vulkan::SharedComputePipeline pipeline)
+{
+	if (mComputePipelines.find(name) != mComputePipelines.end())
+	{
+		LN_LOG(Fatal, Vulkan, "Can't emplace new compute pipeline, name already taken: {}", name);
+		return;
+	}
+	mComputePipelines.emplace(name, std::move(pipeline));
+}
+
+lune::vulkan::SharedComputePipeline lune::VulkanSubsystem::findComputePipeline(const std::string& name)
+{
+	auto findRes = mComputePipelines.find(name);
+	return findRes != mComputePipelines.end() ? findRes->second : nullptr;
+}
+
 void lune::VulkanSubsystem::addPrimitive(std::string name, vulkan::SharedPrimitive primitive)
 {
 	if (mPrimitives.find(name) != mPrimitives.end())
@@ -235,6 +290,43 @@ lune::vulkan::SharedTextureImage lune::VulkanSubsystem::findTextureImage(const s
 	return findRes != mTextureImages.end() ? findRes->second : nullptr;
 }
 
+void lune::VulkanSubsystem::addTextureAtlas(std::string name, vulkan::UniqueTextureAtlas atlas)
+{
+	if (mTextureAtlases.find(name) != mTextureAtlases.end())
+	{
+		LN_LOG(Fatal, Vulkan, "Can't emplace new texture atlas, name already taken: {}", name);
+		return;
+	}
+	atlas->commit();
+	mTextureAtlases.emplace(name, std::move(atlas));
+}
+
+lune::vulkan::TextureAtlas* lune::VulkanSubsystem::findTextureAtlas(const std::string& name)
+{
+	auto findRes = mTextureAtlases.find(name);
+	return findRes != mTextureAtlases.end() ? findRes->second.get() : nullptr;
+}
+
+lune::vulkan::SharedTextureImage lune::VulkanSubsystem::findImage(const std::string& name, lnm::vec4& outUvRect)
+{
+	for (const auto& [atlasName, atlas] : mTextureAtlases)
+	{
+		const vulkan::AtlasRegion* region = atlas->findRegion(name);
+		if (!region || !atlas->getPageTexture(region->page))
+			continue;
+
+		outUvRect = region->uvRect;
+		return atlas->getPageTexture(region->page);
+	}
+
+	if (auto texImage = findTextureImage(name))
+	{
+		outUvRect = lnm::vec4(0.f, 0.f, 1.f, 1.f);
+		return texImage;
+	}
+	return nullptr;
+}
+
 void lune::VulkanSubsystem::addSampler(std::string name, vulkan::SharedSampler sampler)
 {
 	if (mSamplers.find(name) != mSamplers.end())
@@ -270,6 +362,21 @@ lune::vulkan::SharedMaterial lune::VulkanSubsystem::findMaterial(const std::stri
 bool lune::VulkanSubsystem::beginNextFrame(uint32 viewId)
 {
 	getVulkanDeleteQueue().cleanup();
+	getVulkanUploadContext().collect();
+
+	// streamed mips and queued uploads recorded within budget into batches frame doesn't wait for
+	// streamer keeps old views bound till their uploads complete, loads spawn entities only then
+	getVulkanUploadContext().beginBackground();
+	getVulkanTextureStreamer().update();
+	getVulkanUploadScheduler().drain();
+	getVulkanUploadContext().endBackground();
+
+	// previous frame submission waited on, transient sets no longer in use
+	getVulkanDescriptorAllocator().resetTransient();
+
+	// atlas pages not in use anymore either, safe to update in place
+	for (auto& [name, atlas] : mTextureAtlases)
+		atlas->commit();
 
 	if (const auto it = mViews.find(viewId); it != mViews.end()) [[likely]]
 	{
@@ -280,6 +387,23 @@ bool lune::VulkanSubsystem::beginNextFrame(uint32 viewId)
 	return false;
 }
 
+vma::Statistics lune::VulkanSubsystem::getMemoryStatistics() const
+{
+	return vma::calculateStatistics(getVulkanContext().vmaAllocator);
+}
+
+std::vector<vma::HeapBudget> lune::VulkanSubsystem::getMemoryBudgets() const
+{
+	return vma::getHeapBudgets(getVulkanContext().vmaAllocator);
+}
+
+lune::vulkan::RenderQueueStats lune::VulkanSubsystem::getRenderQueueStats(uint32 viewId) const
+{
+	if (const auto it = mViews.find(viewId); it != mViews.end())
+		return it->second->getRenderQueue().getStats();
+	return vulkan::RenderQueueStats();
+}
+
 lune::FrameInfo lune::VulkanSubsystem::getFrameInfo()
 {
 	if (const auto it = mViews.find(mCurrentFrameViewId); it != mViews.end()) [[likely]]
@@ -291,6 +415,8 @@ lune::FrameInfo lune::VulkanSubsystem::getFrameInfo()
 		info.imageIndex = view->getImageIndex();
 		info.copyCommandBuffer = view->getCurrentImageCopyCmdBuffer();
 		info.renderCommandBuffer = view->getCurrentImageCmdBuffer();
+		info.renderQueue = &view->getRenderQueue();
+		info.depthPyramid = view->getDepthPyramid();
 
 		return std::move(info);
 	}
@@ -316,20 +442,29 @@ void lune::VulkanSubsystem::sumbitFrame()
 	mCurrentFrameViewId = UINT32_MAX;
 }
 
-void lune::VulkanSubsystem::loadDefaultAssets()
+// page of built in sprite atlas, room left for images apps add to it
+constexpr uint32 SpriteAtlasPageSize = 512;
+
+// pattern of missing textures
+static lune::UniqueSDLSurface createDefaultSurface()
 {
+	lune::UniqueSDLSurface surface = lune::UniqueSDLSurface(SDL_CreateSurface(64, 64, SDL_PixelFormat::SDL_PIXELFORMAT_RGBA32));
+	const uint8 magnetta[4] = {255, 0, 255, 255};
+	const uint8 black[4] = {0, 0, 0, 255};
+	const auto wh = surface->w * surface->h;
+	for (uint32_t i = 0; i < wh; ++i)
 	{
-		UniqueSDLSurface surface = UniqueSDLSurface(SDL_CreateSurface(64, 64, SDL_PixelFormat::SDL_PIXELFORMAT_RGBA32));
-		const uint8 magnetta[4] = {255, 0, 255, 255};
-		const uint8 black[4] = {0, 0, 0, 255};
-		const auto wh = surface->w * surface->h;
-		for (uint32_t i = 0; i < wh; ++i)
-		{
-			uint8* pixels = reinterpret_cast<uint8*>(surface->pixels);
-			const uint8* src = i % 3 || i == 1 ? &magnetta[0] : &black[0];
-			memcpy(&pixels[i * 4], src, 4);
-		}
+		uint8* pixels = reinterpret_cast<uint8*>(surface->pixels);
+		const uint8* src = i % 3 || i == 1 ? &magnetta[0] : &black[0];
+		memcpy(&pixels[i * 4], src, 4);
+	}
+	return surface;
+}
 
+void lune::VulkanSubsystem::loadDefaultAssets()
+{
+	{
+		UniqueSDLSurface surface = createDefaultSurface();
 		addTextureImage("lune::default", vulkan::TextureImage::create(surface.get()));
 		auto createInfo = vulkan::Sampler::defaultCreateInfo()
 							  .setMagFilter(vk::Filter::eNearest)
@@ -337,10 +472,26 @@ void lune::VulkanSubsystem::loadDefaultAssets()
 		addSampler("lune::default", vulkan::Sampler::create(std::move(createInfo)));
 	}
 
+	if (getVulkanConfig().drawIndirectCount)
+	{
+		auto shComp = loadShader(*EngineShaderPath("gltf/cull.comp.spv"));
+		addComputePipeline("lune::gltf::cull", vulkan::ComputePipeline::create(shComp));
+	}
+	if (getVulkanConfig().sampledDepth)
+	{
+		auto shCopyDepth = loadShader(*EngineShaderPath("hiz/copy_depth.comp.spv"));
+		addComputePipeline("lune::hiz::copyDepth", vulkan::ComputePipeline::create(shCopyDepth));
+		auto shCopyDepthMs = loadShader(*EngineShaderPath("hiz/copy_depth_ms.comp.spv"));
+		addComputePipeline("lune::hiz::copyDepthMs", vulkan::ComputePipeline::create(shCopyDepthMs));
+		auto shReduce = loadShader(*EngineShaderPath("hiz/reduce.comp.spv"));
+		addComputePipeline("lune::hiz::reduce", vulkan::ComputePipeline::create(shReduce));
+	}
 	{
 		auto shVert = loadShader(*EngineShaderPath("sprite.vert.spv"));
 		auto shFrag = loadShader(*EngineShaderPath("sprite.frag.spv"));
-		addPipeline("lune::sprite", vulkan::GraphicsPipeline::create(shVert, shFrag));
+		vulkan::GraphicsPipeline::StatesOverride statesOverride{};
+		statesOverride.bindless = true;
+		addPipeline("lune::sprite", vulkan::GraphicsPipeline::create(shVert, shFrag, statesOverride));
 	}
 	{
 		auto shVert = loadShader(*EngineShaderPath("skybox.vert.spv"));
@@ -351,12 +502,34 @@ void lune::VulkanSubsystem::loadDefaultAssets()
 
 		vulkan::GraphicsPipeline::StatesOverride statesOverride{};
 		statesOverride.depthStencil = &depthStencil;
+		statesOverride.bindless = true;
 
 		addPipeline("lune::skybox", vulkan::GraphicsPipeline::create(shVert, shFrag, statesOverride));
 	}
 	{
-		UniqueSDLSurface scarlet = loadTextureImage((*EngineAssetPath("scarlet.png")).generic_string());
-		addTextureImage("lune::scarlet", vulkan::TextureImage::create(scarlet.get()));
+		// sprite images share atlas page, sprites drawn with them batched together
+		// atlas cached next to its sources, rebuilt once any source is newer
+		const std::filesystem::path atlasPath = *EngineAssetPath("sprites.atlas");
+		const std::filesystem::path scarletPath = *EngineAssetPath("scarlet.png");
+
+		std::error_code error{};
+		const auto atlasTime = std::filesystem::last_write_time(atlasPath, error);
+		const bool upToDate = !error && atlasTime >= std::filesystem::last_write_time(scarletPath, error) && !error;
+
+		vulkan::UniqueTextureAtlas atlas = upToDate ? vulkan::TextureAtlas::load(atlasPath) : nullptr;
+		if (!atlas || !atlas->findRegion("lune::scarlet") || !atlas->findRegion("lune::default"))
+		{
+			atlas = vulkan::TextureAtlas::create(SpriteAtlasPageSize);
+
+			UniqueSDLSurface scarlet = loadTextureImage(scarletPath.generic_string());
+			UniqueSDLSurface defaultSurface = createDefaultSurface();
+			atlas->add("lune::scarlet", scarlet.get());
+			atlas->add("lune::default", defaultSurface.get());
+
+			if (!atlas->save(atlasPath))
+				LN_LOG(Warning, Vulkan, "Sprite atlas not cached, rebuilt on next start");
+		}
+		addTextureAtlas("lune::sprites", std::move(atlas));
 	}
 	{
 		UniqueSDLSurface right = loadTextureImage((*EngineAssetPath("skyboxes/sea/right.png")).generic_string());
@@ -501,7 +674,26 @@ void lune::vulkan::findPhysicalDevice(VulkanContext& context)
 
 	LN_LOG(Info, Vulkan, "Avaiable physical devices:");
 
+	// discrete gpu preferred, cpu implementations (lavapipe) used only when nothing else available
+	const auto rankDeviceType = [](vk::PhysicalDeviceType type) -> int32
+	{
+		switch (type)
+		{
+		case vk::PhysicalDeviceType::eDiscreteGpu:
+			return 4;
+		case vk::PhysicalDeviceType::eIntegratedGpu:
+			return 3;
+		case vk::PhysicalDeviceType::eVirtualGpu:
+			return 2;
+		case vk::PhysicalDeviceType::eCpu:
+			return 1;
+		default:
+			return 0;
+		}
+	};
+
 	vk::PhysicalDevice selectedDevice{};
+	int32 selectedRank{};
 
 	for (size_t i = 0; i < physicalDevices.size(); ++i)
 	{
@@ -510,17 +702,11 @@ void lune::vulkan::findPhysicalDevice(VulkanContext& context)
 
 		LN_LOG(Info, Vulkan, "	{0}: {1} (id: {2})", i, physicalDeviceProperties.deviceName.data(), physicalDeviceProperties.deviceID);
 
-		if (vk::PhysicalDeviceType::eCpu == physicalDeviceProperties.deviceType ||
-			vk::PhysicalDeviceType::eOther == physicalDeviceProperties.deviceType)
+		const int32 rank = rankDeviceType(physicalDeviceProperties.deviceType);
+		if (rank > selectedRank)
 		{
-			continue;
-		}
-
-		selectedDevice = physicalDevice;
-		break;
-		if (vk::PhysicalDeviceType::eDiscreteGpu == physicalDeviceProperties.deviceType)
-		{
-			break;
+			selectedDevice = physicalDevice;
+			selectedRank = rank;
 		}
 	}
 	context.physicalDevice = selectedDevice;
@@ -531,8 +717,53 @@ void lune::vulkan::createDevice(VulkanContext& context)
 	auto extendedDynamicStateEXT = vk::PhysicalDeviceExtendedDynamicStateFeaturesEXT()
 									   .setExtendedDynamicState(VK_TRUE);
 
+	const auto supportedFeatures = context.physicalDevice.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVulkan12Features>();
+	const vk::PhysicalDeviceFeatures& supportedCoreFeatures = supportedFeatures.get<vk::PhysicalDeviceFeatures2>().features;
+
+	// gpu driven mesh draws, meshes drawn one by one without these
+	getVulkanConfig().drawIndirectCount = supportedFeatures.get<vk::PhysicalDeviceVulkan12Features>().drawIndirectCount &&
+										  supportedCoreFeatures.multiDrawIndirect && supportedCoreFeatures.drawIndirectFirstInstance;
+
+	// enabled along with all other supported core features below
+	getVulkanConfig().textureCompressionBC = supportedCoreFeatures.textureCompressionBC;
+
+	// descriptor indexing for bindless heap and timeline semaphore of uploads, no fallback without them
+	const vk::PhysicalDeviceVulkan12Features& supportedVulkan12Features = supportedFeatures.get<vk::PhysicalDeviceVulkan12Features>();
+	const std::array<std::pair<const char*, vk::Bool32>, 8> requiredVulkan12Features = {{
+		{"timelineSemaphore", supportedVulkan12Features.timelineSemaphore},
+		{"descriptorIndexing", supportedVulkan12Features.descriptorIndexing},
+		{"runtimeDescriptorArray", supportedVulkan12Features.runtimeDescriptorArray},
+		{"shaderSampledImageArrayNonUniformIndexing", supportedVulkan12Features.shaderSampledImageArrayNonUniformIndexing},
+		{"descriptorBindingPartiallyBound", supportedVulkan12Features.descriptorBindingPartiallyBound},
+		{"descriptorBindingSampledImageUpdateAfterBind", supportedVulkan12Features.descriptorBindingSampledImageUpdateAfterBind},
+		{"descriptorBindingStorageBufferUpdateAfterBind", supportedVulkan12Features.descriptorBindingStorageBufferUpdateAfterBind},
+		{"descriptorBindingUpdateUnusedWhilePending", supportedVulkan12Features.descriptorBindingUpdateUnusedWhilePending},
+	}};
+
+	for (const auto& [name, supported] : requiredVulkan12Features)
+	{
+		if (!supported)
+		{
+			LN_LOG(Fatal, Vulkan, "Required vulkan 1.2 feature \'{}\' not supported by {}", name,
+				   std::string_view(context.physicalDevice.getProperties().deviceName));
+			return;
+		}
+	}
+
+	auto vulkan12Features = vk::PhysicalDeviceVulkan12Features()
+								.setTimelineSemaphore(VK_TRUE)
+								.setDescriptorIndexing(VK_TRUE)
+								.setRuntimeDescriptorArray(VK_TRUE)
+								.setShaderSampledImageArrayNonUniformIndexing(VK_TRUE)
+								.setDescriptorBindingPartiallyBound(VK_TRUE)
+								.setDescriptorBindingSampledImageUpdateAfterBind(VK_TRUE)
+								.setDescriptorBindingStorageBufferUpdateAfterBind(VK_TRUE)
+								.setDescriptorBindingUpdateUnusedWhilePending(VK_TRUE)
+								.setDrawIndirectCount(getVulkanConfig().drawIndirectCount)
+								.setPNext(&extendedDynamicStateEXT);
+
 	vk::PhysicalDeviceFeatures2 enabledFeatures = context.physicalDevice.getFeatures2()
-													  .setPNext(&extendedDynamicStateEXT);
+													  .setPNext(&vulkan12Features);
 
 	const std::vector<vk::QueueFamilyProperties> queueFamilyProperties = context.physicalDevice.getQueueFamilyProperties();
 
@@ -593,16 +824,39 @@ void lune::vulkan::createQueues(VulkanContext& context)
 {
 	const auto queueFamilyProperties = context.physicalDevice.getQueueFamilyProperties();
 	const size_t queueFamilyPropertiesSize = queueFamilyProperties.size();
+
+	std::optional<uint32> graphicsQueueIndex{};
+	std::optional<uint32> transferOnlyQueueIndex{};
+	std::optional<uint32> nonGraphicsTransferQueueIndex{};
 	for (size_t i = 0; i < queueFamilyPropertiesSize; ++i)
 	{
 		const auto queueFlags = queueFamilyProperties[i].queueFlags;
-		if ((queueFlags & vk::QueueFlagBits::eGraphics) && (queueFlags & vk::QueueFlagBits::eTransfer))
+		if ((queueFlags & vk::QueueFlagBits::eGraphics) && (queueFlags & vk::QueueFlagBits::eCompute))
 		{
-			context.graphicsQueueIndex = i;
-			context.transferQueueIndex = i;
+			if (!graphicsQueueIndex)
+				graphicsQueueIndex = i;
+		}
+		else if (queueFlags & vk::QueueFlagBits::eTransfer)
+		{
+			// transfer only family usually backed by dedicated copy engine
+			if (!(queueFlags & vk::QueueFlagBits::eCompute) && !transferOnlyQueueIndex)
+				transferOnlyQueueIndex = i;
+			else if (!nonGraphicsTransferQueueIndex)
+				nonGraphicsTransferQueueIndex = i;
 		}
 	}
 
+	if (!graphicsQueueIndex) [[unlikely]]
+	{
+		LN_LOG(Fatal, Vulkan, "Failed to find queue family with graphics and compute support");
+		return;
+	}
+
+	context.graphicsQueueIndex = graphicsQueueIndex.value();
+	context.transferQueueIndex = transferOnlyQueueIndex.value_or(nonGraphicsTransferQueueIndex.value_or(context.graphicsQueueIndex));
+
+	LN_LOG(Info, Vulkan, "Queue families: graphics {0}, transfer {1}", context.graphicsQueueIndex, context.transferQueueIndex);
+
 	context.queueFamilyIndices.push_back(context.graphicsQueueIndex);
 	if (context.graphicsQueueIndex != context.transferQueueIndex)
 	{
@@ -629,7 +883,9 @@ void lune::vulkan::createTransferCommandPool(VulkanContext& context)
 	context.transferCommandPool = context.device.createCommandPool(transferCreateInfo);
 }
 
-void lune::vulkan::createRenderPass(VulkanContext& context)
+// split pass keeps color and depth for resumed pass, resumed pass loads them back
+// all variants compatible with each other, same framebuffers and pipelines used with any of them
+static vk::RenderPass createRenderPassVariant(vk::Device device, bool split, bool resume)
 {
 	const bool msaaEnabled = getVulkanConfig().sampleCount != vk::SampleCountFlagBits::e1;
 
@@ -638,26 +894,28 @@ void lune::vulkan::createRenderPass(VulkanContext& context)
 	std::vector<vk::AttachmentReference> attachmentReferences;
 	std::vector<vk::AttachmentReference> resolveAttachmentReferences;
 
+	const vk::ImageLayout presentLayout = msaaEnabled ? vk::ImageLayout::eColorAttachmentOptimal : vk::ImageLayout::ePresentSrcKHR;
 	attachmentsDescriptions.emplace_back() // color
 		.setFormat(getVulkanConfig().colorFormat)
 		.setSamples(getVulkanConfig().sampleCount)
-		.setLoadOp(vk::AttachmentLoadOp::eClear)
-		.setStoreOp(msaaEnabled ? vk::AttachmentStoreOp::eDontCare : vk::AttachmentStoreOp::eStore)
+		.setLoadOp(resume ? vk::AttachmentLoadOp::eLoad : vk::AttachmentLoadOp::eClear)
+		.setStoreOp(msaaEnabled && !split ? vk::AttachmentStoreOp::eDontCare : vk::AttachmentStoreOp::eStore)
 		.setStencilLoadOp(vk::AttachmentLoadOp::eDontCare)
 		.setStencilStoreOp(vk::AttachmentStoreOp::eDontCare)
-		.setInitialLayout(vk::ImageLayout::eUndefined)
-		.setFinalLayout(msaaEnabled ? vk::ImageLayout::eColorAttachmentOptimal : vk::ImageLayout::ePresentSrcKHR);
+		.setInitialLayout(resume ? vk::ImageLayout::eColorAttachmentOptimal : vk::ImageLayout::eUndefined)
+		.setFinalLayout(split ? vk::ImageLayout::eColorAttachmentOptimal : presentLayout);
 	attachmentReferences.push_back(vk::AttachmentReference(0, vk::ImageLayout::eColorAttachmentOptimal));
 
+	// split pass leaves depth readable by compute shaders
 	attachmentsDescriptions.emplace_back() // depth
 		.setFormat(getVulkanConfig().depthFormat)
 		.setSamples(getVulkanConfig().sampleCount)
-		.setLoadOp(vk::AttachmentLoadOp::eClear)
-		.setStoreOp(vk::AttachmentStoreOp::eDontCare)
+		.setLoadOp(resume ? vk::AttachmentLoadOp::eLoad : vk::AttachmentLoadOp::eClear)
+		.setStoreOp(split ? vk::AttachmentStoreOp::eStore : vk::AttachmentStoreOp::eDontCare)
 		.setStencilLoadOp(vk::AttachmentLoadOp::eDontCare)
 		.setStencilStoreOp(vk::AttachmentStoreOp::eDontCare)
-		.setInitialLayout(vk::ImageLayout::eUndefined)
-		.setFinalLayout(vk::ImageLayout::eDepthStencilAttachmentOptimal);
+		.setInitialLayout(resume ? vk::ImageLayout::eDepthStencilReadOnlyOptimal : vk::ImageLayout::eUndefined)
+		.setFinalLayout(split ? vk::ImageLayout::eDepthStencilReadOnlyOptimal : vk::ImageLayout::eDepthStencilAttachmentOptimal);
 	attachmentReferences.push_back(vk::AttachmentReference(1, vk::ImageLayout::eDepthStencilAttachmentOptimal));
 
 	if (msaaEnabled)
@@ -670,7 +928,7 @@ void lune::vulkan::createRenderPass(VulkanContext& context)
 			.setStencilLoadOp(vk::AttachmentLoadOp::eDontCare)
 			.setStencilStoreOp(vk::AttachmentStoreOp::eDontCare)
 			.setInitialLayout(vk::ImageLayout::eUndefined)
-			.setFinalLayout(vk::ImageLayout::ePresentSrcKHR);
+			.setFinalLayout(split ? vk::ImageLayout::eColorAttachmentOptimal : vk::ImageLayout::ePresentSrcKHR);
 		resolveAttachmentReferences.push_back(vk::AttachmentReference(2, vk::ImageLayout::eColorAttachmentOptimal));
 	}
 
@@ -681,22 +939,52 @@ void lune::vulkan::createRenderPass(VulkanContext& context)
 			.setPDepthStencilAttachment(&attachmentReferences[1])
 			.setPResolveAttachments(resolveAttachmentReferences.data());
 
-	const vk::SubpassDependency subpassDependecy =
-		vk::SubpassDependency()
+	std::vector<vk::SubpassDependency> subpassDependecies{};
+	subpassDependecies.push_back(vk::SubpassDependency()
 			.setSrcSubpass(VK_SUBPASS_EXTERNAL)
 			.setDstSubpass(0)
 			.setSrcStageMask(vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eEarlyFragmentTests)
 			.setDstStageMask(vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eEarlyFragmentTests)
 			.setSrcAccessMask(vk::AccessFlagBits(0))
-			.setDstAccessMask(vk::AccessFlagBits::eColorAttachmentWrite | vk::AccessFlagBits::eDepthStencilAttachmentWrite);
+			.setDstAccessMask(vk::AccessFlagBits::eColorAttachmentWrite | vk::AccessFlagBits::eDepthStencilAttachmentWrite));
+
+	if (split)
+	{
+		// depth written by draws read by compute shaders between passes
+		subpassDependecies.push_back(vk::SubpassDependency()
+				.setSrcSubpass(0)
+				.setDstSubpass(VK_SUBPASS_EXTERNAL)
+				.setSrcStageMask(vk::PipelineStageFlagBits::eEarlyFragmentTests | vk::PipelineStageFlagBits::eLateFragmentTests)
+				.setDstStageMask(vk::PipelineStageFlagBits::eComputeShader)
+				.setSrcAccessMask(vk::AccessFlagBits::eDepthStencilAttachmentWrite)
+				.setDstAccessMask(vk::AccessFlagBits::eShaderRead));
+	}
+	if (resume)
+	{
+		// attachments written by split pass and depth reads of compute shaders done before drawing on top
+		subpassDependecies.push_back(vk::SubpassDependency()
+				.setSrcSubpass(VK_SUBPASS_EXTERNAL)
+				.setDstSubpass(0)
+				.setSrcStageMask(vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eLateFragmentTests | vk::PipelineStageFlagBits::eComputeShader)
+				.setDstStageMask(vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eEarlyFragmentTests | vk::PipelineStageFlagBits::eLateFragmentTests)
+				.setSrcAccessMask(vk::AccessFlagBits::eColorAttachmentWrite | vk::AccessFlagBits::eDepthStencilAttachmentWrite)
+				.setDstAccessMask(vk::AccessFlagBits::eColorAttachmentRead | vk::AccessFlagBits::eColorAttachmentWrite | vk::AccessFlagBits::eDepthStencilAttachmentRead | vk::AccessFlagBits::eDepthStencilAttachmentWrite));
+	}
 
 	const vk::RenderPassCreateInfo renderPassCreateInfo =
 		vk::RenderPassCreateInfo()
 			.setAttachments(attachmentsDescriptions)
 			.setSubpasses({1, &subpassDescription})
-			.setDependencies({1, &subpassDependecy});
+			.setDependencies(subpassDependecies);
 
-	getVulkanContext().renderPass = getVulkanContext().device.createRenderPass(renderPassCreateInfo);
+	return device.createRenderPass(renderPassCreateInfo);
+}
+
+void lune::vulkan::createRenderPass(VulkanContext& context)
+{
+	context.renderPass = createRenderPassVariant(context.device, false, false);
+	context.splitRenderPass = createRenderPassVariant(context.device, true, false);
+	context.resumeRenderPass = createRenderPassVariant(context.device, false, true);
 }
 
 void lune::vulkan::createVmaAllocator(VulkanContext& context)
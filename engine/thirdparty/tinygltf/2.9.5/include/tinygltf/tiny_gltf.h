@@ -1564,6 +1564,17 @@ class TinyGLTF {
 
   size_t GetMaxExternalFileSize() const { return max_external_file_size_; }
 
+  ///
+  /// Specify whether data of GLB BIN chunk and external .bin files is copied
+  /// into Buffer::data. When off, only their uri is kept and the caller reads
+  /// them itself (e.g. from a memory mapping). Images in such buffer views
+  /// are not passed to LoadImageData. Data URIs are always decoded.
+  /// Default: true
+  ///
+  void SetLoadBufferData(bool onoff) { load_buffer_data_ = onoff; }
+
+  bool GetLoadBufferData() const { return load_buffer_data_; }
+
  private:
   ///
   /// Loads glTF asset from string(memory).
@@ -1593,6 +1604,8 @@ class TinyGLTF {
   size_t max_external_file_size_{
       size_t((std::numeric_limits<int32_t>::max)())};  // Default 2GB
 
+  bool load_buffer_data_ = true;
+
   // Warning & error messages
   std::string warn_;
   std::string err_;
@@ -4536,7 +4549,7 @@ static bool ParseBuffer(Buffer *buffer, std::string *err, const detail::json &o,
                         const std::string &basedir,
                         const size_t max_buffer_size, bool is_binary = false,
                         const unsigned char *bin_data = nullptr,
-                        size_t bin_size = 0) {
+                        size_t bin_size = 0, bool load_data = true) {
   size_t byteLength;
   if (!ParseUnsignedProperty(&byteLength, err, o, "byteLength", true,
                              "Buffer")) {
@@ -4578,7 +4591,7 @@ static bool ParseBuffer(Buffer *buffer, std::string *err, const detail::json &o,
           }
           return false;
         }
-      } else {
+      } else if (load_data) {
         // External .bin file.
         std::string decoded_uri;
         if (!uri_cb->decode(buffer->uri, &decoded_uri, uri_cb->user_data)) {
@@ -4614,8 +4627,11 @@ static bool ParseBuffer(Buffer *buffer, std::string *err, const detail::json &o,
       }
 
       // Read buffer data
-      buffer->data.resize(static_cast<size_t>(byteLength));
-      memcpy(&(buffer->data.at(0)), bin_data, static_cast<size_t>(byteLength));
+      if (load_data) {
+        buffer->data.resize(static_cast<size_t>(byteLength));
+        memcpy(&(buffer->data.at(0)), bin_data,
+               static_cast<size_t>(byteLength));
+      }
     }
 
   } else {
@@ -4628,7 +4644,7 @@ static bool ParseBuffer(Buffer *buffer, std::string *err, const detail::json &o,
         }
         return false;
       }
-    } else {
+    } else if (load_data) {
       // Assume external .bin file.
       std::string decoded_uri;
       if (!uri_cb->decode(buffer->uri, &decoded_uri, uri_cb->user_data)) {
@@ -6165,7 +6181,7 @@ bool TinyGLTF::LoadFromString(Model *model, std::string *err, std::string *warn,
       if (!ParseBuffer(&buffer, err, o,
                        store_original_json_for_extras_and_extensions_, &fs,
                        &uri_cb, base_dir, max_external_file_size_, is_binary_,
-                       bin_data_, bin_size_)) {
+                       bin_data_, bin_size_, load_buffer_data_)) {
         return false;
       }
 
@@ -6453,6 +6469,12 @@ bool TinyGLTF::LoadFromString(Model *model, std::string *err, std::string *warn,
           return false;
         }
         const Buffer &buffer = model->buffers[size_t(bufferView.buffer)];
+        if (!load_buffer_data_ && buffer.data.empty()) {
+          // Data is read by the caller, nothing to pass to LoadImageData.
+          model->images.emplace_back(std::move(image));
+          ++idx;
+          return true;
+        }
         if (bufferView.byteOffset >= buffer.data.size()) {
           if (err) {
             std::stringstream ss;
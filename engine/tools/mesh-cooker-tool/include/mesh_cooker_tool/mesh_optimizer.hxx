@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace lune::meshopt
+{
+	// indices of triangle list, vertex count of primitive they index
+
+	// triangles reordered for post transform vertex cache, after Forsyth's linear speed vertex cache optimisation
+	void optimizeVertexCache(std::vector<uint32_t>& indices, uint32_t vertexCount);
+
+	// vertices renumbered in order triangles first use them, unused ones moved to end
+	// returns old index of each new vertex, verticies to be reordered with it
+	std::vector<uint32_t> optimizeVertexFetch(std::vector<uint32_t>& indices, uint32_t vertexCount);
+
+	// average transformed vertices per triangle for fifo cache of given size, 0.5 best possible, 3 worst
+	float computeAcmr(const std::vector<uint32_t>& indices, uint32_t vertexCount, uint32_t cacheSize = 16);
+} // namespace lune::meshopt
@@ -0,0 +1,196 @@
+#include "lune/core/gltf.hxx"
+#include "lune/core/lmesh.hxx"
+#include "mesh_cooker_tool/mesh_optimizer.hxx"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+// gltf primitive mode, strips and fans depend on order of their indices
+constexpr int32_t TrianglesMode = 4;
+
+struct CookOptions
+{
+	bool optimize{true};
+	bool force{};
+};
+
+struct CookStats
+{
+	float acmrBefore{};
+	float acmrAfter{};
+	uint64_t triangleCount{};
+};
+
+static bool isSourceModel(const fs::path& path)
+{
+	std::string extension = path.extension().string();
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return static_cast<char>(std::tolower(c)); });
+	return extension == ".gltf" || extension == ".glb";
+}
+
+// indexed triangle lists only, verticies and indices rewritten in place, ranges of primitive stay same
+static void optimizePrimitive(lune::lmesh::Model& model, const lune::lmesh::Primitive& primitive, CookStats& stats)
+{
+	if (primitive.mode != TrianglesMode || primitive.indexCount < 3)
+		return;
+
+	uint8_t* indexData = model.indices.data() + primitive.indexOffset;
+	std::vector<uint32_t> indices(primitive.indexCount);
+	for (uint32_t i = 0; i < primitive.indexCount; ++i)
+	{
+		if (primitive.indexSizeof == sizeof(uint16_t))
+		{
+			uint16_t index16{};
+			std::memcpy(&index16, indexData + i * sizeof(uint16_t), sizeof(uint16_t));
+			indices[i] = index16;
+		}
+		else
+		{
+			std::memcpy(&indices[i], indexData + i * sizeof(uint32_t), sizeof(uint32_t));
+		}
+
+		// broken ones left as they are
+		if (indices[i] >= primitive.vertexCount)
+			return;
+	}
+
+	const float acmrBefore = lune::meshopt::computeAcmr(indices, primitive.vertexCount);
+	lune::meshopt::optimizeVertexCache(indices, primitive.vertexCount);
+	const std::vector<uint32_t> remap = lune::meshopt::optimizeVertexFetch(indices, primitive.vertexCount);
+
+	const uint32_t triangles = primitive.indexCount / 3;
+	stats.acmrBefore += acmrBefore * triangles;
+	stats.acmrAfter += lune::meshopt::computeAcmr(indices, primitive.vertexCount) * triangles;
+	stats.triangleCount += triangles;
+
+	constexpr size_t vertexSize = sizeof(lune::Vertex343224);
+	uint8_t* vertexData = model.verticies.data() + primitive.vertexOffset;
+	const std::vector<uint8_t> verticies(vertexData, vertexData + static_cast<size_t>(primitive.vertexCount) * vertexSize);
+	for (uint32_t v = 0; v < primitive.vertexCount; ++v)
+		std::memcpy(vertexData + v * vertexSize, verticies.data() + remap[v] * vertexSize, vertexSize);
+
+	for (uint32_t i = 0; i < primitive.indexCount; ++i)
+	{
+		if (primitive.indexSizeof == sizeof(uint16_t))
+		{
+			const uint16_t index16 = static_cast<uint16_t>(indices[i]);
+			std::memcpy(indexData + i * sizeof(uint16_t), &index16, sizeof(uint16_t));
+		}
+		else
+		{
+			std::memcpy(indexData + i * sizeof(uint32_t), &indices[i], sizeof(uint32_t));
+		}
+	}
+}
+
+static bool cookModel(const fs::path& source, const fs::path& output, const CookOptions& options, CookStats& outStats)
+{
+	lune::lmesh::Model model{};
+	if (!lune::gltf::convert(source, model))
+		return false;
+
+	if (options.optimize)
+	{
+		for (const lune::lmesh::Primitive& primitive : model.primitives)
+			optimizePrimitive(model, primitive, outStats);
+	}
+
+	return lune::lmesh::write(output, model.getView());
+}
+
+int main(int argc, char* argv[])
+{
+	CookOptions options{};
+	std::vector<fs::path> sources{};
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string_view arg = argv[i];
+		if (arg == "--no-optimize")
+		{
+			options.optimize = false;
+		}
+		else if (arg == "--force")
+		{
+			options.force = true;
+		}
+		else if (fs::is_directory(arg))
+		{
+			for (const auto& entry : fs::recursive_directory_iterator(arg))
+			{
+				if (entry.is_regular_file() && isSourceModel(entry.path()))
+					sources.push_back(entry.path());
+			}
+		}
+		else if (fs::is_regular_file(arg))
+		{
+			sources.push_back(arg);
+		}
+		else
+		{
+			std::cerr << "no such file or directory " << arg << std::endl;
+		}
+	}
+
+	if (sources.empty())
+	{
+		std::cout << "usage: mesh-cooker-tool [--no-optimize] [--force] <models or directories>" << std::endl;
+		return 1;
+	}
+
+	std::cout << "- - - MESH COOKER TOOL - BEGIN" << std::endl;
+	const auto beginTime = std::chrono::steady_clock::now();
+
+	// whole models split between threads, converting single one doesn't share state
+	std::atomic<size_t> nextSource{};
+	std::atomic<uint32_t> failures{};
+	std::mutex outputMutex{};
+	const auto worker = [&]()
+	{
+		for (size_t i = nextSource++; i < sources.size(); i = nextSource++)
+		{
+			fs::path output = sources[i];
+			output.replace_extension(".lmesh");
+
+			std::error_code error{};
+			if (!options.force && fs::exists(output, error) && fs::last_write_time(sources[i]) < fs::last_write_time(output, error))
+			{
+				std::lock_guard lock(outputMutex);
+				std::cout << output.generic_string() << " UP-TO-DATE" << std::endl;
+				continue;
+			}
+
+			CookStats stats{};
+			const bool cooked = cookModel(sources[i], output, options, stats);
+			failures += !cooked;
+
+			std::lock_guard lock(outputMutex);
+			std::cout << output.generic_string() << (cooked ? " - COOKED" : " - COOKING FAILURE");
+			if (cooked && stats.triangleCount)
+				std::cout << " (acmr " << stats.acmrBefore / stats.triangleCount << " -> " << stats.acmrAfter / stats.triangleCount << ")";
+			std::cout << std::endl;
+		}
+	};
+
+	std::vector<std::thread> threads{};
+	const uint32_t threadCount = std::clamp<uint32_t>(std::thread::hardware_concurrency(), 1u, sources.size());
+	for (uint32_t t = 0; t < threadCount; ++t)
+		threads.emplace_back(worker);
+	for (std::thread& thread : threads)
+		thread.join();
+
+	const auto endTime = std::chrono::steady_clock::now();
+	std::cout << "Total time: " << std::chrono::duration_cast<std::chrono::milliseconds>(endTime - beginTime).count() << "ms" << std::endl;
+	std::cout << " - - - MESH COOKER TOOL - END" << std::endl;
+	return failures == 0 ? 0 : 2;
+}
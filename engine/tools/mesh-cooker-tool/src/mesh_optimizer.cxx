@@ -0,0 +1,183 @@
+#include "mesh_cooker_tool/mesh_optimizer.hxx"
+
+#include <algorithm>
+#include <cmath>
+
+// simulated cache, larger than hardware ones so vertices shared by neighbouring strips still score
+constexpr uint32_t CacheSize = 32;
+
+// scoring constants as tuned by Forsyth
+constexpr float CacheDecayPower = 1.5f;
+constexpr float LastTriangleScore = 0.75f;
+constexpr float ValenceBoostScale = 2.f;
+constexpr float ValenceBoostPower = 0.5f;
+
+// vertices of last triangle scored equally, rest decay with position, ones used by few remaining triangles boosted
+static float scoreVertex(int32_t cachePosition, uint32_t activeTriangles)
+{
+	if (activeTriangles == 0)
+		return -1.f;
+
+	float score{};
+	if (cachePosition >= 0 && cachePosition < 3)
+		score = LastTriangleScore;
+	else if (cachePosition >= 3)
+		score = std::pow(1.f - static_cast<float>(cachePosition - 3) / (CacheSize - 3), CacheDecayPower);
+
+	return score + ValenceBoostScale * std::pow(static_cast<float>(activeTriangles), -ValenceBoostPower);
+}
+
+void lune::meshopt::optimizeVertexCache(std::vector<uint32_t>& indices, uint32_t vertexCount)
+{
+	const uint32_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+		return;
+
+	// triangles not emitted yet of each vertex, first activeCount of its range
+	std::vector<uint32_t> activeCount(vertexCount);
+	for (uint32_t i = 0; i < triangleCount * 3; ++i)
+		++activeCount[indices[i]];
+
+	std::vector<uint32_t> firstTriangle(vertexCount + 1);
+	for (uint32_t v = 0; v < vertexCount; ++v)
+		firstTriangle[v + 1] = firstTriangle[v] + activeCount[v];
+
+	std::vector<uint32_t> vertexTriangles(triangleCount * 3);
+	std::vector<uint32_t> fill(firstTriangle.begin(), firstTriangle.end() - 1);
+	for (uint32_t t = 0; t < triangleCount; ++t)
+	{
+		for (uint32_t k = 0; k < 3; ++k)
+			vertexTriangles[fill[indices[t * 3 + k]]++] = t;
+	}
+
+	std::vector<int32_t> cachePositions(vertexCount, -1);
+	std::vector<float> vertexScores(vertexCount);
+	for (uint32_t v = 0; v < vertexCount; ++v)
+		vertexScores[v] = scoreVertex(-1, activeCount[v]);
+
+	const auto scoreTriangle = [&](uint32_t t)
+	{ return vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]]; };
+
+	std::vector<bool> emitted(triangleCount);
+	int64_t best{};
+	float bestScore = -1.f;
+	for (uint32_t t = 0; t < triangleCount; ++t)
+	{
+		const float score = scoreTriangle(t);
+		if (score > bestScore)
+		{
+			best = t;
+			bestScore = score;
+		}
+	}
+
+	std::vector<uint32_t> result{};
+	result.reserve(triangleCount * 3);
+	std::vector<uint32_t> cache{};
+	std::vector<uint32_t> newCache{};
+	uint32_t nextCandidate{};
+	while (result.size() < triangleCount * 3)
+	{
+		// no cached vertex has triangles left, continue from first one not emitted
+		if (best < 0)
+		{
+			while (emitted[nextCandidate])
+				++nextCandidate;
+			best = nextCandidate;
+		}
+
+		emitted[best] = true;
+		newCache.clear();
+		for (uint32_t k = 0; k < 3; ++k)
+		{
+			const uint32_t v = indices[best * 3 + k];
+			result.push_back(v);
+			if (std::find(newCache.begin(), newCache.end(), v) == newCache.end())
+				newCache.push_back(v);
+
+			// swapped out of active part of vertex range
+			uint32_t* triangles = vertexTriangles.data() + firstTriangle[v];
+			std::swap(*std::find(triangles, triangles + activeCount[v], static_cast<uint32_t>(best)), triangles[activeCount[v] - 1]);
+			--activeCount[v];
+		}
+
+		// vertices of emitted triangle move to front, ones pushed past cache size lose their position
+		for (const uint32_t v : cache)
+		{
+			if (std::find(newCache.begin(), newCache.end(), v) == newCache.end())
+				newCache.push_back(v);
+		}
+		for (uint32_t i = 0; i < newCache.size(); ++i)
+		{
+			const uint32_t v = newCache[i];
+			cachePositions[v] = i < CacheSize ? static_cast<int32_t>(i) : -1;
+			vertexScores[v] = scoreVertex(cachePositions[v], activeCount[v]);
+		}
+		newCache.resize(std::min<size_t>(newCache.size(), CacheSize));
+		std::swap(cache, newCache);
+
+		// only triangles of cached vertices changed score, best of them goes next
+		best = -1;
+		bestScore = -1.f;
+		for (const uint32_t v : cache)
+		{
+			for (uint32_t i = 0; i < activeCount[v]; ++i)
+			{
+				const uint32_t t = vertexTriangles[firstTriangle[v] + i];
+				const float score = scoreTriangle(t);
+				if (score > bestScore)
+				{
+					best = t;
+					bestScore = score;
+				}
+			}
+		}
+	}
+
+	indices = std::move(result);
+}
+
+std::vector<uint32_t> lune::meshopt::optimizeVertexFetch(std::vector<uint32_t>& indices, uint32_t vertexCount)
+{
+	constexpr uint32_t Unused = ~0u;
+
+	std::vector<uint32_t> newIndices(vertexCount, Unused);
+	std::vector<uint32_t> remap{};
+	remap.reserve(vertexCount);
+	for (uint32_t& index : indices)
+	{
+		if (newIndices[index] == Unused)
+		{
+			newIndices[index] = remap.size();
+			remap.push_back(index);
+		}
+		index = newIndices[index];
+	}
+
+	for (uint32_t v = 0; v < vertexCount; ++v)
+	{
+		if (newIndices[v] == Unused)
+			remap.push_back(v);
+	}
+	return remap;
+}
+
+float lune::meshopt::computeAcmr(const std::vector<uint32_t>& indices, uint32_t vertexCount, uint32_t cacheSize)
+{
+	if (indices.size() < 3)
+		return 0.f;
+
+	// position of each vertex in fifo by time it entered
+	std::vector<uint64_t> enteredAt(vertexCount);
+	uint64_t time = cacheSize + 1;
+	uint32_t misses{};
+	for (const uint32_t index : indices)
+	{
+		if (time - enteredAt[index] > cacheSize)
+		{
+			enteredAt[index] = time++;
+			++misses;
+		}
+	}
+	return static_cast<float>(misses) / (indices.size() / 3);
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+
+namespace lune::bc
+{
+	// blocks encoded from 4x4 texels of rgba8, row by row, 64 bytes in total
+
+	// opaque color, endpoints along principal axis of block colors, always four color mode
+	void encodeBc1(const uint8_t* rgba, uint8_t* outBlock);
+
+	// bc4 alpha block followed by bc1 color block
+	void encodeBc3(const uint8_t* rgba, uint8_t* outBlock);
+
+	// single channel picked by offset into texel, eight value mode
+	void encodeBc4(const uint8_t* rgba, uint32_t channel, uint8_t* outBlock);
+
+	// red and green as two bc4 blocks, meant for normal maps
+	void encodeBc5(const uint8_t* rgba, uint8_t* outBlock);
+
+	// mode 6 only, single subset rgba with 4 bit indices, good enough for most color textures
+	void encodeBc7(const uint8_t* rgba, uint8_t* outBlock);
+} // namespace lune::bc
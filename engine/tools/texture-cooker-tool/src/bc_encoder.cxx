@@ -0,0 +1,394 @@
+#include "texture_cooker_tool/bc_encoder.hxx"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+
+using Color = std::array<float, 4>;
+
+// interpolation weights of 4 bit bc7 indices, out of 64
+constexpr std::array<uint32_t, 16> Bc7Weights = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+// weights toward second endpoint of bc1 indices, third and fourth palette entries sit between endpoints
+constexpr std::array<float, 4> Bc1Weights = {0.f, 1.f, 1.f / 3.f, 2.f / 3.f};
+
+template <uint32_t Channels>
+static float texelDistance(const Color& color, const uint8_t* texel)
+{
+	float distance{};
+	for (uint32_t c = 0; c < Channels; ++c)
+		distance += (color[c] - texel[c]) * (color[c] - texel[c]);
+	return distance;
+}
+
+// ends of line through block texels along their principal axis, pulled inwards by inset part of its length
+template <uint32_t Channels>
+static void findEndpoints(const uint8_t* rgba, float inset, Color& outFirst, Color& outSecond)
+{
+	Color mean{};
+	for (uint32_t i = 0; i < 16; ++i)
+	{
+		for (uint32_t c = 0; c < Channels; ++c)
+			mean[c] += rgba[i * 4 + c] / 16.f;
+	}
+
+	float covariance[Channels][Channels]{};
+	for (uint32_t i = 0; i < 16; ++i)
+	{
+		for (uint32_t c = 0; c < Channels; ++c)
+		{
+			for (uint32_t d = 0; d < Channels; ++d)
+				covariance[c][d] += (rgba[i * 4 + c] - mean[c]) * (rgba[i * 4 + d] - mean[d]);
+		}
+	}
+
+	// power iteration from row of channel varying most
+	uint32_t widest{};
+	for (uint32_t c = 1; c < Channels; ++c)
+		widest = covariance[c][c] > covariance[widest][widest] ? c : widest;
+
+	Color axis{};
+	for (uint32_t c = 0; c < Channels; ++c)
+		axis[c] = covariance[widest][c];
+	for (uint32_t iteration = 0; iteration < 8; ++iteration)
+	{
+		Color next{};
+		float largest{};
+		for (uint32_t c = 0; c < Channels; ++c)
+		{
+			for (uint32_t d = 0; d < Channels; ++d)
+				next[c] += covariance[c][d] * axis[d];
+			largest = std::max(largest, std::abs(next[c]));
+		}
+		if (largest < 1e-6f)
+			break;
+
+		for (uint32_t c = 0; c < Channels; ++c)
+			axis[c] = next[c] / largest;
+	}
+
+	float length{};
+	for (uint32_t c = 0; c < Channels; ++c)
+		length += axis[c] * axis[c];
+	length = std::sqrt(length);
+	if (length < 1e-6f)
+	{
+		outFirst = mean;
+		outSecond = mean;
+		return;
+	}
+
+	float minT = 1e9f;
+	float maxT = -1e9f;
+	for (uint32_t i = 0; i < 16; ++i)
+	{
+		float t{};
+		for (uint32_t c = 0; c < Channels; ++c)
+			t += (rgba[i * 4 + c] - mean[c]) * axis[c] / length;
+		minT = std::min(minT, t);
+		maxT = std::max(maxT, t);
+	}
+	const float insetT = (maxT - minT) * inset;
+	minT += insetT;
+	maxT -= insetT;
+
+	for (uint32_t c = 0; c < Channels; ++c)
+	{
+		outFirst[c] = std::clamp(mean[c] + axis[c] / length * maxT, 0.f, 255.f);
+		outSecond[c] = std::clamp(mean[c] + axis[c] / length * minT, 0.f, 255.f);
+	}
+}
+
+// least squares endpoints for texels with given weights toward second endpoint, false when weights don't spread
+template <uint32_t Channels>
+static bool fitEndpoints(const uint8_t* rgba, const float* weights, Color& outFirst, Color& outSecond)
+{
+	float a{}, b{}, c{};
+	Color first{}, second{};
+	for (uint32_t i = 0; i < 16; ++i)
+	{
+		const float w = weights[i];
+		a += (1.f - w) * (1.f - w);
+		b += (1.f - w) * w;
+		c += w * w;
+		for (uint32_t ch = 0; ch < Channels; ++ch)
+		{
+			first[ch] += (1.f - w) * rgba[i * 4 + ch];
+			second[ch] += w * rgba[i * 4 + ch];
+		}
+	}
+
+	const float determinant = a * c - b * b;
+	if (std::abs(determinant) < 1e-4f)
+		return false;
+
+	for (uint32_t ch = 0; ch < Channels; ++ch)
+	{
+		outFirst[ch] = std::clamp((c * first[ch] - b * second[ch]) / determinant, 0.f, 255.f);
+		outSecond[ch] = std::clamp((a * second[ch] - b * first[ch]) / determinant, 0.f, 255.f);
+	}
+	return true;
+}
+
+static uint16_t packRgb565(const Color& color)
+{
+	const uint32_t r = std::lround(color[0] * 31.f / 255.f);
+	const uint32_t g = std::lround(color[1] * 63.f / 255.f);
+	const uint32_t b = std::lround(color[2] * 31.f / 255.f);
+	return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+static Color unpackRgb565(uint16_t packed)
+{
+	const uint32_t r = (packed >> 11) & 31;
+	const uint32_t g = (packed >> 5) & 63;
+	const uint32_t b = packed & 31;
+	return Color{static_cast<float>((r << 3) | (r >> 2)), static_cast<float>((g << 2) | (g >> 4)), static_cast<float>((b << 3) | (b >> 2)), 255.f};
+}
+
+// endpoints swapped into four color order, indices written into block, squared error returned
+static float writeBc1(const uint8_t* rgba, uint16_t color0, uint16_t color1, uint8_t* outBlock, float* outWeights)
+{
+	if (color0 < color1)
+		std::swap(color0, color1);
+
+	const Color end0 = unpackRgb565(color0);
+	const Color end1 = unpackRgb565(color1);
+	std::array<Color, 4> palette{end0, end1};
+	for (uint32_t c = 0; c < 3; ++c)
+	{
+		palette[2][c] = std::floor((2.f * end0[c] + end1[c]) / 3.f);
+		palette[3][c] = std::floor((end0[c] + 2.f * end1[c]) / 3.f);
+	}
+
+	// equal endpoints would mean three color mode, all texels take first one then
+	const uint32_t paletteSize = color0 == color1 ? 1 : 4;
+
+	uint32_t indices{};
+	float error{};
+	for (uint32_t i = 0; i < 16; ++i)
+	{
+		uint32_t best{};
+		float bestDistance = texelDistance<3>(palette[0], rgba + i * 4);
+		for (uint32_t p = 1; p < paletteSize; ++p)
+		{
+			const float distance = texelDistance<3>(palette[p], rgba + i * 4);
+			if (distance < bestDistance)
+			{
+				best = p;
+				bestDistance = distance;
+			}
+		}
+		indices |= best << (i * 2);
+		outWeights[i] = Bc1Weights[best];
+		error += bestDistance;
+	}
+
+	std::memcpy(outBlock, &color0, 2);
+	std::memcpy(outBlock + 2, &color1, 2);
+	std::memcpy(outBlock + 4, &indices, 4);
+	return error;
+}
+
+void lune::bc::encodeBc1(const uint8_t* rgba, uint8_t* outBlock)
+{
+	Color first{}, second{};
+	findEndpoints<3>(rgba, 1.f / 16.f, first, second);
+
+	float weights[16]{};
+	float error = writeBc1(rgba, packRgb565(first), packRgb565(second), outBlock, weights);
+
+	// one refit against indices picked, kept only when it helps
+	if (error > 0.f && fitEndpoints<3>(rgba, weights, first, second))
+	{
+		uint8_t refitBlock[8]{};
+		float refitWeights[16]{};
+		if (writeBc1(rgba, packRgb565(first), packRgb565(second), refitBlock, refitWeights) < error)
+			std::memcpy(outBlock, refitBlock, 8);
+	}
+}
+
+void lune::bc::encodeBc3(const uint8_t* rgba, uint8_t* outBlock)
+{
+	encodeBc4(rgba, 3, outBlock);
+	encodeBc1(rgba, outBlock + 8);
+}
+
+void lune::bc::encodeBc4(const uint8_t* rgba, uint32_t channel, uint8_t* outBlock)
+{
+	uint32_t minValue = 255;
+	uint32_t maxValue = 0;
+	for (uint32_t i = 0; i < 16; ++i)
+	{
+		minValue = std::min<uint32_t>(minValue, rgba[i * 4 + channel]);
+		maxValue = std::max<uint32_t>(maxValue, rgba[i * 4 + channel]);
+	}
+
+	// first endpoint greater selects eight value mode, six values interpolated between them
+	std::array<uint32_t, 8> palette{maxValue, minValue};
+	for (uint32_t p = 2; p < 8; ++p)
+		palette[p] = ((8 - p) * maxValue + (p - 1) * minValue) / 7;
+
+	uint64_t indices{};
+	if (minValue != maxValue)
+	{
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			const uint32_t value = rgba[i * 4 + channel];
+			uint64_t best{};
+			for (uint32_t p = 1; p < 8; ++p)
+			{
+				const auto distance = [value](uint32_t entry) { return entry > value ? entry - value : value - entry; };
+				best = distance(palette[p]) < distance(palette[best]) ? p : best;
+			}
+			indices |= best << (i * 3);
+		}
+	}
+
+	outBlock[0] = static_cast<uint8_t>(maxValue);
+	outBlock[1] = static_cast<uint8_t>(minValue);
+	for (uint32_t b = 0; b < 6; ++b)
+		outBlock[2 + b] = static_cast<uint8_t>(indices >> (b * 8));
+}
+
+void lune::bc::encodeBc5(const uint8_t* rgba, uint8_t* outBlock)
+{
+	encodeBc4(rgba, 0, outBlock);
+	encodeBc4(rgba, 1, outBlock + 8);
+}
+
+struct Bc7Endpoint
+{
+	uint8_t quantized[4]{}; // 7 bits per channel
+	uint8_t pBit{};
+
+	Color decode() const
+	{
+		Color color{};
+		for (uint32_t c = 0; c < 4; ++c)
+			color[c] = static_cast<float>((quantized[c] << 1) | pBit);
+		return color;
+	}
+};
+
+// p-bit shared by all channels picked by error of endpoint it gives
+static Bc7Endpoint quantizeBc7(const Color& color)
+{
+	Bc7Endpoint best{};
+	float bestError = 1e9f;
+	for (uint8_t pBit = 0; pBit < 2; ++pBit)
+	{
+		Bc7Endpoint endpoint{};
+		endpoint.pBit = pBit;
+		float error{};
+		for (uint32_t c = 0; c < 4; ++c)
+		{
+			endpoint.quantized[c] = static_cast<uint8_t>(std::clamp<long>(std::lround((color[c] - pBit) / 2.f), 0, 127));
+			const float decoded = static_cast<float>((endpoint.quantized[c] << 1) | pBit);
+			error += (decoded - color[c]) * (decoded - color[c]);
+		}
+		if (error < bestError)
+		{
+			best = endpoint;
+			bestError = error;
+		}
+	}
+	return best;
+}
+
+static float findBc7Indices(const uint8_t* rgba, const Bc7Endpoint& first, const Bc7Endpoint& second, uint8_t* outIndices)
+{
+	const Color end0 = first.decode();
+	const Color end1 = second.decode();
+	std::array<Color, 16> palette{};
+	for (uint32_t p = 0; p < 16; ++p)
+	{
+		for (uint32_t c = 0; c < 4; ++c)
+			palette[p][c] = static_cast<float>(((64 - Bc7Weights[p]) * static_cast<uint32_t>(end0[c]) + Bc7Weights[p] * static_cast<uint32_t>(end1[c]) + 32) >> 6);
+	}
+
+	float error{};
+	for (uint32_t i = 0; i < 16; ++i)
+	{
+		uint8_t best{};
+		float bestDistance = texelDistance<4>(palette[0], rgba + i * 4);
+		for (uint8_t p = 1; p < 16; ++p)
+		{
+			const float distance = texelDistance<4>(palette[p], rgba + i * 4);
+			if (distance < bestDistance)
+			{
+				best = p;
+				bestDistance = distance;
+			}
+		}
+		outIndices[i] = best;
+		error += bestDistance;
+	}
+	return error;
+}
+
+struct BitWriter
+{
+	uint8_t* block{};
+	uint32_t position{};
+
+	void write(uint32_t value, uint32_t bits)
+	{
+		for (uint32_t b = 0; b < bits; ++b, ++position)
+		{
+			if ((value >> b) & 1)
+				block[position >> 3] |= static_cast<uint8_t>(1 << (position & 7));
+		}
+	}
+};
+
+void lune::bc::encodeBc7(const uint8_t* rgba, uint8_t* outBlock)
+{
+	Color first{}, second{};
+	findEndpoints<4>(rgba, 1.f / 32.f, first, second);
+
+	Bc7Endpoint end0 = quantizeBc7(first);
+	Bc7Endpoint end1 = quantizeBc7(second);
+	uint8_t indices[16]{};
+	float error = findBc7Indices(rgba, end0, end1, indices);
+
+	// one refit against indices picked, kept only when it helps
+	float weights[16]{};
+	for (uint32_t i = 0; i < 16; ++i)
+		weights[i] = Bc7Weights[indices[i]] / 64.f;
+	if (error > 0.f && fitEndpoints<4>(rgba, weights, first, second))
+	{
+		const Bc7Endpoint refit0 = quantizeBc7(first);
+		const Bc7Endpoint refit1 = quantizeBc7(second);
+		uint8_t refitIndices[16]{};
+		if (findBc7Indices(rgba, refit0, refit1, refitIndices) < error)
+		{
+			end0 = refit0;
+			end1 = refit1;
+			std::memcpy(indices, refitIndices, sizeof(indices));
+		}
+	}
+
+	// most significant bit of first index is implied zero, endpoints swapped to make it so
+	if (indices[0] & 8)
+	{
+		std::swap(end0, end1);
+		for (uint8_t& index : indices)
+			index = 15 - index;
+	}
+
+	std::memset(outBlock, 0, 16);
+	BitWriter writer{outBlock};
+	writer.write(1 << 6, 7);
+	for (uint32_t c = 0; c < 4; ++c)
+	{
+		writer.write(end0.quantized[c], 7);
+		writer.write(end1.quantized[c], 7);
+	}
+	writer.write(end0.pBit, 1);
+	writer.write(end1.pBit, 1);
+	writer.write(indices[0], 3);
+	for (uint32_t i = 1; i < 16; ++i)
+		writer.write(indices[i], 4);
+}
@@ -0,0 +1,267 @@
+#include "lune/core/ktx2.hxx"
+#include "lune/core/sdl.hxx"
+#include "texture_cooker_tool/bc_encoder.hxx"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+enum class CookFormat : uint8_t
+{
+	Auto = 0, // bc1 for opaque images, bc3 for ones with alpha
+	Bc1 = 1,
+	Bc3 = 2,
+	Bc5 = 3,
+	Bc7 = 4
+};
+
+struct CookOptions
+{
+	CookFormat format{CookFormat::Auto};
+	bool force{};
+};
+
+static bool isSourceImage(const fs::path& path)
+{
+	std::string extension = path.extension().string();
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return static_cast<char>(std::tolower(c)); });
+	return extension == ".png" || extension == ".jpg" || extension == ".jpeg" || extension == ".tga" || extension == ".bmp";
+}
+
+static bool parseFormat(std::string_view value, CookFormat& outFormat)
+{
+	constexpr std::pair<std::string_view, CookFormat> names[] = {
+		{"auto", CookFormat::Auto}, {"bc1", CookFormat::Bc1}, {"bc3", CookFormat::Bc3}, {"bc5", CookFormat::Bc5}, {"bc7", CookFormat::Bc7}};
+	for (const auto& [name, format] : names)
+	{
+		if (value == name)
+		{
+			outFormat = format;
+			return true;
+		}
+	}
+	return false;
+}
+
+static vk::Format toVkFormat(CookFormat format)
+{
+	switch (format)
+	{
+	case CookFormat::Bc3:
+		return vk::Format::eBc3UnormBlock;
+	case CookFormat::Bc5:
+		return vk::Format::eBc5UnormBlock;
+	case CookFormat::Bc7:
+		return vk::Format::eBc7UnormBlock;
+	default:
+		return vk::Format::eBc1RgbUnormBlock;
+	}
+}
+
+static void encodeBlock(CookFormat format, const uint8_t* rgba, uint8_t* outBlock)
+{
+	switch (format)
+	{
+	case CookFormat::Bc3:
+		return lune::bc::encodeBc3(rgba, outBlock);
+	case CookFormat::Bc5:
+		return lune::bc::encodeBc5(rgba, outBlock);
+	case CookFormat::Bc7:
+		return lune::bc::encodeBc7(rgba, outBlock);
+	default:
+		return lune::bc::encodeBc1(rgba, outBlock);
+	}
+}
+
+// 2x2 box filter, last row or column of odd sizes reused
+static std::vector<uint8_t> downsample(const std::vector<uint8_t>& pixels, uint32_t width, uint32_t height)
+{
+	const uint32_t newWidth = std::max(width / 2, 1u);
+	const uint32_t newHeight = std::max(height / 2, 1u);
+	std::vector<uint8_t> result(static_cast<size_t>(newWidth) * newHeight * 4);
+	for (uint32_t y = 0; y < newHeight; ++y)
+	{
+		const uint32_t y0 = std::min(y * 2, height - 1);
+		const uint32_t y1 = std::min(y * 2 + 1, height - 1);
+		for (uint32_t x = 0; x < newWidth; ++x)
+		{
+			const uint32_t x0 = std::min(x * 2, width - 1);
+			const uint32_t x1 = std::min(x * 2 + 1, width - 1);
+			for (uint32_t c = 0; c < 4; ++c)
+			{
+				const uint32_t sum = pixels[(y0 * width + x0) * 4 + c] + pixels[(y0 * width + x1) * 4 + c] +
+									 pixels[(y1 * width + x0) * 4 + c] + pixels[(y1 * width + x1) * 4 + c];
+				result[(y * newWidth + x) * 4 + c] = static_cast<uint8_t>((sum + 2) / 4);
+			}
+		}
+	}
+	return result;
+}
+
+// blocks over image edges filled with clamped texels
+static std::vector<uint8_t> encodeLevel(CookFormat format, const std::vector<uint8_t>& pixels, uint32_t width, uint32_t height)
+{
+	const vk::Format vkFormat = toVkFormat(format);
+	const uint32_t blockSize = lune::Ktx2Texture::getBlockSize(vkFormat);
+	const uint32_t blocksX = (width + 3) / 4;
+	const uint32_t blocksY = (height + 3) / 4;
+
+	std::vector<uint8_t> blocks(lune::Ktx2Texture::getFaceSize(vkFormat, width, height));
+	uint8_t texels[64]{};
+	for (uint32_t by = 0; by < blocksY; ++by)
+	{
+		for (uint32_t bx = 0; bx < blocksX; ++bx)
+		{
+			for (uint32_t i = 0; i < 16; ++i)
+			{
+				const uint32_t x = std::min(bx * 4 + i % 4, width - 1);
+				const uint32_t y = std::min(by * 4 + i / 4, height - 1);
+				std::memcpy(texels + i * 4, pixels.data() + (static_cast<size_t>(y) * width + x) * 4, 4);
+			}
+			encodeBlock(format, texels, blocks.data() + (static_cast<size_t>(by) * blocksX + bx) * blockSize);
+		}
+	}
+	return blocks;
+}
+
+static bool cookTexture(const fs::path& source, const fs::path& output, CookFormat format)
+{
+	auto loaded = lune::UniqueSDLSurface(IMG_Load(source.string().c_str()));
+	if (!loaded)
+		return false;
+
+	auto surface = lune::UniqueSDLSurface(SDL_ConvertSurface(loaded.get(), SDL_PIXELFORMAT_RGBA32));
+	if (!surface)
+		return false;
+
+	const uint32_t width = surface->w;
+	const uint32_t height = surface->h;
+	std::vector<uint8_t> pixels(static_cast<size_t>(width) * height * 4);
+	for (uint32_t y = 0; y < height; ++y)
+		std::memcpy(pixels.data() + static_cast<size_t>(y) * width * 4, static_cast<const uint8_t*>(surface->pixels) + static_cast<size_t>(y) * surface->pitch, width * 4);
+
+	if (format == CookFormat::Auto)
+	{
+		bool opaque = true;
+		for (size_t i = 3; i < pixels.size() && opaque; i += 4)
+			opaque = pixels[i] == 255;
+		format = opaque ? CookFormat::Bc1 : CookFormat::Bc3;
+	}
+
+	lune::Ktx2Texture texture{};
+	texture.format = toVkFormat(format);
+	texture.width = width;
+	texture.height = height;
+
+	// full chain down to 1x1, same count engine generates for uncompressed images
+	uint32_t levelWidth = width;
+	uint32_t levelHeight = height;
+	while (true)
+	{
+		texture.levels.push_back(encodeLevel(format, pixels, levelWidth, levelHeight));
+		if (levelWidth == 1 && levelHeight == 1)
+			break;
+
+		pixels = downsample(pixels, levelWidth, levelHeight);
+		levelWidth = std::max(levelWidth / 2, 1u);
+		levelHeight = std::max(levelHeight / 2, 1u);
+	}
+
+	return lune::ktx2::write(output, texture);
+}
+
+int main(int argc, char* argv[])
+{
+	CookOptions options{};
+	std::vector<fs::path> sources{};
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string_view arg = argv[i];
+		if (arg.starts_with("--format="))
+		{
+			if (!parseFormat(arg.substr(9), options.format))
+			{
+				std::cerr << "unknown format " << arg.substr(9) << std::endl;
+				return 1;
+			}
+		}
+		else if (arg == "--force")
+		{
+			options.force = true;
+		}
+		else if (fs::is_directory(arg))
+		{
+			for (const auto& entry : fs::recursive_directory_iterator(arg))
+			{
+				if (entry.is_regular_file() && isSourceImage(entry.path()))
+					sources.push_back(entry.path());
+			}
+		}
+		else if (fs::is_regular_file(arg))
+		{
+			sources.push_back(arg);
+		}
+		else
+		{
+			std::cerr << "no such file or directory " << arg << std::endl;
+		}
+	}
+
+	if (sources.empty())
+	{
+		std::cout << "usage: texture-cooker-tool [--format=auto|bc1|bc3|bc5|bc7] [--force] <images or directories>" << std::endl;
+		return 1;
+	}
+
+	std::cout << "- - - TEXTURE COOKER TOOL - BEGIN" << std::endl;
+	const auto beginTime = std::chrono::steady_clock::now();
+
+	// whole images split between threads, encoding single one doesn't share state
+	std::atomic<size_t> nextSource{};
+	std::atomic<uint32_t> failures{};
+	std::mutex outputMutex{};
+	const auto worker = [&]()
+	{
+		for (size_t i = nextSource++; i < sources.size(); i = nextSource++)
+		{
+			fs::path output = sources[i];
+			output.replace_extension(".ktx2");
+
+			std::error_code error{};
+			if (!options.force && fs::exists(output, error) && fs::last_write_time(sources[i]) < fs::last_write_time(output, error))
+			{
+				std::lock_guard lock(outputMutex);
+				std::cout << output.generic_string() << " UP-TO-DATE" << std::endl;
+				continue;
+			}
+
+			const bool cooked = cookTexture(sources[i], output, options.format);
+			failures += !cooked;
+
+			std::lock_guard lock(outputMutex);
+			std::cout << output.generic_string() << (cooked ? " - COOKED" : " - COOKING FAILURE") << std::endl;
+		}
+	};
+
+	std::vector<std::thread> threads{};
+	const uint32_t threadCount = std::clamp<uint32_t>(std::thread::hardware_concurrency(), 1u, sources.size());
+	for (uint32_t t = 0; t < threadCount; ++t)
+		threads.emplace_back(worker);
+	for (std::thread& thread : threads)
+		thread.join();
+
+	const auto endTime = std::chrono::steady_clock::now();
+	std::cout << "Total time: " << std::chrono::duration_cast<std::chrono::milliseconds>(endTime - beginTime).count() << "ms" << std::endl;
+	std::cout << " - - - TEXTURE COOKER TOOL - END" << std::endl;
+	return failures == 0 ? 0 : 2;
+}
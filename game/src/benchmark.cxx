@@ -0,0 +1,455 @@
+#include "benchmark.hxx"
+
+#include "lune/core/assets.hxx"
+#include "lune/core/culling.hxx"
+#include "lune/core/engine.hxx"
+#include "lune/core/gltf.hxx"
+#include "lune/core/job_subsystem.hxx"
+#include "lune/game_framework/components/bounds.hxx"
+#include "lune/game_framework/components/camera.hxx"
+#include "lune/game_framework/components/sprite.hxx"
+#include "lune/game_framework/components/transform.hxx"
+#include "lune/game_framework/systems/camera_system.hxx"
+#include "lune/game_framework/systems/spatial_index_system.hxx"
+#include "lune/game_framework/systems/sprite_render_system.hxx"
+
+#include <chrono>
+#include <cmath>
+#include <format>
+#include <functional>
+#include <memory>
+#include <random>
+
+constexpr uint32 WarmupFrames = 30;
+constexpr uint32 MeasuredFrames = 300;
+
+// runs phases one after another, each measured over number of frames after warmup
+// work items per millisecond of frame time logged for every phase
+class FrameBenchmarkSystem : public lune::SystemBase
+{
+public:
+	struct Phase
+	{
+		std::string name{};
+		std::function<void(lune::Scene*)> begin{};
+		uint32 workItems{};
+	};
+
+	FrameBenchmarkSystem(std::string name, std::vector<Phase> phases)
+		: mName(std::move(name))
+		, mPhases(std::move(phases))
+	{
+	}
+
+	virtual void update(lune::Scene* scene, double deltaTime) override
+	{
+		const auto now = std::chrono::steady_clock::now();
+
+		if (mPhaseIndex >= mPhases.size())
+			return;
+
+		Phase& phase = mPhases[mPhaseIndex];
+		if (mFrame == 0)
+			phase.begin(scene);
+
+		if (mFrame == WarmupFrames)
+			mPhaseStart = now;
+
+		if (++mFrame <= WarmupFrames + MeasuredFrames)
+			return;
+
+		const double ms = std::chrono::duration<double, std::milli>(now - mPhaseStart).count();
+		const double frameMs = ms / MeasuredFrames;
+		const double itemsPerMs = phase.workItems / frameMs;
+		LN_LOG(Info, Benchmark, "{} / {}: {:.3f} ms per frame, {:.1f} items per ms, {:.0f} per second", mName, phase.name, frameMs, itemsPerMs, itemsPerMs * 1000.0);
+
+		mFrame = 0;
+		if (++mPhaseIndex == mPhases.size())
+			lune::Engine::get()->stop();
+	}
+
+private:
+	std::string mName{};
+	std::vector<Phase> mPhases{};
+
+	size_t mPhaseIndex{};
+	uint32 mFrame{};
+	std::chrono::steady_clock::time_point mPhaseStart{};
+};
+
+class BenchmarkCameraEntity : public lune::EntityBase
+{
+public:
+	BenchmarkCameraEntity()
+	{
+		addComponent<lune::TransformComponent>();
+		addComponent<lune::PerspectiveCameraComponent>();
+	}
+};
+
+class BenchmarkSpriteEntity : public lune::EntityBase
+{
+public:
+	BenchmarkSpriteEntity()
+	{
+		addComponent<lune::TransformComponent>();
+		addComponent<lune::SpriteComponent>();
+	}
+};
+
+// grid of sprites with two images of sprite atlas, compares draw per sprite with one instanced draw per texture
+// both phases read same instance buffer, sprite path without it (own uniform buffer and set per sprite) no longer exists
+// so difference is cost of draw calls alone
+class SpriteBenchmarkScene : public lune::Scene
+{
+public:
+	explicit SpriteBenchmarkScene(uint32 spriteCount)
+	{
+		const uint32 side = static_cast<uint32>(std::ceil(std::sqrt(static_cast<double>(spriteCount))));
+		const float halfSide = side * 0.5f;
+
+		auto camera = addEntity<BenchmarkCameraEntity>();
+		camera->findComponent<lune::TransformComponent>()->translate(lnm::vec3(0.f, 0.f, -1.25f * side));
+
+		for (uint32 i = 0; i < spriteCount; ++i)
+		{
+			auto sprite = addEntity<BenchmarkSpriteEntity>();
+			sprite->findComponent<lune::TransformComponent>()->translate(lnm::vec3(i % side - halfSide, i / side - halfSide, 0.f));
+
+			auto spriteComp = sprite->findComponent<lune::SpriteComponent>();
+			spriteComp->imageName = i % 2 ? "lune::scarlet" : "lune::default";
+			spriteComp->dstRect = lnm::vec4(0.f, 0.f, 0.45f, 0.45f);
+		}
+
+		registerSystem<lune::CameraSystem>();
+		registerSystem<lune::SpriteRenderSystem>();
+
+		std::vector<FrameBenchmarkSystem::Phase> phases{};
+		phases.push_back({"draw per sprite from instance buffer", [](lune::Scene* scene)
+			{ scene->findSystem<lune::SpriteRenderSystem>()->setInstancing(false); }, spriteCount});
+		phases.push_back({"instanced draw per texture", [](lune::Scene* scene)
+			{ scene->findSystem<lune::SpriteRenderSystem>()->setInstancing(true); }, spriteCount});
+		registerSystem<FrameBenchmarkSystem>("sprites", std::move(phases));
+	}
+};
+
+class BenchmarkBoundsEntity : public lune::EntityBase
+{
+public:
+	BenchmarkBoundsEntity()
+	{
+		addComponent<lune::TransformComponent>();
+		addComponent<lune::BoundsComponent>()->box = lune::BoundingBox{lnm::vec3(-0.5f), lnm::vec3(0.5f)};
+	}
+};
+
+// circles entities around their start positions every frame while enabled
+class BenchmarkMoverSystem : public lune::SystemBase
+{
+public:
+	explicit BenchmarkMoverSystem(std::vector<std::pair<uint64, lnm::vec3>> entities)
+		: mEntities(std::move(entities))
+	{
+	}
+
+	void setEnabled(bool enabled) { mEnabled = enabled; }
+
+	virtual void update(lune::Scene* scene, double deltaTime) override
+	{
+		if (!mEnabled)
+			return;
+
+		mTime += deltaTime;
+		for (size_t i = 0; i < mEntities.size(); ++i)
+		{
+			const auto& [eId, origin] = mEntities[i];
+			const float angle = static_cast<float>(mTime) + i;
+			scene->findEntity(eId)->findComponent<lune::TransformComponent>()->setPosition(origin + lnm::vec3(std::sin(angle), std::cos(angle), 0.f) * 2.f);
+		}
+	}
+
+private:
+	std::vector<std::pair<uint64, lnm::vec3>> mEntities{};
+	double mTime{};
+	bool mEnabled{};
+};
+
+// runs number of queries of one kind at random places every frame
+// linear mode tests every static box without index, baseline for box queries
+class BenchmarkQuerySystem : public lune::SystemBase
+{
+public:
+	enum class Query
+	{
+		None,
+		Box,
+		Sphere,
+		Ray,
+		Frustum,
+		LinearBox
+	};
+
+	BenchmarkQuerySystem(float worldSize, std::vector<lune::BoundingBox> staticBoxes)
+		: mWorldSize(worldSize)
+		, mStaticBoxes(std::move(staticBoxes))
+	{
+		addDependecy<lune::SpatialIndexSystem>();
+	}
+
+	void setQuery(Query query, uint32 queriesPerFrame)
+	{
+		mQuery = query;
+		mQueriesPerFrame = queriesPerFrame;
+	}
+
+	virtual void update(lune::Scene* scene, double deltaTime) override
+	{
+		auto spatialIndex = scene->findSystem<lune::SpatialIndexSystem>();
+		std::uniform_real_distribution<float> position(-mWorldSize * 0.5f, mWorldSize * 0.5f);
+		std::uniform_real_distribution<float> direction(-1.f, 1.f);
+
+		for (uint32 i = 0; i < mQueriesPerFrame; ++i)
+		{
+			const lnm::vec3 center(position(mRandom), position(mRandom), position(mRandom));
+			switch (mQuery)
+			{
+			case Query::Box:
+				spatialIndex->queryBox(lune::BoundingBox{center - lnm::vec3(2.f), center + lnm::vec3(2.f)}, mResults);
+				break;
+			case Query::Sphere:
+				spatialIndex->querySphere(lune::BoundingSphere{center, 2.f}, mResults);
+				break;
+			case Query::Ray:
+			{
+				lune::AabbTree::RayHit hit{};
+				spatialIndex->raycast(center, lnm::vec3(direction(mRandom), direction(mRandom), direction(mRandom)), mWorldSize, hit);
+				break;
+			}
+			case Query::Frustum:
+			{
+				const lnm::vec3 target = center + lnm::vec3(direction(mRandom), direction(mRandom), direction(mRandom));
+				const lnm::mat4 viewProj = lnm::perspective(lnm::radians(60.f), 1.f, 0.1f, mWorldSize * 0.25f) * lnm::lookAtRH(center, target, lune::upAxis);
+				spatialIndex->queryFrustum(lune::Frustum::fromViewProjection(viewProj), mResults);
+				break;
+			}
+			case Query::LinearBox:
+			{
+				const lune::BoundingBox box{center - lnm::vec3(2.f), center + lnm::vec3(2.f)};
+				mResults.clear();
+				for (size_t j = 0; j < mStaticBoxes.size(); ++j)
+				{
+					const lune::BoundingBox& other = mStaticBoxes[j];
+					if (lnm::all(lnm::lessThanEqual(box.min, other.max)) && lnm::all(lnm::greaterThanEqual(box.max, other.min)))
+						mResults.push_back(j);
+				}
+				break;
+			}
+			default:
+				break;
+			}
+		}
+	}
+
+private:
+	float mWorldSize{};
+	std::vector<lune::BoundingBox> mStaticBoxes{};
+
+	Query mQuery{};
+	uint32 mQueriesPerFrame{};
+	std::mt19937 mRandom{};
+	std::vector<uint64> mResults{};
+};
+
+// static boxes spread in cube with few that circle around, index built on first frame
+class SpatialIndexBenchmarkScene : public lune::Scene
+{
+public:
+	SpatialIndexBenchmarkScene(uint32 staticCount, uint32 dynamicCount)
+	{
+		// roughly one object per 4x4x4 cell
+		const float worldSize = std::cbrt(static_cast<float>(staticCount + dynamicCount)) * 4.f;
+		std::mt19937 random{};
+		std::uniform_real_distribution<float> position(-worldSize * 0.5f, worldSize * 0.5f);
+
+		auto camera = addEntity<BenchmarkCameraEntity>();
+		camera->findComponent<lune::TransformComponent>()->translate(lnm::vec3(0.f, 0.f, -worldSize));
+
+		std::vector<lune::BoundingBox> staticBoxes{};
+		staticBoxes.reserve(staticCount);
+		for (uint32 i = 0; i < staticCount; ++i)
+		{
+			const lnm::vec3 center(position(random), position(random), position(random));
+			addEntity<BenchmarkBoundsEntity>()->findComponent<lune::TransformComponent>()->setPosition(center);
+			staticBoxes.push_back(lune::BoundingBox{center - lnm::vec3(0.5f), center + lnm::vec3(0.5f)});
+		}
+
+		std::vector<std::pair<uint64, lnm::vec3>> dynamicEntities{};
+		dynamicEntities.reserve(dynamicCount);
+		for (uint32 i = 0; i < dynamicCount; ++i)
+		{
+			const lnm::vec3 center(position(random), position(random), position(random));
+			auto entity = addEntity<BenchmarkBoundsEntity>();
+			entity->findComponent<lune::TransformComponent>()->setPosition(center);
+			dynamicEntities.emplace_back(entity->getId(), center);
+		}
+
+		registerSystem<lune::CameraSystem>();
+		registerSystem<lune::SpatialIndexSystem>();
+		registerSystem<BenchmarkMoverSystem>(std::move(dynamicEntities));
+		registerSystem<BenchmarkQuerySystem>(worldSize, std::move(staticBoxes));
+
+		constexpr uint32 PointQueries = 1000;
+		constexpr uint32 WideQueries = 10;
+		const auto queryPhase = [](BenchmarkQuerySystem::Query query, uint32 count)
+		{
+			return [query, count](lune::Scene* scene)
+			{
+				scene->findSystem<BenchmarkMoverSystem>()->setEnabled(false);
+				scene->findSystem<BenchmarkQuerySystem>()->setQuery(query, count);
+			};
+		};
+
+		std::vector<FrameBenchmarkSystem::Phase> phases{};
+		phases.push_back({"dynamic updates", [](lune::Scene* scene)
+			{ scene->findSystem<BenchmarkMoverSystem>()->setEnabled(true); }, dynamicCount});
+		phases.push_back({"box queries", queryPhase(BenchmarkQuerySystem::Query::Box, PointQueries), PointQueries});
+		phases.push_back({"sphere queries", queryPhase(BenchmarkQuerySystem::Query::Sphere, PointQueries), PointQueries});
+		phases.push_back({"raycasts", queryPhase(BenchmarkQuerySystem::Query::Ray, PointQueries), PointQueries});
+		phases.push_back({"frustum queries", queryPhase(BenchmarkQuerySystem::Query::Frustum, WideQueries), WideQueries});
+		phases.push_back({"linear box queries", queryPhase(BenchmarkQuerySystem::Query::LinearBox, WideQueries), WideQueries});
+		registerSystem<FrameBenchmarkSystem>("spatial index", std::move(phases));
+	}
+};
+
+// casts same rays against triangles of loaded meshes every frame, once index has seen them
+// rays from sphere around everything indexed towards random points inside its bounds
+class BenchmarkRaycastSystem : public lune::SystemBase
+{
+public:
+	explicit BenchmarkRaycastSystem(uint32 rayCount)
+		: mRayCount(rayCount)
+	{
+		addDependecy<lune::SpatialIndexSystem>();
+	}
+
+	void setUseJobs(bool useJobs) { mUseJobs = useJobs; }
+
+	virtual void update(lune::Scene* scene, double deltaTime) override
+	{
+		auto spatialIndex = scene->findSystem<lune::SpatialIndexSystem>();
+		if (spatialIndex->getEntityCount() == 0)
+			return;
+
+		if (mRays.empty())
+			generateRays(spatialIndex->getBounds());
+
+		auto jobs = mUseJobs ? lune::Engine::get()->findSubsystem<lune::JobSubsystem>() : nullptr;
+		spatialIndex->raycastMeshesBatch(mRays, mHits, jobs);
+	}
+
+private:
+	void generateRays(const lune::BoundingBox& bounds)
+	{
+		std::mt19937 random{};
+		std::normal_distribution<float> normal{};
+		std::uniform_real_distribution<float> unit(0.f, 1.f);
+
+		const lnm::vec3 center = bounds.getCenter();
+		const float radius = lnm::length(bounds.getExtent()) * 1.5f;
+
+		mRays.resize(mRayCount);
+		mHits.resize(mRayCount);
+		for (lune::Ray& ray : mRays)
+		{
+			const lnm::vec3 onSphere = lnm::normalize(lnm::vec3(normal(random), normal(random), normal(random)));
+			const lnm::vec3 target = bounds.min + (bounds.max - bounds.min) * lnm::vec3(unit(random), unit(random), unit(random));
+			ray.origin = center + onSphere * radius;
+			ray.direction = target - ray.origin;
+			ray.maxDistance = 2.f;
+		}
+	}
+
+	uint32 mRayCount{};
+	bool mUseJobs{};
+
+	std::vector<lune::Ray> mRays{};
+	std::vector<lune::MeshRayHit> mHits{};
+};
+
+// rays against triangle hierarchies of model loaded into it, on calling thread only and spread over job threads
+class RaycastBenchmarkScene : public lune::Scene
+{
+public:
+	explicit RaycastBenchmarkScene(uint32 rayCount)
+	{
+		addEntity<BenchmarkCameraEntity>();
+
+		registerSystem<lune::CameraSystem>();
+		registerSystem<lune::SpatialIndexSystem>();
+		registerSystem<BenchmarkRaycastSystem>(rayCount);
+
+		std::vector<FrameBenchmarkSystem::Phase> phases{};
+		phases.push_back({"single thread", [](lune::Scene* scene)
+			{ scene->findSystem<BenchmarkRaycastSystem>()->setUseJobs(false); }, rayCount});
+		phases.push_back({"job threads", [](lune::Scene* scene)
+			{ scene->findSystem<BenchmarkRaycastSystem>()->setUseJobs(true); }, rayCount});
+		registerSystem<FrameBenchmarkSystem>("raycast", std::move(phases));
+	}
+};
+
+std::string benchmark::findBenchmarkName(const std::vector<std::string>& args)
+{
+	constexpr std::string_view prefix = "--benchmark=";
+	for (const auto& arg : args)
+	{
+		if (arg.starts_with(prefix))
+			return arg.substr(prefix.size());
+	}
+	return std::string();
+}
+
+uint32 benchmark::findArgValue(const std::vector<std::string>& args, std::string_view name, uint32 fallback)
+{
+	const std::string prefix = std::format("--{}=", name);
+	for (const auto& arg : args)
+	{
+		if (arg.starts_with(prefix))
+			return static_cast<uint32>(std::stoul(arg.substr(prefix.size())));
+	}
+	return fallback;
+}
+
+bool benchmark::addBenchmarkScene(lune::Engine& engine, std::string_view name, const std::vector<std::string>& args)
+{
+	if (name == "sprites")
+	{
+		const uint32 spriteCount = findArgValue(args, "sprites", 100000);
+		LN_LOG(Info, Benchmark, "Sprites benchmark with {} sprites", spriteCount);
+		engine.addScene(std::make_unique<SpriteBenchmarkScene>(spriteCount));
+		return true;
+	}
+
+	if (name == "spatial")
+	{
+		const uint32 staticCount = findArgValue(args, "static", 1000000);
+		const uint32 dynamicCount = findArgValue(args, "dynamic", 10000);
+		LN_LOG(Info, Benchmark, "Spatial index benchmark with {} static and {} dynamic objects", staticCount, dynamicCount);
+		engine.addScene(std::make_unique<SpatialIndexBenchmarkScene>(staticCount, dynamicCount));
+		return true;
+	}
+
+	if (name == "raycast")
+	{
+		const uint32 rayCount = findArgValue(args, "rays", 100000);
+		LN_LOG(Info, Benchmark, "Raycast benchmark with {} rays against mi-24d", rayCount);
+		auto scene = engine.addScene(std::make_unique<RaycastBenchmarkScene>(rayCount));
+
+		lune::gltf::LoadOptions options{};
+		options.buildTriangleBvh = true;
+		lune::gltf::loadInScene(*lune::EngineAssetPath("mi-24d/scene.gltf"), "mi-24d", scene, options);
+		return true;
+	}
+
+	LN_LOG(Error, Benchmark, "Unknown benchmark \'{}\'", name);
+	return false;
+}
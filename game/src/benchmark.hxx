@@ -0,0 +1,25 @@
+#pragma once
+
+#include "lune/lune.hxx"
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace lune
+{
+	class Engine;
+} // namespace lune
+
+namespace benchmark
+{
+	// value of --benchmark=<name> argument, empty if not given
+	std::string findBenchmarkName(const std::vector<std::string>& args);
+
+	// value of --<name>=<number> argument, fallback if not given
+	uint32 findArgValue(const std::vector<std::string>& args, std::string_view name, uint32 fallback);
+
+	// adds scene of benchmark to engine, engine stopped once benchmark done and results logged
+	// false if there is no benchmark with such name
+	bool addBenchmarkScene(lune::Engine& engine, std::string_view name, const std::vector<std::string>& args);
+} // namespace benchmark
@@ -1,9 +1,12 @@
+#include "benchmark.hxx"
 #include "lune/core/assets.hxx"
 #include "lune/core/engine.hxx"
 #include "lune/core/gltf.hxx"
 #include "lune/game_framework/components/camera.hxx"
 #include "lune/game_framework/components/input.hxx"
+#include "lune/game_framework/components/mesh.hxx"
 #include "lune/game_framework/components/move.hxx"
+#include "lune/game_framework/components/occluder.hxx"
 #include "lune/game_framework/components/rotate.hxx"
 #include "lune/game_framework/components/skybox.hxx"
 #include "lune/game_framework/components/sprite.hxx"
@@ -14,9 +17,14 @@
 #include "lune/game_framework/systems/mesh_render_system.hxx"
 #include "lune/game_framework/systems/move_system.hxx"
 #include "lune/game_framework/systems/skybox_system.hxx"
+#include "lune/game_framework/systems/spatial_index_system.hxx"
 #include "lune/game_framework/systems/sprite_render_system.hxx"
 #include "lune/lune.hxx"
+#include "lune/vulkan/texture_streamer.hxx"
+#include "lune/vulkan/upload_scheduler.hxx"
+#include "lune/vulkan/vulkan_subsystem.hxx"
 
+#include <cmath>
 #include <imgui.h>
 #include <iostream>
 #include <string>
@@ -28,6 +36,110 @@ class DebugSystem : public lune::SystemBase,
 public:
 	virtual void imGuiRender(lune::Scene* scene) override
 	{
+		if (ImGui::GetCurrentContext())
+		{
+			// budgets are cheap, detailed statistics walk every allocation so they are refreshed only now and then
+			auto vulkanSubsystem = ln::Engine::get()->findSubsystem<lune::VulkanSubsystem>();
+			if (mMemStatsAge++ % MemStatsInterval == 0)
+				mMemStats = vulkanSubsystem->getMemoryStatistics();
+
+			ImGui::Begin("gpu memory");
+			for (const vma::HeapBudget& heap : vulkanSubsystem->getMemoryBudgets())
+			{
+				if (!heap.blockBytes)
+					continue;
+
+				ImGui::Text("heap %u%s: %u allocations, used %.2f / %.2f MiB, budget %.2f / %.2f MiB", heap.heapIndex, heap.deviceLocal ? " (device local)" : "", heap.allocationCount,
+					heap.allocationBytes / (1024.0 * 1024.0), heap.blockBytes / (1024.0 * 1024.0), heap.usage / (1024.0 * 1024.0), heap.budget / (1024.0 * 1024.0));
+			}
+			for (const vma::HeapStatistics& heap : mMemStats.heaps)
+			{
+				if (heap.blockCount)
+					ImGui::Text("heap %u: %u blocks, fragmentation %.3f", heap.heapIndex, heap.blockCount, heap.fragmentation);
+			}
+			for (const auto& pool : mMemStats.smallBufferPools)
+				ImGui::Text("pool <= %llu B: %u allocs in %u blocks", static_cast<unsigned long long>(pool.sizeClass), pool.allocationCount, pool.blockCount);
+			ImGui::End();
+
+			const lune::vulkan::TextureStreamerStats& streamStats = lune::getVulkanTextureStreamer().getStats();
+			ImGui::Begin("texture streaming");
+			ImGui::Text("textures: %u, waiting for mips: %u", streamStats.textureCount, streamStats.pendingCount);
+			ImGui::Text("resident: %.2f / %.2f MiB wanted", streamStats.residentBytes / (1024.0 * 1024.0), streamStats.wantedBytes / (1024.0 * 1024.0));
+			ImGui::Text("device local: %.2f / %.2f MiB limit", streamStats.usageBytes / (1024.0 * 1024.0), streamStats.limitBytes / (1024.0 * 1024.0));
+			ImGui::Text("upgrades: %u, evictions: %u, uploaded %.2f MiB", streamStats.upgradeCount, streamStats.evictionCount, streamStats.uploadedBytes / (1024.0 * 1024.0));
+			ImGui::End();
+
+			const lune::vulkan::UploadSchedulerStats& uploadStats = lune::getVulkanUploadScheduler().getStats();
+			ImGui::Begin("uploads");
+			ImGui::Text("queued: %u jobs, %.2f MiB, oldest %.1f ms", uploadStats.queuedCount, uploadStats.queuedBytes / (1024.0 * 1024.0), uploadStats.oldestWaitMs);
+			ImGui::Text("drained: %u jobs, %.2f MiB in %.2f ms", uploadStats.drainedCount, uploadStats.drainedBytes / (1024.0 * 1024.0), uploadStats.drainMs);
+			ImGui::Text("latency: %.1f ms average, %.1f ms max", uploadStats.averageLatencyMs, uploadStats.maxLatencyMs);
+			ImGui::End();
+
+			ImGui::Begin("render queue");
+			for (uint32 viewId : ln::Engine::get()->getViewIds())
+			{
+				const lune::vulkan::RenderQueueStats queueStats = ln::Engine::get()->findSubsystem<lune::VulkanSubsystem>()->getRenderQueueStats(viewId);
+				ImGui::Text("view %u: %u packets", viewId, queueStats.packets);
+				ImGui::Text("binds: %u pipeline, %u descriptor set, %u vertex, %u index", queueStats.pipelineBinds, queueStats.descriptorSetBinds, queueStats.vertexBufferBinds, queueStats.indexBufferBinds);
+				ImGui::Text("indirect draws: %u", queueStats.indirectDraws);
+				ImGui::Text("pass breaks: %u", queueStats.passBreaks);
+				ImGui::Text("binds saved: %u", queueStats.bindsSaved);
+			}
+			ImGui::End();
+
+			if (auto meshSystem = scene->findSystem<lune::MeshRenderSystem>())
+			{
+				ImGui::Begin("culling");
+				bool culling = meshSystem->getCulling();
+				if (ImGui::Checkbox("frustum culling", &culling))
+					meshSystem->setCulling(culling);
+				ImGui::Text("visible: %u / %u primitives", meshSystem->getVisibleCount(), meshSystem->getObjectCount());
+				bool gpuDriven = meshSystem->getGpuDriven();
+				if (ImGui::Checkbox("gpu driven", &gpuDriven))
+					meshSystem->setGpuDriven(gpuDriven);
+				ImGui::Text("indirect draw groups: %u", meshSystem->getDrawGroupCount());
+				bool occlusionCulling = meshSystem->getOcclusionCulling();
+				if (ImGui::Checkbox("occlusion culling", &occlusionCulling))
+					meshSystem->setOcclusionCulling(occlusionCulling);
+				const auto& cullStats = meshSystem->getCullStats();
+				ImGui::Text("gpu frustum culled: %u", cullStats.frustumCulled);
+				ImGui::Text("gpu occlusion culled: %u", cullStats.occlusionCulled);
+				ImGui::Text("gpu drawn early: %u, late: %u", cullStats.earlyDrawn, cullStats.lateDrawn);
+				bool softwareOcclusion = meshSystem->getSoftwareOcclusion();
+				if (ImGui::Checkbox("software occlusion", &softwareOcclusion))
+					meshSystem->setSoftwareOcclusion(softwareOcclusion);
+				const lune::OcclusionBuffer& occlusionBuffer = meshSystem->getOcclusionBuffer();
+				ImGui::Text("occluder triangles: %u / %u", occlusionBuffer.getRasterizedCount(), occlusionBuffer.getTriangleCount());
+				ImGui::Text("software occluded: %u", meshSystem->getSoftwareOccludedCount());
+				ImGui::End();
+
+				if (softwareOcclusion)
+					drawOcclusionBuffer(occlusionBuffer);
+			}
+
+			if (auto spatialIndex = scene->findSystem<lune::SpatialIndexSystem>())
+			{
+				ImGui::Begin("spatial index");
+				ImGui::Text("entities: %u, tree height: %u", spatialIndex->getEntityCount(), spatialIndex->getTreeHeight());
+				ImGui::Text("refit: %u, reinserted: %u", spatialIndex->getRefitCount(), spatialIndex->getReinsertCount());
+
+				// triangle under center of view
+				for (uint64 eId : scene->getComponentEntities<lune::PerspectiveCameraComponent>())
+				{
+					auto cameraTransform = scene->findEntity(eId)->findComponent<lune::TransformComponent>();
+					const lune::Ray ray{cameraTransform->mPosition, cameraTransform->mOrientation * lune::forwardAxis, 1000.f};
+					lune::MeshRayHit hit{};
+					if (spatialIndex->raycastMeshes(ray, hit))
+						ImGui::Text("looking at entity %llu, primitive %u, triangle %u, %.2f away", static_cast<unsigned long long>(hit.entity), hit.primitive, hit.triangle.triangle, hit.triangle.distance);
+					else
+						ImGui::Text("looking at nothing");
+					break;
+				}
+				ImGui::End();
+			}
+		}
+
 		auto eIds = scene->getComponentEntities<lune::SpriteComponent>();
 		for (auto eId : eIds)
 		{
@@ -43,11 +155,48 @@ public:
 				ImGui::InputFloat3("euler", &e.x);
 				ImGui::End();
 
-				transformComp->mOrientation = lnm::normalize(transformComp->mOrientation);
+				transformComp->setOrientation(lnm::normalize(transformComp->mOrientation));
 				return;
 			}
 		}
 	}
+
+private:
+	// runs of same depth in each row drawn as rects, tiles hold two depths at most so runs stay long
+	void drawOcclusionBuffer(const lune::OcclusionBuffer& occlusionBuffer)
+	{
+		occlusionBuffer.resolveDepth(mOcclusionDepth);
+		const uint32 width = occlusionBuffer.getWidth();
+		const uint32 height = occlusionBuffer.getHeight();
+		if (mOcclusionDepth.empty())
+			return;
+
+		ImGui::Begin("software occlusion buffer");
+		const ImVec2 origin = ImGui::GetCursorScreenPos();
+		ImDrawList* drawList = ImGui::GetWindowDrawList();
+		for (uint32 y = 0; y < height; ++y)
+		{
+			const float* row = mOcclusionDepth.data() + y * width;
+			for (uint32 begin = 0, end = 1; begin < width; begin = end++)
+			{
+				while (end < width && row[end] == row[begin])
+					++end;
+
+				// depth crowds near 1, root spreads it for display
+				const float shade = row[begin] >= 1.f ? 0.f : std::pow(1.f - (row[begin] * 0.5f + 0.5f), 0.25f);
+				const ImU32 color = ImGui::GetColorU32(ImVec4(shade, shade, shade, 1.f));
+				drawList->AddRectFilled(ImVec2(origin.x + begin, origin.y + y), ImVec2(origin.x + end, origin.y + y + 1), color);
+			}
+		}
+		ImGui::Dummy(ImVec2(static_cast<float>(width), static_cast<float>(height)));
+		ImGui::End();
+	}
+
+	std::vector<float> mOcclusionDepth{};
+
+	static constexpr uint32 MemStatsInterval = 60;
+	uint32 mMemStatsAge{};
+	vma::Statistics mMemStats{};
 };
 
 class CameraEntity : public lune::EntityBase
@@ -152,6 +301,7 @@ public:
 		registerSystem<lune::GizmoSystem>();
 		registerSystem<lune::MeshRenderSystem>();
 		registerSystem<lune::SkyboxSystem>();
+		registerSystem<lune::SpatialIndexSystem>();
 
 		auto inputSystem = registerSystem<lune::InputSystem>();
 		inputSystem->setWindowId(ln::Engine::get()->getViewWindowId(0));
@@ -163,6 +313,8 @@ public:
 int main(int argc, char** argv)
 {
 	std::vector<std::string> args(argv, argv + argc);
+	const std::string benchmarkName = benchmark::findBenchmarkName(args);
+	const std::vector<std::string> benchmarkArgs = args;
 
 	ln::getApplicationName() = "game";
 	ln::getApplicationVersion() = ln::makeVersion(1, 0, 0);
@@ -174,10 +326,28 @@ int main(int argc, char** argv)
 	uint32 viewId = engine.createWindow("so8", 800, 800);
 	//engine.createWindow("so8 - 2", 800, 800);
 
+	if (!benchmarkName.empty())
+	{
+		if (benchmark::addBenchmarkScene(engine, benchmarkName, benchmarkArgs))
+			engine.run();
+
+		engine.shutdown();
+		return 0;
+	}
+
 	auto scene = engine.addScene(std::make_unique<GameScene>());
 
 	lune::gltf::loadInScene(*lune::EngineAssetPath("viking_room/scene.gltf"), "viking_room", scene);
-	lune::gltf::loadInScene(*lune::EngineAssetPath("mi-24d/scene.gltf"), "mi-24d", scene);
+
+	// room walls hide whatever stands behind them
+	for (uint64 eId : scene->getComponentEntities<lune::MeshComponent>())
+		scene->findEntity(eId)->addComponent<lune::OccluderComponent>();
+
+	lune::gltf::LoadOptions heliOptions{};
+	heliOptions.buildTriangleBvh = true;
+	heliOptions.streamTextures = true;
+	// shows up once read on job threads, room visible meanwhile
+	lune::gltf::loadInSceneAsync(*lune::EngineAssetPath("mi-24d/scene.gltf"), "mi-24d", scene, heliOptions);
 
 	engine.run();
 